@@ -1,15 +1,62 @@
 #include "CLIClient.h"
+#include "TopologyBuilder.h"
+#include "common/CallbackDataReaderListenerImpl.h"
+#include "common/Metrics.h"
 #include "common/QosHelper.h"
 #include "common/Utils.h"
 
 #include <dds/DCPS/PublisherImpl.h>
 #include <dds/DCPS/SubscriberImpl.h>
 #include <dds/DCPS/Marked_Default_Qos.h>
+#include <dds/DCPS/TimeDuration.h>
 #include <dds/DCPS/WaitSet.h>
 
+#include <atomic>
 #include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <thread>
 #include <iomanip>
+#include <sstream>
+
+namespace {
+
+// A string as a JSON string literal
+std::string json_string(const std::string& s)
+{
+  std::string json = "\"";
+  json.reserve(s.size() + 2);
+  for (const char c : s) {
+    switch (c) {
+    case '"':
+      json += "\\\"";
+      break;
+    case '\\':
+      json += "\\\\";
+      break;
+    case '\n':
+      json += "\\n";
+      break;
+    case '\t':
+      json += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escape[8];
+        std::snprintf(escape, sizeof escape, "\\u%04x", c);
+        json += escape;
+      } else {
+        json += c;
+      }
+    }
+  }
+  return json + "\"";
+}
+
+}
 
 CLIClient::CLIClient(const tms::Identity& id)
   : handshaking_(id)
@@ -45,6 +92,47 @@ DDS::ReturnCode_t CLIClient::init_tms(DDS::DomainId_t domain_id, int argc, char*
 
   DDS::DomainParticipant_var dp = handshaking_.get_domain_participant();
 
+  // Follow the active controllers and energy levels of the devices for watch
+  const DDS::SubscriberQos tms_sub_qos = Qos::Subscriber::get_qos();
+  DDS::Subscriber_var tms_sub = dp->create_subscriber(tms_sub_qos,
+                                                      nullptr,
+                                                      ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!tms_sub) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::init: create_subscriber with TMS QoS failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  rc = subscribe<tms::ActiveMicrogridControllerState>(tms_sub, tms::topic::TOPIC_ACTIVE_MICROGRID_CONTROLLER_STATE,
+    [this](const tms::ActiveMicrogridControllerState& amcs, const DDS::SampleInfo& si) {
+      if (si.valid_data) {
+        dashboard_.active_controller(amcs.deviceId(), amcs.masterId());
+      }
+    });
+  if (rc != DDS::RETCODE_OK) {
+    return rc;
+  }
+
+  rc = subscribe<tms::EnergyStartStopRequest>(tms_sub, tms::topic::TOPIC_ENERGY_START_STOP_REQUEST,
+    [this](const tms::EnergyStartStopRequest& essr, const DDS::SampleInfo& si) {
+      if (si.valid_data) {
+        dashboard_.level_requested(essr.requestId().targetDeviceId(), essr.sequenceId(), essr.toLevel());
+      }
+    });
+  if (rc != DDS::RETCODE_OK) {
+    return rc;
+  }
+
+  rc = subscribe<tms::Reply>(tms_sub, tms::topic::TOPIC_REPLY,
+    [this](const tms::Reply& reply, const DDS::SampleInfo& si) {
+      if (si.valid_data) {
+        dashboard_.level_replied(reply.targetDeviceId(), reply.requestSequenceId(),
+                                 reply.status().code() == tms::ReplyCode::REPLY_OK);
+      }
+    });
+  if (rc != DDS::RETCODE_OK) {
+    return rc;
+  }
+
   // Publish to the tms::OperatorIntentRequest topic
   tms::OperatorIntentRequestTypeSupport_var oir_ts = new tms::OperatorIntentRequestTypeSupportImpl;
   if (DDS::RETCODE_OK != oir_ts->register_type(dp, "")) {
@@ -94,6 +182,44 @@ DDS::ReturnCode_t CLIClient::init_tms(DDS::DomainId_t domain_id, int argc, char*
   return DDS::RETCODE_OK;
 }
 
+template <typename Sample>
+DDS::ReturnCode_t CLIClient::subscribe(DDS::Subscriber_ptr sub, const std::string& topic_name,
+                                       std::function<void(const Sample&, const DDS::SampleInfo&)> callback)
+{
+  using TypeSupportImpl = typename OpenDDS::DCPS::DDSTraits<Sample>::TypeSupportImplType;
+  DDS::DomainParticipant_var dp = handshaking_.get_domain_participant();
+  typename TypeSupportImpl::_var_type ts = new TypeSupportImpl;
+  if (DDS::RETCODE_OK != ts->register_type(dp, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::subscribe: register_type for topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  CORBA::String_var type_name = ts->get_type_name();
+  DDS::Topic_var topic = dp->create_topic(topic_name.c_str(),
+                                          type_name,
+                                          TOPIC_QOS_DEFAULT,
+                                          nullptr,
+                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::subscribe: create_topic \"%C\" failed\n", topic_name.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  const DDS::DataReaderQos& qos = Qos::DataReader::fn_map.at(topic_name)(handshaking_.get_device_id());
+  DDS::DataReaderListener_var listener(new CallbackDataReaderListenerImpl<Sample>(topic_name, callback));
+  DDS::DataReader_var dr = sub->create_datareader(topic,
+                                                  qos,
+                                                  listener,
+                                                  ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!dr) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::subscribe: create_datareader for topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+  return DDS::RETCODE_OK;
+}
+
 DDS::ReturnCode_t CLIClient::init_sim(DDS::DomainId_t sim_domain_id)
 {
   DDS::DomainParticipantFactory_var dpf = handshaking_.get_participant_factory();
@@ -238,6 +364,18 @@ DDS::ReturnCode_t CLIClient::init_sim(DDS::DomainId_t sim_domain_id)
     return DDS::RETCODE_ERROR;
   }
 
+  // Wait for the replies of all controllers on the same condition
+  pdrep_rc_ = pdrep_dr_->create_readcondition(DDS::NOT_READ_SAMPLE_STATE,
+                                              DDS::ANY_VIEW_STATE,
+                                              DDS::ANY_INSTANCE_STATE);
+  if (!pdrep_rc_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::init: create_readcondition for topic \"%C\" failed\n",
+               cli::TOPIC_POWER_DEVICES_REPLY.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+  pdrep_ws_ = new DDS::WaitSet;
+  pdrep_ws_->attach_condition(pdrep_rc_);
+
   // Publish to the powersim::PowerTopology topic
   powersim::PowerTopologyTypeSupport_var pt_ts = new powersim::PowerTopologyTypeSupportImpl;
   if (DDS::RETCODE_OK != pt_ts->register_type(sim_participant_, "")) {
@@ -278,23 +416,32 @@ DDS::ReturnCode_t CLIClient::init_sim(DDS::DomainId_t sim_domain_id)
 
 bool CLIClient::cli_stopped() const
 {
-  std::lock_guard<std::mutex> guard(cli_m_);
+  SimpleGuard guard(cli_m_);
   return stop_cli_;
 }
 
 void CLIClient::display_commands() const
 {
   const char* msg = R"(=== Command-Line Interface for Microgrid Controller (MC) ===
-list-mc          : list the connected MCs.
+list-mc          : list the connected MCs and how fast they replied to the last request for power devices.
 list-pd          : list the power devices reported by the connected MCs.
 connect-pd       : connect power devices to simulate the power topology of a microgrid.
+import  <file>   : connect power devices from an edge list file, replacing the power topology.
+grid <shape> [n] : connect the power devices in a radial, ring or mesh grid, or n simulated ones.
+energized        : list the loads and the sources that energize them.
+path <pd> <pd>   : print the path of operational power devices from one power device to another.
+watch   [rows]   : show the devices as their state changes, until Enter is pressed.
 start   <pd_id>  : start a power device with the given Id.
 stop    <pd_id>  : stop a power device with the given Id.
 suspend <mc_id>  : suspend the heartbeats of the given MC (simulating an MC becomming unavailable).
 resume  <mc_id>  : resume the heartbeats of the given MC (simulating an MC becomming available).
 term    <mc_id>  : terminate the given MC's process.
+locks   [mc_id]  : print the lock statistics of this CLI, or have the given MC log its lock statistics.
+spof    <mc_id>  : have the given MC log the power devices whose loss would leave loads unserved.
+wait    <secs>   : do nothing for the given number of seconds.
+wait-mc [n] [s]  : wait up to s seconds (10 by default) for n MCs (1 by default) to be available.
 show             : display this list of CLI commands.)";
-  std::cout << msg << std::endl;
+  out() << msg << std::endl;
 }
 
 void CLIClient::run_cli()
@@ -310,31 +457,257 @@ void CLIClient::run_cli()
     tolower(op_pair.first);
     const std::string& op = op_pair.first;
 
-    if (op == "list-mc") {
-      display_controllers();
-    } else if (op == "list-pd") {
-      list_power_devices();
-    } else if (op == "connect-pd") {
+    // Not while execute redirects the output of the commands
+    SimpleGuard guard(execute_m_);
+    if (op == "connect-pd") {
       connect_power_devices();
-    } else if (op == "start") {
-      send_start_device_cmd(op_pair);
-    } else if (op == "stop") {
-      send_stop_device_cmd(op_pair);
-    } else if (op == "suspend") {
-      send_suspend_controller_cmd(op_pair);
-    } else if (op == "resume") {
-      send_resume_controller_cmd(op_pair);
-    } else if (op == "term") {
-      send_terminate_controller_cmd(op_pair);
-    } else if (op == "show") {
-      display_commands();
-    } else {
+    } else if (op == "watch") {
+      watch(op_pair);
+    } else if (!dispatch(op_pair)) {
       std::cout << "Unknown operation entered!" << std::endl;
     }
     std::cout << '\n' << prompt;
   }
 }
 
+// Run a command other than connect-pd, which prompts for input.
+// Returns false if the operation is unknown.
+bool CLIClient::dispatch(const OpArgPair& op_pair)
+{
+  const std::string& op = op_pair.first;
+  if (op == "list-mc") {
+    display_controllers();
+  } else if (op == "list-pd") {
+    list_power_devices();
+  } else if (op == "import") {
+    import_power_topology(op_pair);
+  } else if (op == "grid") {
+    generate_power_topology(op_pair);
+  } else if (op == "energized") {
+    display_energization();
+  } else if (op == "path") {
+    display_path(op_pair);
+  } else if (op == "start") {
+    send_start_device_cmd(op_pair);
+  } else if (op == "stop") {
+    send_stop_device_cmd(op_pair);
+  } else if (op == "suspend") {
+    send_suspend_controller_cmd(op_pair);
+  } else if (op == "resume") {
+    send_resume_controller_cmd(op_pair);
+  } else if (op == "term") {
+    send_terminate_controller_cmd(op_pair);
+  } else if (op == "locks") {
+    dump_lock_stats(op_pair);
+  } else if (op == "spof") {
+    dump_contingencies(op_pair);
+  } else if (op == "wait") {
+    wait(op_pair);
+  } else if (op == "wait-mc") {
+    wait_for_controllers(op_pair);
+  } else if (op == "show") {
+    display_commands();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+CLIClient::CommandResult CLIClient::execute(const std::string& line)
+{
+  SimpleGuard guard(execute_m_);
+  CommandResult result;
+  std::ostringstream out, err;
+  out_ = &out;
+  err_ = &err;
+  data_ = &result.data;
+
+  const TimePoint start = Clock::now();
+  auto op_pair = parse(line);
+  tolower(op_pair.first);
+  bool known = false;
+  if (op_pair.first == "connect-pd") {
+    err << "connect-pd is interactive, use import or grid instead!" << std::endl;
+    known = true;
+  } else {
+    known = dispatch(op_pair);
+  }
+  result.duration = Clock::now() - start;
+
+  out_ = &std::cout;
+  err_ = &std::cerr;
+  data_ = nullptr;
+
+  if (!known) {
+    err << "Unknown operation \"" << op_pair.first << "\"!" << std::endl;
+  }
+  result.output = out.str();
+  result.error = err.str();
+  result.ok = result.error.empty();
+  return result;
+}
+
+// Scripts have a command per line. A line can start with @<seconds> to run
+// the command no earlier than that long after the start of the script. A line
+// whose time can't be parsed fails without running its command.
+size_t CLIClient::run_script(std::istream& script, std::ostream& out, bool json_lines)
+{
+  const TimePoint start = Clock::now();
+  size_t failed = 0;
+  size_t seq = 0;
+  size_t line_number = 0;
+  std::string line;
+  while (!cli_stopped() && std::getline(script, line)) {
+    ++line_number;
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+
+    std::string command = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+    CommandResult result;
+    if (command[0] == '@') {
+      const char* const begin = command.c_str() + 1;
+      char* end = nullptr;
+      const double at = std::strtod(begin, &end);
+      if (end == begin || (*end != '\0' && *end != ' ' && *end != '\t') || !std::isfinite(at) || at < 0) {
+        const std::string time = command.substr(1, command.find_first_of(" \t") - 1);
+        result.error = "Invalid time \"" + time + "\" after @ on line " + std::to_string(line_number) +
+          " of the script!\n";
+        result.ok = false;
+      } else {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(Sec(at)));
+        command = end + std::strspn(end, " \t");
+      }
+    }
+
+    if (result.ok) {
+      result = execute(command);
+    }
+    failed += !result.ok;
+    const double time = Sec(Clock::now() - start).count();
+    if (json_lines) {
+      out << "{\"seq\":" << seq++ << ",\"time\":" << time
+          << ",\"command\":" << json_string(command)
+          << ",\"ok\":" << (result.ok ? "true" : "false")
+          << ",\"duration_ms\":" << result.duration.count() * 1e3
+          << ",\"output\":" << json_string(result.output);
+      if (!result.ok) {
+        out << ",\"error\":" << json_string(result.error);
+      }
+      if (!result.data.empty()) {
+        out << ",\"data\":" << result.data;
+      }
+      out << "}\n";
+    } else {
+      out << "> " << command << '\n' << result.output << result.error;
+    }
+  }
+  out.flush();
+  return failed;
+}
+
+int CLIClient::run(const std::string& script_path, bool json_lines)
+{
+  std::ifstream script(script_path);
+  if (!script) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::run: can't open script \"%C\"\n", script_path.c_str()));
+    return 1;
+  }
+
+  size_t failed = 0;
+  std::thread thr([&]() {
+    failed = run_script(script, std::cout, json_lines);
+    reactor_->end_reactor_event_loop();
+  });
+  reactor_->run_reactor_event_loop();
+  thr.join();
+  return failed == 0 ? 0 : 1;
+}
+
+// Redraw the changes to the devices at up to watch_fps frames per second until
+// the user presses Enter. The state comes from the samples the CLI receives,
+// so watching doesn't send requests to the controllers.
+void CLIClient::watch(const OpArgPair& op_pair)
+{
+  size_t rows = default_watch_rows;
+  if (op_pair.second) {
+    std::istringstream args(*op_pair.second);
+    if (!(args >> rows) || rows == 0) {
+      std::cerr << "Invalid number of rows!" << std::endl;
+      return;
+    }
+  }
+
+  dashboard_.reset(rows);
+  std::atomic<bool> stop(false);
+  std::thread drawer([&]() {
+    const auto frame = std::chrono::duration_cast<Clock::duration>(Sec(1.0 / watch_fps));
+    while (!stop) {
+      const TimePoint start = Clock::now();
+      dashboard_.render(std::cout, start);
+      std::this_thread::sleep_until(start + frame);
+    }
+  });
+
+  std::string line;
+  std::getline(std::cin, line);
+  stop = true;
+  drawer.join();
+}
+
+void CLIClient::wait(const OpArgPair& op_pair)
+{
+  char* end = nullptr;
+  const std::string arg = op_pair.second.value_or("");
+  const double seconds = std::strtod(arg.c_str(), &end);
+  if (arg.empty() || *end != '\0' || !(seconds >= 0)) {
+    err() << "The time to wait must be a number of seconds!" << std::endl;
+    return;
+  }
+  std::this_thread::sleep_for(Sec(seconds));
+}
+
+void CLIClient::wait_for_controllers(const OpArgPair& op_pair)
+{
+  std::istringstream args(op_pair.second.value_or(""));
+  size_t count = 1;
+  double timeout = 10;
+  // Both arguments are optional
+  if (!(args >> std::ws).eof() && !(args >> count)) {
+    err() << "Invalid number of microgrid controllers!" << std::endl;
+    return;
+  }
+  if (!(args >> std::ws).eof() && !(args >> timeout)) {
+    err() << "Invalid timeout!" << std::endl;
+    return;
+  }
+
+  const TimePoint deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(Sec(timeout));
+  size_t available = 0;
+  while (true) {
+    {
+      SimpleGuard guard(data_m_);
+      const auto now = Clock::now();
+      available = 0;
+      for (auto it = controllers_.begin(); it != controllers_.end(); ++it) {
+        available += controller_status(now, it->second.last_hb) == ControllerStatus::AVAILABLE;
+      }
+    }
+    if (available >= count || Clock::now() >= deadline) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  if (available < count) {
+    err() << "Only " << available << " of " << count << " microgrid controllers available after "
+          << timeout << " seconds!" << std::endl;
+  } else {
+    out() << available << " microgrid controllers available" << std::endl;
+  }
+}
+
 void CLIClient::run()
 {
   std::thread thr(&CLIClient::run_cli, this);
@@ -370,41 +743,143 @@ OpArgPair CLIClient::parse(const std::string& input) const
   return std::make_pair(op, std::optional<std::string>(arg));
 }
 
-std::string CLIClient::energy_level_to_string(tms::EnergyStartStopLevel essl) const
+// Collect the list of power devices from the available MCs. The requests go to
+// all of them before waiting for any reply, and the replies are merged once
+// they are all in or the timeout has passed.
+bool CLIClient::collect_power_devices()
 {
-  switch (essl) {
-  case tms::EnergyStartStopLevel::ESSL_OPERATIONAL:
-    return "Operational";
-  case tms::EnergyStartStopLevel::ESSL_READY_SYNCED:
-    return "Ready Synced";
-  case tms::EnergyStartStopLevel::ESSL_READY:
-    return "Ready";
-  case tms::EnergyStartStopLevel::ESSL_IDLE:
-    return "Idle";
-  case tms::EnergyStartStopLevel::ESSL_WARM:
-    return "Warm";
-  case tms::EnergyStartStopLevel::ESSL_OFF:
-    return "Off";
-  case tms::EnergyStartStopLevel::ESSL_ANY:
-    return "Any";
-  default:
-    return "Unknown";
+  SimpleGuard collect_guard(collect_m_);
+
+  std::vector<tms::Identity> mc_ids;
+  {
+    SimpleGuard guard(data_m_);
+    const auto now = Clock::now();
+    for (auto it = controllers_.begin(); it != controllers_.end(); ++it) {
+      const auto status = controller_status(now, it->second.last_hb);
+      if (status == ControllerStatus::AVAILABLE) {
+        mc_ids.push_back(it->first);
+      } else {
+        // There may be stale entries that need to be deleted,
+        // so displaying power devices looks clean.
+        mc_to_devices_.erase(it->first);
+      }
+    }
+  }
+  if (mc_ids.empty()) {
+    return true;
   }
-}
 
-// Collect the list of power devices from the available MCs.
-bool CLIClient::collect_power_devices()
-{
+  // Replies carry the seqnum of their request, so late replies to an earlier
+  // request that timed out aren't taken for replies to this one.
+  const uint64_t seqnum = ++pd_req_seqnum_;
+
   bool ret = true;
-  const auto now = Clock::now();
-  for (auto it = controllers_.begin(); it != controllers_.end(); ++it) {
-    const auto status = controller_status(now, it->second.last_hb);
-    if (status == ControllerStatus::AVAILABLE) {
-      ret &= send_power_devices_request(it->first);
-    } else {
-      // There may be stale entries that need to be deleted,
-      // so displaying power devices looks clean.
-      mc_to_devices_.erase(it->first);
+  std::unordered_map<tms::Identity, TimePoint> pending;
+  for (const tms::Identity& mc_id : mc_ids) {
+    cli::PowerDevicesRequest pd_req;
+    pd_req.mc_id(mc_id);
+    pd_req.seqnum(seqnum);
+    const TimePoint sent = Clock::now();
+    const DDS::ReturnCode_t rc = pdreq_dw_->write(pd_req, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::collect_power_devices: "
+                 "write to controller \"%C\" failed: %C\n", mc_id.c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+      ret = false;
+      continue;
+    }
+    pending.insert(std::make_pair(mc_id, sent));
+  }
+
+  struct Reply {
+    cli::PowerDevicesReply reply;
+    DDS::SampleInfo info;
+    Sec time;
+  };
+  std::vector<Reply> replies;
+  replies.reserve(pending.size());
+
+  const TimePoint deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(power_devices_reply_timeout);
+  while (!pending.empty()) {
+    const Sec remaining = deadline - Clock::now();
+    if (remaining.count() <= 0) {
+      break;
+    }
+
+    DDS::ConditionSeq active;
+    DDS::ReturnCode_t rc = pdrep_ws_->wait(active,
+      OpenDDS::DCPS::TimeDuration::from_double(remaining.count()).to_dds_duration());
+    if (rc == DDS::RETCODE_TIMEOUT) {
+      break;
+    } else if (rc != DDS::RETCODE_OK) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::collect_power_devices: "
+                 "WaitSet's wait returned \"%C\"\n", OpenDDS::DCPS::retcode_to_string(rc)));
+      ret = false;
+      break;
+    }
+
+    cli::PowerDevicesReplySeq data;
+    DDS::SampleInfoSeq info_seq;
+    rc = pdrep_dr_->take_w_condition(data, info_seq, DDS::LENGTH_UNLIMITED, pdrep_rc_);
+    if (rc == DDS::RETCODE_NO_DATA) {
+      continue;
+    } else if (rc != DDS::RETCODE_OK) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::collect_power_devices: "
+                 "take data failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+      ret = false;
+      break;
+    }
+
+    const TimePoint received = Clock::now();
+    for (CORBA::ULong i = 0; i < data.length(); ++i) {
+      const auto it = pending.find(data[i].mc_id());
+      if (it == pending.end()) {
+        // Not requested or already replied
+        continue;
+      }
+      if (info_seq[i].valid_data && data[i].seqnum() != seqnum) {
+        // Late reply to an earlier request
+        continue;
+      }
+      replies.push_back(Reply{data[i], info_seq[i], received - it->second});
+      pending.erase(it);
+    }
+  }
+
+  SimpleGuard guard(data_m_);
+  for (const Reply& reply : replies) {
+    const tms::Identity& mc_id = reply.reply.mc_id();
+    if (reply.info.valid_data) {
+      const cli::PowerDeviceInfoSeq& pdi_seq = reply.reply.devices();
+      auto& power_devices = mc_to_devices_[mc_id];
+      for (auto it = pdi_seq.begin(); it != pdi_seq.end(); ++it) {
+        // Add to the existing list of power devices.
+        // This allows power devices to be added gradually in case
+        // the "list-pd" command is issued before all devices have joined.
+        power_devices.insert_or_assign(it->device_info().deviceId(), *it);
+        if (!it->master_id() || it->master_id().value() == mc_id) {
+          dashboard_.energy_level(it->device_info().deviceId(), it->essl());
+        }
+      }
+    } else if (reply.info.instance_state == DDS::NOT_ALIVE_DISPOSED_INSTANCE_STATE) {
+      mc_to_devices_.erase(mc_id);
+    }
+
+    const auto it = controllers_.find(mc_id);
+    if (it != controllers_.end()) {
+      it->second.reply_time = reply.time;
+      it->second.requested = true;
+    }
+  }
+
+  for (auto it = pending.begin(); it != pending.end(); ++it) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::collect_power_devices: "
+               "controller \"%C\" didn't reply within %f seconds\n",
+               it->first.c_str(), power_devices_reply_timeout.count()));
+    const auto it2 = controllers_.find(it->first);
+    if (it2 != controllers_.end()) {
+      it2->second.reply_time.reset();
+      it2->second.requested = true;
     }
   }
   return ret;
@@ -416,40 +891,40 @@ void CLIClient::display_power_devices() const
   for (auto it = mc_to_devices_.begin(); it != mc_to_devices_.end(); ++it) {
     const auto mc_id = it->first;
     const auto power_devices = it->second;
-    std::cout << "Devices connected to Microgrid Controller \"" << mc_id << "\":" << std::endl;
+    out() << "Devices connected to Microgrid Controller \"" << mc_id << "\":" << std::endl;
     for (auto it2 = power_devices.begin(); it2 != power_devices.end(); ++it2) {
       const std::string formated_id = std::string("\"") + it2->first + "\"";
       std::string selected_controller = std::string("\"") + it2->second.master_id().value_or("Undetermined") + "\"";
 
-      std::cout << std::right << std::setfill(' ') << std::setw(3) << i++
+      out() << std::right << std::setfill(' ') << std::setw(3) << i++
         << ". Id: " << std::left << std::setw(15) << formated_id
         << "| Type: " << std::left << std::setw(18) << Utils::device_role_to_string(it2->second.device_info().role())
-        << "| Energy Level: " << std::left << std::setw(15) << energy_level_to_string(it2->second.essl())
+        << "| Energy Level: " << std::left << std::setw(15) << Utils::energy_level_to_string(it2->second.essl())
         << "| Active Controller: " << std::left << selected_controller << std::endl;
+
+      if (data_) {
+        const auto& master_id = it2->second.master_id();
+        *data_ += std::string(data_->empty() ? "[" : ",") + "{\"mc_id\":" + json_string(mc_id) +
+          ",\"id\":" + json_string(it2->first) +
+          ",\"role\":" + json_string(Utils::device_role_to_string(it2->second.device_info().role())) +
+          ",\"energy_level\":" + json_string(Utils::energy_level_to_string(it2->second.essl())) +
+          ",\"active_mc_id\":" + (master_id ? json_string(*master_id) : "null") + "}";
+      }
     }
-    std::cout << std::endl;
+    out() << std::endl;
+  }
+  if (data_) {
+    *data_ += data_->empty() ? "[]" : "]";
   }
 }
 
 void CLIClient::list_power_devices()
 {
-  std::lock_guard<std::mutex> guard(data_m_);
   collect_power_devices();
+  SimpleGuard guard(data_m_);
   display_power_devices();
 }
 
-bool CLIClient::is_single_port_device(tms::DeviceRole role) const
-{
-  switch (role) {
-  case tms::DeviceRole::ROLE_SOURCE:
-  case tms::DeviceRole::ROLE_LOAD:
-  case tms::DeviceRole::ROLE_STORAGE:
-    return true;
-  default:
-    return false;
-  }
-}
-
 bool CLIClient::can_connect(const tms::Identity& id1, tms::DeviceRole role1,
                             const tms::Identity& id2, tms::DeviceRole role2) const
 {
@@ -457,25 +932,15 @@ bool CLIClient::can_connect(const tms::Identity& id1, tms::DeviceRole role1,
     return false;
   }
 
-  std::lock_guard<std::mutex> guard(data_m_);
-  const bool dev1_is_not_connected = power_connections_.count(id1) == 0 || power_connections_.at(id1).empty();
-  const bool dev2_is_not_connected = power_connections_.count(id2) == 0 || power_connections_.at(id2).empty();
-
-  if (dev1_is_not_connected || !is_single_port_device(role1)) {
-    if (dev2_is_not_connected) {
-      return true;
-    }
-    return !is_single_port_device(role2);
-  }
-  return false;
+  SimpleGuard guard(data_m_);
+  return TopologyBuilder::can_connect(power_connections_, id1, role1, id2, role2);
 }
 
 void CLIClient::connect(const tms::Identity& id1, tms::DeviceRole role1,
                         const tms::Identity& id2, tms::DeviceRole role2)
 {
-  std::lock_guard<std::mutex> guard(data_m_);
-  power_connections_[id1].insert(powersim::ConnectedDevice{id2, role2});
-  power_connections_[id2].insert(powersim::ConnectedDevice{id1, role1});
+  SimpleGuard guard(data_m_);
+  power_connections_.add_connection(id1, role1, id2, role2);
 }
 
 // Gather information for all power devices in the microgrid from all MCs.
@@ -484,12 +949,9 @@ void CLIClient::connect(const tms::Identity& id1, tms::DeviceRole role1,
 // This is necessary when simulating network partition is supported, e.g., MC 1
 // has connections to a subset of devices and MC 2 has connections to the remaining devices.
 // When there is no network partition, all MCs should have the same set of devices.
+// Caller must already hold data_m_ lock.
 void CLIClient::consolidate_power_devices()
 {
-  if (mc_to_devices_.empty()) {
-    collect_power_devices();
-  }
-
   for (auto it = mc_to_devices_.begin(); it != mc_to_devices_.end(); ++it) {
     const PowerDevices& pds = it->second;
     power_devices_.insert(pds.begin(), pds.end());
@@ -505,8 +967,16 @@ void CLIClient::connect_power_devices()
   // so that the CLI can continue processing heartbeats from MCs and
   // does not incorrectly report available MCs as unavailable.
   PowerDevices local_pds;
+  bool collect = false;
   {
-    std::lock_guard<std::mutex> guard(data_m_);
+    SimpleGuard guard(data_m_);
+    collect = power_devices_.empty() && mc_to_devices_.empty();
+  }
+  if (collect) {
+    collect_power_devices();
+  }
+  {
+    SimpleGuard guard(data_m_);
     if (power_devices_.empty()) {
       consolidate_power_devices();
     }
@@ -546,21 +1016,16 @@ void CLIClient::connect_power_devices()
     }
   }
 
-  // Send the power topology to the current controller which then
-  // distributes the power connections to its managed power devices.
-  std::lock_guard<std::mutex> guard(data_m_);
-  powersim::PowerTopology pt;
-  pt.connections().reserve(power_connections_.size());
-  CORBA::ULong i = 0;
-  for (auto it = power_connections_.begin(); it != power_connections_.end(); ++it, ++i) {
-    powersim::PowerConnection pc;
-    pc.pd_id() = it->first;
-    pc.connected_devices().reserve(it->second.size());
-    for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-      pc.connected_devices().push_back(*it2);
-    }
-    pt.connections().push_back(pc);
-  }
+  SimpleGuard guard(data_m_);
+  send_power_topology();
+}
+
+// Send the power topology to the current controller which then
+// distributes the power connections to its managed power devices.
+// Caller must already hold data_m_ lock.
+bool CLIClient::send_power_topology()
+{
+  powersim::PowerTopology pt = TopologyBuilder::to_power_topology(power_connections_.build());
 
   // Forward to the first available controller in the list
   const auto now = Clock::now();
@@ -574,7 +1039,8 @@ void CLIClient::connect_power_devices()
     pt.mc_id() = mc_id;
     DDS::ReturnCode_t rc = pt_dw_->write(pt, DDS::HANDLE_NIL);
     if (rc != DDS::RETCODE_OK) {
-      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::connect_power_devices: "
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::send_power_topology: "
                  "write power topology to controller \"%C\" failed\n", mc_id.c_str()));
     } else {
       sent = true;
@@ -582,125 +1048,262 @@ void CLIClient::connect_power_devices()
   }
 
   if (!sent) {
-    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::connect_power_devices: "
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIClient::send_power_topology: "
                "Failed to setup power topology for the simulation!\n"));
+    err() << "Failed to send the power topology to a microgrid controller!" << std::endl;
   }
+  return sent;
 }
 
-CLIClient::ControllerStatus CLIClient::controller_status(TimePoint now, TimePoint last_heartbeat) const
+// Roles of the power devices reported by the MCs, for building a topology
+// from their ids.
+PowerDevices CLIClient::known_power_devices()
 {
-  return (now - last_heartbeat < unavail_controller_delay) ? ControllerStatus::AVAILABLE : ControllerStatus::UNAVAILABLE;
+  bool collect = false;
+  {
+    SimpleGuard guard(data_m_);
+    collect = power_devices_.empty() && mc_to_devices_.empty();
+  }
+  if (collect) {
+    collect_power_devices();
+  }
+
+  SimpleGuard guard(data_m_);
+  consolidate_power_devices();
+  return power_devices_;
 }
 
-void CLIClient::display_controllers() const
+// Replace the power connections with the ones built and send them to the
+// controller.
+void CLIClient::set_power_topology(const TopologyBuilder& builder, TimePoint start)
 {
-  std::lock_guard<std::mutex> guard(data_m_);
-  std::cout << "Number of Connected Microgrid Controllers: " << controllers_.size() << std::endl;
-  size_t i = 1;
-  const auto now = Clock::now();
-  for (auto it = controllers_.begin(); it != controllers_.end(); ++it) {
-    std::cout << i++ << ". Controller Id: " << it->first << " (" <<
-      (controller_status(now, it->second.last_hb) == ControllerStatus::AVAILABLE ? "available)" : "unavailable)")
-      << std::endl;
+  SimpleGuard guard(data_m_);
+  power_connections_ = builder.connections();
+  const TopologyGraph graph = power_connections_.build();
+  out() << "Built a power topology of " << graph.size() << " devices and " << builder.added()
+            << " connections in " << std::fixed << std::setprecision(1)
+            << Sec(Clock::now() - start).count() * 1e3 << " ms" << std::defaultfloat;
+  if (builder.rejected()) {
+    out() << ", " << builder.rejected() << " connections rejected";
   }
+  out() << std::endl;
+  send_power_topology();
 }
 
-// Caller must already hold data_m_ lock
-bool CLIClient::send_power_devices_request(const tms::Identity& mc_id)
+void CLIClient::import_power_topology(const OpArgPair& op_pair)
 {
-  cli::PowerDevicesRequest pd_req;
-  pd_req.mc_id(mc_id);
+  if (!op_pair.second.has_value()) {
+    err() << "No topology file specified!" << std::endl;
+    return;
+  }
 
-  DDS::ReturnCode_t rc = pdreq_dw_->write(pd_req, DDS::HANDLE_NIL);
-  if (rc != DDS::RETCODE_OK) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_power_devices_request: "
-               "write to controller \"%C\" failed\n", mc_id.c_str()));
-    return false;
+  const std::string& path = op_pair.second.value();
+  std::ifstream in(path);
+  if (!in) {
+    err() << "Can't open \"" << path << "\"!" << std::endl;
+    return;
   }
 
-  // Wait for the reply
-  DDS::StringSeq params;
-  params.length(1);
-  params[0] = mc_id.c_str();
-  DDS::QueryCondition_var qc = pdrep_dr_->create_querycondition(DDS::NOT_READ_SAMPLE_STATE,
-                                                                DDS::ANY_VIEW_STATE,
-                                                                DDS::ANY_INSTANCE_STATE,
-                                                                "mc_id = %0",
-                                                                params);
-  if (!qc) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_power_devices_request: "
-               "create_querycondition to receive from controller \"%C\" failed\n",
-               mc_id.c_str()));
-    return false;
+  const TimePoint start = Clock::now();
+  TopologyBuilder builder(known_power_devices());
+  if (!builder.read_edge_list(in)) {
+    err() << "Invalid topology file \"" << path << "\": " << builder.error() << std::endl;
+    return;
   }
+  set_power_topology(builder, start);
+}
 
-  DDS::WaitSet_var ws = new DDS::WaitSet;
-  ws->attach_condition(qc);
-  DDS::ConditionSeq cond_seq;
-  const DDS::Duration_t forever = { DDS::DURATION_INFINITE_SEC, DDS::DURATION_INFINITE_NSEC };
-  rc = ws->wait(cond_seq, forever);
-  ws->detach_condition(qc);
-  if (rc != DDS::RETCODE_OK) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_power_devices_request: "
-               "WaitSet's wait returned \"%C\"\n", OpenDDS::DCPS::retcode_to_string(rc)));
-    return false;
+void CLIClient::generate_power_topology(const OpArgPair& op_pair)
+{
+  std::istringstream args(op_pair.second.value_or(""));
+  std::string shape_name;
+  args >> shape_name;
+  tolower(shape_name);
+  const std::optional<TopologyBuilder::Shape> shape = TopologyBuilder::parse_shape(shape_name);
+  if (!shape) {
+    err() << "The shape must be radial, ring or mesh!" << std::endl;
+    return;
   }
 
-  cli::PowerDevicesReplySeq data;
-  DDS::SampleInfoSeq info_seq;
-  rc = pdrep_dr_->take(data, info_seq, DDS::LENGTH_UNLIMITED,
-                       DDS::ANY_SAMPLE_STATE, DDS::ANY_VIEW_STATE, DDS::ANY_INSTANCE_STATE);
-  if (rc != DDS::RETCODE_OK) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_power_devices_request: "
-               "take data failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
-    return false;
+  size_t count = 0;
+  if (!args.eof() && !(args >> count)) {
+    err() << "Invalid number of power devices!" << std::endl;
+    return;
+  }
+
+  const TimePoint start = Clock::now();
+  std::vector<TopologyBuilder::Device> devices;
+  if (count) {
+    devices = TopologyBuilder::synthetic_devices(count);
+  } else {
+    const PowerDevices known = known_power_devices();
+    devices.reserve(known.size());
+    for (auto it = known.begin(); it != known.end(); ++it) {
+      devices.emplace_back(it->first, it->second.device_info().role());
+    }
+    // Generate the same grid whatever the order of the reports
+    std::sort(devices.begin(), devices.end());
+  }
+
+  TopologyBuilder builder;
+  if (!builder.generate(*shape, devices)) {
+    err() << "Can't generate a " << shape_name << " grid: " << builder.error() << std::endl;
+    return;
+  }
+  set_power_topology(builder, start);
+}
+
+TopologyGraph CLIClient::topology_graph() const
+{
+  TopologyGraph graph = power_connections_.build();
+  // Take the energy level of a device from its active controller
+  for (auto it = mc_to_devices_.begin(); it != mc_to_devices_.end(); ++it) {
+    for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+      const auto& master_id = it2->second.master_id();
+      if (!master_id.has_value() || master_id.value() == it->first) {
+        graph.set_level(it2->first, it2->second.essl());
+      }
+    }
   }
+  return graph;
+}
 
-  bool received = false;
-  for (CORBA::ULong i = 0; !received && i < data.length(); ++i) {
-    if (data[i].mc_id() != mc_id) {
-      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_power_devices_request: "
-                 "reply expected from controller \"%C\". Received from \"%C\"\n",
-                 mc_id.c_str(), data[i].mc_id().c_str()));
+void CLIClient::display_energization()
+{
+  collect_power_devices();
+  SimpleGuard guard(data_m_);
+  const TopologyGraph graph = topology_graph();
+  if (graph.size() == 0) {
+    out() << "No power connections! Use connect-pd to connect power devices first." << std::endl;
+    return;
+  }
+
+  const TopologyGraph::Energization energization = graph.energization();
+  for (TopologyGraph::Node n = 0; n < graph.size(); ++n) {
+    if (graph.role(n) != tms::DeviceRole::ROLE_LOAD) {
       continue;
     }
 
-    if (info_seq[i].valid_data) {
-      const cli::PowerDeviceInfoSeq& pdi_seq = data[i].devices();
-      auto& power_devices = mc_to_devices_[mc_id];
-      for (auto it = pdi_seq.begin(); it != pdi_seq.end(); ++it) {
-        // Add to the existing list of power devices.
-        // This allows power devices to be added gradually in case
-        // the "list-pd" command is issued before all devices have joined.
-        power_devices.insert_or_assign(it->device_info().deviceId(), *it);
+    const std::string formated_id = std::string("\"") + graph.id(n) + "\"";
+    out() << "Load Id: " << std::left << std::setw(15) << formated_id << "| ";
+    if (!graph.active(n)) {
+      out() << "Not operational" << std::endl;
+    } else if (!energization.energized(n)) {
+      out() << "Not energized" << std::endl;
+    } else {
+      out() << "Energized by:";
+      for (const TopologyGraph::Node src : energization.sources_of(n)) {
+        out() << " \"" << graph.id(src) << "\"";
       }
-    } else if (info_seq[i].instance_state == DDS::NOT_ALIVE_DISPOSED_INSTANCE_STATE) {
-      mc_to_devices_.erase(mc_id);
+      out() << std::endl;
+    }
+
+    if (data_) {
+      *data_ += std::string(data_->empty() ? "[" : ",") + "{\"id\":" + json_string(graph.id(n)) +
+        ",\"operational\":" + (graph.active(n) ? "true" : "false") + ",\"sources\":[";
+      const std::vector<TopologyGraph::Node>& sources = energization.sources_of(n);
+      for (size_t i = 0; i < sources.size(); ++i) {
+        *data_ += (i ? "," : "") + json_string(graph.id(sources[i]));
+      }
+      *data_ += "]}";
     }
-    received = true;
   }
+  if (data_) {
+    *data_ += data_->empty() ? "[]" : "]";
+  }
+}
 
-  if (!received) {
-    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIClient::send_power_devices_request: "
-               "Failed to receive data from controller (%C)\n", mc_id.c_str()));
+void CLIClient::display_path(const OpArgPair& op_pair)
+{
+  std::istringstream args(op_pair.second.value_or(""));
+  tms::Identity from, to;
+  if (!(args >> from >> to)) {
+    err() << "Two power devices must be specified!" << std::endl;
+    return;
+  }
+
+  collect_power_devices();
+  SimpleGuard guard(data_m_);
+  const TopologyGraph graph = topology_graph();
+  const TopologyGraph::Node from_node = graph.index(from);
+  const TopologyGraph::Node to_node = graph.index(to);
+  if (from_node == TopologyGraph::NONE || to_node == TopologyGraph::NONE) {
+    err() << "Power device \"" << (from_node == TopologyGraph::NONE ? from : to)
+              << "\" has no power connections!" << std::endl;
+    return;
+  }
+
+  const std::vector<TopologyGraph::Node> path = graph.path(from_node, to_node);
+  if (path.empty()) {
+    out() << "No path of operational devices from \"" << from << "\" to \"" << to << "\"" << std::endl;
+    return;
+  }
+
+  for (size_t i = 0; i < path.size(); ++i) {
+    out() << (i == 0 ? "" : " -> ") << "\"" << graph.id(path[i]) << "\"";
+    if (data_) {
+      *data_ += (i == 0 ? "[" : ",") + json_string(graph.id(path[i]));
+    }
+  }
+  out() << std::endl;
+  if (data_) {
+    *data_ += "]";
+  }
+}
+
+CLIClient::ControllerStatus CLIClient::controller_status(TimePoint now, TimePoint last_heartbeat) const
+{
+  return (now - last_heartbeat < unavail_controller_delay) ? ControllerStatus::AVAILABLE : ControllerStatus::UNAVAILABLE;
+}
+
+void CLIClient::display_controllers() const
+{
+  SimpleGuard guard(data_m_);
+  out() << "Number of Connected Microgrid Controllers: " << controllers_.size() << std::endl;
+  size_t i = 1;
+  const auto now = Clock::now();
+  for (auto it = controllers_.begin(); it != controllers_.end(); ++it) {
+    out() << i++ << ". Controller Id: " << it->first << " (" <<
+      (controller_status(now, it->second.last_hb) == ControllerStatus::AVAILABLE ? "available" : "unavailable");
+    if (it->second.reply_time) {
+      std::ostringstream ms;
+      ms << std::fixed << std::setprecision(1) << it->second.reply_time->count() * 1e3;
+      out() << ", replied in " << ms.str() << " ms";
+    } else if (it->second.requested) {
+      out() << ", didn't reply";
+    }
+    out() << ")" << std::endl;
+
+    if (data_) {
+      *data_ += std::string(data_->empty() ? "[" : ",") + "{\"id\":" + json_string(it->first) +
+        ",\"available\":" + (controller_status(now, it->second.last_hb) == ControllerStatus::AVAILABLE ? "true" : "false") +
+        ",\"reply_ms\":" + (it->second.reply_time ? std::to_string(it->second.reply_time->count() * 1e3) : "null") + "}";
+    }
+  }
+  if (data_) {
+    *data_ += data_->empty() ? "[]" : "]";
   }
-  return true;
 }
 
 void CLIClient::send_start_stop_request(const OpArgPair& op_arg,
                                         tms::OperatorPriorityType opt)
 {
   if (!op_arg.second.has_value()) {
-    std::cerr << "No power device specified!" << std::endl;
+    err() << "No power device specified!" << std::endl;
     return;
   }
   auto& pd_id = op_arg.second.value();
 
-  std::lock_guard<std::mutex> guard(data_m_);
-  if (mc_to_devices_.empty()) {
+  bool collect = false;
+  {
+    SimpleGuard guard(data_m_);
+    collect = mc_to_devices_.empty();
+  }
+  if (collect) {
     collect_power_devices();
   }
 
+  SimpleGuard guard(data_m_);
   const tms::Identity my_id = handshaking_.get_device_id();
 
   tms::OperatorIntentRequest oir;
@@ -727,6 +1330,7 @@ void CLIClient::send_start_stop_request(const OpArgPair& op_arg,
     if (it2 == controllers_.end()) {
       ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_start_stop_request: controller \"%C\" not found\n",
                  mc_id.c_str()));
+      err() << "Unknown controller \"" << mc_id << "\"!" << std::endl;
       return;
     }
 
@@ -738,10 +1342,12 @@ void CLIClient::send_start_stop_request(const OpArgPair& op_arg,
 
     DDS::ReturnCode_t rc = oir_dw_->write(oir, DDS::HANDLE_NIL);
     if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
       ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIClient::send_start_stop_request: write %C request for device \"%C\" "
                  "to controller \"%C\" returned \"%C\"\n",
                  opt == tms::OperatorPriorityType::OPT_ALWAYS_OPERATE ? "start" : "stop",
                  pd_id.c_str(), mc_id.c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+      err() << "Failed to send the request to controller \"" << mc_id << "\"!" << std::endl;
     }
   }
 }
@@ -758,15 +1364,15 @@ void CLIClient::send_stop_device_cmd(const OpArgPair& op_arg)
 
 void CLIClient::send_controller_cmd(const OpArgPair& op_arg, cli::ControllerCmdType cmd_type) const
 {
-  std::lock_guard<std::mutex> guard(data_m_);
+  SimpleGuard guard(data_m_);
   if (!op_arg.second.has_value()) {
-    std::cerr << "No microgrid controller specified!" << std::endl;
+    err() << "No microgrid controller specified!" << std::endl;
     return;
   }
 
   const auto& mc_id = op_arg.second.value();
   if (!controllers_.count(mc_id)) {
-    std::cerr << "Unknown controller \"" << mc_id << "\"!!!" << std::endl;
+    err() << "Unknown controller \"" << mc_id << "\"!!!" << std::endl;
     return;
   }
 
@@ -776,8 +1382,10 @@ void CLIClient::send_controller_cmd(const OpArgPair& op_arg, cli::ControllerCmdT
 
   DDS::ReturnCode_t rc = cc_dw_->write(cmd, DDS::HANDLE_NIL);
   if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
     ACE_ERROR((LM_WARNING, "CLIClient::send_controller_cmd: write ControllerCommand to MC \"%C\" failed: \"%C\"\n",
                mc_id.c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+    err() << "Failed to send the command to controller \"" << mc_id << "\"!" << std::endl;
   }
 }
 
@@ -796,26 +1404,44 @@ void CLIClient::send_terminate_controller_cmd(const OpArgPair& op_arg) const
   send_controller_cmd(op_arg, cli::ControllerCmdType::CCT_TERMINATE);
 }
 
+void CLIClient::dump_lock_stats(const OpArgPair& op_arg) const
+{
+  if (!op_arg.second.has_value()) {
+    out() << LockRegistry::instance().report();
+    return;
+  }
+  send_controller_cmd(op_arg, cli::ControllerCmdType::CCT_DUMP_LOCK_STATS);
+}
+
+void CLIClient::dump_contingencies(const OpArgPair& op_arg) const
+{
+  send_controller_cmd(op_arg, cli::ControllerCmdType::CCT_DUMP_CONTINGENCIES);
+}
+
 void CLIClient::process_device_info(const tms::DeviceInfo& di, const DDS::SampleInfo& si)
 {
-  std::lock_guard<std::mutex> guard(data_m_);
+  SimpleGuard guard(data_m_);
   if (si.valid_data) {
     if (di.role() == tms::DeviceRole::ROLE_MICROGRID_CONTROLLER) {
       controllers_.insert(std::make_pair(di.deviceId(), ControllerInfo{ di, Clock::now() }));
     }
+    dashboard_.device_info(di.deviceId(), di.role());
   } else if (si.instance_state & DDS::NOT_ALIVE_DISPOSED_INSTANCE_STATE){
     controllers_.erase(di.deviceId());
+    dashboard_.remove(di.deviceId());
   }
 }
 
 void CLIClient::process_heartbeat(const tms::Heartbeat& hb, const DDS::SampleInfo& si)
 {
-  std::lock_guard<std::mutex> guard(data_m_);
+  SimpleGuard guard(data_m_);
   if (si.valid_data) {
+    const TimePoint now = Clock::now();
     auto it = controllers_.find(hb.deviceId());
     if (it != controllers_.end()) {
-      it->second.last_hb = Clock::now();
+      it->second.last_hb = now;
     }
+    dashboard_.heartbeat(hb.deviceId(), now);
   } else if (si.instance_state & DDS::NOT_ALIVE_DISPOSED_INSTANCE_STATE) {
     controllers_.erase(hb.deviceId());
   }
@@ -823,7 +1449,7 @@ void CLIClient::process_heartbeat(const tms::Heartbeat& hb, const DDS::SampleInf
 
 int CLIClient::handle_signal(int, siginfo_t*, ucontext_t*)
 {
-  std::lock_guard<std::mutex> cli_guard(cli_m_);
+  SimpleGuard cli_guard(cli_m_);
   stop_cli_ = true;
 
   reactor_->end_reactor_event_loop();
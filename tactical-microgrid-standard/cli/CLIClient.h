@@ -1,30 +1,22 @@
 #ifndef CLI_CLI_CLIENT_H
 #define CLI_CLI_CLIENT_H
 
+#include "Dashboard.h"
 #include "common/Handshaking.h"
+#include "common/TopologyGraph.h"
 #include "controller/Common.h"
 
 #include <cli_idl/CLICommandsTypeSupportImpl.h>
 #include <power_devices/PowerSimTypeSupportImpl.h>
 
+#include <functional>
+#include <iostream>
+#include <optional>
 #include <string>
 #include <utility>
 #include <mutex>
-#include <unordered_set>
 
-struct ConnectedDeviceEqual {
-  bool operator()(const powersim::ConnectedDevice& cd1, const powersim::ConnectedDevice& cd2) const
-  {
-    return cd1.id() == cd2.id() && cd1.role() == cd2.role();
-  }
-};
-
-struct ConnectedDeviceHash {
-  size_t operator()(const powersim::ConnectedDevice& cd) const
-  {
-    return std::hash<tms::Identity>{}(cd.id());
-  }
-};
+class TopologyBuilder;
 
 class CLIClient {
 public:
@@ -35,21 +27,62 @@ public:
 
   void run();
 
+  // Run a script instead of the interactive CLI. Returns 1 if a command failed.
+  int run(const std::string& script_path, bool json_lines);
+
+  struct CommandResult {
+    bool ok = true;
+    // What the command printed, as in the interactive CLI
+    std::string output;
+    std::string error;
+    // The result of list-mc, list-pd, energized and path as a JSON array
+    std::string data;
+    Sec duration{0};
+  };
+
+  // Run a CLI command and capture its output. Can be called from any thread
+  // once the client is initialized, e.g. to drive a load test, and commands
+  // run one at a time. Commands that prompt for input (connect-pd) fail, and
+  // so do commands that failed to send a request or command.
+  CommandResult execute(const std::string& line);
+
+  // Run the commands of a script, writing a JSON object per command to out if
+  // json_lines is set, or the output of the commands otherwise. Returns the
+  // number of commands that failed.
+  size_t run_script(std::istream& script, std::ostream& out, bool json_lines);
+
 private:
   // Initialize DDS entities in the TMS domain
   DDS::ReturnCode_t init_tms(DDS::DomainId_t tms_domain_id, int argc = 0, char* argv[] = nullptr);
 
+  template <typename Sample>
+  DDS::ReturnCode_t subscribe(DDS::Subscriber_ptr sub, const std::string& topic_name,
+                              std::function<void(const Sample&, const DDS::SampleInfo&)> callback);
+
   // Initialize DDS entities used for CLI commands and power simulation
   DDS::ReturnCode_t init_sim(DDS::DomainId_t sim_domain_id);
 
   void run_cli();
   bool cli_stopped() const;
+  bool dispatch(const OpArgPair& op_pair);
+  void watch(const OpArgPair& op_pair);
+  void wait(const OpArgPair& op_pair);
+  void wait_for_controllers(const OpArgPair& op_pair);
+
+  std::ostream& out() const
+  {
+    return *out_;
+  }
+
+  std::ostream& err() const
+  {
+    return *err_;
+  }
 
   void tolower(std::string& s) const;
   OpArgPair parse(const std::string& input) const;
 
   void display_commands() const;
-  std::string energy_level_to_string(tms::EnergyStartStopLevel essl) const;
 
   enum class ControllerStatus {
     AVAILABLE,
@@ -58,10 +91,13 @@ private:
 
   ControllerStatus controller_status(TimePoint now, TimePoint last_heartbeat) const;
   void display_controllers() const;
+
+  // Request the power devices of all available controllers at once and wait
+  // for their replies up to power_devices_reply_timeout. Caller must not hold
+  // the data_m_ lock, so that heartbeats are processed while waiting.
   bool collect_power_devices();
   void display_power_devices() const;
   void list_power_devices();
-  bool is_single_port_device(tms::DeviceRole role) const;
 
   // Check that two power devices can have a power connection
   bool can_connect(const tms::Identity& id1, tms::DeviceRole role1,
@@ -72,13 +108,27 @@ private:
     const tms::Identity& id2, tms::DeviceRole role2);
   void consolidate_power_devices();
   void connect_power_devices();
-  bool send_power_devices_request(const tms::Identity& mc_id);
+  bool send_power_topology();
+
+  // Build the whole power topology from an edge list file or as a grid
+  PowerDevices known_power_devices();
+  void set_power_topology(const TopologyBuilder& builder, TimePoint start);
+  void import_power_topology(const OpArgPair& op_pair);
+  void generate_power_topology(const OpArgPair& op_pair);
+
+  // Graph of the power connections made so far, with the devices that aren't
+  // operational switched off. Caller must already hold data_m_ lock.
+  TopologyGraph topology_graph() const;
+  void display_energization();
+  void display_path(const OpArgPair& op_pair);
   void send_start_device_cmd(const OpArgPair& op_arg);
   void send_stop_device_cmd(const OpArgPair& op_arg);
   void send_start_stop_request(const OpArgPair& op_arg, tms::OperatorPriorityType opt);
   void send_suspend_controller_cmd(const OpArgPair& op_pair) const;
   void send_resume_controller_cmd(const OpArgPair& op_pair) const;
   void send_terminate_controller_cmd(const OpArgPair& op_pair) const;
+  void dump_lock_stats(const OpArgPair& op_pair) const;
+  void dump_contingencies(const OpArgPair& op_pair) const;
   void send_controller_cmd(const OpArgPair& op_pair, cli::ControllerCmdType cmd_type) const;
 
   void process_device_info(const tms::DeviceInfo& di, const DDS::SampleInfo& si);
@@ -92,6 +142,8 @@ private:
   cli::PowerDevicesRequestDataWriter_var pdreq_dw_;
   tms::OperatorIntentRequestDataWriter_var oir_dw_;
   cli::PowerDevicesReplyDataReader_var pdrep_dr_;
+  DDS::ReadCondition_var pdrep_rc_;
+  DDS::WaitSet_var pdrep_ws_;
   cli::ControllerCommandDataWriter_var cc_dw_;
   powersim::PowerTopologyDataWriter_var pt_dw_;
 
@@ -103,16 +155,35 @@ private:
   static constexpr Sec lost_controller_delay{6};
   static constexpr Sec unavail_controller_delay = missed_controller_delay + lost_controller_delay;
 
+  // Controllers that haven't replied to a power devices request in this amount
+  // of time are left out of the result.
+  static constexpr Sec power_devices_reply_timeout{2};
+
   struct ControllerInfo {
     tms::DeviceInfo info;
     TimePoint last_hb;
+    // Time the last power devices request took, or none if it timed out
+    std::optional<Sec> reply_time;
+    bool requested = false;
   };
 
-  mutable std::mutex cli_m_;
+  mutable SimpleMutex cli_m_{"CLIClient::cli"};
   bool stop_cli_;
 
+  // Serializes the commands run by execute, which redirects their output,
+  // and those entered at the prompt
+  SimpleMutex execute_m_{"CLIClient::execute"};
+  std::ostream* out_ = &std::cout;
+  std::ostream* err_ = &std::cerr;
+  std::string* data_ = nullptr;
+
+  // Serializes the power devices requests, which share the reply condition
+  SimpleMutex collect_m_{"CLIClient::collect"};
+  // Seqnum of the last round of power devices requests, protected by collect_m_
+  uint64_t pd_req_seqnum_ = 0;
+
   // Mutex for the following data
-  mutable std::mutex data_m_;
+  mutable SimpleMutex data_m_{"CLIClient::data"};
 
   // Microgrid controllers that are (and were) reachable by the CLI
   std::unordered_map<tms::Identity, ControllerInfo> controllers_;
@@ -125,9 +196,12 @@ private:
   PowerDevices power_devices_;
 
   // Store the simulated power connections between power devices
-  using PowerConnection = std::unordered_map<tms::Identity,
-    std::unordered_set<powersim::ConnectedDevice, ConnectedDeviceHash, ConnectedDeviceEqual>>;
-  PowerConnection power_connections_;
+  TopologyGraph::Builder power_connections_;
+
+  // State of all devices for the watch command
+  static constexpr size_t default_watch_rows = 40;
+  static constexpr double watch_fps = 10;
+  Dashboard dashboard_;
 };
 
 #endif
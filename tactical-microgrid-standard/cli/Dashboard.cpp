@@ -0,0 +1,230 @@
+#include "Dashboard.h"
+
+#include "common/Utils.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Lines above the rows of devices: the summary and the column names
+constexpr size_t header_lines = 2;
+
+std::string move_to(size_t line)
+{
+  return "\x1b[" + std::to_string(line) + ";1H";
+}
+
+const char* const clear_line = "\x1b[K";
+
+}
+
+Dashboard::Row& Dashboard::row(const tms::Identity& id)
+{
+  const auto it = index_.find(id);
+  if (it != index_.end()) {
+    return rows_[it->second];
+  }
+  index_.insert(std::make_pair(id, rows_.size()));
+  rows_.emplace_back();
+  rows_.back().id = id;
+  dirty_.push_back(rows_.size() - 1);
+  return rows_.back();
+}
+
+void Dashboard::mark(Row& row)
+{
+  if (!row.dirty) {
+    row.dirty = true;
+    dirty_.push_back(&row - rows_.data());
+  }
+}
+
+void Dashboard::device_info(const tms::Identity& id, tms::DeviceRole role)
+{
+  SimpleGuard guard(m_);
+  Row& r = row(id);
+  if (r.role != role || r.removed) {
+    r.role = role;
+    r.removed = false;
+    mark(r);
+  }
+}
+
+void Dashboard::heartbeat(const tms::Identity& id, TimePoint now)
+{
+  // Only a change of liveness is drawn, which render checks for every frame
+  SimpleGuard guard(m_);
+  row(id).last_hb = now;
+}
+
+void Dashboard::active_controller(const tms::Identity& id, const std::optional<tms::Identity>& mc_id)
+{
+  SimpleGuard guard(m_);
+  Row& r = row(id);
+  if (r.mc_id != mc_id) {
+    r.mc_id = mc_id;
+    mark(r);
+  }
+}
+
+void Dashboard::energy_level(const tms::Identity& id, tms::EnergyStartStopLevel essl)
+{
+  SimpleGuard guard(m_);
+  Row& r = row(id);
+  if (r.level != essl) {
+    r.level = essl;
+    mark(r);
+  }
+}
+
+void Dashboard::level_requested(const tms::Identity& id, uint64_t seq, tms::EnergyStartStopLevel essl)
+{
+  SimpleGuard guard(m_);
+  Row& r = row(id);
+  r.requested = essl;
+  r.requested_seq = seq;
+  mark(r);
+}
+
+void Dashboard::level_replied(const tms::Identity& id, uint64_t seq, bool ok)
+{
+  SimpleGuard guard(m_);
+  const auto it = index_.find(id);
+  if (it == index_.end()) {
+    return;
+  }
+
+  Row& r = rows_[it->second];
+  if (!r.requested || r.requested_seq != seq) {
+    return;
+  }
+  if (ok) {
+    r.level = r.requested;
+  }
+  r.requested.reset();
+  mark(r);
+}
+
+void Dashboard::remove(const tms::Identity& id)
+{
+  // The row stays so the rows below it don't move
+  SimpleGuard guard(m_);
+  const auto it = index_.find(id);
+  if (it != index_.end() && !rows_[it->second].removed) {
+    rows_[it->second].removed = true;
+    mark(rows_[it->second]);
+  }
+}
+
+void Dashboard::reset(size_t max_rows)
+{
+  SimpleGuard guard(m_);
+  max_rows_ = max_rows;
+  clear_ = true;
+}
+
+Dashboard::Liveness Dashboard::liveness(const Row& row, TimePoint now) const
+{
+  if (!row.last_hb) {
+    return Liveness::UNKNOWN;
+  }
+  const Sec since = now - *row.last_hb;
+  return since < missed_delay ? Liveness::ALIVE : since < lost_delay ? Liveness::MISSED : Liveness::LOST;
+}
+
+std::string Dashboard::format(const Row& row, Liveness liveness) const
+{
+  static const char* const liveness_names[] = {"-", "Alive", "Missed", "Lost"};
+
+  std::string level = row.level ? Utils::energy_level_to_string(*row.level) : "-";
+  if (row.requested) {
+    level += " > " + Utils::energy_level_to_string(*row.requested);
+  }
+
+  char line[160];
+  std::snprintf(line, sizeof line, "%-24.24s %-20.20s %-26.26s %-24.24s %s",
+                row.id.c_str(),
+                row.role ? Utils::device_role_to_string(*row.role).c_str() : "-",
+                level.c_str(),
+                row.mc_id ? row.mc_id->c_str() : "-",
+                row.removed ? "Gone" : liveness_names[static_cast<int>(liveness)]);
+  return line;
+}
+
+std::string Dashboard::header() const
+{
+  size_t controllers = 0, operational = 0, lost = 0;
+  for (const Row& r : rows_) {
+    if (r.removed) {
+      continue;
+    }
+    controllers += r.role == tms::DeviceRole::ROLE_MICROGRID_CONTROLLER;
+    operational += r.level == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+    lost += r.drawn_liveness == Liveness::LOST;
+  }
+
+  std::string line = "Devices: " + std::to_string(rows_.size()) + " | Controllers: " + std::to_string(controllers) +
+    " | Operational: " + std::to_string(operational) + " | Lost: " + std::to_string(lost);
+  if (rows_.size() > max_rows_) {
+    line += " | Showing " + std::to_string(max_rows_);
+  }
+  line += " | Press Enter to stop";
+  return line;
+}
+
+size_t Dashboard::render(std::ostream& out, TimePoint now)
+{
+  std::string frame;
+  size_t drawn = 0;
+  {
+    SimpleGuard guard(m_);
+    if (clear_) {
+      clear_ = false;
+      drawn_header_.clear();
+      char columns[160];
+      std::snprintf(columns, sizeof columns, "%-24s %-20s %-26s %-24s %s",
+                    "Id", "Role", "Energy Level", "Active Controller", "Heartbeat");
+      frame += "\x1b[2J" + move_to(2) + columns + clear_line;
+      dirty_.clear();
+      for (size_t i = 0; i < rows_.size(); ++i) {
+        rows_[i].dirty = true;
+        dirty_.push_back(i);
+      }
+    }
+
+    // Heartbeats only matter when they stop
+    for (size_t i = 0; i < rows_.size(); ++i) {
+      if (liveness(rows_[i], now) != rows_[i].drawn_liveness) {
+        mark(rows_[i]);
+      }
+    }
+
+    for (const size_t i : dirty_) {
+      Row& r = rows_[i];
+      r.dirty = false;
+      r.drawn_liveness = liveness(r, now);
+      if (i < max_rows_) {
+        frame += move_to(header_lines + 1 + i) + format(r, r.drawn_liveness) + clear_line;
+        ++drawn;
+      }
+    }
+    dirty_.clear();
+
+    std::string summary = header();
+    if (summary != drawn_header_) {
+      frame += move_to(1) + summary + clear_line;
+      drawn_header_ = std::move(summary);
+    }
+
+    if (!frame.empty()) {
+      // Leave the cursor below the rows
+      frame += move_to(header_lines + 1 + std::min(rows_.size(), max_rows_));
+    }
+  }
+
+  if (!frame.empty()) {
+    out << frame << std::flush;
+  }
+  return drawn;
+}
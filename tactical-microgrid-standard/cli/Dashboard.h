@@ -0,0 +1,81 @@
+#ifndef CLI_DASHBOARD_H
+#define CLI_DASHBOARD_H
+
+#include "common/TimerHandler.h"
+
+#include <common/mil-std-3071_data_modelTypeSupportImpl.h>
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * State of the devices in the microgrid for the watch command, kept up to date
+ * from the samples the CLI receives instead of by querying the controllers.
+ * Each device keeps its row on the screen, so a frame only rewrites the rows
+ * that changed since the last one, using ANSI escape sequences. Thread-safe.
+ */
+class Dashboard {
+public:
+  void device_info(const tms::Identity& id, tms::DeviceRole role);
+  void heartbeat(const tms::Identity& id, TimePoint now);
+  void active_controller(const tms::Identity& id, const std::optional<tms::Identity>& mc_id);
+  void energy_level(const tms::Identity& id, tms::EnergyStartStopLevel essl);
+
+  // A controller requested a new energy level, which is taken once the device
+  // replies that it succeeded.
+  void level_requested(const tms::Identity& id, uint64_t seq, tms::EnergyStartStopLevel essl);
+  void level_replied(const tms::Identity& id, uint64_t seq, bool ok);
+
+  void remove(const tms::Identity& id);
+
+  // Clear the screen on the next frame and draw up to the given number of rows
+  void reset(size_t max_rows);
+
+  // Draw what changed since the last frame, returns the number of rows drawn
+  size_t render(std::ostream& out, TimePoint now);
+
+private:
+  enum class Liveness {
+    UNKNOWN,
+    ALIVE,
+    MISSED,
+    LOST,
+  };
+
+  struct Row {
+    tms::Identity id;
+    std::optional<tms::DeviceRole> role;
+    std::optional<tms::Identity> mc_id;
+    std::optional<tms::EnergyStartStopLevel> level;
+    std::optional<tms::EnergyStartStopLevel> requested;
+    uint64_t requested_seq = 0;
+    std::optional<TimePoint> last_hb;
+    Liveness drawn_liveness = Liveness::UNKNOWN;
+    bool removed = false;
+    bool dirty = true;
+  };
+
+  // Caller must hold m_
+  Row& row(const tms::Identity& id);
+  void mark(Row& row);
+  Liveness liveness(const Row& row, TimePoint now) const;
+  std::string format(const Row& row, Liveness liveness) const;
+  std::string header() const;
+
+  // Same delays as for microgrid controllers
+  static constexpr Sec missed_delay{3};
+  static constexpr Sec lost_delay{9};
+
+  mutable SimpleMutex m_{"Dashboard"};
+  std::vector<Row> rows_;
+  std::unordered_map<tms::Identity, size_t> index_;
+  std::vector<size_t> dirty_;
+  size_t max_rows_ = 0;
+  bool clear_ = true;
+  std::string drawn_header_;
+};
+
+#endif
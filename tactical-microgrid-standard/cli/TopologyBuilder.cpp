@@ -0,0 +1,238 @@
+#include "TopologyBuilder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+// Children of each distribution device in a radial grid
+constexpr size_t radial_fanout = 4;
+
+std::optional<tms::DeviceRole> parse_role(std::string name)
+{
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (name == "source") {
+    return tms::DeviceRole::ROLE_SOURCE;
+  } else if (name == "load") {
+    return tms::DeviceRole::ROLE_LOAD;
+  } else if (name == "storage") {
+    return tms::DeviceRole::ROLE_STORAGE;
+  } else if (name == "distribution") {
+    return tms::DeviceRole::ROLE_DISTRIBUTION;
+  }
+  return std::nullopt;
+}
+
+}
+
+std::optional<TopologyBuilder::Shape> TopologyBuilder::parse_shape(const std::string& name)
+{
+  if (name == "radial") {
+    return Shape::RADIAL;
+  } else if (name == "ring") {
+    return Shape::RING;
+  } else if (name == "mesh") {
+    return Shape::MESH;
+  }
+  return std::nullopt;
+}
+
+bool TopologyBuilder::is_single_port_device(tms::DeviceRole role)
+{
+  switch (role) {
+  case tms::DeviceRole::ROLE_SOURCE:
+  case tms::DeviceRole::ROLE_LOAD:
+  case tms::DeviceRole::ROLE_STORAGE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool TopologyBuilder::can_connect(const TopologyGraph::Builder& connections,
+                                  const tms::Identity& id1, tms::DeviceRole role1,
+                                  const tms::Identity& id2, tms::DeviceRole role2)
+{
+  if (id1 == id2) {
+    return false;
+  }
+
+  const bool dev1_is_not_connected = connections.degree(id1) == 0;
+  const bool dev2_is_not_connected = connections.degree(id2) == 0;
+
+  if (dev1_is_not_connected || !is_single_port_device(role1)) {
+    if (dev2_is_not_connected) {
+      return true;
+    }
+    return !is_single_port_device(role2);
+  }
+  return false;
+}
+
+std::vector<TopologyBuilder::Device> TopologyBuilder::synthetic_devices(size_t count)
+{
+  const size_t sources = std::max<size_t>(1, count / 50);
+  const size_t distribution = std::max<size_t>(1, count / 10);
+  const size_t loads = count > sources + distribution ? count - sources - distribution : 0;
+
+  std::vector<Device> devices;
+  devices.reserve(sources + distribution + loads);
+  for (size_t i = 1; i <= sources; ++i) {
+    devices.emplace_back("src-" + std::to_string(i), tms::DeviceRole::ROLE_SOURCE);
+  }
+  for (size_t i = 1; i <= distribution; ++i) {
+    devices.emplace_back("dist-" + std::to_string(i), tms::DeviceRole::ROLE_DISTRIBUTION);
+  }
+  for (size_t i = 1; i <= loads; ++i) {
+    devices.emplace_back("load-" + std::to_string(i), tms::DeviceRole::ROLE_LOAD);
+  }
+  return devices;
+}
+
+powersim::PowerTopology TopologyBuilder::to_power_topology(const TopologyGraph& graph)
+{
+  powersim::PowerTopology pt;
+  pt.connections().reserve(graph.size());
+  for (TopologyGraph::Node n = 0; n < graph.size(); ++n) {
+    powersim::PowerConnection pc;
+    pc.pd_id() = graph.id(n);
+    pc.connected_devices().reserve(graph.degree(n));
+    for (const TopologyGraph::Node* it = graph.neighbors_begin(n); it != graph.neighbors_end(n); ++it) {
+      pc.connected_devices().push_back(powersim::ConnectedDevice{graph.id(*it), graph.role(*it)});
+    }
+    pt.connections().push_back(pc);
+  }
+  return pt;
+}
+
+TopologyBuilder::TopologyBuilder(const PowerDevices& known)
+{
+  roles_.reserve(known.size());
+  for (auto it = known.begin(); it != known.end(); ++it) {
+    roles_.insert(std::make_pair(it->first, it->second.device_info().role()));
+  }
+}
+
+bool TopologyBuilder::connect(const Device& dev1, const Device& dev2)
+{
+  if (!can_connect(connections_, dev1.first, dev1.second, dev2.first, dev2.second)) {
+    ++rejected_;
+    return false;
+  }
+  connections_.add_connection(dev1.first, dev1.second, dev2.first, dev2.second);
+  ++added_;
+  return true;
+}
+
+bool TopologyBuilder::read_edge_list(std::istream& in)
+{
+  error_.clear();
+  std::string line;
+  for (size_t line_number = 1; std::getline(in, line); ++line_number) {
+    std::istringstream fields(line);
+    std::string first, second, third;
+    if (!(fields >> first) || first[0] == '#') {
+      continue;
+    }
+
+    const bool declaration = first == "device";
+    if (!(fields >> second) || (declaration && !(fields >> third))) {
+      error_ = "line " + std::to_string(line_number) + ": expected \"<pd_id> <pd_id>\" or \"device <pd_id> <role>\"";
+      return false;
+    }
+
+    if (declaration) {
+      const std::optional<tms::DeviceRole> role = parse_role(third);
+      if (!role) {
+        error_ = "line " + std::to_string(line_number) + ": unknown role \"" + third + "\"";
+        return false;
+      }
+      roles_[second] = *role;
+      continue;
+    }
+
+    const auto it1 = roles_.find(first);
+    const auto it2 = roles_.find(second);
+    if (it1 == roles_.end() || it2 == roles_.end()) {
+      error_ = "line " + std::to_string(line_number) + ": unknown power device \"" +
+        (it1 == roles_.end() ? first : second) + "\"";
+      return false;
+    }
+    connect(*it1, *it2);
+  }
+
+  if (in.bad()) {
+    error_ = "read failed";
+    return false;
+  }
+  return true;
+}
+
+bool TopologyBuilder::generate(Shape shape, const std::vector<Device>& devices)
+{
+  error_.clear();
+  std::vector<const Device*> sources, distribution, loads;
+  for (const Device& dev : devices) {
+    switch (dev.second) {
+    case tms::DeviceRole::ROLE_SOURCE:
+    case tms::DeviceRole::ROLE_STORAGE:
+      sources.push_back(&dev);
+      break;
+    case tms::DeviceRole::ROLE_DISTRIBUTION:
+      distribution.push_back(&dev);
+      break;
+    case tms::DeviceRole::ROLE_LOAD:
+      loads.push_back(&dev);
+      break;
+    default:
+      break;
+    }
+  }
+
+  const size_t m = distribution.size();
+  if (m == 0) {
+    error_ = "at least one distribution device is needed";
+    return false;
+  }
+
+  // Connect the distribution devices to each other
+  switch (shape) {
+  case Shape::RADIAL:
+    for (size_t i = 1; i < m; ++i) {
+      connect(*distribution[(i - 1) / radial_fanout], *distribution[i]);
+    }
+    break;
+  case Shape::RING:
+    for (size_t i = 0; m > 1 && i < (m == 2 ? 1 : m); ++i) {
+      connect(*distribution[i], *distribution[(i + 1) % m]);
+    }
+    break;
+  case Shape::MESH:
+    {
+      const size_t width = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(m))));
+      for (size_t i = 0; i < m; ++i) {
+        if ((i + 1) % width != 0 && i + 1 < m) {
+          connect(*distribution[i], *distribution[i + 1]);
+        }
+        if (i + width < m) {
+          connect(*distribution[i], *distribution[i + width]);
+        }
+      }
+    }
+    break;
+  }
+
+  // Feed a radial grid from its root and spread the sources evenly otherwise.
+  // Loads are spread over all distribution devices.
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const size_t d = shape == Shape::RADIAL ? 0 : i * m / sources.size();
+    connect(*sources[i], *distribution[d]);
+  }
+  for (size_t i = 0; i < loads.size(); ++i) {
+    connect(*loads[i], *distribution[i % m]);
+  }
+  return true;
+}
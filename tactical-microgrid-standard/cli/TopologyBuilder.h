@@ -0,0 +1,95 @@
+#ifndef CLI_TOPOLOGY_BUILDER_H
+#define CLI_TOPOLOGY_BUILDER_H
+
+#include "common/TopologyGraph.h"
+#include "controller/Common.h"
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <istream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Builds a whole simulated power topology at once instead of a connection at a
+ * time: from an edge list or as a generated grid. Connections are checked the
+ * same way as those entered in connect-pd, so sources, loads and storage
+ * devices only get one connection and the rest are rejected.
+ */
+class TopologyBuilder {
+public:
+  using Device = std::pair<tms::Identity, tms::DeviceRole>;
+
+  enum class Shape {
+    // A tree of distribution devices fed by the sources at its root
+    RADIAL,
+    // Distribution devices in a loop with the sources spread around it
+    RING,
+    // Distribution devices in a square lattice with the sources spread over it
+    MESH,
+  };
+
+  static std::optional<Shape> parse_shape(const std::string& name);
+
+  static bool is_single_port_device(tms::DeviceRole role);
+
+  // Check that a connection between two power devices can be added to the
+  // given connections.
+  static bool can_connect(const TopologyGraph::Builder& connections,
+                          const tms::Identity& id1, tms::DeviceRole role1,
+                          const tms::Identity& id2, tms::DeviceRole role2);
+
+  // Power devices named after their role, about 1 in 50 a source and 1 in 10
+  // a distribution device, for testing at scale without running the devices.
+  static std::vector<Device> synthetic_devices(size_t count);
+
+  static powersim::PowerTopology to_power_topology(const TopologyGraph& graph);
+
+  // The roles of the known devices are used for the ids in an edge list
+  explicit TopologyBuilder(const PowerDevices& known = PowerDevices());
+
+  /**
+   * Read connections from lines of "<pd_id> <pd_id>". Devices that aren't
+   * known are declared before they're used with "device <pd_id> <role>", where
+   * the role is source, load, storage or distribution. Blank lines and lines
+   * starting with # are skipped. Returns false on the first invalid line.
+   */
+  bool read_edge_list(std::istream& in);
+
+  // Connect the given devices in the given shape. Needs a distribution device.
+  bool generate(Shape shape, const std::vector<Device>& devices);
+
+  const TopologyGraph::Builder& connections() const
+  {
+    return connections_;
+  }
+
+  size_t added() const
+  {
+    return added_;
+  }
+
+  size_t rejected() const
+  {
+    return rejected_;
+  }
+
+  // Why the last call failed
+  const std::string& error() const
+  {
+    return error_;
+  }
+
+private:
+  bool connect(const Device& dev1, const Device& dev2);
+
+  std::unordered_map<tms::Identity, tms::DeviceRole> roles_;
+  TopologyGraph::Builder connections_;
+  size_t added_ = 0;
+  size_t rejected_ = 0;
+  std::string error_;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "CLIClient.h"
+#include "common/MetricsExporter.h"
 
 #include <ace/Get_Opt.h>
 
@@ -6,8 +7,11 @@ int main(int argc, char* argv[])
 {
   const char* id = "CLI Client";
   DDS::DomainId_t tms_domain_id = OpenDDS::DOMAIN_UNKNOWN;
+  const char* script = nullptr;
+  bool json_lines = false;
+  int metrics_port = -1;
 
-  ACE_Get_Opt get_opt(argc, argv, "i:d:");
+  ACE_Get_Opt get_opt(argc, argv, "i:d:s:jE:");
   int c;
   while ((c = get_opt()) != -1) {
     switch (c) {
@@ -17,13 +21,25 @@ int main(int argc, char* argv[])
     case 'd':
       tms_domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
       break;
+    case 's':
+      script = get_opt.opt_arg();
+      break;
+    case 'j':
+      json_lines = true;
+      break;
+    case 'E':
+      metrics_port = ACE_OS::atoi(get_opt.opt_arg());
+      break;
     default:
       break;
     }
   }
 
-  if (tms_domain_id == OpenDDS::DOMAIN_UNKNOWN) {
-    ACE_ERROR((LM_ERROR, "Usage: %C -d TMS_Domain_Id [-i CLI_Client_Id]\n", argv[0]));
+  if (tms_domain_id == OpenDDS::DOMAIN_UNKNOWN || metrics_port > 65535) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d TMS_Domain_Id [-i CLI_Client_Id] [-s Script_File [-j]] [-E Metrics_Port]\n"
+               "  -s: run the commands of the script instead of reading them from the terminal\n"
+               "  -j: print a JSON object per command of the script\n"
+               "  -E: serve Prometheus metrics at http://127.0.0.1:Metrics_Port/metrics\n", argv[0]));
     return 1;
   }
 
@@ -33,6 +49,15 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  MetricsExporter exporter(id);
+  if (metrics_port >= 0 && !exporter.start(static_cast<u_short>(metrics_port))) {
+    return 1;
+  }
+
+  if (script) {
+    return client.run(script, json_lines);
+  }
+
   client.run();
 
   return 0;
@@ -0,0 +1,58 @@
+#ifndef TMS_COMMON_CALLBACK_DATA_READER_LISTENER_IMPL_H
+#define TMS_COMMON_CALLBACK_DATA_READER_LISTENER_IMPL_H
+
+#include "DataReaderListenerBase.h"
+
+#include <dds/DCPS/TypeSupportImpl.h>
+
+#include <functional>
+
+// Takes the samples of any topic and passes each of them to a callback
+template <typename Sample>
+class CallbackDataReaderListenerImpl : public DataReaderListenerBase {
+public:
+  using Callback = std::function<void(const Sample&, const DDS::SampleInfo&)>;
+  using DataReader = typename OpenDDS::DCPS::DDSTraits<Sample>::DataReaderType;
+
+  CallbackDataReaderListenerImpl(const std::string& name, Callback callback)
+    : DataReaderListenerBase(name + " - DataReaderListenerImpl")
+    , name_(name)
+    , callback_(callback)
+  {}
+
+  virtual ~CallbackDataReaderListenerImpl() = default;
+
+  void on_data_available(DDS::DataReader_ptr reader) final
+  {
+    typename DataReader::_var_type typed_reader = DataReader::_narrow(reader);
+    if (!typed_reader) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CallbackDataReaderListenerImpl::on_data_available: "
+                 "%C _narrow failed\n", name_.c_str()));
+      return;
+    }
+
+    size_t taken = 0;
+    while (true) {
+      Sample sample;
+      DDS::SampleInfo si;
+      const DDS::ReturnCode_t rc = typed_reader->take_next_sample(sample, si);
+      if (rc == DDS::RETCODE_OK) {
+        ++taken;
+        callback_(sample, si);
+      } else if (rc == DDS::RETCODE_NO_DATA) {
+        break;
+      } else {
+        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CallbackDataReaderListenerImpl::on_data_available: "
+                   "%C take_next_sample failed (%C)\n", name_.c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+        break;
+      }
+    }
+    record_queue_depth(taken);
+  }
+
+private:
+  const std::string name_;
+  Callback callback_;
+};
+
+#endif
@@ -5,15 +5,18 @@
 #include <dds/DCPS/InternalDataReaderListener.h>
 #include <dds/DCPS/Service_Participant.h>
 
+#include "ProfiledMutex.h"
+
 #include <mutex>
 
 class Configurable {
 public:
-  using Mutex = std::recursive_mutex;
+  using Mutex = ProfiledMutex<std::recursive_mutex>;
   using Guard = std::lock_guard<Mutex>;
 
   Configurable(const std::string& prefix)
-    : config_prefix_(prefix)
+    : config_lock_("Configurable")
+    , config_prefix_(prefix)
   {
   }
 
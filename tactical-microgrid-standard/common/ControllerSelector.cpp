@@ -1,9 +1,10 @@
 #include "ControllerSelector.h"
+#include "Metrics.h"
 
 #include <sstream>
 
 ControllerSelector::ControllerSelector(const tms::Identity& device_id, ACE_Reactor* reactor)
-  : TimerHandler(reactor)
+  : TimerHandler(reactor, "ControllerSelector")
   , ControllerCallbacks(lock_)
   , Configurable("TMS_SELECTOR")
   , device_id_(device_id)
@@ -183,6 +184,9 @@ bool ControllerSelector::select_controller()
 void ControllerSelector::select(const tms::Identity& id, Sec last_hb)
 {
   ACE_DEBUG((LM_INFO, "(%P|%t) INFO: ControllerSelector::select: \"%C\"\n", id.c_str()));
+  if (selected_ != id) {
+    Metrics::instance().selection_changes.add();
+  }
   selected_ = id;
   if (new_controller_callback_) {
     new_controller_callback_(selected_);
@@ -201,6 +205,7 @@ void ControllerSelector::send_controller_state()
 
   const DDS::ReturnCode_t rc = amcs_dw_->write(amcs, DDS::HANDLE_NIL);
   if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
     ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: ControllerSelector::send_controller_state: write ActiveMicrogridControllerState failed\n"));
   }
 }
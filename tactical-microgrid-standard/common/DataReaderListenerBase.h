@@ -1,6 +1,8 @@
 #ifndef TMS_COMMON_DATA_READER_LISTENER_BASE_H
 #define TMS_COMMON_DATA_READER_LISTENER_BASE_H
 
+#include "StatusMetrics.h"
+
 #include <dds/DCPS/LocalObject.h>
 #include <dds/DCPS/debug.h>
 #include <dds/DdsDcpsSubscriptionC.h>
@@ -10,16 +12,18 @@ public:
   explicit DataReaderListenerBase(const std::string& listener_name) : listener_name_(listener_name) {}
 
   virtual void on_requested_deadline_missed(DDS::DataReader_ptr,
-                                            const DDS::RequestedDeadlineMissedStatus&)
+                                            const DDS::RequestedDeadlineMissedStatus& status)
   {
+    count_status(status);
     if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
       ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_requested_deadline_missed\n", listener_name_.c_str()));
     }
   }
 
   virtual void on_requested_incompatible_qos(DDS::DataReader_ptr,
-                                             const DDS::RequestedIncompatibleQosStatus&)
+                                             const DDS::RequestedIncompatibleQosStatus& status)
   {
+    count_status(status);
     if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
       ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_requested_incompatible_qos\n", listener_name_.c_str()));
     }
@@ -34,16 +38,18 @@ public:
   }
 
   virtual void on_subscription_matched(DDS::DataReader_ptr,
-                                       const DDS::SubscriptionMatchedStatus&)
+                                       const DDS::SubscriptionMatchedStatus& status)
   {
+    count_status(status);
     if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
       ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_subscription_matched\n", listener_name_.c_str()));
     }
   }
 
   virtual void on_sample_rejected(DDS::DataReader_ptr,
-                                  const DDS::SampleRejectedStatus&)
+                                  const DDS::SampleRejectedStatus& status)
   {
+    count_status(status);
     if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
       ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_sample_rejected\n", listener_name_.c_str()));
     }
@@ -52,13 +58,23 @@ public:
   virtual void on_data_available(DDS::DataReader_ptr) = 0;
 
   virtual void on_sample_lost(DDS::DataReader_ptr,
-                              const DDS::SampleLostStatus&)
+                              const DDS::SampleLostStatus& status)
   {
+    count_status(status);
     if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
       ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_sample_lost\n", listener_name_.c_str()));
     }
   }
 
+protected:
+  // Record how many samples one on_data_available took
+  static void record_queue_depth(size_t samples)
+  {
+    Metrics& metrics = Metrics::instance();
+    metrics.listener_queue_depth.record_us(samples);
+    metrics.listener_samples.add(samples);
+  }
+
 private:
   const std::string listener_name_;
 };
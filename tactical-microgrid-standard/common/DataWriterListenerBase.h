@@ -0,0 +1,60 @@
+#ifndef TMS_COMMON_DATA_WRITER_LISTENER_BASE_H
+#define TMS_COMMON_DATA_WRITER_LISTENER_BASE_H
+
+#include "StatusMetrics.h"
+
+#include <dds/DCPS/LocalObject.h>
+#include <dds/DCPS/debug.h>
+#include <dds/DdsDcpsPublicationC.h>
+
+class DataWriterListenerBase : public virtual OpenDDS::DCPS::LocalObject<DDS::DataWriterListener> {
+public:
+  explicit DataWriterListenerBase(const std::string& listener_name) : listener_name_(listener_name) {}
+
+  virtual void on_offered_deadline_missed(DDS::DataWriter_ptr,
+                                          const DDS::OfferedDeadlineMissedStatus& status)
+  {
+    count_status(status);
+    if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_offered_deadline_missed\n", listener_name_.c_str()));
+    }
+  }
+
+  virtual void on_offered_incompatible_qos(DDS::DataWriter_ptr,
+                                           const DDS::OfferedIncompatibleQosStatus& status)
+  {
+    count_status(status);
+    if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_offered_incompatible_qos\n", listener_name_.c_str()));
+    }
+  }
+
+  virtual void on_liveliness_lost(DDS::DataWriter_ptr,
+                                  const DDS::LivelinessLostStatus& status)
+  {
+    count_status(status);
+    if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_liveliness_lost\n", listener_name_.c_str()));
+    }
+  }
+
+  virtual void on_publication_matched(DDS::DataWriter_ptr,
+                                      const DDS::PublicationMatchedStatus& status)
+  {
+    count_status(status);
+    if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::on_publication_matched\n", listener_name_.c_str()));
+    }
+  }
+
+protected:
+  const std::string& listener_name() const
+  {
+    return listener_name_;
+  }
+
+private:
+  const std::string listener_name_;
+};
+
+#endif
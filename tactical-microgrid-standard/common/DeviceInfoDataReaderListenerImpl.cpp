@@ -9,12 +9,14 @@ void DeviceInfoDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr rea
     return;
   }
 
+  size_t taken = 0;
   while (true) {
     tms::DeviceInfo device_info;
     DDS::SampleInfo si;
     const DDS::ReturnCode_t rc = di_dr->take_next_sample(device_info, si);
 
     if (rc == DDS::RETCODE_OK) {
+      ++taken;
       if (callback_) {
         callback_(device_info, si);
       } else {
@@ -28,4 +30,5 @@ void DeviceInfoDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr rea
       break;
     }
   }
+  record_queue_depth(taken);
 }
@@ -1,6 +1,8 @@
 #include "Handshaking.h"
 #include "DeviceInfoDataReaderListenerImpl.h"
 #include "HeartbeatDataReaderListenerImpl.h"
+#include "Metrics.h"
+#include "StatusMetrics.h"
 #include "QosHelper.h"
 
 #include <dds/DCPS/PublisherImpl.h>
@@ -12,6 +14,8 @@
 #include <dds/DCPS/transport/framework/TransportInst.h>
 #include <dds/DCPS/StaticIncludes.h>
 
+#include <limits>
+
 Handshaking::~Handshaking()
 {
   delete_all_entities();
@@ -54,10 +58,12 @@ DDS::ReturnCode_t Handshaking::join_domain(DDS::DomainId_t domain_id, int argc,
     dpf_ = TheParticipantFactory;
   }
 
+  // Count the statuses of the writers and readers without a listener of their own
+  status_listener_ = new StatusMetricsListener;
   participant_ = dpf_->create_participant(domain_id,
                                           PARTICIPANT_QOS_DEFAULT,
-                                          nullptr,
-                                          OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+                                          status_listener_.in(),
+                                          StatusMetricsListener::mask);
   if (!participant_) {
     ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Handshaking::join_domain: create_participant failed\n"));
     return DDS::RETCODE_ERROR;
@@ -103,12 +109,32 @@ DDS::ReturnCode_t Handshaking::join_domain(DDS::DomainId_t domain_id, int argc,
     return DDS::RETCODE_ERROR;
   }
 
+  // and one for the MetricParameterState type
+  tms::MetricParameterStateTypeSupport_var mps_ts = new tms::MetricParameterStateTypeSupportImpl();
+  rc = mps_ts->register_type(participant_, "");
+  if (DDS::RETCODE_OK != rc) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Handshaking::join_domain: register_type for MetricParameterState failed\n"));
+    return rc;
+  }
+
+  CORBA::String_var mps_type_name = mps_ts->get_type_name();
+  mps_topic_ = participant_->create_topic(tms::topic::TOPIC_METRIC_PARAMETER_STATE.c_str(),
+                                          mps_type_name,
+                                          TOPIC_QOS_DEFAULT,
+                                          nullptr,
+                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!mps_topic_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Handshaking::join_domain: create topic '%C' failed\n",
+               tms::topic::TOPIC_METRIC_PARAMETER_STATE.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
   return DDS::RETCODE_OK;
 }
 
 DDS::ReturnCode_t Handshaking::create_publishers()
 {
-  if (!di_topic_ || !hb_topic_) {
+  if (!di_topic_ || !hb_topic_ || !mps_topic_) {
     ACE_ERROR((LM_NOTICE, "(%P|%t) NOTICE: Handshaking::create_publishers: create topics first with join_domain!\n"));
     return DDS::RETCODE_ERROR;
   }
@@ -156,6 +182,23 @@ DDS::ReturnCode_t Handshaking::create_publishers()
     return DDS::RETCODE_ERROR;
   }
 
+  const DDS::DataWriterQos& mps_qos = Qos::DataWriter::fn_map.at(tms::topic::TOPIC_METRIC_PARAMETER_STATE)(device_id_);
+  DDS::DataWriter_var mps_dw_base = pub->create_datawriter(mps_topic_,
+                                                           mps_qos,
+                                                           nullptr,
+                                                           ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!mps_dw_base) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Handshaking::create_publishers: create_datawriter for topic '%C' failed\n",
+               tms::topic::TOPIC_METRIC_PARAMETER_STATE.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  mps_dw_ = tms::MetricParameterStateDataWriter::_narrow(mps_dw_base.in());
+  if (!mps_dw_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Handshaking::create_publishers: MetricParameterStateDataWriter could not be narrowed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
   return DDS::RETCODE_OK;
 }
 
@@ -166,6 +209,22 @@ DDS::ReturnCode_t Handshaking::send_device_info(tms::DeviceInfo device_info)
     return DDS::RETCODE_ERROR;
   }
 
+  if (!device_info.metricParameters()) {
+    device_info.metricParameters(tms::ParameterMetadataSequence());
+  }
+  const float infinity = std::numeric_limits<float>::infinity();
+  for (const MetricInfo& info : Metrics::info()) {
+    tms::ParameterMetadata pm;
+    pm.name(info.name);
+    pm.units(info.units);
+    pm.nominalMinValue(0);
+    pm.nominalMaxValue(infinity);
+    pm.hardMinValue(0);
+    pm.hardMaxValue(infinity);
+    pm.resolution(info.resolution);
+    device_info.metricParameters()->push_back(pm);
+  }
+
   const DDS::InstanceHandle_t instance_handle = di_dw_->register_instance(device_info);
   if (instance_handle == DDS::HANDLE_NIL) {
     return DDS::RETCODE_ERROR;
@@ -173,9 +232,14 @@ DDS::ReturnCode_t Handshaking::send_device_info(tms::DeviceInfo device_info)
 
   const DDS::ReturnCode_t rc = di_dw_->write(device_info, instance_handle);
   if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
     return rc;
   }
 
+  if (mps_dw_ && !get_timer<PublishMetricsEvent>()->active()) {
+    schedule(PublishMetricsEvent(), metrics_period);
+  }
+
   return start_heartbeats();
 }
 
@@ -190,6 +254,7 @@ DDS::ReturnCode_t Handshaking::start_heartbeats()
     tms::Heartbeat hb;
     hb.deviceId(device_id_);
     HeartbeatEvent hb_ev = { hb };
+    last_heartbeat_ = std::chrono::steady_clock::time_point();
     schedule(hb_ev, heartbeat_period);
   }
 
@@ -250,9 +315,37 @@ DDS::ReturnCode_t Handshaking::create_subscribers(
 
 void Handshaking::timer_fired(Timer<HeartbeatEvent>& timer)
 {
+  const auto now = std::chrono::steady_clock::now();
+  if (last_heartbeat_ != std::chrono::steady_clock::time_point()) {
+    const auto late = now - last_heartbeat_ - heartbeat_period;
+    Metrics::instance().heartbeat_jitter.record(late < late.zero() ? -late : late);
+  }
+  last_heartbeat_ = now;
+
   timer.arg.hb.sequenceNumber(seq_num_++);
   const DDS::ReturnCode_t rc = hb_dw_->write(timer.arg.hb, DDS::HANDLE_NIL);
   if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
     ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: Handshaking::send_heartbeats: write Heartbeat failed\n"));
   }
 }
+
+void Handshaking::timer_fired(Timer<PublishMetricsEvent>&)
+{
+  const std::vector<MetricInfo>& info = Metrics::info();
+  const std::vector<float> values = Metrics::instance().values();
+  tms::MetricParameterState mps;
+  mps.deviceId(device_id_);
+  for (size_t i = 0; i < info.size(); ++i) {
+    tms::ParameterValue pv;
+    pv.name(info[i].name);
+    pv.value(values[i]);
+    mps.metricParameters().push_back(pv);
+  }
+
+  const DDS::ReturnCode_t rc = mps_dw_->write(mps, DDS::HANDLE_NIL);
+  if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: Handshaking::publish_metrics: write MetricParameterState failed\n"));
+  }
+}
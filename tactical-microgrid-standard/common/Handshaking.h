@@ -15,10 +15,14 @@ struct HeartbeatEvent {
   static const char* name() { return "tms::Heartbeat"; }
 };
 
-class OpenDDS_TMS_Export Handshaking : public TimerHandler<HeartbeatEvent> {
+struct PublishMetricsEvent {
+  static const char* name() { return "PublishMetrics"; }
+};
+
+class OpenDDS_TMS_Export Handshaking : public TimerHandler<HeartbeatEvent, PublishMetricsEvent> {
 public:
   explicit Handshaking(const tms::Identity& device_id)
-    : TimerHandler(ACE_Reactor::instance())
+    : TimerHandler(ACE_Reactor::instance(), "Handshaking")
     , device_id_(device_id)
     , seq_num_(0)
   {}
@@ -26,12 +30,15 @@ public:
   virtual ~Handshaking();
 
   // Initialize a domain participant for the given domain ID.
-  // Create the DeviceInfo and Heartbeat topics.
+  // Create the DeviceInfo, Heartbeat, and MetricParameterState topics.
   DDS::ReturnCode_t join_domain(DDS::DomainId_t domain_id, int argc = 0, char* argv[] = nullptr);
 
-  // Create publishers and data writers for the DeviceInfo and Heartbeat topics.
+  // Create publishers and data writers for the DeviceInfo, Heartbeat, and
+  // MetricParameterState topics.
   DDS::ReturnCode_t create_publishers();
 
+  // Add the runtime metrics of the process to the metricParameters of
+  // device_info, send it, and start sending heartbeats and metrics.
   DDS::ReturnCode_t send_device_info(tms::DeviceInfo device_info);
 
   // Send heartbeats in a separate thread
@@ -79,19 +86,26 @@ protected:
 
 private:
   static constexpr Sec heartbeat_period = Sec(1);
+  // Within the 20 second deadline of the Slow QoS profile
+  static constexpr Sec metrics_period = Sec(10);
 
   void timer_fired(Timer<HeartbeatEvent>& timer);
+  void timer_fired(Timer<PublishMetricsEvent>& timer);
   void any_timer_fired(AnyTimer timer)
   {
     std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
   }
 
   DDS::DomainParticipantFactory_var dpf_;
-  DDS::Topic_var di_topic_, hb_topic_;
+  DDS::DomainParticipantListener_var status_listener_;
+  DDS::Topic_var di_topic_, hb_topic_, mps_topic_;
   tms::DeviceInfoDataWriter_var di_dw_;
   tms::HeartbeatDataWriter_var hb_dw_;
+  tms::MetricParameterStateDataWriter_var mps_dw_;
 
   uint32_t seq_num_;
+  // When the last heartbeat was sent, for measuring the jitter of the next one
+  std::chrono::steady_clock::time_point last_heartbeat_;
 };
 
 #endif // HANDSHAKING_H
@@ -9,12 +9,14 @@ void HeartbeatDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr read
     return;
   }
 
+  size_t taken = 0;
   while (true) {
     tms::Heartbeat heartbeat;
     DDS::SampleInfo si;
     const DDS::ReturnCode_t rc = hb_dr->take_next_sample(heartbeat, si);
 
     if (rc == DDS::RETCODE_OK) {
+      ++taken;
       if (callback_) {
         callback_(heartbeat, si);
       } else {
@@ -28,4 +30,5 @@ void HeartbeatDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr read
       break;
     }
   }
+  record_queue_depth(taken);
 }
@@ -0,0 +1,188 @@
+#ifndef TMS_COMMON_HISTOGRAM_H
+#define TMS_COMMON_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+/**
+ * Histogram of durations with power-of-two buckets in microseconds, i.e. bucket
+ * i counts durations in [2^(i-1), 2^i) us, and bucket 0 counts durations under
+ * 1 us. Recording is constant time and the histogram is a fixed size, so it can
+ * be kept per device or per lock. It is not thread-safe.
+ */
+class Histogram {
+public:
+  static constexpr size_t bucket_count = 40;
+
+  template <typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period>& d)
+  {
+    using namespace std::chrono;
+    const int64_t us_signed = duration_cast<microseconds>(d).count();
+    record_us(us_signed < 0 ? 0 : static_cast<uint64_t>(us_signed));
+  }
+
+  void record_us(uint64_t us)
+  {
+    ++buckets_[bucket_of(us)];
+    ++count_;
+    sum_us_ += us;
+    if (us < min_us_) {
+      min_us_ = us;
+    }
+    if (us > max_us_) {
+      max_us_ = us;
+    }
+  }
+
+  void merge(const Histogram& other)
+  {
+    for (size_t i = 0; i < bucket_count; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_us_ += other.sum_us_;
+    if (other.min_us_ < min_us_) {
+      min_us_ = other.min_us_;
+    }
+    if (other.max_us_ > max_us_) {
+      max_us_ = other.max_us_;
+    }
+  }
+
+  uint64_t count() const
+  {
+    return count_;
+  }
+
+  uint64_t sum_us() const
+  {
+    return sum_us_;
+  }
+
+  uint64_t min_us() const
+  {
+    return count_ ? min_us_ : 0;
+  }
+
+  uint64_t max_us() const
+  {
+    return max_us_;
+  }
+
+  double mean_us() const
+  {
+    return count_ ? static_cast<double>(sum_us_) / count_ : 0.0;
+  }
+
+  uint64_t bucket(size_t i) const
+  {
+    return buckets_[i];
+  }
+
+  // Upper bound in microseconds of bucket i
+  static uint64_t bucket_limit_us(size_t i)
+  {
+    return uint64_t(1) << i;
+  }
+
+  // Upper bound of the bucket containing the q-th quantile, 0 <= q <= 1
+  uint64_t quantile_us(double q) const
+  {
+    if (!count_) {
+      return 0;
+    }
+    const uint64_t rank = static_cast<uint64_t>(q * (count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        const uint64_t limit = bucket_limit_us(i);
+        return limit < max_us_ ? limit : max_us_;
+      }
+    }
+    return max_us_;
+  }
+
+  std::string summary() const
+  {
+    std::ostringstream oss;
+    oss << "count=" << count_ << " min=" << min_us() << "us mean=" << static_cast<uint64_t>(mean_us())
+        << "us p50<=" << quantile_us(0.5) << "us p99<=" << quantile_us(0.99) << "us max=" << max_us_ << "us";
+    return oss.str();
+  }
+
+private:
+  friend class AtomicHistogram;
+  friend class ShardedHistogram;
+
+  static size_t bucket_of(uint64_t us)
+  {
+    size_t i = 0;
+    while (us && i < bucket_count - 1) {
+      us >>= 1;
+      ++i;
+    }
+    return i;
+  }
+
+  std::array<uint64_t, bucket_count> buckets_{};
+  uint64_t count_ = 0;
+  uint64_t sum_us_ = 0;
+  uint64_t min_us_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_us_ = 0;
+};
+
+/**
+ * Histogram with the same buckets as Histogram that can be recorded to from
+ * multiple threads without a lock. Use snapshot() to read it.
+ */
+class AtomicHistogram {
+public:
+  void record_us(uint64_t us)
+  {
+    buckets_[Histogram::bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  template <typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period>& d)
+  {
+    using namespace std::chrono;
+    const int64_t us_signed = duration_cast<microseconds>(d).count();
+    record_us(us_signed < 0 ? 0 : static_cast<uint64_t>(us_signed));
+  }
+
+  // Minimums aren't tracked, so the snapshot reports the lower bound of the lowest bucket.
+  Histogram snapshot() const
+  {
+    Histogram h;
+    for (size_t i = 0; i < Histogram::bucket_count; ++i) {
+      h.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+      if (h.buckets_[i] && h.min_us_ == std::numeric_limits<uint64_t>::max()) {
+        h.min_us_ = i ? Histogram::bucket_limit_us(i - 1) : 0;
+      }
+    }
+    h.count_ = count_.load(std::memory_order_relaxed);
+    h.sum_us_ = sum_us_.load(std::memory_order_relaxed);
+    h.max_us_ = max_us_.load(std::memory_order_relaxed);
+    return h;
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, Histogram::bucket_count> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "Metrics.h"
+
+Metrics& Metrics::instance()
+{
+  static Metrics metrics;
+  return metrics;
+}
+
+const std::vector<MetricInfo>& Metrics::info()
+{
+  // Names are at most 32 characters and units 16 to fit ParameterMetadata
+  static const std::vector<MetricInfo> info = {
+    {"heartbeatJitterP99", "us", 0},
+    {"heartbeatJitterMax", "us", 0},
+    {"timerQueueDepth", "timers", 1},
+    {"listenerQueueDepthP99", "samples", 1},
+    {"listenerQueueDepthMax", "samples", 1},
+    {"essrRoundTrips", "requests", 1},
+    {"essrRoundTripP50", "us", 0},
+    {"essrRoundTripP99", "us", 0},
+    {"selectionChanges", "changes", 1},
+    {"writeFailures", "writes", 1},
+  };
+  return info;
+}
+
+std::vector<float> Metrics::values() const
+{
+  const Histogram jitter = heartbeat_jitter.snapshot();
+  const Histogram depth = listener_queue_depth.snapshot();
+  const Histogram essr = essr_round_trip.snapshot();
+  const int64_t timers = timer_queue_depth.value();
+  return {
+    static_cast<float>(jitter.quantile_us(0.99)),
+    static_cast<float>(jitter.max_us()),
+    static_cast<float>(timers < 0 ? 0 : timers),
+    static_cast<float>(depth.quantile_us(0.99)),
+    static_cast<float>(depth.max_us()),
+    static_cast<float>(essr.count()),
+    static_cast<float>(essr.quantile_us(0.5)),
+    static_cast<float>(essr.quantile_us(0.99)),
+    static_cast<float>(selection_changes.value()),
+    static_cast<float>(write_failures.value()),
+  };
+}
@@ -0,0 +1,80 @@
+#ifndef TMS_COMMON_METRICS_H
+#define TMS_COMMON_METRICS_H
+
+#include "ShardedMetrics.h"
+
+#include <common/OpenDDS_TMS_export.h>
+
+#include <cstdint>
+#include <vector>
+
+// Describes a value of Metrics::values()
+struct MetricInfo {
+  const char* name;
+  const char* units;
+  // Smallest change of the value, 0 if there's none
+  float resolution;
+};
+
+/**
+ * Runtime metrics of this process, recorded per thread without a lock. Handshaking
+ * publishes a summary of them as the MetricParameterState of the device and
+ * describes it in the metricParameters of its DeviceInfo. MetricsExporter
+ * serves all of them to Prometheus. Histograms and counters accumulate for the
+ * lifetime of the process.
+ */
+class OpenDDS_TMS_Export Metrics {
+public:
+  static Metrics& instance();
+
+  // How far each heartbeat was sent from one period after the previous one
+  ShardedHistogram heartbeat_jitter;
+
+  // Round trip of the EnergyStartStopRequests that were replied to
+  ShardedHistogram essr_round_trip;
+
+  // Samples taken by a data reader listener in one on_data_available
+  ShardedHistogram listener_queue_depth;
+  ShardedCounter listener_samples;
+
+  // Timers of all the TimerHandlers of the process
+  ShardedCounter timers_scheduled;
+  ShardedCounter timers_fired;
+  ShardedGauge timer_queue_depth;
+  // How long handling a timer took
+  ShardedHistogram timer_callback;
+
+  // Changes of the active controller made by ControllerSelector
+  ShardedCounter selection_changes;
+
+  // DDS writes that didn't return RETCODE_OK
+  ShardedCounter write_failures;
+
+  // Totals of the communication statuses of all data writers and readers. The
+  // matched gauges are the readers matched with the writers and the writers
+  // matched with the readers.
+  ShardedCounter offered_deadline_missed;
+  ShardedCounter offered_incompatible_qos;
+  ShardedCounter liveliness_lost;
+  ShardedCounter publication_matched;
+  ShardedGauge matched_readers;
+  ShardedCounter requested_deadline_missed;
+  ShardedCounter requested_incompatible_qos;
+  ShardedCounter sample_lost;
+  ShardedCounter sample_rejected;
+  ShardedCounter subscription_matched;
+  ShardedGauge matched_writers;
+  ShardedCounter inconsistent_topics;
+
+  void write_failed()
+  {
+    write_failures.add();
+  }
+
+  static const std::vector<MetricInfo>& info();
+
+  // Current values in the order of info()
+  std::vector<float> values() const;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "ProfiledMutex.h"
+
+#include <ace/INET_Addr.h>
+#include <ace/Log_Msg.h>
+#include <ace/OS_NS_unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Longest request that's read, the metrics don't need more than the request line
+constexpr size_t max_request_size = 8192;
+
+std::string escape_label(const std::string& value)
+{
+  std::string escaped;
+  for (const char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+class Writer {
+public:
+  Writer()
+  {
+    out_.precision(12);
+  }
+
+  void family(const char* name, const char* type, const char* help)
+  {
+    out_ << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+  }
+
+  template <typename Value>
+  void sample(const char* name, const std::string& labels, Value value)
+  {
+    out_ << name;
+    if (!labels.empty()) {
+      out_ << '{' << labels << '}';
+    }
+    out_ << ' ' << value << '\n';
+  }
+
+  template <typename Value>
+  void single(const char* name, const char* type, const char* help, Value value)
+  {
+    family(name, type, help);
+    sample(name, "", value);
+  }
+
+  // The buckets are in microseconds, scale converts them, e.g. 1e-6 to seconds
+  void histogram(const char* name, const std::string& labels, const Histogram& h, double scale)
+  {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    // Bucket i holds whole microseconds in [2^(i-1), 2^i), so its inclusive bound
+    // is 2^i - 1. The last bucket also holds everything larger and is only +Inf.
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i + 1 < Histogram::bucket_count; ++i) {
+      cumulative += h.bucket(i);
+      out_ << name << "_bucket{" << prefix << "le=\"" << (Histogram::bucket_limit_us(i) - 1) * scale << "\"} "
+           << cumulative << '\n';
+    }
+    out_ << name << "_bucket{" << prefix << "le=\"+Inf\"} " << h.count() << '\n';
+    const std::string braced = labels.empty() ? "" : '{' + labels + '}';
+    out_ << name << "_sum" << braced << ' ' << h.sum_us() * scale << '\n';
+    out_ << name << "_count" << braced << ' ' << h.count() << '\n';
+  }
+
+  void single_histogram(const char* name, const char* help, const Histogram& h, double scale)
+  {
+    family(name, "histogram", help);
+    histogram(name, "", h, scale);
+  }
+
+  std::string str() const
+  {
+    return out_.str();
+  }
+
+private:
+  std::ostringstream out_;
+};
+
+}
+
+MetricsExporter::MetricsExporter(const std::string& device_id)
+  : device_id_(device_id)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  stop();
+}
+
+bool MetricsExporter::start(u_short port)
+{
+  const ACE_INET_Addr addr(port, static_cast<ACE_UINT32>(INADDR_LOOPBACK));
+  if (acceptor_.open(addr, 1) == -1) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MetricsExporter::start: listen on port %u failed: %m\n", port));
+    return false;
+  }
+
+  ACE_INET_Addr local;
+  acceptor_.get_local_addr(local);
+  port_ = local.get_port_number();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: MetricsExporter::start: serving metrics at http://127.0.0.1:%u/metrics\n",
+             port_));
+  thread_ = std::thread(&MetricsExporter::run, this);
+  return true;
+}
+
+void MetricsExporter::stop()
+{
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  thread_.join();
+  acceptor_.close();
+}
+
+void MetricsExporter::run()
+{
+  // Wake up regularly to see if the exporter is stopping
+  const ACE_Time_Value poll(0, 200000);
+  while (!stopping_) {
+    ACE_SOCK_Stream peer;
+    if (acceptor_.accept(peer, nullptr, &poll) == -1) {
+      if (errno != ETIME && errno != EWOULDBLOCK && errno != EINTR) {
+        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: MetricsExporter::run: accept failed: %m\n"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      }
+      continue;
+    }
+    serve(peer);
+    peer.close();
+  }
+}
+
+void MetricsExporter::serve(ACE_SOCK_Stream& peer)
+{
+  const ACE_Time_Value timeout(1);
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+         request.size() < max_request_size) {
+    const ssize_t n = peer.recv(buffer, sizeof buffer, &timeout);
+    if (n <= 0) {
+      return;
+    }
+    request.append(buffer, n);
+  }
+
+  // Request line: GET /metrics HTTP/1.1
+  const std::string line = request.substr(0, request.find_first_of("\r\n"));
+  std::string status = "200 OK";
+  std::string body;
+  if (line.compare(0, 4, "GET ") != 0) {
+    status = "405 Method Not Allowed";
+  } else {
+    const std::string target = line.substr(4, line.find(' ', 4) - 4);
+    if (target.substr(0, target.find('?')) == "/metrics") {
+      body = scrape();
+    } else {
+      status = "404 Not Found";
+    }
+  }
+
+  std::ostringstream response;
+  response << "HTTP/1.1 " << status << "\r\n"
+           << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << body;
+  const std::string bytes = response.str();
+  if (peer.send_n(bytes.data(), bytes.size(), &timeout) != static_cast<ssize_t>(bytes.size())) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: MetricsExporter::serve: send response failed: %m\n"));
+  }
+}
+
+std::string MetricsExporter::scrape() const
+{
+  const Metrics& m = Metrics::instance();
+  Writer w;
+
+  w.family("tms_device_info", "gauge", "Device of the process");
+  w.sample("tms_device_info", "device_id=\"" + escape_label(device_id_) + '"', 1);
+
+  w.single("tms_timers_scheduled_total", "counter", "Timers scheduled", m.timers_scheduled.value());
+  w.single("tms_timers_fired_total", "counter", "Timers that fired", m.timers_fired.value());
+  w.single("tms_timer_queue_depth", "gauge", "Timers currently scheduled", m.timer_queue_depth.value());
+  w.single_histogram("tms_timer_callback_seconds", "Time taken to handle a timer", m.timer_callback.snapshot(), 1e-6);
+  w.single_histogram("tms_heartbeat_jitter_seconds", "How far heartbeats were sent from one period after the previous one",
+                     m.heartbeat_jitter.snapshot(), 1e-6);
+
+  w.single("tms_listener_samples_total", "counter", "Samples taken by data reader listeners", m.listener_samples.value());
+  w.single_histogram("tms_listener_batch_samples", "Samples taken by a data reader listener at once",
+                     m.listener_queue_depth.snapshot(), 1);
+
+  w.single_histogram("tms_essr_round_trip_seconds", "Round trip of replied EnergyStartStopRequests",
+                     m.essr_round_trip.snapshot(), 1e-6);
+  w.single("tms_selection_changes_total", "counter", "Changes of the active controller", m.selection_changes.value());
+  w.single("tms_dds_write_failures_total", "counter", "DDS writes that failed", m.write_failures.value());
+
+  w.family("tms_dds_writer_status_total", "counter", "Communication status changes of the data writers");
+  w.sample("tms_dds_writer_status_total", "status=\"offered_deadline_missed\"", m.offered_deadline_missed.value());
+  w.sample("tms_dds_writer_status_total", "status=\"offered_incompatible_qos\"", m.offered_incompatible_qos.value());
+  w.sample("tms_dds_writer_status_total", "status=\"liveliness_lost\"", m.liveliness_lost.value());
+  w.sample("tms_dds_writer_status_total", "status=\"publication_matched\"", m.publication_matched.value());
+  w.family("tms_dds_reader_status_total", "counter", "Communication status changes of the data readers");
+  w.sample("tms_dds_reader_status_total", "status=\"requested_deadline_missed\"", m.requested_deadline_missed.value());
+  w.sample("tms_dds_reader_status_total", "status=\"requested_incompatible_qos\"", m.requested_incompatible_qos.value());
+  w.sample("tms_dds_reader_status_total", "status=\"sample_lost\"", m.sample_lost.value());
+  w.sample("tms_dds_reader_status_total", "status=\"sample_rejected\"", m.sample_rejected.value());
+  w.sample("tms_dds_reader_status_total", "status=\"subscription_matched\"", m.subscription_matched.value());
+  w.single("tms_dds_inconsistent_topics_total", "counter", "Inconsistent topics discovered", m.inconsistent_topics.value());
+  w.single("tms_dds_writer_matched_readers", "gauge", "Readers matched with the data writers", m.matched_readers.value());
+  w.single("tms_dds_reader_matched_writers", "gauge", "Writers matched with the data readers", m.matched_writers.value());
+
+#ifdef TMS_LOCK_PROFILING
+  // Lock statistics are only recorded with lock profiling
+  struct Lock {
+    std::string labels;
+    uint64_t acquisitions;
+    uint64_t contended;
+    Histogram wait;
+    Histogram hold;
+  };
+  std::vector<Lock> locks;
+  LockRegistry::instance().visit([&](const std::string& name, const LockStats& s) {
+    locks.push_back(Lock{"lock=\"" + escape_label(name) + '"', s.acquisitions.load(), s.contended.load(),
+                         s.wait.snapshot(), s.hold.snapshot()});
+  });
+  w.family("tms_lock_acquisitions_total", "counter", "Acquisitions of the named locks");
+  for (const Lock& lock : locks) {
+    w.sample("tms_lock_acquisitions_total", lock.labels, lock.acquisitions);
+  }
+  w.family("tms_lock_contended_total", "counter", "Acquisitions that waited for another thread");
+  for (const Lock& lock : locks) {
+    w.sample("tms_lock_contended_total", lock.labels, lock.contended);
+  }
+  w.family("tms_lock_wait_seconds", "histogram", "Time spent waiting for the named locks");
+  for (const Lock& lock : locks) {
+    w.histogram("tms_lock_wait_seconds", lock.labels, lock.wait, 1e-6);
+  }
+  w.family("tms_lock_hold_seconds", "histogram", "Time the named locks were held");
+  for (const Lock& lock : locks) {
+    w.histogram("tms_lock_hold_seconds", lock.labels, lock.hold, 1e-6);
+  }
+#endif
+
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size_pages, resident_pages;
+  if (statm >> size_pages >> resident_pages) {
+    const uint64_t page_size = ACE_OS::getpagesize();
+    w.single("process_virtual_memory_bytes", "gauge", "Virtual memory size", size_pages * page_size);
+    w.single("process_resident_memory_bytes", "gauge", "Resident memory size", resident_pages * page_size);
+  }
+#endif
+
+  return w.str();
+}
@@ -0,0 +1,50 @@
+#ifndef TMS_COMMON_METRICS_EXPORTER_H
+#define TMS_COMMON_METRICS_EXPORTER_H
+
+#include <common/OpenDDS_TMS_export.h>
+
+#include <ace/SOCK_Acceptor.h>
+#include <ace/SOCK_Stream.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/**
+ * Serves Metrics, the lock statistics and the memory use of the process in the
+ * Prometheus text format at http://127.0.0.1:<port>/metrics. Requests are
+ * answered one at a time by a thread of its own, and that is the only place
+ * where the per-thread metrics are summed up.
+ */
+class OpenDDS_TMS_Export MetricsExporter {
+public:
+  explicit MetricsExporter(const std::string& device_id);
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  // Listen on the port of the loopback interface, 0 picks a free port
+  bool start(u_short port);
+  void stop();
+
+  u_short port() const
+  {
+    return port_;
+  }
+
+  // The metrics in the Prometheus text format
+  std::string scrape() const;
+
+private:
+  void run();
+  void serve(ACE_SOCK_Stream& peer);
+
+  const std::string device_id_;
+  ACE_SOCK_Acceptor acceptor_;
+  u_short port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+};
+
+#endif
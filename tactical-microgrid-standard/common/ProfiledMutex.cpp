@@ -0,0 +1,73 @@
+#include "ProfiledMutex.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+LockRegistry& LockRegistry::instance()
+{
+  static LockRegistry registry;
+  return registry;
+}
+
+LockStats& LockRegistry::stats(const std::string& name)
+{
+  std::lock_guard<std::mutex> guard(m_);
+  auto& stats = stats_[name];
+  if (!stats) {
+    stats.reset(new LockStats);
+  }
+  return *stats;
+}
+
+void LockRegistry::visit(const std::function<void(const std::string&, const LockStats&)>& f) const
+{
+  std::lock_guard<std::mutex> guard(m_);
+  for (const auto& pair : stats_) {
+    f(pair.first, *pair.second);
+  }
+}
+
+std::string LockRegistry::report() const
+{
+#ifndef TMS_LOCK_PROFILING
+  return "Lock profiling is disabled. Build with -DTMS_LOCK_PROFILING=ON to enable it.\n";
+#else
+  struct Row {
+    std::string name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    Histogram wait;
+    Histogram hold;
+  };
+
+  std::vector<Row> rows;
+  {
+    std::lock_guard<std::mutex> guard(m_);
+    for (const auto& pair : stats_) {
+      const LockStats& s = *pair.second;
+      rows.push_back(Row{pair.first, s.acquisitions.load(), s.contended.load(), s.wait.snapshot(), s.hold.snapshot()});
+    }
+  }
+
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return a.wait.sum_us() > b.wait.sum_us();
+  });
+
+  std::ostringstream oss;
+  oss << std::left << std::setw(36) << "Lock" << std::right
+      << std::setw(12) << "Acquired" << std::setw(12) << "Contended"
+      << std::setw(14) << "Wait total" << std::setw(12) << "Wait p99" << std::setw(12) << "Wait max"
+      << std::setw(14) << "Hold total" << std::setw(12) << "Hold p99" << std::setw(12) << "Hold max" << '\n';
+  for (const Row& row : rows) {
+    oss << std::left << std::setw(36) << row.name << std::right
+        << std::setw(12) << row.acquisitions << std::setw(12) << row.contended
+        << std::setw(12) << row.wait.sum_us() << "us" << std::setw(10) << row.wait.quantile_us(0.99) << "us"
+        << std::setw(10) << row.wait.max_us() << "us"
+        << std::setw(12) << row.hold.sum_us() << "us" << std::setw(10) << row.hold.quantile_us(0.99) << "us"
+        << std::setw(10) << row.hold.max_us() << "us" << '\n';
+  }
+  return oss.str();
+#endif
+}
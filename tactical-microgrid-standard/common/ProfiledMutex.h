@@ -0,0 +1,128 @@
+#ifndef TMS_COMMON_PROFILED_MUTEX_H
+#define TMS_COMMON_PROFILED_MUTEX_H
+
+#include "Histogram.h"
+
+#include <common/OpenDDS_TMS_export.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Usage statistics of all mutexes with the same name
+struct LockStats {
+  std::atomic<uint64_t> acquisitions{0};
+  // Acquisitions that had to wait for another thread to release the mutex
+  std::atomic<uint64_t> contended{0};
+  AtomicHistogram wait;
+  AtomicHistogram hold;
+};
+
+class OpenDDS_TMS_Export LockRegistry {
+public:
+  static LockRegistry& instance();
+
+  // The returned reference is valid for the lifetime of the process.
+  LockStats& stats(const std::string& name);
+
+  // Table of the statistics of each named mutex, the most waited for first
+  std::string report() const;
+
+  // Call f with the name and statistics of each named mutex
+  void visit(const std::function<void(const std::string&, const LockStats&)>& f) const;
+
+private:
+  mutable std::mutex m_;
+  std::map<std::string, std::unique_ptr<LockStats>> stats_;
+};
+
+#ifdef TMS_LOCK_PROFILING
+
+/**
+ * Drop-in replacement for BaseMutex (std::mutex or std::recursive_mutex) that
+ * records acquisitions, contended acquisitions, and histograms of the time spent
+ * waiting for and holding it. For recursive mutexes only the outermost lock and
+ * unlock count. Use std::condition_variable_any to wait on it.
+ */
+template <typename BaseMutex>
+class ProfiledMutex {
+public:
+  explicit ProfiledMutex(const char* name)
+    : stats_(LockRegistry::instance().stats(name))
+  {
+  }
+
+  ProfiledMutex(const ProfiledMutex&) = delete;
+  ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+  void lock()
+  {
+    if (base_.try_lock()) {
+      acquired(false, std::chrono::steady_clock::duration::zero());
+      return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    base_.lock();
+    acquired(true, std::chrono::steady_clock::now() - start);
+  }
+
+  bool try_lock()
+  {
+    if (!base_.try_lock()) {
+      return false;
+    }
+    acquired(false, std::chrono::steady_clock::duration::zero());
+    return true;
+  }
+
+  void unlock()
+  {
+    // Only the owner gets here, so depth_ and acquired_at_ are protected by base_.
+    if (--depth_ == 0) {
+      stats_.hold.record(std::chrono::steady_clock::now() - acquired_at_);
+    }
+    base_.unlock();
+  }
+
+private:
+  void acquired(bool contended, std::chrono::steady_clock::duration wait)
+  {
+    if (depth_++ > 0) {
+      return;
+    }
+    acquired_at_ = std::chrono::steady_clock::now();
+    stats_.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+      stats_.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    stats_.wait.record(wait);
+  }
+
+  BaseMutex base_;
+  LockStats& stats_;
+  unsigned depth_ = 0;
+  std::chrono::steady_clock::time_point acquired_at_;
+};
+
+#else
+
+// Lock profiling is disabled, this is just BaseMutex.
+template <typename BaseMutex>
+class ProfiledMutex : public BaseMutex {
+public:
+  explicit ProfiledMutex(const char*)
+  {
+  }
+};
+
+#endif
+
+using SimpleMutex = ProfiledMutex<std::mutex>;
+using SimpleGuard = std::lock_guard<SimpleMutex>;
+
+#endif
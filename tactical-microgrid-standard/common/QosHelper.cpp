@@ -19,7 +19,13 @@ const FnMap fn_map = {
   {tms::topic::TOPIC_OPERATOR_INTENT_REQUEST, get_Command},
   {tms::topic::TOPIC_ENERGY_START_STOP_REQUEST, get_Command},
   {tms::topic::TOPIC_REPLY, get_Reply},
-  {tms::topic::TOPIC_ACTIVE_MICROGRID_CONTROLLER_STATE, get_PublishLast} };
+  {tms::topic::TOPIC_ACTIVE_MICROGRID_CONTROLLER_STATE, get_PublishLast},
+  {tms::topic::TOPIC_AC_MEASUREMENT_UPDATE, get_Medium},
+  {tms::topic::TOPIC_DC_MEASUREMENT_UPDATE, get_Medium},
+  {tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE, get_Continuous},
+  {tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE, get_Continuous},
+  {tms::topic::TOPIC_STORAGE_UPDATE, get_Slow},
+  {tms::topic::TOPIC_METRIC_PARAMETER_STATE, get_Slow} };
 }
 
 namespace DataWriter {
@@ -30,7 +36,13 @@ const FnMap fn_map = {
   {tms::topic::TOPIC_OPERATOR_INTENT_REQUEST, get_Command},
   {tms::topic::TOPIC_ENERGY_START_STOP_REQUEST, get_Command},
   {tms::topic::TOPIC_REPLY, get_Reply},
-  {tms::topic::TOPIC_ACTIVE_MICROGRID_CONTROLLER_STATE, get_PublishLast} };
+  {tms::topic::TOPIC_ACTIVE_MICROGRID_CONTROLLER_STATE, get_PublishLast},
+  {tms::topic::TOPIC_AC_MEASUREMENT_UPDATE, get_Medium},
+  {tms::topic::TOPIC_DC_MEASUREMENT_UPDATE, get_Medium},
+  {tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE, get_Continuous},
+  {tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE, get_Continuous},
+  {tms::topic::TOPIC_STORAGE_UPDATE, get_Slow},
+  {tms::topic::TOPIC_METRIC_PARAMETER_STATE, get_Slow} };
 }
 
 }
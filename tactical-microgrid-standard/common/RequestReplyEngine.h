@@ -0,0 +1,372 @@
+#ifndef TMS_COMMON_REQUEST_REPLY_ENGINE_H
+#define TMS_COMMON_REQUEST_REPLY_ENGINE_H
+
+#include "TimerHandler.h"
+#include "Histogram.h"
+
+#include <common/mil-std-3071_data_modelTypeSupportImpl.h>
+
+#include <dds/DCPS/debug.h>
+
+#include <functional>
+#include <future>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Describes how to correlate a TMS request topic with tms::Reply.
+// Request must have a sequenceId field and a target device in its requestId.
+template <typename Request>
+struct RequestTraits;
+
+template <>
+struct RequestTraits<tms::EnergyStartStopRequest> {
+  static const char* name() { return "tms::EnergyStartStopRequest"; }
+  static tms::RequestSequence sequence_id(const tms::EnergyStartStopRequest& r) { return r.sequenceId(); }
+  static void sequence_id(tms::EnergyStartStopRequest& r, tms::RequestSequence seq) { r.sequenceId(seq); }
+  static const tms::Identity& target(const tms::EnergyStartStopRequest& r) { return r.requestId().targetDeviceId(); }
+};
+
+template <>
+struct RequestTraits<tms::PowerSwitchRequest> {
+  static const char* name() { return "tms::PowerSwitchRequest"; }
+  static tms::RequestSequence sequence_id(const tms::PowerSwitchRequest& r) { return r.sequenceId(); }
+  static void sequence_id(tms::PowerSwitchRequest& r, tms::RequestSequence seq) { r.sequenceId(seq); }
+  static const tms::Identity& target(const tms::PowerSwitchRequest& r) { return r.requestId().targetDeviceId(); }
+};
+
+template <>
+struct RequestTraits<tms::ControlParameterRequest> {
+  static const char* name() { return "tms::ControlParameterRequest"; }
+  static tms::RequestSequence sequence_id(const tms::ControlParameterRequest& r) { return r.sequenceId(); }
+  static void sequence_id(tms::ControlParameterRequest& r, tms::RequestSequence seq) { r.sequenceId(seq); }
+  static const tms::Identity& target(const tms::ControlParameterRequest& r) { return r.requestId().targetDeviceId(); }
+};
+
+struct RequestSweepEvent {
+  static const char* name() { return "RequestReplyEngine::Sweep"; }
+};
+
+/**
+ * Correlates requests of a TMS request topic with the tms::Reply samples sent
+ * back by the target devices.
+ *
+ * Each request is assigned the next sequence number and tracked until a reply
+ * with the same target device and sequence number arrives, or until it expired
+ * after the configured number of retries. Deadlines are checked by a periodic
+ * sweep timer on the given reactor, so the engine adds a single timer no matter
+ * how many requests are pending. Completion is reported through a callback or a
+ * future, outside of the engine's lock. Round-trip times of replies are kept in a
+ * histogram per target device.
+ *
+ * Replies don't say which request topic they answer, so engines for different
+ * request topics must not be used with the same target devices unless their
+ * sequence numbers are kept apart with first_sequence.
+ */
+template <typename Request>
+class RequestReplyEngine : public TimerHandler<RequestSweepEvent> {
+public:
+  using Traits = RequestTraits<Request>;
+
+  enum class Outcome {
+    REPLIED,
+    EXPIRED,
+    SEND_FAILED,
+    CANCELLED
+  };
+
+  struct Result {
+    Outcome outcome;
+    tms::Identity target;
+    tms::RequestSequence sequence_id;
+    unsigned attempts;
+    // Only set if outcome is REPLIED
+    std::optional<tms::Reply> reply;
+    Sec round_trip = Sec(0);
+  };
+
+  using Callback = std::function<void(const Result&)>;
+  using SendFn = std::function<DDS::ReturnCode_t(const Request&)>;
+
+  struct Config {
+    // Time to wait for a reply to each attempt
+    Sec timeout = Sec(3);
+    // Number of times a request is sent again after its timeout
+    unsigned max_retries = 1;
+    // Granularity of the deadlines
+    Sec sweep_period = Sec(0.1);
+    // Requests beyond this are rejected with RETCODE_OUT_OF_RESOURCES
+    size_t max_pending = 100000;
+    tms::RequestSequence first_sequence = 0;
+  };
+
+  RequestReplyEngine(SendFn send_fn, ACE_Reactor* reactor, const Config& config = Config())
+    : TimerHandler(reactor, "RequestReplyEngine")
+    , send_fn_(send_fn)
+    , config_(config)
+    , next_seq_(config.first_sequence)
+  {
+    this->schedule(RequestSweepEvent{}, config_.sweep_period, config_.sweep_period);
+  }
+
+  virtual ~RequestReplyEngine()
+  {
+    cancel_all();
+  }
+
+  // Assign the next sequence number to the request and send it.
+  // cb is called once when the request completes, unless this returns an error.
+  DDS::ReturnCode_t send(Request req, Callback cb = nullptr)
+  {
+    return send_request(req, cb);
+  }
+
+  std::future<Result> send_future(Request req)
+  {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    const DDS::ReturnCode_t rc = send_request(req, [promise](const Result& result) { promise->set_value(result); });
+    if (rc != DDS::RETCODE_OK) {
+      // req has the sequence number it was assigned by send_request
+      Result result{Outcome::SEND_FAILED, Traits::target(req), Traits::sequence_id(req), 1, std::nullopt};
+      promise->set_value(result);
+    }
+    return future;
+  }
+
+  // Returns false if the reply doesn't match a pending request,
+  // e.g. it's a late reply to a request that already expired.
+  bool receive_reply(const tms::Reply& reply)
+  {
+    Result result;
+    Callback cb;
+    {
+      SimpleGuard guard(m_);
+      auto it = pending_.find(Key{reply.targetDeviceId(), reply.requestSequenceId()});
+      if (it == pending_.end()) {
+        return false;
+      }
+
+      Pending& p = it->second;
+      result = Result{Outcome::REPLIED, reply.targetDeviceId(), reply.requestSequenceId(), p.attempts, reply};
+      result.round_trip = Clock::now() - p.sent_at;
+      latencies_[reply.targetDeviceId()].record(result.round_trip);
+      cb = p.cb;
+      deadlines_.erase(p.deadline);
+      pending_.erase(it);
+    }
+
+    if (cb) {
+      cb(result);
+    }
+    return true;
+  }
+
+  // Complete all pending requests with CANCELLED
+  void cancel_pending()
+  {
+    std::vector<std::pair<Callback, Result>> done;
+    {
+      SimpleGuard guard(m_);
+      for (auto& pair : pending_) {
+        done.push_back(std::make_pair(pair.second.cb, Result{Outcome::CANCELLED, pair.first.target,
+                                                             pair.first.seq, pair.second.attempts, std::nullopt}));
+      }
+      pending_.clear();
+      deadlines_.clear();
+    }
+    complete(done);
+  }
+
+  size_t pending() const
+  {
+    SimpleGuard guard(m_);
+    return pending_.size();
+  }
+
+  std::unordered_map<tms::Identity, Histogram> latencies() const
+  {
+    SimpleGuard guard(m_);
+    return latencies_;
+  }
+
+  Histogram latency(const tms::Identity& target) const
+  {
+    SimpleGuard guard(m_);
+    auto it = latencies_.find(target);
+    return it == latencies_.end() ? Histogram() : it->second;
+  }
+
+  uint64_t expired_count() const
+  {
+    SimpleGuard guard(m_);
+    return expired_;
+  }
+
+  uint64_t retry_count() const
+  {
+    SimpleGuard guard(m_);
+    return retries_;
+  }
+
+private:
+  struct Key {
+    tms::Identity target;
+    tms::RequestSequence seq;
+
+    bool operator==(const Key& other) const
+    {
+      return seq == other.seq && target == other.target;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const
+    {
+      return std::hash<tms::Identity>{}(key.target) ^ (std::hash<tms::RequestSequence>{}(key.seq) << 1);
+    }
+  };
+
+  using Deadlines = std::multimap<TimePoint, Key>;
+
+  struct Pending {
+    Request request;
+    Callback cb;
+    unsigned attempts = 0;
+    TimePoint sent_at;
+    typename Deadlines::iterator deadline;
+  };
+
+  TimePoint deadline(const TimePoint& sent_at) const
+  {
+    return sent_at + std::chrono::duration_cast<Clock::duration>(config_.timeout);
+  }
+
+  // Assign the next sequence number to req, even if it's rejected, and send it
+  DDS::ReturnCode_t send_request(Request& req, const Callback& cb)
+  {
+    const tms::Identity target = Traits::target(req);
+    Key key;
+    {
+      SimpleGuard guard(m_);
+      Traits::sequence_id(req, next_seq_++);
+      if (pending_.size() >= config_.max_pending) {
+        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: RequestReplyEngine<%C>::send: "
+                   "%B requests pending, rejecting request %Q to \"%C\"\n",
+                   Traits::name(), pending_.size(), static_cast<ACE_UINT64>(Traits::sequence_id(req)),
+                   target.c_str()));
+        return DDS::RETCODE_OUT_OF_RESOURCES;
+      }
+
+      key = Key{target, Traits::sequence_id(req)};
+      Pending& p = pending_[key];
+      p.request = req;
+      p.cb = cb;
+      p.attempts = 1;
+      p.sent_at = Clock::now();
+      p.deadline = deadlines_.insert(std::make_pair(deadline(p.sent_at), key));
+    }
+
+    // The reply may arrive before write returns, which is why it's already pending.
+    const DDS::ReturnCode_t rc = send_fn_(req);
+    if (rc != DDS::RETCODE_OK) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: RequestReplyEngine<%C>::send: write to \"%C\" failed: %C\n",
+                 Traits::name(), target.c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+      SimpleGuard guard(m_);
+      erase(key);
+    }
+    return rc;
+  }
+
+  void any_timer_fired(AnyTimer) final
+  {
+    sweep();
+  }
+
+  void sweep()
+  {
+    std::vector<std::pair<Callback, Result>> done;
+    std::vector<Request> resend;
+    {
+      SimpleGuard guard(m_);
+      const TimePoint now = Clock::now();
+      while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+        const Key key = deadlines_.begin()->second;
+        deadlines_.erase(deadlines_.begin());
+        auto it = pending_.find(key);
+        if (it == pending_.end()) {
+          continue;
+        }
+
+        Pending& p = it->second;
+        if (p.attempts <= config_.max_retries) {
+          // Same sequence number, so that a late reply to an earlier attempt still completes it.
+          ++p.attempts;
+          ++retries_;
+          p.sent_at = now;
+          p.deadline = deadlines_.insert(std::make_pair(deadline(now), key));
+          resend.push_back(p.request);
+        } else {
+          ++expired_;
+          done.push_back(std::make_pair(p.cb, Result{Outcome::EXPIRED, key.target, key.seq,
+                                                     p.attempts, std::nullopt}));
+          pending_.erase(it);
+        }
+      }
+    }
+
+    for (const Request& req : resend) {
+      if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+        ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: RequestReplyEngine<%C>::sweep: retrying request %Q to \"%C\"\n",
+                   Traits::name(), static_cast<ACE_UINT64>(Traits::sequence_id(req)),
+                   Traits::target(req).c_str()));
+      }
+      const DDS::ReturnCode_t rc = send_fn_(req);
+      if (rc != DDS::RETCODE_OK) {
+        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: RequestReplyEngine<%C>::sweep: retry to \"%C\" failed: %C\n",
+                   Traits::name(), Traits::target(req).c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+      }
+    }
+
+    for (const auto& pair : done) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: RequestReplyEngine<%C>::sweep: "
+                 "request %Q to \"%C\" expired after %u attempt(s)\n",
+                 Traits::name(), static_cast<ACE_UINT64>(pair.second.sequence_id),
+                 pair.second.target.c_str(), pair.second.attempts));
+    }
+    complete(done);
+  }
+
+  void complete(const std::vector<std::pair<Callback, Result>>& done)
+  {
+    for (const auto& pair : done) {
+      if (pair.first) {
+        pair.first(pair.second);
+      }
+    }
+  }
+
+  // Caller must hold m_
+  void erase(const Key& key)
+  {
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+      deadlines_.erase(it->second.deadline);
+      pending_.erase(it);
+    }
+  }
+
+  const SendFn send_fn_;
+  const Config config_;
+
+  mutable SimpleMutex m_{"RequestReplyEngine::pending"};
+  tms::RequestSequence next_seq_;
+  std::unordered_map<Key, Pending, KeyHash> pending_;
+  Deadlines deadlines_;
+  std::unordered_map<tms::Identity, Histogram> latencies_;
+  uint64_t expired_ = 0;
+  uint64_t retries_ = 0;
+};
+
+#endif
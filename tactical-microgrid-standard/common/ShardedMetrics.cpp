@@ -0,0 +1,135 @@
+#include "ShardedMetrics.h"
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace MetricShards {
+
+namespace {
+
+struct Registry {
+  std::mutex m;
+  std::vector<std::unique_ptr<Shard>> shards;
+  // Shards of threads that exited
+  std::vector<Shard*> free;
+};
+
+// Never destroyed, since threads can still exit after static destruction
+Registry& registry()
+{
+  static Registry* const registry = new Registry;
+  return *registry;
+}
+
+struct LocalShard {
+  Shard* shard = nullptr;
+
+  ~LocalShard()
+  {
+    if (shard) {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> guard(r.m);
+      r.free.push_back(shard);
+    }
+  }
+};
+
+thread_local LocalShard local_shard;
+
+std::atomic<size_t> counters_allocated{0};
+std::atomic<size_t> histograms_allocated{0};
+
+}
+
+Shard& local()
+{
+  Shard* shard = local_shard.shard;
+  if (shard) {
+    return *shard;
+  }
+
+  Registry& r = registry();
+  std::lock_guard<std::mutex> guard(r.m);
+  if (r.free.empty()) {
+    r.shards.push_back(std::make_unique<Shard>());
+    shard = r.shards.back().get();
+  } else {
+    shard = r.free.back();
+    r.free.pop_back();
+  }
+  local_shard.shard = shard;
+  return *shard;
+}
+
+void visit(const std::function<void(const Shard&)>& f)
+{
+  Registry& r = registry();
+  std::lock_guard<std::mutex> guard(r.m);
+  for (const auto& shard : r.shards) {
+    f(*shard);
+  }
+}
+
+size_t allocate_counter()
+{
+  const size_t index = counters_allocated++;
+  if (index >= max_counters) {
+    throw std::length_error("MetricShards::allocate_counter: more than max_counters counters");
+  }
+  return index;
+}
+
+size_t allocate_histogram()
+{
+  const size_t index = histograms_allocated++;
+  if (index >= max_histograms) {
+    throw std::length_error("MetricShards::allocate_histogram: more than max_histograms histograms");
+  }
+  return index;
+}
+
+}
+
+uint64_t ShardedCounter::value() const
+{
+  uint64_t sum = 0;
+  MetricShards::visit([&](const MetricShards::Shard& shard) {
+    sum += shard.counters[index_].load(std::memory_order_relaxed);
+  });
+  return sum;
+}
+
+int64_t ShardedGauge::value() const
+{
+  uint64_t sum = 0;
+  MetricShards::visit([&](const MetricShards::Shard& shard) {
+    sum += shard.counters[index_].load(std::memory_order_relaxed);
+  });
+  return static_cast<int64_t>(sum);
+}
+
+Histogram ShardedHistogram::snapshot() const
+{
+  Histogram h;
+  MetricShards::visit([&](const MetricShards::Shard& shard) {
+    const MetricShards::HistogramSlot& slot = shard.histograms[index_];
+    for (size_t i = 0; i < Histogram::bucket_count; ++i) {
+      h.buckets_[i] += slot.buckets[i].load(std::memory_order_relaxed);
+    }
+    h.count_ += slot.count.load(std::memory_order_relaxed);
+    h.sum_us_ += slot.sum_us.load(std::memory_order_relaxed);
+    const uint64_t max = slot.max_us.load(std::memory_order_relaxed);
+    if (max > h.max_us_) {
+      h.max_us_ = max;
+    }
+  });
+  for (size_t i = 0; i < Histogram::bucket_count; ++i) {
+    if (h.buckets_[i]) {
+      h.min_us_ = i ? Histogram::bucket_limit_us(i - 1) : 0;
+      break;
+    }
+  }
+  return h;
+}
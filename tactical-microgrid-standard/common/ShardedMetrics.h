@@ -0,0 +1,139 @@
+#ifndef TMS_COMMON_SHARDED_METRICS_H
+#define TMS_COMMON_SHARDED_METRICS_H
+
+#include "Histogram.h"
+
+#include <common/OpenDDS_TMS_export.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Every thread that records a sharded metric gets a shard with a slot for each
+ * counter and histogram. Only the owning thread writes to its shard, so
+ * recording is a relaxed load and store without a read-modify-write or a
+ * shared cache line. Reading a metric sums the slots of all the shards, which
+ * is only done when the metrics are published or scraped.
+ */
+namespace MetricShards {
+
+constexpr size_t max_counters = 64;
+constexpr size_t max_histograms = 16;
+
+struct HistogramSlot {
+  std::array<std::atomic<uint64_t>, Histogram::bucket_count> buckets{};
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum_us{0};
+  std::atomic<uint64_t> max_us{0};
+};
+
+struct alignas(64) Shard {
+  std::array<std::atomic<uint64_t>, max_counters> counters{};
+  std::array<HistogramSlot, max_histograms> histograms;
+};
+
+// Shard of the calling thread. When the thread exits its shard is kept with
+// its values and handed to the next new thread.
+OpenDDS_TMS_Export Shard& local();
+
+// Call f with every shard while no shard is handed out
+OpenDDS_TMS_Export void visit(const std::function<void(const Shard&)>& f);
+
+OpenDDS_TMS_Export size_t allocate_counter();
+OpenDDS_TMS_Export size_t allocate_histogram();
+
+// Only the owning thread writes to a slot
+inline void add(std::atomic<uint64_t>& slot, uint64_t n)
+{
+  slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+// Monotonic counter
+class OpenDDS_TMS_Export ShardedCounter {
+public:
+  ShardedCounter()
+    : index_(MetricShards::allocate_counter())
+  {
+  }
+
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  void add(uint64_t n = 1)
+  {
+    MetricShards::add(MetricShards::local().counters[index_], n);
+  }
+
+  uint64_t value() const;
+
+private:
+  const size_t index_;
+};
+
+// Value that goes up and down, e.g. the number of something currently active
+class OpenDDS_TMS_Export ShardedGauge {
+public:
+  ShardedGauge()
+    : index_(MetricShards::allocate_counter())
+  {
+  }
+
+  ShardedGauge(const ShardedGauge&) = delete;
+  ShardedGauge& operator=(const ShardedGauge&) = delete;
+
+  // Shards wrap around, but their sum is right as long as it fits in an int64_t
+  void add(int64_t n)
+  {
+    MetricShards::add(MetricShards::local().counters[index_], static_cast<uint64_t>(n));
+  }
+
+  int64_t value() const;
+
+private:
+  const size_t index_;
+};
+
+// Histogram with the buckets of Histogram, which can also count things other
+// than microseconds, e.g. samples.
+class OpenDDS_TMS_Export ShardedHistogram {
+public:
+  ShardedHistogram()
+    : index_(MetricShards::allocate_histogram())
+  {
+  }
+
+  ShardedHistogram(const ShardedHistogram&) = delete;
+  ShardedHistogram& operator=(const ShardedHistogram&) = delete;
+
+  void record_us(uint64_t us)
+  {
+    MetricShards::HistogramSlot& slot = MetricShards::local().histograms[index_];
+    MetricShards::add(slot.buckets[Histogram::bucket_of(us)], 1);
+    MetricShards::add(slot.count, 1);
+    MetricShards::add(slot.sum_us, us);
+    if (us > slot.max_us.load(std::memory_order_relaxed)) {
+      slot.max_us.store(us, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period>& d)
+  {
+    using namespace std::chrono;
+    const int64_t us_signed = duration_cast<microseconds>(d).count();
+    record_us(us_signed < 0 ? 0 : static_cast<uint64_t>(us_signed));
+  }
+
+  // Minimums aren't tracked, so the snapshot reports the lower bound of the lowest bucket.
+  Histogram snapshot() const;
+
+private:
+  const size_t index_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef TMS_COMMON_STATUS_METRICS_H
+#define TMS_COMMON_STATUS_METRICS_H
+
+#include "Metrics.h"
+
+#include <dds/DCPS/LocalObject.h>
+#include <dds/DdsDcpsDomainC.h>
+
+// Add a communication status of a data writer or reader to Metrics
+inline void count_status(const DDS::OfferedDeadlineMissedStatus& status)
+{
+  Metrics::instance().offered_deadline_missed.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::OfferedIncompatibleQosStatus& status)
+{
+  Metrics::instance().offered_incompatible_qos.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::LivelinessLostStatus& status)
+{
+  Metrics::instance().liveliness_lost.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::PublicationMatchedStatus& status)
+{
+  Metrics& metrics = Metrics::instance();
+  metrics.publication_matched.add(status.total_count_change);
+  metrics.matched_readers.add(status.current_count_change);
+}
+
+inline void count_status(const DDS::RequestedDeadlineMissedStatus& status)
+{
+  Metrics::instance().requested_deadline_missed.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::RequestedIncompatibleQosStatus& status)
+{
+  Metrics::instance().requested_incompatible_qos.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::SampleLostStatus& status)
+{
+  Metrics::instance().sample_lost.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::SampleRejectedStatus& status)
+{
+  Metrics::instance().sample_rejected.add(status.total_count_change);
+}
+
+inline void count_status(const DDS::SubscriptionMatchedStatus& status)
+{
+  Metrics& metrics = Metrics::instance();
+  metrics.subscription_matched.add(status.total_count_change);
+  metrics.matched_writers.add(status.current_count_change);
+}
+
+inline void count_status(const DDS::InconsistentTopicStatus& status)
+{
+  Metrics::instance().inconsistent_topics.add(status.total_count_change);
+}
+
+/**
+ * Participant listener that counts the communication statuses of the entities
+ * of the participant that don't have a listener of their own for them. Readers
+ * and writers with a listener count them in DataReaderListenerBase and
+ * DataWriterListenerBase. It doesn't take data, so readers without a listener
+ * are read as usual.
+ */
+class StatusMetricsListener : public virtual OpenDDS::DCPS::LocalObject<DDS::DomainParticipantListener> {
+public:
+  static constexpr DDS::StatusMask mask =
+    DDS::INCONSISTENT_TOPIC_STATUS |
+    DDS::OFFERED_DEADLINE_MISSED_STATUS | DDS::OFFERED_INCOMPATIBLE_QOS_STATUS |
+    DDS::LIVELINESS_LOST_STATUS | DDS::PUBLICATION_MATCHED_STATUS |
+    DDS::REQUESTED_DEADLINE_MISSED_STATUS | DDS::REQUESTED_INCOMPATIBLE_QOS_STATUS |
+    DDS::SAMPLE_LOST_STATUS | DDS::SAMPLE_REJECTED_STATUS | DDS::SUBSCRIPTION_MATCHED_STATUS;
+
+  void on_inconsistent_topic(DDS::Topic_ptr, const DDS::InconsistentTopicStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_offered_deadline_missed(DDS::DataWriter_ptr, const DDS::OfferedDeadlineMissedStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_offered_incompatible_qos(DDS::DataWriter_ptr, const DDS::OfferedIncompatibleQosStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_liveliness_lost(DDS::DataWriter_ptr, const DDS::LivelinessLostStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_publication_matched(DDS::DataWriter_ptr, const DDS::PublicationMatchedStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_requested_deadline_missed(DDS::DataReader_ptr, const DDS::RequestedDeadlineMissedStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_requested_incompatible_qos(DDS::DataReader_ptr, const DDS::RequestedIncompatibleQosStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_sample_rejected(DDS::DataReader_ptr, const DDS::SampleRejectedStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_liveliness_changed(DDS::DataReader_ptr, const DDS::LivelinessChangedStatus&) override
+  {
+  }
+
+  void on_data_available(DDS::DataReader_ptr) override
+  {
+  }
+
+  void on_subscription_matched(DDS::DataReader_ptr, const DDS::SubscriptionMatchedStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_sample_lost(DDS::DataReader_ptr, const DDS::SampleLostStatus& status) override
+  {
+    count_status(status);
+  }
+
+  void on_data_on_readers(DDS::Subscriber_ptr) override
+  {
+  }
+};
+
+#endif
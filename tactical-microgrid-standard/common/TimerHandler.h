@@ -1,6 +1,9 @@
 #ifndef TMS_COMMON_TIMER_HANDLER_H
 #define TMS_COMMON_TIMER_HANDLER_H
 
+#include "Metrics.h"
+#include "ProfiledMutex.h"
+
 #include <ace/Event_Handler.h>
 #include <ace/Log_Msg.h>
 #include <ace/Reactor.h>
@@ -22,7 +25,7 @@ using TimePoint = std::chrono::time_point<Clock>;
 using TimerId = long;
 using TimerKey = std::string;
 constexpr TimerId null_timer_id = 0;
-using Mutex = std::recursive_mutex;
+using Mutex = ProfiledMutex<std::recursive_mutex>;
 using Guard = std::lock_guard<Mutex>;
 
 // Workaround https://github.com/DOCGroup/ACE_TAO/pull/2462
@@ -131,9 +134,10 @@ public:
   using AnyTimer = std::variant<typename Timer<EventTypes>::Ptr...>;
 
   // Create a new ACE_Reactor with ACE_Timer_Hash if @a reactor is null.
-  // Otherwise, use the provided reactor.
-  explicit TimerHandler(ACE_Reactor* reactor = nullptr)
-    : reactor_(reactor)
+  // Otherwise, use the provided reactor. @a lock_name names the lock in lock profiling.
+  explicit TimerHandler(ACE_Reactor* reactor = nullptr, const char* lock_name = "TimerHandler")
+    : lock_(lock_name)
+    , reactor_(reactor)
   {
     if (!reactor) {
       reactor_ = new ACE_Reactor;
@@ -186,7 +190,10 @@ public:
     const TimerId id = reactor_->schedule_timer(
       this, &timer->key, to_time_value(timer->delay), to_time_value(timer->period));
     timer->activate(id);
-    active_timers_[timer->key] = timer;
+    if (active_timers_.insert_or_assign(timer->key, timer).second) {
+      Metrics::instance().timer_queue_depth.add(1);
+    }
+    Metrics::instance().timers_scheduled.add();
   }
 
   template <typename EventType>
@@ -255,6 +262,7 @@ public:
         timer->deactivate();
       }, it->second);
     }
+    Metrics::instance().timer_queue_depth.add(-static_cast<int64_t>(active_timers_.size()));
     active_timers_.clear();
   }
 
@@ -267,7 +275,11 @@ public:
     }
 
     auto timer = active_timers_[key];
+    const auto start = std::chrono::steady_clock::now();
     any_timer_fired(timer);
+    Metrics& metrics = Metrics::instance();
+    metrics.timer_callback.record(std::chrono::steady_clock::now() - start);
+    metrics.timers_fired.add();
     bool exit_after = false;
     std::visit([&](auto&& value) {
       if (!value->period.count()) {
@@ -328,7 +340,9 @@ private:
   template <typename EventType>
   void timer_wont_run(typename Timer<EventType>::Ptr timer)
   {
-    active_timers_.erase(timer->key);
+    if (active_timers_.erase(timer->key)) {
+      Metrics::instance().timer_queue_depth.add(-1);
+    }
     timer->deactivate();
   }
 
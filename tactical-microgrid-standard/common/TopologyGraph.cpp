@@ -0,0 +1,205 @@
+#include "TopologyGraph.h"
+
+#include <algorithm>
+
+TopologyGraph::Node TopologyGraph::Builder::add_device(const tms::Identity& id,
+                                                       std::optional<tms::DeviceRole> role)
+{
+  const auto it = index_.find(id);
+  if (it != index_.end()) {
+    if (role.has_value()) {
+      roles_[it->second] = *role;
+    }
+    return it->second;
+  }
+
+  const Node n = static_cast<Node>(ids_.size());
+  ids_.push_back(id);
+  roles_.push_back(role.value_or(tms::DeviceRole::ROLE_DISTRIBUTION));
+  degree_.push_back(0);
+  index_.insert(std::make_pair(id, n));
+  return n;
+}
+
+void TopologyGraph::Builder::add_connection(const tms::Identity& id1, std::optional<tms::DeviceRole> role1,
+                                            const tms::Identity& id2, std::optional<tms::DeviceRole> role2)
+{
+  const Node n1 = add_device(id1, role1);
+  const Node n2 = add_device(id2, role2);
+  if (n1 == n2) {
+    return;
+  }
+  edges_.push_back(std::make_pair(n1, n2));
+  ++degree_[n1];
+  ++degree_[n2];
+}
+
+size_t TopologyGraph::Builder::degree(const tms::Identity& id) const
+{
+  const auto it = index_.find(id);
+  return it == index_.end() ? 0 : degree_[it->second];
+}
+
+TopologyGraph TopologyGraph::Builder::build() const
+{
+  TopologyGraph g;
+  g.ids_ = ids_;
+  g.roles_ = roles_;
+  g.index_ = index_;
+
+  const size_t n = ids_.size();
+  g.offsets_.assign(n + 1, 0);
+  for (const auto& e : edges_) {
+    ++g.offsets_[e.first + 1];
+    ++g.offsets_[e.second + 1];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    g.offsets_[i + 1] += g.offsets_[i];
+  }
+
+  std::vector<size_t> next(g.offsets_.begin(), g.offsets_.end() - 1);
+  g.targets_.resize(g.offsets_[n]);
+  for (const auto& e : edges_) {
+    g.targets_[next[e.first]++] = e.second;
+    g.targets_[next[e.second]++] = e.first;
+  }
+
+  // Sort the neighbors and drop duplicate connections, compacting in place
+  size_t out = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t begin = g.offsets_[i];
+    const size_t end = g.offsets_[i + 1];
+    std::sort(g.targets_.begin() + begin, g.targets_.begin() + end);
+    g.offsets_[i] = out;
+    for (size_t p = begin; p < end; ++p) {
+      if (p == begin || g.targets_[p] != g.targets_[p - 1]) {
+        g.targets_[out++] = g.targets_[p];
+      }
+    }
+  }
+  g.offsets_[n] = out;
+  g.targets_.resize(out);
+
+  g.edge_active_.assign(out, 1);
+  g.node_active_.assign(n, 1);
+  return g;
+}
+
+const std::vector<TopologyGraph::Node>& TopologyGraph::Energization::sources_of(Node n) const
+{
+  static const std::vector<Node> no_sources;
+  return component[n] == NONE ? no_sources : sources[component[n]];
+}
+
+TopologyGraph::Node TopologyGraph::index(const tms::Identity& id) const
+{
+  const auto it = index_.find(id);
+  return it == index_.end() ? NONE : it->second;
+}
+
+bool TopologyGraph::set_active(Node n, bool active)
+{
+  if (static_cast<bool>(node_active_[n]) == active) {
+    return false;
+  }
+  node_active_[n] = active;
+  return true;
+}
+
+bool TopologyGraph::set_level(const tms::Identity& id, tms::EnergyStartStopLevel essl)
+{
+  const Node n = index(id);
+  return n != NONE && set_active(n, essl == tms::EnergyStartStopLevel::ESSL_OPERATIONAL);
+}
+
+size_t TopologyGraph::edge(Node n1, Node n2) const
+{
+  const Node* const begin = neighbors_begin(n1);
+  const Node* const end = neighbors_end(n1);
+  const Node* const it = std::lower_bound(begin, end, n2);
+  return it == end || *it != n2 ? no_edge : static_cast<size_t>(it - targets_.data());
+}
+
+bool TopologyGraph::connection_active(Node n1, Node n2) const
+{
+  const size_t e = edge(n1, n2);
+  return e != no_edge && edge_active_[e];
+}
+
+bool TopologyGraph::set_connection_active(Node n1, Node n2, bool active)
+{
+  const size_t e12 = edge(n1, n2);
+  if (e12 == no_edge || static_cast<bool>(edge_active_[e12]) == active) {
+    return false;
+  }
+  edge_active_[e12] = active;
+  edge_active_[edge(n2, n1)] = active;
+  return true;
+}
+
+TopologyGraph::Energization TopologyGraph::energization() const
+{
+  Energization result;
+  const size_t n = size();
+  result.component.assign(n, NONE);
+
+  std::vector<Node> queue;
+  queue.reserve(n);
+  for (Node start = 0; start < n; ++start) {
+    if (!node_active_[start] || result.component[start] != NONE) {
+      continue;
+    }
+
+    const Node c = static_cast<Node>(result.sources.size());
+    result.sources.emplace_back();
+    result.component[start] = c;
+    queue.assign(1, start);
+    for (size_t q = 0; q < queue.size(); ++q) {
+      const Node u = queue[q];
+      if (roles_[u] == tms::DeviceRole::ROLE_SOURCE) {
+        result.sources[c].push_back(u);
+      }
+      for (size_t e = offsets_[u]; e < offsets_[u + 1]; ++e) {
+        const Node v = targets_[e];
+        if (conducts(e, v) && result.component[v] == NONE) {
+          result.component[v] = c;
+          queue.push_back(v);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<TopologyGraph::Node> TopologyGraph::path(Node from, Node to) const
+{
+  std::vector<Node> result;
+  if (from >= size() || to >= size() || !node_active_[from] || !node_active_[to]) {
+    return result;
+  }
+
+  // Breadth-first search from "from", stopping as soon as "to" is reached
+  std::vector<Node> parent(size(), NONE);
+  std::vector<Node> queue(1, from);
+  parent[from] = from;
+  for (size_t q = 0; q < queue.size() && parent[to] == NONE; ++q) {
+    const Node u = queue[q];
+    for (size_t e = offsets_[u]; e < offsets_[u + 1]; ++e) {
+      const Node v = targets_[e];
+      if (conducts(e, v) && parent[v] == NONE) {
+        parent[v] = u;
+        queue.push_back(v);
+      }
+    }
+  }
+
+  if (parent[to] == NONE) {
+    return result;
+  }
+  for (Node v = to; v != from; v = parent[v]) {
+    result.push_back(v);
+  }
+  result.push_back(from);
+  std::reverse(result.begin(), result.end());
+  return result;
+}
@@ -0,0 +1,170 @@
+#ifndef TMS_COMMON_TOPOLOGY_GRAPH_H
+#define TMS_COMMON_TOPOLOGY_GRAPH_H
+
+#include <common/mil-std-3071_data_modelTypeSupportImpl.h>
+#include <common/OpenDDS_TMS_export.h>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Power topology as an undirected graph in compressed sparse row form: the
+ * neighbors of node n are targets_[offsets_[n]] to targets_[offsets_[n + 1] - 1],
+ * sorted by node. Nodes are the power devices and edges their power connections.
+ *
+ * The structure is fixed once built, but devices and connections can be
+ * switched on and off in place, e.g. when a device changes its energy level.
+ * Current only flows through active devices over active connections. Queries
+ * take time linear in the size of the graph. It is not thread-safe.
+ */
+class OpenDDS_TMS_Export TopologyGraph {
+public:
+  using Node = uint32_t;
+  static constexpr Node NONE = ~Node(0);
+
+  // Collects devices and connections, in any order and with duplicates.
+  class OpenDDS_TMS_Export Builder {
+  public:
+    // A device whose role isn't given is taken as a distribution device until
+    // it is given.
+    Node add_device(const tms::Identity& id, std::optional<tms::DeviceRole> role = std::nullopt);
+
+    void add_connection(const tms::Identity& id1, std::optional<tms::DeviceRole> role1,
+                        const tms::Identity& id2, std::optional<tms::DeviceRole> role2);
+
+    // Add the connections of a powersim::PowerTopology. It is a template so
+    // the graph doesn't depend on the simulation types.
+    template <typename Topology>
+    void add_topology(const Topology& pt)
+    {
+      for (const auto& pc : pt.connections()) {
+        add_device(pc.pd_id());
+        for (const auto& cd : pc.connected_devices()) {
+          add_connection(pc.pd_id(), std::nullopt, cd.id(), cd.role());
+        }
+      }
+    }
+
+    // Number of connections added for a device, counting duplicates
+    size_t degree(const tms::Identity& id) const;
+
+    TopologyGraph build() const;
+
+  private:
+    std::vector<tms::Identity> ids_;
+    std::vector<tms::DeviceRole> roles_;
+    std::unordered_map<tms::Identity, Node> index_;
+    std::vector<std::pair<Node, Node>> edges_;
+    std::vector<size_t> degree_;
+  };
+
+  template <typename Topology>
+  static TopologyGraph from_topology(const Topology& pt)
+  {
+    Builder builder;
+    builder.add_topology(pt);
+    return builder.build();
+  }
+
+  // Which devices are energized and by which sources. Devices are grouped in
+  // components connected through active devices and connections.
+  struct Energization {
+    // Component of each node, or NONE for an inactive node
+    std::vector<Node> component;
+    // Active sources of each component
+    std::vector<std::vector<Node>> sources;
+
+    bool energized(Node n) const
+    {
+      return component[n] != NONE && !sources[component[n]].empty();
+    }
+
+    // Sources energizing a node, empty if it isn't energized
+    const std::vector<Node>& sources_of(Node n) const;
+  };
+
+  size_t size() const
+  {
+    return ids_.size();
+  }
+
+  size_t connection_count() const
+  {
+    return targets_.size() / 2;
+  }
+
+  // Node of a device, or NONE if it isn't in the topology
+  Node index(const tms::Identity& id) const;
+
+  const tms::Identity& id(Node n) const
+  {
+    return ids_[n];
+  }
+
+  tms::DeviceRole role(Node n) const
+  {
+    return roles_[n];
+  }
+
+  const Node* neighbors_begin(Node n) const
+  {
+    return targets_.data() + offsets_[n];
+  }
+
+  const Node* neighbors_end(Node n) const
+  {
+    return targets_.data() + offsets_[n + 1];
+  }
+
+  size_t degree(Node n) const
+  {
+    return offsets_[n + 1] - offsets_[n];
+  }
+
+  bool active(Node n) const
+  {
+    return node_active_[n];
+  }
+
+  // Returns whether the state of the device changed
+  bool set_active(Node n, bool active);
+
+  // A device is active when it is operational
+  bool set_level(const tms::Identity& id, tms::EnergyStartStopLevel essl);
+
+  bool connection_active(Node n1, Node n2) const;
+
+  // Returns whether the state of the connection changed. Takes time
+  // logarithmic in the degrees of the devices.
+  bool set_connection_active(Node n1, Node n2, bool active);
+
+  Energization energization() const;
+
+  // Shortest path of active devices and connections from one device to
+  // another, including both, or empty if there is none.
+  std::vector<Node> path(Node from, Node to) const;
+
+private:
+  static constexpr size_t no_edge = static_cast<size_t>(-1);
+
+  // Position of the edge n1 -> n2 in targets_, or no_edge
+  size_t edge(Node n1, Node n2) const;
+
+  bool conducts(size_t edge, Node to) const
+  {
+    return edge_active_[edge] && node_active_[to];
+  }
+
+  std::vector<tms::Identity> ids_;
+  std::vector<tms::DeviceRole> roles_;
+  std::unordered_map<tms::Identity, Node> index_;
+  std::vector<size_t> offsets_{0};
+  std::vector<Node> targets_;
+  std::vector<uint8_t> edge_active_;
+  std::vector<uint8_t> node_active_;
+};
+
+#endif
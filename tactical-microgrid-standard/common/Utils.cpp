@@ -88,6 +88,28 @@ namespace Utils {
     }
   }
 
+  std::string energy_level_to_string(tms::EnergyStartStopLevel essl)
+  {
+    switch (essl) {
+    case tms::EnergyStartStopLevel::ESSL_OPERATIONAL:
+      return "Operational";
+    case tms::EnergyStartStopLevel::ESSL_READY_SYNCED:
+      return "Ready Synced";
+    case tms::EnergyStartStopLevel::ESSL_READY:
+      return "Ready";
+    case tms::EnergyStartStopLevel::ESSL_IDLE:
+      return "Idle";
+    case tms::EnergyStartStopLevel::ESSL_WARM:
+      return "Warm";
+    case tms::EnergyStartStopLevel::ESSL_OFF:
+      return "Off";
+    case tms::EnergyStartStopLevel::ESSL_ANY:
+      return "Any";
+    default:
+      return "Unknown";
+    }
+  }
+
   tms::ProductInfo get_ProductInfo()
   {
     tms::ProductInfo prod_info;
@@ -111,4 +133,20 @@ namespace Utils {
     topic_info.supportedRequestTopics() = subscribed_topics;
     return topic_info;
   }
+
+  std::chrono::duration<double> time_since(const DDS::Time_t& ts)
+  {
+    using namespace std::chrono;
+    const auto then = seconds(ts.sec) + nanoseconds(ts.nanosec);
+    return duration<double>(system_clock::now().time_since_epoch() - then);
+  }
+
+  bool filter_string_parameter(const std::string& value, std::string& param)
+  {
+    if (value.find('\'') != std::string::npos) {
+      return false;
+    }
+    param = "'" + value + "'";
+    return true;
+  }
 }
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <random>
+#include <chrono>
 
 extern const char* MANUFACTURER_NAME;
 extern const char* MODEL_NAME;
@@ -21,8 +22,17 @@ OpenDDS_TMS_Export void setup_sim_transport(DDS::DomainParticipant_var sim_dp);
 
 OpenDDS_TMS_Export std::string device_role_to_string(tms::DeviceRole role);
 
+OpenDDS_TMS_Export std::string energy_level_to_string(tms::EnergyStartStopLevel essl);
+
 OpenDDS_TMS_Export tms::ProductInfo get_ProductInfo();
 
+// Time elapsed since a DDS timestamp, e.g. the source timestamp of a sample.
+OpenDDS_TMS_Export std::chrono::duration<double> time_since(const DDS::Time_t& ts);
+
+// Quote a string as a parameter of a content filter expression. Returns false if
+// it contains a single quote, which the string literals of filters can't escape.
+OpenDDS_TMS_Export bool filter_string_parameter(const std::string& value, std::string& param);
+
 OpenDDS_TMS_Export tms::TopicInfo get_TopicInfo(const tms::TopicList& published_conditional_topics,
   const tms::TopicList& published_optional_topics, const tms::TopicList& subscribed_topics);
 
@@ -0,0 +1,109 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+{
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 1; i < threads; ++i) {
+    threads_.emplace_back(&WorkStealingPool::work, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    SimpleGuard guard(m_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::run(std::vector<Task>& tasks)
+{
+  if (tasks.empty()) {
+    return;
+  }
+
+  SimpleGuard run_guard(run_m_);
+  pending_ = tasks.size();
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    Queue& queue = *queues_[i % queues_.size()];
+    SimpleGuard guard(queue.m);
+    queue.tasks.push_back(std::move(tasks[i]));
+  }
+  tasks.clear();
+
+  {
+    SimpleGuard guard(m_);
+    ++batch_;
+  }
+  cv_.notify_all();
+
+  Task task;
+  while (take(0, task)) {
+    task();
+    --pending_;
+  }
+
+  // The last tasks may still be running in other threads
+  std::unique_lock<SimpleMutex> lock(m_);
+  cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void WorkStealingPool::work(size_t self)
+{
+  uint64_t seen = 0;
+  Task task;
+  while (true) {
+    {
+      std::unique_lock<SimpleMutex> lock(m_);
+      cv_.wait(lock, [&] { return stop_ || batch_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = batch_;
+    }
+
+    while (take(self, task)) {
+      task();
+      if (--pending_ == 0) {
+        // Lock so the wakeup can't slip in between the check and the wait of run()
+        SimpleGuard guard(m_);
+        cv_.notify_all();
+      }
+    }
+  }
+}
+
+bool WorkStealingPool::take(size_t self, Task& task)
+{
+  {
+    Queue& own = *queues_[self];
+    SimpleGuard guard(own.m);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue& other = *queues_[(self + i) % queues_.size()];
+    SimpleGuard guard(other.m);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,67 @@
+#ifndef TMS_COMMON_WORK_STEALING_POOL_H
+#define TMS_COMMON_WORK_STEALING_POOL_H
+
+#include "ProfiledMutex.h"
+
+#include <common/OpenDDS_TMS_export.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of threads that run batches of independent tasks. The tasks of a
+ * batch are dealt out to a queue per thread. Each thread takes tasks from the
+ * back of its own queue, and once that is empty steals from the front of the
+ * others, so threads that drew cheap tasks help with the expensive ones. The
+ * thread that runs a batch works on it too and returns once all tasks are done.
+ */
+class OpenDDS_TMS_Export WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  // Threads running a batch including the calling thread. 0 means one per
+  // hardware thread and 1 runs batches in the calling thread only.
+  explicit WorkStealingPool(size_t threads = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  size_t size() const
+  {
+    return queues_.size();
+  }
+
+  // Run the tasks, which must not throw, and wait for them. Batches run one at
+  // a time and tasks can't run batches of their own.
+  void run(std::vector<Task>& tasks);
+
+private:
+  struct Queue {
+    SimpleMutex m{"WorkStealingPool::Queue"};
+    std::deque<Task> tasks;
+  };
+
+  void work(size_t self);
+
+  // Take a task from queue self or steal one from another queue
+  bool take(size_t self, Task& task);
+
+  // Queue 0 belongs to the thread running the batch
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  SimpleMutex run_m_{"WorkStealingPool::run"};
+  SimpleMutex m_{"WorkStealingPool"};
+  std::condition_variable_any cv_;
+  uint64_t batch_ = 0;
+  bool stop_ = false;
+  std::atomic<size_t> pending_{0};
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "ActiveMicrogridControllerStateDataReaderListenerImpl.h"
 
+#include <common/Utils.h>
+
 void ActiveMicrogridControllerStateDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
 {
   tms::ActiveMicrogridControllerStateSeq data;
@@ -13,11 +15,13 @@ void ActiveMicrogridControllerStateDataReaderListenerImpl::on_data_available(DDS
     return;
   }
 
+  record_queue_depth(data.length());
+
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const tms::Identity& device_id = data[i].deviceId();
       auto master_id = data[i].masterId();
-      controller_.set_active_controller(device_id, master_id);
+      controller_.set_active_controller(device_id, master_id, Utils::time_since(info_seq[i].source_timestamp));
     }
   }
 }
@@ -4,13 +4,17 @@
 #include "ControllerCommandDataReaderListenerImpl.h"
 #include "ReplyDataReaderListenerImpl.h"
 #include "PowerTopologyDataReaderListenerImpl.h"
+#include "common/Metrics.h"
 #include "common/QosHelper.h"
 #include "common/Utils.h"
 
 #include <dds/DCPS/Marked_Default_Qos.h>
 
 CLIServer::CLIServer(Controller& mc)
-  : controller_(mc)
+  : TimerHandler(mc.get_reactor(), "CLIServer")
+  , controller_(mc)
+  , replicator_(mc, *this)
+  , contingencies_(mc.get_reactor())
 {
   init();
 }
@@ -96,6 +100,7 @@ DDS::ReturnCode_t CLIServer::init_tms()
     ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: create_publisher with TMS QoS failed\n"));
     return DDS::RETCODE_ERROR;
   }
+  essr_pub_ = tms_pub;
 
   const DDS::DataWriterQos& essr_dw_qos = Qos::DataWriter::fn_map.at(tms::topic::TOPIC_ENERGY_START_STOP_REQUEST)(controller_.get_device_id());
   DDS::DataWriter_var essr_dw_base = tms_pub->create_datawriter(essr_topic,
@@ -114,6 +119,15 @@ DDS::ReturnCode_t CLIServer::init_tms()
     return DDS::RETCODE_ERROR;
   }
 
+  tms::EnergyStartStopRequestDataWriter_var essr_dw = essr_dw_;
+  essr_engine_.reset(new EssrEngine([essr_dw](const tms::EnergyStartStopRequest& essr) {
+    const DDS::ReturnCode_t rc = essr_dw->write(essr, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+    }
+    return rc;
+  }, controller_.get_reactor()));
+
   // Subscribe to the tms::Reply topic
   tms::ReplyTypeSupport_var reply_ts = new tms::ReplyTypeSupportImpl;
   if (DDS::RETCODE_OK != reply_ts->register_type(dp, "")) {
@@ -262,6 +276,7 @@ DDS::ReturnCode_t CLIServer::init_sim()
     ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: create_publisher failed\n"));
     return DDS::RETCODE_ERROR;
   }
+  sim_pub_ = pub;
 
   DDS::DataWriterQos dw_qos;
   pub->get_default_datawriter_qos(dw_qos);
@@ -332,8 +347,15 @@ DDS::ReturnCode_t CLIServer::init_sim()
     return DDS::RETCODE_ERROR;
   }
 
+  // Only the connections that changed are written, so a power device that starts after
+  // them gets the last connections of each device from the writer.
+  DDS::DataWriterQos pc_dw_qos = dw_qos;
+  pc_dw_qos.durability.kind = DDS::DurabilityQosPolicyKind::TRANSIENT_LOCAL_DURABILITY_QOS;
+  pc_dw_qos.history.kind = DDS::HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+  pc_dw_qos.history.depth = 1;
+
   DDS::DataWriter_var pc_dw_base = pub->create_datawriter(pc_topic,
-                                                          dw_qos,
+                                                          pc_dw_qos,
                                                           nullptr,
                                                           ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
   if (!pc_dw_base) {
@@ -348,7 +370,43 @@ DDS::ReturnCode_t CLIServer::init_sim()
     return DDS::RETCODE_ERROR;
   }
 
-  return DDS::RETCODE_OK;
+  // Publish to the powersim::PowerFlow topic
+  powersim::PowerFlowTypeSupport_var pf_ts = new powersim::PowerFlowTypeSupportImpl;
+  if (DDS::RETCODE_OK != pf_ts->register_type(sim_participant_, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: register_type PowerFlow failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  CORBA::String_var pf_type_name = pf_ts->get_type_name();
+  DDS::Topic_var pf_topic = sim_participant_->create_topic(powersim::TOPIC_POWER_FLOW.c_str(),
+                                                           pf_type_name,
+                                                           TOPIC_QOS_DEFAULT,
+                                                           nullptr,
+                                                           ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!pf_topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: create_topic \"%C\" failed\n",
+               powersim::TOPIC_POWER_FLOW.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  DDS::DataWriter_var pf_dw_base = pub->create_datawriter(pf_topic,
+                                                          dw_qos,
+                                                          nullptr,
+                                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!pf_dw_base) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: create_datawriter for topic \"%C\" failed\n",
+               powersim::TOPIC_POWER_FLOW.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  pf_dw_ = powersim::PowerFlowDataWriter::_narrow(pf_dw_base);
+  if (!pf_dw_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::init: PowerFlowDataWriter narrow failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  // Replicate the state of this controller to the standby controllers
+  return replicator_.init(sim_participant_, pub, sub);
 }
 
 tms::EnergyStartStopLevel CLIServer::ESSL_from_OPT(tms::OperatorPriorityType opt)
@@ -365,52 +423,375 @@ tms::EnergyStartStopLevel CLIServer::ESSL_from_OPT(tms::OperatorPriorityType opt
 
 void CLIServer::start_stop_device(const tms::Identity& pd_id, tms::OperatorPriorityType opt)
 {
-  PowerDevices pdvs = controller_.power_devices();
-  auto it = pdvs.find(pd_id);
-  if (it == pdvs.end()) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::start_stop_device: power device \"%C\" not found\n", pd_id.c_str()));
+  start_stop_devices(DeviceOpts{std::make_pair(pd_id, opt)});
+}
+
+void CLIServer::start_stop_devices(const DeviceOpts& devices)
+{
+  Guard g(lock_);
+  load_shedder_.set_intents(devices);
+  set_levels(devices);
+  shed_loads();
+}
+
+void CLIServer::rank_devices(const DeviceRanks& ranks)
+{
+  load_shedder_.set_ranks(ranks);
+  shed_loads();
+}
+
+void CLIServer::update_load_shedding(const powersim::PowerTopology& pt)
+{
+  load_shedder_.set_topology(pt, controller_.power_devices());
+  shed_loads();
+}
+
+void CLIServer::shed_loads()
+{
+  // A plan started before the levels of the last one were updated would count
+  // the loads it shed as operational and shed more.
+  Guard g(lock_);
+  const LoadShedPlan plan = load_shedder_.plan(controller_.power_devices(), controller_.id());
+
+  // Keep planning until a plan is complete
+  const auto replan = get_timer<ReplanLoadSheddingEvent>();
+  if (!plan.complete && !replan->active()) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::shed_loads: ran out of time after %f ms, "
+               "planning again every %f s until a plan is complete\n",
+               plan.plan_time.count() * 1e3, replan_delay.count()));
+    schedule(ReplanLoadSheddingEvent(), replan_delay, replan_delay);
+  } else if (plan.complete && replan->active()) {
+    cancel<ReplanLoadSheddingEvent>(replan);
+  }
+  if (plan.empty()) {
     return;
   }
 
-  const tms::EnergyStartStopLevel to_essl = ESSL_from_OPT(opt);
-  if (to_essl == tms::EnergyStartStopLevel::ESSL_UNKNOWN) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::start_stop_device: unknown EnergyStartStopLevel\n"));
-    return;
+  ACE_DEBUG((LM_NOTICE, "(%P|%t) NOTICE: CLIServer::shed_loads: shedding %B load(s) and restoring %B, "
+             "planned in %f ms\n", plan.shed.size(), plan.restore.size(), plan.plan_time.count() * 1e3));
+
+  DeviceOpts devices;
+  devices.reserve(plan.shed.size() + plan.restore.size());
+  for (const tms::Identity& pd_id : plan.shed) {
+    devices.push_back(std::make_pair(pd_id, tms::OperatorPriorityType::OPT_NEVER_OPERATE));
   }
+  for (const tms::Identity& pd_id : plan.restore) {
+    devices.push_back(std::make_pair(pd_id, tms::OperatorPriorityType::OPT_ALWAYS_OPERATE));
+  }
+  set_levels(devices);
+}
 
-  const tms::EnergyStartStopLevel curr_essl = it->second.essl();
-  if (curr_essl == to_essl) {
-    ACE_DEBUG((LM_DEBUG, "(%P|%t) INFO: CLIServer::start_stop_device: device \"%C\" already in requested state\n", pd_id.c_str()));
+void CLIServer::set_levels(const DeviceOpts& devices)
+{
+  const PowerDevices pdvs = controller_.power_devices();
+
+  // Devices whose energy level is only updated locally, and requests to the devices this controller is active for
+  EsslUpdates updates;
+  std::vector<tms::EnergyStartStopRequest> requests;
+  for (const auto& device : devices) {
+    const tms::Identity& pd_id = device.first;
+    auto it = pdvs.find(pd_id);
+    if (it == pdvs.end()) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::set_levels: power device \"%C\" not found\n", pd_id.c_str()));
+      continue;
+    }
+
+    const tms::EnergyStartStopLevel to_essl = ESSL_from_OPT(device.second);
+    if (to_essl == tms::EnergyStartStopLevel::ESSL_UNKNOWN) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::set_levels: unknown EnergyStartStopLevel for device \"%C\"\n", pd_id.c_str()));
+      continue;
+    }
+
+    const tms::EnergyStartStopLevel curr_essl = it->second.essl();
+    if (curr_essl == to_essl) {
+      ACE_DEBUG((LM_DEBUG, "(%P|%t) INFO: CLIServer::set_levels: device \"%C\" already in requested state\n", pd_id.c_str()));
+      continue;
+    }
+
+    // Only update the energy level of the device locally if this is not its active controller.
+    const auto& master_id = it->second.master_id();
+    if (!master_id.has_value() || master_id.value() != controller_.get_device_id()) {
+      updates.push_back(std::make_pair(pd_id, to_essl));
+      continue;
+    }
+
+    // Else, send a command to the device to actually start/stop it.
+    tms::EnergyStartStopRequest essr;
+    essr.requestId().requestingDeviceId(controller_.id());
+    essr.requestId().targetDeviceId(pd_id);
+    essr.requestId().config() = tms::ConfigId::CONFIG_ACTIVE;
+    essr.fromLevel() = tms::EnergyStartStopLevel::ESSL_ANY;
+    essr.toLevel() = to_essl;
+    requests.push_back(essr);
+  }
+
+  if (!requests.empty()) {
+    send_essrs(requests, updates);
+  }
+  controller_.update_essls(updates);
+  levels_changed(updates);
+}
+
+void CLIServer::levels_changed(const EsslUpdates& updates)
+{
+  if (updates.empty()) {
     return;
   }
 
-  // Only update the energy level of the device locally if this is not its active controller.
-  const auto& master_id = it->second.master_id();
-  if (!master_id.has_value() || master_id.value() != controller_.get_device_id()) {
-    controller_.update_essl(pd_id, to_essl);
+  log_island_changes(islanding_.set_levels(updates));
+  contingencies_.set_levels(updates);
+  power_flow_.set_levels(updates);
+  publish_power_flow();
+}
+
+void CLIServer::timer_fired(Timer<ReplanLoadSheddingEvent>&)
+{
+  shed_loads();
+}
+
+void CLIServer::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
+
+void CLIServer::send_essrs(const std::vector<tms::EnergyStartStopRequest>& requests, EsslUpdates& updates)
+{
+  // The group holds one extra count while the requests are written so that it
+  // can't complete before the last one is sent.
+  auto group = std::make_shared<EssrGroup>();
+  group->remaining = 1;
+
+  auto complete = [group]() {
+    if (requests_done(*group) && group->total > 1) {
+      const Sec elapsed = Clock::now() - group->started;
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: CLIServer::send_essrs: %B EnergyStartStopRequests completed in %f s: "
+                 "%B OK, %B rejected, %B without reply\n",
+                 group->total, elapsed.count(), group->ok, group->rejected, group->expired));
+    }
+  };
+
+  auto on_result = [this, group, complete](const EssrEngine::Result& result) {
+    if (result.outcome == EssrEngine::Outcome::REPLIED) {
+      Metrics::instance().essr_round_trip.record(result.round_trip);
+    }
+    {
+      SimpleGuard guard(group->m);
+      if (result.outcome == EssrEngine::Outcome::REPLIED && result.reply->status().code() == tms::ReplyCode::REPLY_OK) {
+        ++group->ok;
+      } else if (result.outcome == EssrEngine::Outcome::REPLIED) {
+        ++group->rejected;
+      } else {
+        ++group->expired;
+      }
+    }
+
+    if (result.outcome == EssrEngine::Outcome::EXPIRED) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::send_essrs: "
+                 "no reply from device \"%C\" after %u attempt(s)\n", result.target.c_str(), result.attempts));
+    } else if (result.reply && result.reply->status().code() != tms::ReplyCode::REPLY_OK) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::send_essrs: device \"%C\" replied %C: %C\n",
+                 result.target.c_str(), replycode_to_string(result.reply->status().code()).c_str(),
+                 result.reply->status().reason().c_str()));
+    }
+    complete();
+  };
+
+  // Write all requests back to back without waiting for any reply. Suspending
+  // the publisher lets the transport coalesce them into fewer network messages.
+  essr_pub_->suspend_publications();
+  for (const tms::EnergyStartStopRequest& essr : requests) {
+    {
+      SimpleGuard guard(group->m);
+      ++group->remaining;
+      ++group->total;
+    }
+    if (essr_engine_->send(essr, on_result) == DDS::RETCODE_OK) {
+      updates.push_back(std::make_pair(essr.requestId().targetDeviceId(), essr.toLevel()));
+    } else {
+      SimpleGuard guard(group->m);
+      --group->remaining;
+      --group->total;
+    }
+  }
+  essr_pub_->resume_publications();
+
+  complete();
+}
+
+bool CLIServer::requests_done(EssrGroup& group)
+{
+  SimpleGuard guard(group.m);
+  return --group.remaining == 0;
+}
+
+void CLIServer::distribute_topology(const powersim::PowerTopology& pt)
+{
+  SimpleGuard guard(distributed_m_);
+  const PowerConnectionsDiff diff = update_connections(distributed_, pt);
+  if (diff.empty()) {
     return;
   }
+  replicator_.connections_changed(diff);
+
+  // Send all changes together
+  sim_pub_->suspend_publications();
+  for (const powersim::PowerConnection& pc : diff.changed) {
+    const DDS::ReturnCode_t rc = pc_dw_->write(pc, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::distribute_topology:"
+                 " write PowerConnection to device \"%C\" failed: %C\n", pc.pd_id().c_str(),
+                 OpenDDS::DCPS::retcode_to_string(rc)));
+      // Make sure it's written next time
+      distributed_.erase(pc.pd_id());
+    }
+  }
+
+  for (const tms::Identity& pd_id : diff.removed) {
+    powersim::PowerConnection pc;
+    pc.pd_id(pd_id);
+    const DDS::ReturnCode_t rc = pc_dw_->dispose(pc, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::distribute_topology:"
+                 " dispose PowerConnection of device \"%C\" failed: %C\n", pd_id.c_str(),
+                 OpenDDS::DCPS::retcode_to_string(rc)));
+      // Keep it without connections so that it's disposed again next time
+      distributed_[pd_id];
+    }
+  }
+  sim_pub_->resume_publications();
+
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIServer::distribute_topology: %B of %B power connection(s) changed, %B removed\n",
+               diff.changed.size(), pt.connections().size(), diff.removed.size()));
+  }
+}
+
+void CLIServer::visit_distributed_topology(const std::function<void(const PowerConnections&)>& f)
+{
+  SimpleGuard guard(distributed_m_);
+  f(distributed_);
+}
+
+bool CLIServer::adopt_connections(const tms::Identity& pd_id, const powersim::ConnectedDeviceSeq& cds)
+{
+  SimpleGuard guard(distributed_m_);
+  if (!distributed_.insert(std::make_pair(pd_id, cds)).second) {
+    return false;
+  }
 
-  // Else, send a command to the device to actually start/stop it.
-  tms::EnergyStartStopRequest essr;
-  essr.requestId().requestingDeviceId(controller_.id());
-  essr.requestId().targetDeviceId(pd_id);
-  essr.requestId().config() = tms::ConfigId::CONFIG_ACTIVE;
-  essr.sequenceId() = essr_seqnum_++;
-  essr.fromLevel() = tms::EnergyStartStopLevel::ESSL_ANY;
-  essr.toLevel() = to_essl;
+  PowerConnectionsDiff diff;
+  powersim::PowerConnection pc;
+  pc.pd_id(pd_id);
+  pc.connected_devices(cds);
+  diff.changed.push_back(pc);
+  replicator_.connections_changed(diff);
 
-  const DDS::ReturnCode_t rc = essr_dw_->write(essr, DDS::HANDLE_NIL);
+  // The writer of the previous controller is gone with its connections, so this
+  // controller's writer holds them for the device when it restarts.
+  const DDS::ReturnCode_t rc = pc_dw_->write(pc, DDS::HANDLE_NIL);
   if (rc != DDS::RETCODE_OK) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CLIServer::start_stop_device: write failed: %C\n",
+    Metrics::instance().write_failed();
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::adopt_connections:"
+               " write PowerConnection to device \"%C\" failed: %C\n", pd_id.c_str(),
                OpenDDS::DCPS::retcode_to_string(rc)));
+    distributed_.erase(pd_id);
+  }
+  return true;
+}
+
+void CLIServer::update_islands(const powersim::PowerTopology& pt)
+{
+  islanding_.set_topology(pt, controller_.power_devices());
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    const IslandingDetector::Stats stats = islanding_.stats();
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIServer::update_islands: %B device(s) in %B island(s), took %f ms\n",
+               stats.devices, stats.islands, stats.last_update_time.count() * 1e3));
+  }
+}
+
+void CLIServer::log_island_changes(const std::vector<IslandChange>& changes) const
+{
+  for (const IslandChange& change : changes) {
+    for (const Island& island : change.islands) {
+      ACE_DEBUG((LM_NOTICE, "(%P|%t) NOTICE: CLIServer::log_island_changes: island of %B device(s) "
+                 "with %B operational source(s) %C by device \"%C\"\n",
+                 island.devices.size(), island.sources,
+                 IslandingDetector::kind_to_string(change.kind), change.cause.c_str()));
+    }
+  }
+
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    const IslandingDetector::Stats stats = islanding_.stats();
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIServer::log_island_changes: %B island(s), update took %f ms\n",
+               stats.islands, stats.last_update_time.count() * 1e3));
+  }
+}
+
+void CLIServer::update_contingencies(const powersim::PowerTopology& pt)
+{
+  contingencies_.set_topology(pt, controller_.power_devices());
+}
+
+void CLIServer::log_contingencies() const
+{
+  const size_t max_shown = 20;
+  const ContingencyAnalyzer::Stats stats = contingencies_.stats();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: Controller \"%C\" has %B single point(s) of failure among %B device(s)%C\n",
+             controller_.id().c_str(), stats.single_points_of_failure, stats.devices,
+             stats.single_points_of_failure > max_shown ? ", the worst are:" : ""));
+  for (const Contingency& c : contingencies_.ranking(max_shown)) {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO:   %C \"%C\": %f W unserved, %B load(s) lost (%f W), "
+               "%f W short in the %B island(s) left\n",
+               Utils::device_role_to_string(c.role).c_str(), c.device.c_str(), c.unserved,
+               c.lost_loads, c.lost_demand, c.shortfall, c.islands));
+  }
+}
+
+void CLIServer::update_power_flow(const powersim::PowerTopology& pt)
+{
+  power_flow_.set_topology(pt, controller_.power_devices());
+  publish_power_flow();
+}
+
+void CLIServer::publish_power_flow()
+{
+  const PowerFlowUpdate update = power_flow_.solve(controller_.id());
+  if (update.empty() || !pf_dw_) {
     return;
   }
 
-  controller_.update_essl(pd_id, to_essl);
-  {
-    std::lock_guard<std::mutex> guard(pending_essr_m_);
-    pending_essr_.insert(std::make_pair(essr.sequenceId(), pd_id));
+  sim_pub_->suspend_publications();
+  for (const powersim::PowerFlow& pf : update.changed) {
+    const DDS::ReturnCode_t rc = pf_dw_->write(pf, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::publish_power_flow:"
+                 " write PowerFlow of device \"%C\" failed: %C\n", pf.pd_id().c_str(),
+                 OpenDDS::DCPS::retcode_to_string(rc)));
+    }
+  }
+
+  for (const tms::Identity& pd_id : update.removed) {
+    powersim::PowerFlow pf;
+    pf.pd_id(pd_id);
+    const DDS::ReturnCode_t rc = pf_dw_->dispose(pf, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: CLIServer::publish_power_flow:"
+                 " dispose PowerFlow of device \"%C\" failed: %C\n", pd_id.c_str(),
+                 OpenDDS::DCPS::retcode_to_string(rc)));
+    }
+  }
+  sim_pub_->resume_publications();
+
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    const PowerFlowSolver::Stats stats = power_flow_.stats();
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIServer::publish_power_flow: %B bus(es), %B branch(es), %B island(s): "
+               "factored %Q time(s), last in %f ms with %B nonzeros, last solve in %f ms, %B result(s) changed\n",
+               stats.buses, stats.branches, stats.islands, stats.factorizations,
+               stats.last_factor_time.count() * 1e3, stats.factor_nonzeros, stats.last_solve_time.count() * 1e3,
+               update.changed.size()));
   }
 }
 
@@ -457,9 +838,14 @@ void CLIServer::receive_reply(const tms::Reply& reply)
                target_id.c_str(), replycode_to_string(status.code()).c_str()));
   }
 
-  {
-    // Regardless of the status, remove the entry for the pending request
-    std::lock_guard<std::mutex> guard(pending_essr_m_);
-    pending_essr_.erase(seqnum);
+  // Regardless of the status, complete the pending request
+  if (!essr_engine_->receive_reply(reply) && OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: CLIServer::receive_reply: no pending request %Q to device \"%C\"\n",
+               static_cast<ACE_UINT64>(seqnum), target_id.c_str()));
   }
 }
+
+std::unordered_map<tms::Identity, Histogram> CLIServer::essr_latencies() const
+{
+  return essr_engine_->latencies();
+}
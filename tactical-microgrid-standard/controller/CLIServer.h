@@ -2,11 +2,28 @@
 #define CONTROLLER_CLI_SERVER_H
 
 #include "Controller.h"
+#include "StateReplicator.h"
+#include "PowerConnections.h"
+#include "PowerFlowSolver.h"
+#include "IslandingDetector.h"
+#include "LoadShedder.h"
+#include "ContingencyMonitor.h"
+
+#include <common/RequestReplyEngine.h>
 
 #include <cli_idl/CLICommandsTypeSupportImpl.h>
 #include <power_devices/PowerSimTypeSupportImpl.h>
 
-class CLIServer {
+#include <functional>
+
+struct ReplanLoadSheddingEvent {
+  static const char* name()
+  {
+    return "ReplanLoadShedding";
+  }
+};
+
+class CLIServer : public TimerHandler<ReplanLoadSheddingEvent> {
 public:
   explicit CLIServer(Controller& mc);
   ~CLIServer() {}
@@ -26,9 +43,71 @@ public:
     return pc_dw_;
   }
 
+  using DeviceOpts = std::vector<std::pair<tms::Identity, tms::OperatorPriorityType>>;
+  using DeviceRanks = std::vector<std::pair<tms::Identity, int16_t>>;
+
   void start_stop_device(const tms::Identity& pd_id, tms::OperatorPriorityType opt);
+
+  // Start or stop many power devices in one pass. The requests to all devices are
+  // written before any reply is awaited, and their replies are tracked as a group.
+  // Loads started or stopped by an operator are left alone by load shedding.
+  void start_stop_devices(const DeviceOpts& devices);
   void receive_reply(const tms::Reply& reply);
 
+  // Send the power connections of a new topology to the power devices.
+  // Only the connections that differ from the last topology are written,
+  // and those of power devices no longer in the topology are disposed. The
+  // writer keeps the last connections of each device for devices that start later.
+  void distribute_topology(const powersim::PowerTopology& pt);
+
+  // Call f with the last topology distributed to the power devices, which doesn't
+  // change until f returns.
+  void visit_distributed_topology(const std::function<void(const PowerConnections&)>& f);
+
+  // Take over the power connections of a power device that failed over from a peer
+  // controller, unless this controller already distributed connections for it.
+  bool adopt_connections(const tms::Identity& pd_id, const powersim::ConnectedDeviceSeq& cds);
+
+  // Track the islands of a new topology
+  void update_islands(const powersim::PowerTopology& pt);
+
+  // Operator priorities of loads for load shedding, where 0 is the highest
+  void rank_devices(const DeviceRanks& ranks);
+
+  // Shed loads from a new topology on
+  void update_load_shedding(const powersim::PowerTopology& pt);
+
+  // Shed or restore loads as the operational sources allow. If the plan ran out
+  // of time, loads are planned again every replan_delay until a plan is complete.
+  // Plans and the levels they set are serialized by lock_, so each plan sees the
+  // levels set by the one before.
+  void shed_loads();
+
+  // Update the islands, contingencies and power flow after the energy levels of
+  // devices changed, e.g. as replicated from the peer controllers
+  void levels_changed(const EsslUpdates& updates);
+
+  // Analyze the contingencies of a new topology, later on the reactor
+  void update_contingencies(const powersim::PowerTopology& pt);
+
+  // Log the single points of failure found by the last analysis
+  void log_contingencies() const;
+
+  // Solve the power flow over a new topology and publish the results
+  void update_power_flow(const powersim::PowerTopology& pt);
+
+  // Solve the power flow again, e.g. after energy levels changed, and publish
+  // the results that changed.
+  void publish_power_flow();
+
+  PowerFlowSolver::Stats power_flow_stats() const
+  {
+    return power_flow_.stats();
+  }
+
+  // Round-trip times of EnergyStartStopRequests per power device
+  std::unordered_map<tms::Identity, Histogram> essr_latencies() const;
+
 private:
   DDS::ReturnCode_t init();
   DDS::ReturnCode_t init_tms();
@@ -37,18 +116,55 @@ private:
   tms::EnergyStartStopLevel ESSL_from_OPT(tms::OperatorPriorityType opt);
   std::string replycode_to_string(tms::ReplyCode code);
 
-  // Provide sequence number for the EnergyStartStopRequest
-  tms::RequestSequence essr_seqnum_ = 0;
+  using EssrEngine = RequestReplyEngine<tms::EnergyStartStopRequest>;
 
-  // Requests that are waiting for a reply from the target power device
-  std::unordered_map<tms::RequestSequence, tms::Identity> pending_essr_;
-  std::mutex pending_essr_m_;
+  // Outcome of the EnergyStartStopRequests sent by one set_levels call
+  struct EssrGroup {
+    SimpleMutex m{"CLIServer::EssrGroup"};
+    size_t remaining = 0;
+    size_t total = 0;
+    size_t ok = 0;
+    size_t rejected = 0;
+    size_t expired = 0;
+    const TimePoint started = Clock::now();
+  };
+
+  // Bring devices to the energy levels of their priorities. Must be called with lock_ held.
+  void set_levels(const DeviceOpts& devices);
+
+  // Send requests and append the energy levels of the devices they were sent to
+  void send_essrs(const std::vector<tms::EnergyStartStopRequest>& requests, EsslUpdates& updates);
+
+  void timer_fired(Timer<ReplanLoadSheddingEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  void log_island_changes(const std::vector<IslandChange>& changes) const;
+  static bool requests_done(EssrGroup& group);
+
+  // Tracks the EnergyStartStopRequests that are waiting for a reply from the target power device
+  std::unique_ptr<EssrEngine> essr_engine_;
 
   Controller& controller_;
+  StateReplicator replicator_;
   cli::PowerDevicesReplyDataWriter_var pdrep_dw_;
+  DDS::Publisher_var sim_pub_;
+  DDS::Publisher_var essr_pub_;
   tms::EnergyStartStopRequestDataWriter_var essr_dw_;
   powersim::PowerConnectionDataWriter_var pc_dw_;
+  powersim::PowerFlowDataWriter_var pf_dw_;
   DDS::DomainParticipant_var sim_participant_;
+
+  // The last topology distributed to the power devices
+  PowerConnections distributed_;
+  SimpleMutex distributed_m_{"CLIServer::distributed"};
+
+  // Time between load shedding plans while they run out of time
+  static constexpr Sec replan_delay = Sec(0.5);
+
+  PowerFlowSolver power_flow_;
+  IslandingDetector islanding_;
+  LoadShedder load_shedder_;
+  ContingencyMonitor contingencies_;
 };
 
 #endif
@@ -6,8 +6,10 @@
 
 #include <unordered_map>
 #include <optional>
+#include <vector>
 
 using OpArgPair = std::pair<std::string, std::optional<std::string>>;
 using PowerDevices = std::unordered_map<tms::Identity, cli::PowerDeviceInfo>;
+using EsslUpdates = std::vector<std::pair<tms::Identity, tms::EnergyStartStopLevel>>;
 
 #endif
@@ -0,0 +1,346 @@
+#include "ContingencyAnalyzer.h"
+#include "PowerFlowSolver.h"
+
+#include <algorithm>
+
+ContingencyAnalyzer::Totals& ContingencyAnalyzer::Totals::operator+=(const Totals& other)
+{
+  devices += other.devices;
+  sources += other.sources;
+  loads += other.loads;
+  capacity += other.capacity;
+  demand += other.demand;
+  return *this;
+}
+
+ContingencyAnalyzer::Totals& ContingencyAnalyzer::Totals::operator-=(const Totals& other)
+{
+  devices -= other.devices;
+  sources -= other.sources;
+  loads -= other.loads;
+  capacity -= other.capacity;
+  demand -= other.demand;
+  return *this;
+}
+
+double ContingencyAnalyzer::Totals::unserved() const
+{
+  return sources == 0 ? demand : std::max(0.0, demand - capacity);
+}
+
+ContingencyAnalyzer::ContingencyAnalyzer(const Config& config)
+  : config_(config)
+  , pool_(config.threads)
+{
+}
+
+void ContingencyAnalyzer::set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices)
+{
+  SimpleGuard guard(m_);
+  TopologyGraph::Builder builder;
+  builder.add_topology(pt);
+  for (const auto& pair : devices) {
+    builder.add_device(pair.first, pair.second.device_info().role());
+  }
+  const TopologyGraph old_graph = std::move(graph_);
+  const std::vector<double> old_rating = std::move(rating_);
+  const std::vector<uint8_t> old_load_operational = std::move(load_operational_);
+  const std::vector<uint8_t> old_dirty = std::move(dirty_);
+  const std::vector<Result> old_result = std::move(result_);
+  graph_ = builder.build();
+
+  // Devices the controller doesn't know are taken to conduct but supply nothing
+  const size_t n = graph_.size();
+  rating_.assign(n, 0.0);
+  load_operational_.assign(n, 0);
+  for (Node u = 0; u < n; ++u) {
+    const auto it = devices.find(graph_.id(u));
+    const bool operational = it == devices.end() ||
+      it->second.essl() == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+    if (is_load(u)) {
+      graph_.set_active(u, false);
+      if (it != devices.end()) {
+        rating_[u] = PowerFlowSolver::rated_demand(it->second.device_info()).value_or(config_.default_load_demand);
+        load_operational_[u] = operational;
+      }
+    } else {
+      graph_.set_active(u, operational);
+      if (it != devices.end() && graph_.role(u) == tms::DeviceRole::ROLE_SOURCE) {
+        rating_[u] = PowerFlowSolver::rated_capacity(it->second.device_info()).value_or(config_.default_source_capacity);
+      }
+    }
+  }
+
+  // Keep the results of the devices that are the same as before and have the
+  // same neighbors. The neighbors of a load must also be in the same order, so
+  // it is supplied through the same one. Only the islands of the other devices
+  // are analyzed again.
+  auto neighbor_ids = [this](const TopologyGraph& graph, Node u) {
+    std::vector<tms::Identity> ids;
+    for (const Node* v = graph.neighbors_begin(u); v != graph.neighbors_end(u); ++v) {
+      ids.push_back(graph.id(*v));
+    }
+    if (!is_load(u)) {
+      std::sort(ids.begin(), ids.end());
+    }
+    return ids;
+  };
+  dirty_.assign(n, 0);
+  result_.assign(n, Result());
+  std::vector<Node> changed;
+  for (Node u = 0; u < n; ++u) {
+    const Node o = old_graph.index(graph_.id(u));
+    const bool same = o != TopologyGraph::NONE && graph_.role(u) == old_graph.role(o) &&
+      graph_.active(u) == old_graph.active(o) && rating_[u] == old_rating[o] &&
+      load_operational_[u] == old_load_operational[o] && graph_.degree(u) == old_graph.degree(o) &&
+      neighbor_ids(graph_, u) == neighbor_ids(old_graph, o);
+    if (same) {
+      dirty_[u] = old_dirty[o];
+      result_[u] = old_result[o];
+    } else {
+      changed.push_back(u);
+    }
+  }
+  for (const Node u : changed) {
+    touch(u);
+  }
+
+  own_.assign(n, Totals());
+  split_.assign(n, Totals());
+  below_.assign(n, Totals());
+  order_.assign(n, 0);
+  low_.assign(n, 0);
+  ranked_.clear();
+  stats_.devices = n;
+}
+
+void ContingencyAnalyzer::set_levels(const EsslUpdates& updates)
+{
+  SimpleGuard guard(m_);
+  for (const auto& update : updates) {
+    const Node n = graph_.index(update.first);
+    if (n != TopologyGraph::NONE) {
+      set_operational(n, update.second == tms::EnergyStartStopLevel::ESSL_OPERATIONAL);
+    }
+  }
+}
+
+void ContingencyAnalyzer::set_operational(Node n, bool operational)
+{
+  if (is_load(n)) {
+    if (load_operational_[n] == operational) {
+      return;
+    }
+    load_operational_[n] = operational;
+  } else if (!graph_.set_active(n, operational)) {
+    return;
+  }
+  touch(n);
+}
+
+void ContingencyAnalyzer::touch(Node n)
+{
+  // A load may move to another neighbor if its neighbor changes
+  dirty_[n] = 1;
+  for (const Node* v = graph_.neighbors_begin(n); v != graph_.neighbors_end(n); ++v) {
+    dirty_[*v] = 1;
+    if (is_load(*v)) {
+      for (const Node* w = graph_.neighbors_begin(*v); w != graph_.neighbors_end(*v); ++w) {
+        dirty_[*w] = 1;
+      }
+    }
+  }
+}
+
+void ContingencyAnalyzer::analyze()
+{
+  const auto start_time = std::chrono::steady_clock::now();
+  SimpleGuard guard(m_);
+  const size_t n = graph_.size();
+  const TopologyGraph::Energization energization = graph_.energization();
+  const size_t islands = energization.sources.size();
+
+  // Sources and loads of each device, and the devices of each island
+  std::vector<uint32_t> offsets(islands + 1, 0);
+  for (Node u = 0; u < n; ++u) {
+    own_[u] = Totals();
+    if (!graph_.active(u)) {
+      continue;
+    }
+    own_[u].devices = 1;
+    if (graph_.role(u) == tms::DeviceRole::ROLE_SOURCE) {
+      own_[u].sources = 1;
+      own_[u].capacity = rating_[u];
+    }
+    ++offsets[energization.component[u] + 1];
+  }
+  for (Node u = 0; u < n; ++u) {
+    if (!is_load(u) || !load_operational_[u]) {
+      continue;
+    }
+    for (const Node* v = graph_.neighbors_begin(u); v != graph_.neighbors_end(u); ++v) {
+      if (energization.component[*v] != TopologyGraph::NONE && graph_.connection_active(u, *v)) {
+        ++own_[*v].loads;
+        own_[*v].demand += rating_[u];
+        break;
+      }
+    }
+  }
+  for (size_t c = 0; c < islands; ++c) {
+    offsets[c + 1] += offsets[c];
+  }
+  std::vector<Node> members(offsets[islands]);
+  {
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (Node u = 0; u < n; ++u) {
+      if (graph_.active(u)) {
+        members[next[energization.component[u]]++] = u;
+      }
+    }
+  }
+
+  // Islands without a source have nothing to lose
+  std::vector<WorkStealingPool::Task> tasks;
+  for (size_t c = 0; c < islands; ++c) {
+    const Node* begin = members.data() + offsets[c];
+    const Node* end = members.data() + offsets[c + 1];
+    if (std::none_of(begin, end, [this](Node u) { return dirty_[u] != 0; })) {
+      continue;
+    }
+    if (energization.sources[c].empty()) {
+      for (const Node* u = begin; u != end; ++u) {
+        result_[*u] = Result();
+      }
+    } else {
+      tasks.push_back([this, begin, end]() { analyze_island(begin, end); });
+    }
+  }
+  stats_.last_analyzed_islands = tasks.size();
+  pool_.run(tasks);
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+
+  ranked_.clear();
+  for (Node u = 0; u < n; ++u) {
+    if (graph_.active(u) && (result_[u].unserved > 0 || result_[u].lost_loads > 0)) {
+      ranked_.push_back(u);
+    }
+  }
+  std::sort(ranked_.begin(), ranked_.end(), [this](Node a, Node b) {
+    const Result& ra = result_[a];
+    const Result& rb = result_[b];
+    return ra.unserved != rb.unserved ? ra.unserved > rb.unserved :
+      ra.lost_loads != rb.lost_loads ? ra.lost_loads > rb.lost_loads : a < b;
+  });
+
+  ++stats_.runs;
+  stats_.islands = islands;
+  stats_.single_points_of_failure = ranked_.size();
+  stats_.last_run_time = std::chrono::steady_clock::now() - start_time;
+  stats_.max_run_time = std::max(stats_.max_run_time, stats_.last_run_time);
+}
+
+void ContingencyAnalyzer::analyze_island(const Node* begin, const Node* end)
+{
+  Totals total;
+  for (const Node* u = begin; u != end; ++u) {
+    total += own_[*u];
+    order_[*u] = 0;
+    below_[*u] = own_[*u];
+    split_[*u] = Totals();
+    result_[*u] = Result();
+  }
+
+  // Iterative depth-first search. Where the devices below a child of u can
+  // only reach u and what is below it, they break off when u is lost.
+  struct Frame {
+    Node u;
+    Node parent;
+    const Node* next;
+  };
+  std::vector<Frame> stack;
+  uint32_t counter = 1;
+  order_[*begin] = low_[*begin] = counter++;
+  stack.push_back(Frame{*begin, TopologyGraph::NONE, graph_.neighbors_begin(*begin)});
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    const Node u = frame.u;
+    if (frame.next != graph_.neighbors_end(u)) {
+      const Node v = *frame.next++;
+      if (v == frame.parent || !graph_.active(v) || !graph_.connection_active(u, v)) {
+        continue;
+      }
+      if (order_[v] == 0) {
+        order_[v] = low_[v] = counter++;
+        stack.push_back(Frame{v, u, graph_.neighbors_begin(v)});
+      } else {
+        low_[u] = std::min(low_[u], order_[v]);
+      }
+      continue;
+    }
+
+    const Node parent = frame.parent;
+    stack.pop_back();
+    if (parent != TopologyGraph::NONE) {
+      low_[parent] = std::min(low_[parent], low_[u]);
+      below_[parent] += below_[u];
+      if (low_[u] >= order_[parent]) {
+        add_part(result_[parent], below_[u]);
+        split_[parent] += below_[u];
+      }
+    }
+  }
+
+  // The rest of the island, which is what isn't below u, stays together. The
+  // loads supplied through u are lost with it.
+  const double base = total.unserved();
+  for (const Node* u = begin; u != end; ++u) {
+    Result& result = result_[*u];
+    Totals rest = total;
+    rest -= own_[*u];
+    rest -= split_[*u];
+    if (rest.devices > 0) {
+      add_part(result, rest);
+    }
+    result.lost_loads += own_[*u].loads;
+    result.lost_demand += own_[*u].demand;
+    result.unserved = std::max(0.0, result.unserved + own_[*u].demand - base);
+  }
+}
+
+void ContingencyAnalyzer::add_part(Result& result, const Totals& part) const
+{
+  ++result.islands;
+  if (part.sources == 0) {
+    result.lost_loads += part.loads;
+    result.lost_demand += part.demand;
+  } else {
+    result.shortfall += std::max(0.0, part.demand - part.capacity);
+  }
+  result.unserved += part.unserved();
+}
+
+std::vector<Contingency> ContingencyAnalyzer::ranking(size_t max) const
+{
+  SimpleGuard guard(m_);
+  std::vector<Contingency> contingencies;
+  for (size_t i = 0; i < ranked_.size() && i < max; ++i) {
+    const Node u = ranked_[i];
+    const Result& result = result_[u];
+    Contingency contingency;
+    contingency.device = graph_.id(u);
+    contingency.role = graph_.role(u);
+    contingency.islands = result.islands;
+    contingency.lost_loads = result.lost_loads;
+    contingency.lost_demand = result.lost_demand;
+    contingency.shortfall = result.shortfall;
+    contingency.unserved = result.unserved;
+    contingencies.push_back(std::move(contingency));
+  }
+  return contingencies;
+}
+
+ContingencyAnalyzer::Stats ContingencyAnalyzer::stats() const
+{
+  SimpleGuard guard(m_);
+  return stats_;
+}
@@ -0,0 +1,160 @@
+#ifndef CONTROLLER_CONTINGENCY_ANALYZER_H
+#define CONTROLLER_CONTINGENCY_ANALYZER_H
+
+#include "Common.h"
+
+#include <common/TimerHandler.h>
+#include <common/TopologyGraph.h>
+#include <common/WorkStealingPool.h>
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <cstdint>
+#include <vector>
+
+// What happens to the island of a device if the device is lost
+struct Contingency {
+  tms::Identity device;
+  tms::DeviceRole role;
+  // Islands the rest of the island breaks into
+  size_t islands = 0;
+  // Loads left without an operational source and their demand, in W
+  size_t lost_loads = 0;
+  double lost_demand = 0.0;
+  // Demand beyond the capacity of the islands that are still supplied, in W
+  double shortfall = 0.0;
+  // Demand that can't be served anymore because of the loss, in W
+  double unserved = 0.0;
+};
+
+/**
+ * N-1 contingency analysis: for each operational source and distribution
+ * device, what the loss of just that device would do to the loads of its
+ * island. Devices whose loss leaves loads unserved are single points of failure.
+ *
+ * Islands are the groups of operational sources and distribution devices
+ * connected to each other, and each operational load is supplied through the
+ * first of its neighbors that is in one. Instead of searching the island again
+ * without each device, one depth-first search per island finds the devices
+ * that split it (its articulation points) and sums the sources and loads below
+ * each of them, which gives the parts the island breaks into for every device
+ * at once. Islands are analyzed in parallel on a WorkStealingPool and only the
+ * islands that changed since the last analysis are analyzed again.
+ */
+class ContingencyAnalyzer {
+public:
+  struct Config {
+    // Threads analyzing islands, 0 for one per hardware thread
+    size_t threads = 0;
+    // Power of loads and sources whose DeviceInfo doesn't give their rating, in W
+    double default_load_demand = 1000.0;
+    double default_source_capacity = 10000.0;
+  };
+
+  struct Stats {
+    size_t devices = 0;
+    size_t islands = 0;
+    size_t single_points_of_failure = 0;
+    uint64_t runs = 0;
+    // Islands analyzed by the last run, the others were unchanged
+    size_t last_analyzed_islands = 0;
+    Sec last_run_time = Sec(0);
+    Sec max_run_time = Sec(0);
+  };
+
+  ContingencyAnalyzer()
+    : ContingencyAnalyzer(Config())
+  {
+  }
+
+  explicit ContingencyAnalyzer(const Config& config);
+
+  // Replace the topology. Energy levels and ratings come from the devices
+  // known to the controller. Only the islands with devices that were added,
+  // removed or changed, including their connections, are analyzed again.
+  void set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices);
+
+  void set_levels(const EsslUpdates& updates);
+
+  // Analyze the islands that changed since the last run
+  void analyze();
+
+  // Single points of failure found by the last run, the most unserved demand
+  // first, then the most lost loads
+  std::vector<Contingency> ranking(size_t max = SIZE_MAX) const;
+
+  Stats stats() const;
+
+private:
+  using Node = TopologyGraph::Node;
+
+  // Sources and loads of a group of devices
+  struct Totals {
+    uint32_t devices = 0;
+    uint32_t sources = 0;
+    uint32_t loads = 0;
+    double capacity = 0.0;
+    double demand = 0.0;
+
+    Totals& operator+=(const Totals& other);
+    Totals& operator-=(const Totals& other);
+
+    // Demand the group can't serve as an island of its own
+    double unserved() const;
+  };
+
+  struct Result {
+    uint32_t islands = 0;
+    uint32_t lost_loads = 0;
+    double lost_demand = 0.0;
+    double shortfall = 0.0;
+    double unserved = 0.0;
+  };
+
+  bool is_load(Node n) const
+  {
+    return graph_.role(n) == tms::DeviceRole::ROLE_LOAD;
+  }
+
+  void set_operational(Node n, bool operational);
+
+  // Mark the islands a change of the energy level of n can affect
+  void touch(Node n);
+
+  // Analyze the island of the given devices. Islands write disjoint parts of
+  // the members and can be analyzed concurrently.
+  void analyze_island(const Node* begin, const Node* end);
+
+  // Count a part the island breaks into in the result of a device
+  void add_part(Result& result, const Totals& part) const;
+
+  Config config_;
+  mutable SimpleMutex m_{"ContingencyAnalyzer"};
+  WorkStealingPool pool_;
+  TopologyGraph graph_;
+
+  // Rated power of each source and load, and whether each load is operational.
+  // Sources and distribution devices are operational when they're active in graph_.
+  std::vector<double> rating_;
+  std::vector<uint8_t> load_operational_;
+  // Devices of islands that need to be analyzed again
+  std::vector<uint8_t> dirty_;
+
+  // Sources and loads of each device, that is, the loads supplied through it
+  std::vector<Totals> own_;
+  std::vector<Result> result_;
+
+  // Depth-first search state, per device so islands don't share any
+  std::vector<uint32_t> order_;
+  std::vector<uint32_t> low_;
+  // Sum of the devices below each device and of the parts that break off there
+  std::vector<Totals> below_;
+  std::vector<Totals> split_;
+
+  // Devices with a result worth ranking, sorted
+  std::vector<Node> ranked_;
+
+  Stats stats_;
+};
+
+#endif
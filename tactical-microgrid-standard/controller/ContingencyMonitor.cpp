@@ -0,0 +1,65 @@
+#include "ContingencyMonitor.h"
+
+ContingencyMonitor::ContingencyMonitor(ACE_Reactor* reactor, const ContingencyAnalyzer::Config& config)
+  : TimerHandler(reactor, "ContingencyMonitor")
+  , analyzer_(config)
+{
+  schedule(AnalyzeContingenciesEvent(), analysis_period, analysis_period);
+}
+
+ContingencyMonitor::~ContingencyMonitor()
+{
+  Guard g(lock_);
+  cancel<AnalyzeContingenciesEvent>();
+}
+
+void ContingencyMonitor::set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices)
+{
+  std::unique_ptr<Topology> topology(new Topology{pt, devices});
+  SimpleGuard g(m_);
+  topology_ = std::move(topology);
+  levels_.clear();
+}
+
+void ContingencyMonitor::set_levels(const EsslUpdates& updates)
+{
+  if (updates.empty()) {
+    return;
+  }
+  SimpleGuard g(m_);
+  levels_.insert(levels_.end(), updates.begin(), updates.end());
+}
+
+void ContingencyMonitor::timer_fired(Timer<AnalyzeContingenciesEvent>&)
+{
+  std::unique_ptr<Topology> topology;
+  EsslUpdates levels;
+  {
+    SimpleGuard g(m_);
+    if (!topology_ && levels_.empty()) {
+      return;
+    }
+    topology = std::move(topology_);
+    levels.swap(levels_);
+  }
+
+  if (topology) {
+    analyzer_.set_topology(topology->pt, topology->devices);
+  }
+  if (!levels.empty()) {
+    analyzer_.set_levels(levels);
+  }
+  analyzer_.analyze();
+
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    const ContingencyAnalyzer::Stats stats = analyzer_.stats();
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: ContingencyMonitor::timer_fired: %B single point(s) of failure, "
+               "analyzed %B of %B island(s) in %f ms\n", stats.single_points_of_failure,
+               stats.last_analyzed_islands, stats.islands, stats.last_run_time.count() * 1e3));
+  }
+}
+
+void ContingencyMonitor::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
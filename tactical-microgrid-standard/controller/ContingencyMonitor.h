@@ -0,0 +1,61 @@
+#ifndef CONTROLLER_CONTINGENCY_MONITOR_H
+#define CONTROLLER_CONTINGENCY_MONITOR_H
+
+#include "ContingencyAnalyzer.h"
+
+#include <memory>
+
+struct AnalyzeContingenciesEvent {
+  static const char* name() { return "AnalyzeContingencies"; }
+};
+
+/**
+ * Runs a ContingencyAnalyzer from a timer on the controller's reactor, so the
+ * DDS listeners that change the topology or the energy levels only queue the
+ * change. Changes queued between two ticks are applied together and analyzed
+ * once, and nothing is analyzed while nothing changed.
+ */
+class ContingencyMonitor : public TimerHandler<AnalyzeContingenciesEvent> {
+public:
+  // Time between checks for queued changes, the most an analysis lags behind them
+  static constexpr Sec analysis_period = Sec(0.1);
+
+  ContingencyMonitor(ACE_Reactor* reactor, const ContingencyAnalyzer::Config& config = ContingencyAnalyzer::Config());
+  ~ContingencyMonitor();
+
+  // Queue a new topology. It replaces a topology and the levels queued before,
+  // since the devices passed already have the current levels.
+  void set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices);
+
+  // Queue changes of the energy levels, applied after the queued topology
+  void set_levels(const EsslUpdates& updates);
+
+  // Results of the last analysis
+  std::vector<Contingency> ranking(size_t max = SIZE_MAX) const
+  {
+    return analyzer_.ranking(max);
+  }
+
+  ContingencyAnalyzer::Stats stats() const
+  {
+    return analyzer_.stats();
+  }
+
+private:
+  struct Topology {
+    powersim::PowerTopology pt;
+    PowerDevices devices;
+  };
+
+  void timer_fired(Timer<AnalyzeContingenciesEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  ContingencyAnalyzer analyzer_;
+
+  // Changes queued since the last tick
+  SimpleMutex m_{"ContingencyMonitor"};
+  std::unique_ptr<Topology> topology_;
+  EsslUpdates levels_;
+};
+
+#endif
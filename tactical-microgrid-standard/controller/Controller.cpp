@@ -101,7 +101,7 @@ bool Controller::got_config(const std::string& name, const OpenDDS::DCPS::Config
 
 void Controller::set_debug(bool value)
 {
-  std::lock_guard<std::mutex> guard(mut_);
+  SimpleGuard guard(mut_);
   debug_ = value;
 }
 
@@ -112,17 +112,92 @@ tms::Identity Controller::id() const
 
 PowerDevices Controller::power_devices() const
 {
-  std::lock_guard<std::mutex> guard(mut_);
+  SimpleGuard guard(mut_);
   return power_devices_;
 }
 
+std::vector<tms::Identity> Controller::managed_devices() const
+{
+  std::vector<tms::Identity> ids;
+  SimpleGuard guard(mut_);
+  for (const auto& pair : power_devices_) {
+    if (pair.second.master_id() == device_id_) {
+      ids.push_back(pair.first);
+    }
+  }
+  return ids;
+}
+
 void Controller::update_essl(const tms::Identity& pd_id, tms::EnergyStartStopLevel to_level)
 {
-  std::lock_guard<std::mutex> guard(mut_);
+  update_essls(EsslUpdates{std::make_pair(pd_id, to_level)});
+}
+
+void Controller::update_essls(const EsslUpdates& updates)
+{
+  DeviceCallback cb;
+  std::vector<cli::PowerDeviceInfo> changed;
+  {
+    SimpleGuard guard(mut_);
+    for (const auto& update : updates) {
+      auto it = power_devices_.find(update.first);
+      if (it == power_devices_.end() || it->second.essl() == update.second) {
+        continue;
+      }
+      it->second.essl() = update.second;
+      changed.push_back(it->second);
+    }
+    cb = device_changed_cb_;
+  }
+
+  if (cb) {
+    for (const auto& pdi : changed) {
+      cb(pdi);
+    }
+  }
+}
+
+void Controller::set_device_changed_callback(DeviceCallback cb)
+{
+  SimpleGuard guard(mut_);
+  device_changed_cb_ = cb;
+}
+
+void Controller::set_takeover_callback(TakeoverCallback cb)
+{
+  SimpleGuard guard(mut_);
+  takeover_cb_ = cb;
+}
+
+bool Controller::apply_replicated_device(const cli::PowerDeviceInfo& pdi, const tms::Identity& mc_id)
+{
+  const tms::Identity& pd_id = pdi.device_info().deviceId();
+  if (pd_id == device_id_ || pdi.device_info().role() == tms::DeviceRole::ROLE_MICROGRID_CONTROLLER) {
+    return false;
+  }
+
+  // Only the active controller of a device commands it, the energy level held by any
+  // other controller, e.g. one that just started, is only a default.
+  if (pdi.master_id() != mc_id) {
+    return false;
+  }
+
+  SimpleGuard guard(mut_);
   auto it = power_devices_.find(pd_id);
-  if (it != power_devices_.end()) {
-    it->second.essl() = to_level;
+  if (it == power_devices_.end()) {
+    // Not discovered locally yet, e.g. the device is partitioned from this controller.
+    power_devices_.insert(std::make_pair(pd_id, pdi));
+    return true;
   }
+
+  // The energy level is only known to controllers that processed the request,
+  // but the active controller is reported to every controller by the device itself.
+  const bool changed = it->second.essl() != pdi.essl();
+  it->second.essl() = pdi.essl();
+  if (!it->second.master_id().has_value()) {
+    it->second.master_id() = pdi.master_id();
+  }
+  return changed;
 }
 
 void Controller::device_info_cb(const tms::DeviceInfo& di, const DDS::SampleInfo& si)
@@ -131,17 +206,31 @@ void Controller::device_info_cb(const tms::DeviceInfo& di, const DDS::SampleInfo
     return;
   }
 
-  std::lock_guard<std::mutex> guard(mut_);
-  if (debug_) {
-    ACE_DEBUG((LM_DEBUG, "(%P|%t) Controller::device_info_cb: device: \"%C\"\n", di.deviceId().c_str()));
+  DeviceCallback cb;
+  cli::PowerDeviceInfo added;
+  {
+    SimpleGuard guard(mut_);
+    if (debug_) {
+      ACE_DEBUG((LM_DEBUG, "(%P|%t) Controller::device_info_cb: device: \"%C\"\n", di.deviceId().c_str()));
+    }
+
+    // Ignore other control devices, such as microgrid controllers.
+    // Store all power devices, including those that select a different MC as its active MC.
+    if (di.role() == tms::DeviceRole::ROLE_MICROGRID_CONTROLLER) {
+      return;
+    }
+
+    const auto res = power_devices_.insert(std::make_pair(di.deviceId(),
+      cli::PowerDeviceInfo(di, tms::EnergyStartStopLevel::ESSL_OPERATIONAL, std::optional<tms::Identity>())));
+    if (!res.second) {
+      return;
+    }
+    added = res.first->second;
+    cb = device_changed_cb_;
   }
 
-  // Ignore other control devices, such as microgrid controllers.
-  // Store all power devices, including those that select a different MC as its active MC.
-  if (di.role() != tms::DeviceRole::ROLE_MICROGRID_CONTROLLER) {
-    power_devices_.insert(std::make_pair(di.deviceId(),
-                                         cli::PowerDeviceInfo(di, tms::EnergyStartStopLevel::ESSL_OPERATIONAL,
-                                                              std::optional<tms::Identity>())));
+  if (cb) {
+    cb(added);
   }
 }
 
@@ -151,7 +240,7 @@ void Controller::heartbeat_cb(const tms::Heartbeat& hb, const DDS::SampleInfo& s
     return;
   }
 
-  std::lock_guard<std::mutex> guard(mut_);
+  SimpleGuard guard(mut_);
   if (debug_) {
     const tms::Identity& id = hb.deviceId();
     ACE_DEBUG((LM_DEBUG, "(%P|%t) Controller::heartbeat_cb: %C device: \"%C\", seqnum: %u\n",
@@ -159,12 +248,30 @@ void Controller::heartbeat_cb(const tms::Heartbeat& hb, const DDS::SampleInfo& s
   }
 }
 
-void Controller::set_active_controller(const tms::Identity& pd_id, const std::optional<tms::Identity>& master_id)
+void Controller::set_active_controller(const tms::Identity& pd_id, const std::optional<tms::Identity>& master_id,
+                                       Sec selection_age)
 {
-  std::lock_guard<std::mutex> guard(mut_);
-  auto it = power_devices_.find(pd_id);
-  if (it != power_devices_.end()) {
+  TakeoverCallback cb;
+  tms::Identity prev_mc_id;
+  {
+    SimpleGuard guard(mut_);
+    auto it = power_devices_.find(pd_id);
+    if (it == power_devices_.end()) {
+      return;
+    }
+
+    const std::optional<tms::Identity> prev_master_id = it->second.master_id();
     it->second.master_id() = master_id;
+
+    // A device failing over from another controller to this one
+    if (master_id == device_id_ && prev_master_id.has_value() && prev_master_id != master_id) {
+      cb = takeover_cb_;
+      prev_mc_id = prev_master_id.value();
+    }
+  }
+
+  if (cb) {
+    cb(pd_id, prev_mc_id, selection_age);
   }
 }
 
@@ -173,8 +280,11 @@ tms::DeviceInfo Controller::populate_device_info() const
   auto device_info = get_device_info();
   device_info.role() = tms::DeviceRole::ROLE_MICROGRID_CONTROLLER;
   device_info.product() = Utils::get_ProductInfo();
-  device_info.topics() = Utils::get_TopicInfo({}, { tms::topic::TOPIC_ENERGY_START_STOP_REQUEST },
-    { tms::topic::TOPIC_OPERATOR_INTENT_REQUEST });
+  device_info.topics() = Utils::get_TopicInfo({},
+    { tms::topic::TOPIC_ENERGY_START_STOP_REQUEST,
+      tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE, tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE },
+    { tms::topic::TOPIC_OPERATOR_INTENT_REQUEST,
+      tms::topic::TOPIC_AC_MEASUREMENT_UPDATE, tms::topic::TOPIC_DC_MEASUREMENT_UPDATE });
 
   tms::ControlServiceInfo csi;
   {
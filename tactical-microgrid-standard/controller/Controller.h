@@ -6,8 +6,13 @@
 #include <common/Handshaking.h>
 #include <common/Configurable.h>
 
+#include <functional>
+
 class Controller : public Handshaking, Configurable {
 public:
+  using DeviceCallback = std::function<void(const cli::PowerDeviceInfo&)>;
+  using TakeoverCallback = std::function<void(const tms::Identity& pd_id, const tms::Identity& prev_mc_id, Sec)>;
+
   explicit Controller(const tms::Identity& id, uint16_t priority = 0)
     : Handshaking(id)
     , Configurable("TMS_CONTROLLER")
@@ -19,7 +24,11 @@ public:
   int run();
   tms::Identity id() const;
   PowerDevices power_devices() const;
+
+  // Power devices that selected this controller as their active controller
+  std::vector<tms::Identity> managed_devices() const;
   void update_essl(const tms::Identity& pd_id, tms::EnergyStartStopLevel to_level);
+  void update_essls(const EsslUpdates& updates);
   void terminate();
 
   bool got_config(const std::string& name, const OpenDDS::DCPS::ConfigPair& pair);
@@ -30,17 +39,33 @@ public:
     return tms_domain_id_;
   }
 
-  void set_active_controller(const tms::Identity& pd_id, const std::optional<tms::Identity>& master_id);
+  void set_active_controller(const tms::Identity& pd_id, const std::optional<tms::Identity>& master_id,
+                             Sec selection_age = Sec(0));
+
+  // Called with the new state of a power device whenever it is changed locally,
+  // i.e. not as the result of apply_replicated_device.
+  void set_device_changed_callback(DeviceCallback cb);
+
+  // Called when a power device that had selected another controller selects this one.
+  // The last argument is how long ago the device made the selection.
+  void set_takeover_callback(TakeoverCallback cb);
+
+  // Merge the state of a power device replicated from a peer controller. It's ignored
+  // unless the peer is the active controller of the device. Returns true if the
+  // energy level of the device changed.
+  bool apply_replicated_device(const cli::PowerDeviceInfo& pdi, const tms::Identity& mc_id);
 
 private:
   void device_info_cb(const tms::DeviceInfo& di, const DDS::SampleInfo& si);
   void heartbeat_cb(const tms::Heartbeat& hb, const DDS::SampleInfo& si);
   tms::DeviceInfo populate_device_info() const;
 
-  mutable std::mutex mut_;
+  mutable SimpleMutex mut_{"Controller::power_devices"};
   bool debug_ = false;
   PowerDevices power_devices_;
   uint16_t priority_;
+  DeviceCallback device_changed_cb_;
+  TakeoverCallback takeover_cb_;
 
   DDS::DomainId_t tms_domain_id_ = OpenDDS::DOMAIN_UNKNOWN;;
 };
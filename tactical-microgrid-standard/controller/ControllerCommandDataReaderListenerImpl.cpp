@@ -13,6 +13,8 @@ void ControllerCommandDataReaderListenerImpl::on_data_available(DDS::DataReader_
     return;
   }
 
+  record_queue_depth(data.length());
+
   Controller& mc = cli_server_.get_controller();
   bool found_valid_cmd = false;
   cli::ControllerCmdType cct;
@@ -32,9 +34,20 @@ void ControllerCommandDataReaderListenerImpl::on_data_available(DDS::DataReader_
     case cli::ControllerCmdType::CCT_RESUME:
       mc.start_heartbeats();
       break;
-    default:
+    case cli::ControllerCmdType::CCT_TERMINATE:
       mc.terminate();
       break;
+    case cli::ControllerCmdType::CCT_DUMP_LOCK_STATS:
+      ACE_DEBUG((LM_INFO, "(%P|%t) INFO: Lock statistics of controller \"%C\":\n%C",
+                 mc.id().c_str(), LockRegistry::instance().report().c_str()));
+      break;
+    case cli::ControllerCmdType::CCT_DUMP_CONTINGENCIES:
+      cli_server_.log_contingencies();
+      break;
+    default:
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: ControllerCommandDataReaderListenerImpl::on_data_available: "
+                 "unknown command type %d\n", static_cast<int>(cct)));
+      break;
     }
   }
 }
@@ -0,0 +1,356 @@
+#include "IslandingDetector.h"
+
+#include <algorithm>
+
+const char* IslandingDetector::kind_to_string(IslandChange::Kind kind)
+{
+  switch (kind) {
+  case IslandChange::Kind::SPLIT:
+    return "split off";
+  case IslandChange::Kind::MERGED:
+    return "joined";
+  case IslandChange::Kind::ENERGIZED:
+    return "energized";
+  case IslandChange::Kind::DEENERGIZED:
+    return "de-energized";
+  default:
+    return "unknown";
+  }
+}
+
+void IslandingDetector::set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices)
+{
+  const auto start_time = std::chrono::steady_clock::now();
+  SimpleGuard guard(m_);
+  TopologyGraph::Builder builder;
+  builder.add_topology(pt);
+  // Take the roles from the devices themselves where they are known
+  for (const auto& pair : devices) {
+    builder.add_device(pair.first, pair.second.device_info().role());
+  }
+  graph_ = builder.build();
+  for (const auto& pair : devices) {
+    graph_.set_level(pair.first, pair.second.essl());
+  }
+
+  const size_t n = graph_.size();
+  label_.assign(n, no_label);
+  size_.clear();
+  sources_.clear();
+  free_labels_.clear();
+  island_count_ = 0;
+  visited_.assign(n, 0);
+  visit_ = 0;
+  owner_.assign(n, 0);
+
+  std::vector<Node> nodes;
+  for (Node u = 0; u < n; ++u) {
+    if (graph_.active(u) && label_[u] == no_label) {
+      nodes.clear();
+      collect(u, no_label, nodes);
+      const Label label = new_label();
+      relabel(nodes, label);
+      size_[label] = static_cast<uint32_t>(nodes.size());
+      sources_[label] = static_cast<uint32_t>(to_island(nodes).sources);
+    }
+  }
+
+  ++stats_.updates;
+  stats_.devices = n;
+  stats_.islands = island_count_;
+  stats_.last_update_time = std::chrono::steady_clock::now() - start_time;
+}
+
+std::vector<IslandChange> IslandingDetector::set_levels(const EsslUpdates& updates)
+{
+  const auto start_time = std::chrono::steady_clock::now();
+  std::vector<IslandChange> changes;
+  SimpleGuard guard(m_);
+  for (const auto& update : updates) {
+    const Node n = graph_.index(update.first);
+    if (n == TopologyGraph::NONE) {
+      continue;
+    }
+
+    const bool operational = update.second == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+    if (operational == graph_.active(n)) {
+      continue;
+    }
+    if (operational) {
+      start(n, changes);
+    } else {
+      stop(n, changes);
+    }
+  }
+
+  ++stats_.updates;
+  stats_.islands = island_count_;
+  stats_.last_update_time = std::chrono::steady_clock::now() - start_time;
+  stats_.max_update_time = std::max(stats_.max_update_time, stats_.last_update_time);
+  return changes;
+}
+
+Island IslandingDetector::island_of(const tms::Identity& pd_id) const
+{
+  SimpleGuard guard(m_);
+  const Node n = graph_.index(pd_id);
+  if (n == TopologyGraph::NONE || !graph_.active(n)) {
+    return Island();
+  }
+  std::vector<Node> nodes;
+  collect(n, label_[n], nodes);
+  return to_island(nodes);
+}
+
+IslandingDetector::Stats IslandingDetector::stats() const
+{
+  SimpleGuard guard(m_);
+  return stats_;
+}
+
+void IslandingDetector::start(Node n, std::vector<IslandChange>& changes)
+{
+  graph_.set_active(n, true);
+
+  // Islands of the neighbors, each with a device to find it from
+  std::vector<std::pair<Label, Node>> neighbors;
+  for (const Node* v = graph_.neighbors_begin(n); v != graph_.neighbors_end(n); ++v) {
+    const Label label = label_[*v];
+    if (label != no_label &&
+        std::none_of(neighbors.begin(), neighbors.end(), [label](const auto& p) { return p.first == label; })) {
+      neighbors.push_back(std::make_pair(label, *v));
+    }
+  }
+
+  if (neighbors.empty()) {
+    const Label label = new_label();
+    label_[n] = label;
+    size_[label] = 1;
+    sources_[label] = is_source(n);
+    return;
+  }
+
+  // The device joins the largest island and the others are relabeled
+  Label label = neighbors.front().first;
+  uint32_t prior_sources = 0;
+  for (const auto& p : neighbors) {
+    if (size_[p.first] > size_[label]) {
+      label = p.first;
+    }
+    prior_sources += sources_[p.first];
+  }
+  label_[n] = label;
+  ++size_[label];
+  sources_[label] += is_source(n);
+
+  IslandChange merged;
+  std::vector<Node> nodes;
+  for (const auto& p : neighbors) {
+    if (p.first == label) {
+      continue;
+    }
+    nodes.clear();
+    collect(p.second, p.first, nodes);
+    relabel(nodes, label);
+    size_[label] += size_[p.first];
+    sources_[label] += sources_[p.first];
+    free_label(p.first);
+    merged.islands.push_back(to_island(nodes));
+  }
+
+  if (!merged.islands.empty()) {
+    merged.kind = IslandChange::Kind::MERGED;
+    merged.cause = graph_.id(n);
+    changes.push_back(std::move(merged));
+  }
+
+  if (prior_sources == 0 && sources_[label] > 0) {
+    nodes.clear();
+    collect(n, label, nodes);
+    changes.push_back(IslandChange{IslandChange::Kind::ENERGIZED, graph_.id(n),
+                                   std::vector<Island>(1, to_island(nodes))});
+  }
+}
+
+void IslandingDetector::stop(Node n, std::vector<IslandChange>& changes)
+{
+  graph_.set_active(n, false);
+  const Label label = label_[n];
+  const uint32_t prior_sources = sources_[label];
+  label_[n] = no_label;
+  --size_[label];
+  sources_[label] -= is_source(n);
+
+  std::vector<Node> starts;
+  for (const Node* v = graph_.neighbors_begin(n); v != graph_.neighbors_end(n); ++v) {
+    if (label_[*v] == label) {
+      starts.push_back(*v);
+    }
+  }
+
+  if (starts.empty()) {
+    free_label(label);
+    return;
+  }
+
+  // Search from each neighbor in turn. Searches that meet belong to the same
+  // group, and a group is done when all of its searches ran out of devices.
+  struct Search {
+    std::vector<Node> nodes;
+    size_t next = 0;
+  };
+  const uint32_t k = static_cast<uint32_t>(starts.size());
+  std::vector<Search> searches(k);
+  std::vector<uint32_t> group(k);
+  std::vector<uint32_t> running(k, 1);
+  auto find_group = [&group](uint32_t i) {
+    while (group[i] != i) {
+      group[i] = group[group[i]];
+      i = group[i];
+    }
+    return i;
+  };
+
+  ++visit_;
+  for (uint32_t i = 0; i < k; ++i) {
+    group[i] = i;
+    searches[i].nodes.push_back(starts[i]);
+    visited_[starts[i]] = visit_;
+    owner_[starts[i]] = i;
+  }
+
+  uint32_t groups = k;
+  uint32_t unfinished = k;
+  while (unfinished > 1) {
+    for (uint32_t i = 0; i < k && unfinished > 1; ++i) {
+      Search& search = searches[i];
+      if (search.next == search.nodes.size()) {
+        continue;
+      }
+
+      const Node u = search.nodes[search.next++];
+      for (const Node* v = graph_.neighbors_begin(u); v != graph_.neighbors_end(u); ++v) {
+        if (label_[*v] != label) {
+          continue;
+        }
+        if (visited_[*v] != visit_) {
+          visited_[*v] = visit_;
+          owner_[*v] = i;
+          search.nodes.push_back(*v);
+          continue;
+        }
+        const uint32_t gi = find_group(i);
+        const uint32_t gj = find_group(owner_[*v]);
+        if (gi != gj) {
+          group[gj] = gi;
+          running[gi] += running[gj];
+          --groups;
+          --unfinished;
+        }
+      }
+
+      if (search.next == search.nodes.size() && --running[find_group(i)] == 0) {
+        --unfinished;
+      }
+    }
+  }
+
+  if (groups > 1) {
+    // The island keeps its label for the group still searching, or the
+    // largest group if all are done. The other groups broke off.
+    std::vector<std::vector<Node>> parts(k);
+    for (uint32_t i = 0; i < k; ++i) {
+      std::vector<Node>& part = parts[find_group(i)];
+      part.insert(part.end(), searches[i].nodes.begin(), searches[i].nodes.end());
+    }
+    uint32_t keep = find_group(0);
+    for (uint32_t i = 0; i < k; ++i) {
+      if (group[i] == i && (running[i] > 0 ||
+                            (running[keep] == 0 && parts[i].size() > parts[keep].size()))) {
+        keep = i;
+      }
+    }
+
+    IslandChange split;
+    split.kind = IslandChange::Kind::SPLIT;
+    split.cause = graph_.id(n);
+    for (uint32_t i = 0; i < k; ++i) {
+      if (group[i] != i || i == keep) {
+        continue;
+      }
+      Island island = to_island(parts[i]);
+      const Label part_label = new_label();
+      relabel(parts[i], part_label);
+      size_[part_label] = static_cast<uint32_t>(parts[i].size());
+      sources_[part_label] = static_cast<uint32_t>(island.sources);
+      size_[label] -= size_[part_label];
+      sources_[label] -= sources_[part_label];
+      split.islands.push_back(std::move(island));
+    }
+    changes.push_back(std::move(split));
+    starts.front() = parts[keep].front();
+  }
+
+  if (prior_sources > 0 && sources_[label] == 0) {
+    std::vector<Node> nodes;
+    collect(starts.front(), label, nodes);
+    changes.push_back(IslandChange{IslandChange::Kind::DEENERGIZED, graph_.id(n),
+                                   std::vector<Island>(1, to_island(nodes))});
+  }
+}
+
+IslandingDetector::Label IslandingDetector::new_label()
+{
+  ++island_count_;
+  if (!free_labels_.empty()) {
+    const Label label = free_labels_.back();
+    free_labels_.pop_back();
+    return label;
+  }
+  size_.push_back(0);
+  sources_.push_back(0);
+  return static_cast<Label>(size_.size() - 1);
+}
+
+void IslandingDetector::free_label(Label label)
+{
+  --island_count_;
+  size_[label] = 0;
+  sources_[label] = 0;
+  free_labels_.push_back(label);
+}
+
+void IslandingDetector::collect(Node n, Label label, std::vector<Node>& out) const
+{
+  ++visit_;
+  const size_t begin = out.size();
+  visited_[n] = visit_;
+  out.push_back(n);
+  for (size_t q = begin; q < out.size(); ++q) {
+    const Node u = out[q];
+    for (const Node* v = graph_.neighbors_begin(u); v != graph_.neighbors_end(u); ++v) {
+      if (graph_.active(*v) && label_[*v] == label && visited_[*v] != visit_) {
+        visited_[*v] = visit_;
+        out.push_back(*v);
+      }
+    }
+  }
+}
+
+void IslandingDetector::relabel(const std::vector<Node>& nodes, Label label)
+{
+  for (const Node u : nodes) {
+    label_[u] = label;
+  }
+}
+
+Island IslandingDetector::to_island(const std::vector<Node>& nodes) const
+{
+  Island island;
+  island.devices.reserve(nodes.size());
+  for (const Node u : nodes) {
+    island.devices.push_back(graph_.id(u));
+    island.sources += is_source(u);
+  }
+  return island;
+}
@@ -0,0 +1,125 @@
+#ifndef CONTROLLER_ISLANDING_DETECTOR_H
+#define CONTROLLER_ISLANDING_DETECTOR_H
+
+#include "Common.h"
+
+#include <common/TimerHandler.h>
+#include <common/TopologyGraph.h>
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <vector>
+
+struct Island {
+  std::vector<tms::Identity> devices;
+  // Number of operational sources in the island
+  size_t sources = 0;
+
+  bool energized() const
+  {
+    return sources > 0;
+  }
+};
+
+struct IslandChange {
+  enum class Kind {
+    // Islands broke off from the island of the cause, which stopped
+    SPLIT,
+    // Islands joined the island of the cause, which started
+    MERGED,
+    // The island of the cause gained its first operational source
+    ENERGIZED,
+    // The island the cause was in lost its last operational source
+    DEENERGIZED,
+  };
+
+  Kind kind;
+  // Device whose energy level caused the change
+  tms::Identity cause;
+  // Islands that broke off or joined, or the island that was (de-)energized
+  std::vector<Island> islands;
+};
+
+/**
+ * Tracks the islands of a power topology, i.e. the groups of operational
+ * devices connected to each other through operational devices, by labeling
+ * each device with its island.
+ *
+ * A device that becomes operational joins the islands of its neighbors and the
+ * smaller islands are relabeled. When a device stops, the rest of its island is
+ * searched from each of its neighbors in turn, one device at a time, until all
+ * but one of the searches have either met another or run out of devices. The
+ * searches that ran out found the islands that broke off and only those are
+ * relabeled. Either way the cost depends on the smaller islands, not on the
+ * size of the topology, and a device at the edge of the topology, like a load
+ * or a source, costs constant time.
+ */
+class IslandingDetector {
+public:
+  struct Stats {
+    size_t devices = 0;
+    size_t islands = 0;
+    uint64_t updates = 0;
+    Sec last_update_time = Sec(0);
+    Sec max_update_time = Sec(0);
+  };
+
+  static const char* kind_to_string(IslandChange::Kind kind);
+
+  // Replace the topology. Energy levels come from the devices known to the
+  // controller. No changes are reported since there is nothing to compare to.
+  void set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices);
+
+  // Apply new energy levels and return the islands that changed
+  std::vector<IslandChange> set_levels(const EsslUpdates& updates);
+
+  // Island of a device, or an empty island if the device is not operational
+  // or not in the topology
+  Island island_of(const tms::Identity& pd_id) const;
+
+  Stats stats() const;
+
+private:
+  using Node = TopologyGraph::Node;
+  using Label = uint32_t;
+
+  void start(Node n, std::vector<IslandChange>& changes);
+  void stop(Node n, std::vector<IslandChange>& changes);
+
+  Label new_label();
+  void free_label(Label label);
+
+  // Devices with the given label reachable from n, appended to out
+  void collect(Node n, Label label, std::vector<Node>& out) const;
+  void relabel(const std::vector<Node>& nodes, Label label);
+  Island to_island(const std::vector<Node>& nodes) const;
+
+  bool is_source(Node n) const
+  {
+    return graph_.role(n) == tms::DeviceRole::ROLE_SOURCE;
+  }
+
+  static constexpr Label no_label = ~Label(0);
+
+  mutable SimpleMutex m_{"IslandingDetector"};
+  TopologyGraph graph_;
+
+  // Island of each device, or no_label if the device is not operational
+  std::vector<Label> label_;
+  // Size and number of operational sources of each island
+  std::vector<uint32_t> size_;
+  std::vector<uint32_t> sources_;
+  std::vector<Label> free_labels_;
+  size_t island_count_ = 0;
+
+  // Devices visited by a search, marked with the current visit so they don't
+  // need clearing
+  mutable std::vector<uint64_t> visited_;
+  mutable uint64_t visit_ = 0;
+  // Search that visited each device during stop()
+  std::vector<uint32_t> owner_;
+
+  Stats stats_;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "LoadShedder.h"
+#include "PowerFlowSolver.h"
+
+#include <algorithm>
+
+LoadShedder::LoadShedder(const Config& config)
+  : config_(config)
+{
+}
+
+void LoadShedder::set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices)
+{
+  SimpleGuard guard(m_);
+  TopologyGraph::Builder builder;
+  builder.add_topology(pt);
+  for (const auto& pair : devices) {
+    builder.add_device(pair.first, pair.second.device_info().role());
+  }
+
+  // Loads stay shed across topologies
+  std::unordered_set<tms::Identity> shed;
+  for (Node u = 0; u < graph_.size(); ++u) {
+    if (flags_[u] & SHED) {
+      shed.insert(graph_.id(u));
+    }
+  }
+
+  graph_ = builder.build();
+  node_rank_.assign(graph_.size(), lowest_rank);
+  flags_.assign(graph_.size(), 0);
+  for (Node u = 0; u < graph_.size(); ++u) {
+    const tms::Identity& id = graph_.id(u);
+    const auto rank = ranks_.find(id);
+    if (rank != ranks_.end()) {
+      node_rank_[u] = rank->second;
+    }
+    set_flag(u, ALWAYS_OPERATE, always_operate_.count(id));
+    set_flag(u, NEVER_OPERATE, never_operate_.count(id));
+    set_flag(u, SHED, shed.count(id));
+  }
+}
+
+void LoadShedder::set_intents(const std::vector<std::pair<tms::Identity, tms::OperatorPriorityType>>& intents)
+{
+  SimpleGuard guard(m_);
+  for (const auto& intent : intents) {
+    const bool always = intent.second == tms::OperatorPriorityType::OPT_ALWAYS_OPERATE;
+    if (!always && intent.second != tms::OperatorPriorityType::OPT_NEVER_OPERATE) {
+      continue;
+    }
+    if (always) {
+      always_operate_.insert(intent.first);
+      never_operate_.erase(intent.first);
+    } else {
+      never_operate_.insert(intent.first);
+      always_operate_.erase(intent.first);
+    }
+
+    const Node n = graph_.index(intent.first);
+    if (n != TopologyGraph::NONE) {
+      set_flag(n, ALWAYS_OPERATE, always);
+      set_flag(n, NEVER_OPERATE, !always);
+      set_flag(n, SHED, false);
+    }
+  }
+}
+
+void LoadShedder::set_ranks(const std::vector<std::pair<tms::Identity, int16_t>>& ranks)
+{
+  SimpleGuard guard(m_);
+  for (const auto& rank : ranks) {
+    ranks_[rank.first] = rank.second;
+    const Node n = graph_.index(rank.first);
+    if (n != TopologyGraph::NONE) {
+      node_rank_[n] = rank.second;
+    }
+  }
+}
+
+LoadShedPlan LoadShedder::plan(const PowerDevices& devices, const tms::Identity& mc_id)
+{
+  const auto start = std::chrono::steady_clock::now();
+  LoadShedPlan plan;
+  SimpleGuard guard(m_);
+
+  // Loads don't connect other devices, so the islands are found without them.
+  // Devices the controller doesn't know are taken to conduct but supply nothing.
+  const size_t n = graph_.size();
+  std::vector<const cli::PowerDeviceInfo*> info(n, nullptr);
+  std::vector<bool> operational(n, false);
+  for (Node u = 0; u < n; ++u) {
+    const auto it = devices.find(graph_.id(u));
+    if (it != devices.end()) {
+      info[u] = &it->second;
+      operational[u] = it->second.essl() == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+    }
+    graph_.set_active(u, graph_.role(u) != tms::DeviceRole::ROLE_LOAD && (!info[u] || operational[u]));
+  }
+  const TopologyGraph::Energization energization = graph_.energization();
+
+  std::vector<double> capacity(energization.sources.size(), 0.0);
+  std::vector<double> demand(energization.sources.size(), 0.0);
+  for (size_t c = 0; c < capacity.size(); ++c) {
+    for (const Node src : energization.sources[c]) {
+      if (info[src]) {
+        capacity[c] += config_.max_utilization *
+          PowerFlowSolver::rated_capacity(info[src]->device_info()).value_or(config_.default_source_capacity);
+      }
+    }
+  }
+
+  // Operational loads that may be shed and shed loads that may be restored
+  std::vector<Load> on;
+  std::vector<Load> off;
+  for (Node u = 0; u < n; ++u) {
+    if (graph_.role(u) != tms::DeviceRole::ROLE_LOAD || !info[u]) {
+      continue;
+    }
+
+    uint32_t island = TopologyGraph::NONE;
+    for (const Node* v = graph_.neighbors_begin(u); v != graph_.neighbors_end(u) && island == TopologyGraph::NONE; ++v) {
+      island = energization.component[*v];
+    }
+    if (island == TopologyGraph::NONE) {
+      continue;
+    }
+
+    const Load load{u, island, node_rank_[u],
+                    PowerFlowSolver::rated_demand(info[u]->device_info()).value_or(config_.default_load_demand)};
+    const auto& master_id = info[u]->master_id();
+    const bool controllable = master_id.has_value() && master_id.value() == mc_id;
+    if (operational[u]) {
+      demand[island] += load.demand;
+      if (controllable && !(flags_[u] & ALWAYS_OPERATE)) {
+        on.push_back(load);
+      }
+    } else if (controllable && (flags_[u] & SHED)) {
+      off.push_back(load);
+    }
+  }
+
+  // In overloaded islands, shed from the lowest priority and the largest load
+  // up, then put back what still fits from the highest priority down. Shedding
+  // enough is not subject to the budget. Islands without operational sources
+  // are left alone, since shedding can't help them.
+  const auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(config_.budget);
+  size_t steps = 0;
+  auto out_of_time = [&]() {
+    // Only look at the clock every so often
+    return ++steps % 64 == 0 && std::chrono::steady_clock::now() > deadline;
+  };
+  on.erase(std::remove_if(on.begin(), on.end(), [&](const Load& load) {
+    return demand[load.island] <= capacity[load.island] || capacity[load.island] == 0;
+  }), on.end());
+  std::sort(on.begin(), on.end(), [](const Load& a, const Load& b) {
+    return a.island != b.island ? a.island < b.island :
+      a.rank != b.rank ? a.rank > b.rank : a.demand > b.demand;
+  });
+  std::vector<const Load*> shed;
+  for (size_t i = 0; i < on.size();) {
+    const uint32_t island = on[i].island;
+    size_t end = i;
+    while (end < on.size() && on[end].island == island) {
+      ++end;
+    }
+
+    shed.clear();
+    for (size_t j = i; j < end && demand[island] > capacity[island]; ++j) {
+      shed.push_back(&on[j]);
+      demand[island] -= on[j].demand;
+    }
+    for (size_t j = shed.size(); j-- > 0 && plan.complete;) {
+      if (out_of_time()) {
+        plan.complete = false;
+        break;
+      }
+      if (demand[island] + shed[j]->demand <= capacity[island]) {
+        demand[island] += shed[j]->demand;
+        shed[j] = nullptr;
+      }
+    }
+    for (const Load* load : shed) {
+      if (load) {
+        plan.shed.push_back(graph_.id(load->node));
+        set_flag(load->node, SHED, true);
+      }
+    }
+    i = end;
+  }
+
+  // Restore from the highest priority and the smallest load down what fits
+  off.erase(std::remove_if(off.begin(), off.end(), [&](const Load& load) {
+    return demand[load.island] + load.demand > capacity[load.island];
+  }), off.end());
+  std::sort(off.begin(), off.end(), [](const Load& a, const Load& b) {
+    return a.island != b.island ? a.island < b.island :
+      a.rank != b.rank ? a.rank < b.rank : a.demand < b.demand;
+  });
+  for (size_t i = 0; i < off.size() && plan.complete; ++i) {
+    const Load& load = off[i];
+    if (out_of_time()) {
+      plan.complete = false;
+      break;
+    }
+    if (demand[load.island] + load.demand <= capacity[load.island]) {
+      demand[load.island] += load.demand;
+      plan.restore.push_back(graph_.id(load.node));
+      set_flag(load.node, SHED, false);
+    }
+  }
+
+  plan.plan_time = std::chrono::steady_clock::now() - start;
+  return plan;
+}
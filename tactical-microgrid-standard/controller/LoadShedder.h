@@ -0,0 +1,121 @@
+#ifndef CONTROLLER_LOAD_SHEDDER_H
+#define CONTROLLER_LOAD_SHEDDER_H
+
+#include "Common.h"
+
+#include <common/TimerHandler.h>
+#include <common/TopologyGraph.h>
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct LoadShedPlan {
+  // Loads to stop and loads to start again
+  std::vector<tms::Identity> shed;
+  std::vector<tms::Identity> restore;
+  // False if the time budget ran out. The loads needed to relieve overloaded
+  // islands are always shed, but fewer loads may be restored than possible.
+  bool complete = true;
+  Sec plan_time = Sec(0);
+
+  bool empty() const
+  {
+    return shed.empty() && restore.empty();
+  }
+};
+
+/**
+ * Decides which loads to shed when the operational sources of an island can't
+ * supply its operational loads, and which shed loads to restore when they can.
+ *
+ * Islands are the groups of loads supplied through operational sources and
+ * distribution devices. In an overloaded island, loads are shed from the
+ * lowest operator priority up, the largest first within a priority, until the
+ * demand fits. The shed loads are then put back from the highest priority down
+ * where they still fit. Loads are restored the same way when there is spare
+ * capacity. Both are greedy passes over the sorted loads, so a plan takes
+ * O(n log n) for n loads, and a plan stops restoring loads once its time
+ * budget is spent.
+ *
+ * Loads with OPT_ALWAYS_OPERATE are never shed and loads the operator stopped
+ * are never restored. Otherwise the OPT_NUMERIC_RANK of a load is its priority,
+ * where 0 is the highest, and loads without one have the lowest priority. Only
+ * the loads this controller is the active controller of are in the plan.
+ */
+class LoadShedder {
+public:
+  struct Config {
+    // Fraction of the rated power of the sources that loads may use
+    double max_utilization = 1.0;
+    // Time the passes over the loads may take before they stop restoring loads
+    Sec budget = Sec(0.001);
+    // Power of loads and sources whose DeviceInfo doesn't give their rating, in W
+    double default_load_demand = 1000.0;
+    double default_source_capacity = 10000.0;
+  };
+
+  LoadShedder()
+    : LoadShedder(Config())
+  {
+  }
+
+  explicit LoadShedder(const Config& config);
+
+  void set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices);
+
+  // Operators starting or stopping loads, which the shedder then leaves alone
+  void set_intents(const std::vector<std::pair<tms::Identity, tms::OperatorPriorityType>>& intents);
+
+  // Numeric operator priorities of loads
+  void set_ranks(const std::vector<std::pair<tms::Identity, int16_t>>& ranks);
+
+  // Plan for the current energy levels of the devices. The shedder assumes
+  // the plan is carried out.
+  LoadShedPlan plan(const PowerDevices& devices, const tms::Identity& mc_id);
+
+private:
+  using Node = TopologyGraph::Node;
+
+  struct Load {
+    Node node;
+    uint32_t island;
+    int32_t rank;
+    double demand;
+  };
+
+  static constexpr int32_t lowest_rank = INT16_MAX + 1;
+
+  enum Flags : uint8_t {
+    // Operators always want the load operating
+    ALWAYS_OPERATE = 1,
+    // Operators stopped the load
+    NEVER_OPERATE = 2,
+    // This shedder stopped the load and may start it again
+    SHED = 4,
+  };
+
+  void set_flag(Node n, uint8_t flag, bool set)
+  {
+    flags_[n] = set ? flags_[n] | flag : flags_[n] & ~flag;
+  }
+
+  Config config_;
+  mutable SimpleMutex m_{"LoadShedder"};
+  TopologyGraph graph_;
+
+  // Operator priorities by device, kept across topologies
+  std::unordered_map<tms::Identity, int16_t> ranks_;
+  std::unordered_set<tms::Identity> always_operate_;
+  std::unordered_set<tms::Identity> never_operate_;
+
+  // The same and the shed loads by node of graph_, so planning doesn't look
+  // them up by identity
+  std::vector<int32_t> node_rank_;
+  std::vector<uint8_t> flags_;
+};
+
+#endif
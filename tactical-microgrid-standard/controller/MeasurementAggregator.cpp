@@ -0,0 +1,486 @@
+#include "MeasurementAggregator.h"
+#include "MeasurementUpdateDataReaderListenerImpl.h"
+
+#include <common/Metrics.h>
+#include <common/QosHelper.h>
+
+#include <dds/DCPS/Marked_Default_Qos.h>
+
+#include <cmath>
+#include <type_traits>
+
+namespace {
+
+template <typename Update>
+DDS::Topic_var create_topic(DDS::DomainParticipant_ptr dp, const std::string& topic_name)
+{
+  using TypeSupportImpl = typename OpenDDS::DCPS::DDSTraits<Update>::TypeSupportImplType;
+
+  typename TypeSupportImpl::_var_type ts = new TypeSupportImpl;
+  if (DDS::RETCODE_OK != ts->register_type(dp, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: register_type for \"%C\" failed\n",
+               topic_name.c_str()));
+    return nullptr;
+  }
+
+  CORBA::String_var type_name = ts->get_type_name();
+  DDS::Topic_var topic = dp->create_topic(topic_name.c_str(),
+                                          type_name,
+                                          TOPIC_QOS_DEFAULT,
+                                          nullptr,
+                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: create_topic \"%C\" failed\n",
+               topic_name.c_str()));
+  }
+  return topic;
+}
+
+double to_seconds(const tms::ClockMonotonic& cm)
+{
+  return cm.seconds() + cm.nanoseconds() * 1e-9;
+}
+
+template <typename Update>
+const auto& measurements(const Update& update)
+{
+  return update.internalMeasurement().empty() ? update.externalMeasurement() : update.internalMeasurement();
+}
+
+template <typename Update>
+auto& measurements(Update& update)
+{
+  return update.internalMeasurement().empty() ? update.externalMeasurement() : update.internalMeasurement();
+}
+
+// Channels of the window from the lines of an AC port
+void set_channels(MeasurementWindow& window, size_t slot, size_t port, const tms::ac::PowerPortMeasurement& ppm)
+{
+  float real_power = 0.0f, reactive_power = 0.0f;
+  for (const auto& line : ppm.line()) {
+    real_power += line.realPower();
+    reactive_power += line.reactivePower();
+  }
+  const bool has_line = !ppm.line().empty();
+  window.set(slot, port, MeasurementWindow::VOLTAGE, has_line ? ppm.line()[0].voltage() : 0.0f);
+  window.set(slot, port, MeasurementWindow::AMPERAGE, has_line ? ppm.line()[0].amperage() : 0.0f);
+  window.set(slot, port, MeasurementWindow::FREQUENCY, has_line ? ppm.line()[0].frequency() : 0.0f);
+  window.set(slot, port, MeasurementWindow::REAL_POWER, real_power);
+  window.set(slot, port, MeasurementWindow::REACTIVE_POWER, reactive_power);
+}
+
+void set_channels(MeasurementWindow& window, size_t slot, size_t port, const tms::dc::PowerPortMeasurement& ppm)
+{
+  float power = 0.0f;
+  for (const auto& line : ppm.line()) {
+    power += line.power();
+  }
+  const bool has_line = !ppm.line().empty();
+  window.set(slot, port, MeasurementWindow::VOLTAGE, has_line ? ppm.line()[0].voltage() : 0.0f);
+  window.set(slot, port, MeasurementWindow::AMPERAGE, has_line ? ppm.line()[0].amperage() : 0.0f);
+  window.set(slot, port, MeasurementWindow::FREQUENCY, 0.0f);
+  window.set(slot, port, MeasurementWindow::REAL_POWER, power);
+  window.set(slot, port, MeasurementWindow::REACTIVE_POWER, 0.0f);
+}
+
+}
+
+MeasurementAggregator::MeasurementAggregator(const tms::Identity& mc_id, ACE_Reactor* reactor, const Config& config)
+  : TimerHandler(reactor, "MeasurementAggregator")
+  , mc_id_(mc_id)
+  , config_(config)
+{
+}
+
+MeasurementAggregator::~MeasurementAggregator()
+{
+  stop();
+
+  // The listeners of the readers refer to this, and the participant may outlive it
+  if (sub_) {
+    sub_->delete_contained_entities();
+  }
+}
+
+DDS::ReturnCode_t MeasurementAggregator::init(DDS::DomainParticipant_ptr dp)
+{
+  if (!enabled()) {
+    return DDS::RETCODE_OK;
+  }
+
+  const DDS::SubscriberQos sub_qos = Qos::Subscriber::get_qos();
+  sub_ = dp->create_subscriber(sub_qos, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!sub_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: create_subscriber with TMS QoS failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  const DDS::PublisherQos pub_qos = Qos::Publisher::get_qos();
+  DDS::Publisher_var pub = dp->create_publisher(pub_qos, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!pub) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: create_publisher with TMS QoS failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  const auto create_reader = [&](DDS::Topic_ptr topic, const std::string& topic_name,
+                                 DDS::DataReaderListener_ptr listener) {
+    // Keep the samples that arrive between two takes instead of only the last
+    DDS::DataReaderQos dr_qos = Qos::DataReader::fn_map.at(topic_name)(mc_id_);
+    dr_qos.history.kind = DDS::KEEP_LAST_HISTORY_QOS;
+    dr_qos.history.depth = config_.reader_depth;
+    DDS::DataReader_var dr = sub_->create_datareader(topic, dr_qos, listener, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!dr) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: create_datareader for topic \"%C\" failed\n",
+                 topic_name.c_str()));
+    }
+    return dr;
+  };
+
+  const auto create_writer = [&](DDS::Topic_ptr topic, const std::string& topic_name) {
+    const DDS::DataWriterQos& dw_qos = Qos::DataWriter::fn_map.at(topic_name)(mc_id_);
+    DDS::DataWriter_var dw = pub->create_datawriter(topic, dw_qos, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!dw) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementAggregator::init: create_datawriter for topic \"%C\" failed\n",
+                 topic_name.c_str()));
+    }
+    return dw;
+  };
+
+  DDS::Topic_var ac_topic = create_topic<tms::ac::MeasurementUpdate>(dp, tms::topic::TOPIC_AC_MEASUREMENT_UPDATE);
+  DDS::Topic_var dc_topic = create_topic<tms::dc::MeasurementUpdate>(dp, tms::topic::TOPIC_DC_MEASUREMENT_UPDATE);
+  DDS::Topic_var ac_summary_topic =
+    create_topic<tms::ac::MeasurementUpdate>(dp, tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE);
+  DDS::Topic_var dc_summary_topic =
+    create_topic<tms::dc::MeasurementUpdate>(dp, tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE);
+  if (!ac_topic || !dc_topic || !ac_summary_topic || !dc_summary_topic) {
+    return DDS::RETCODE_ERROR;
+  }
+
+  DDS::DataWriter_var ac_dw = create_writer(ac_summary_topic, tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE);
+  DDS::DataWriter_var dc_dw = create_writer(dc_summary_topic, tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE);
+  if (!ac_dw || !dc_dw) {
+    return DDS::RETCODE_ERROR;
+  }
+  {
+    Guard g(lock_);
+    ac_dw_ = tms::ac::MeasurementUpdateDataWriter::_narrow(ac_dw);
+    dc_dw_ = tms::dc::MeasurementUpdateDataWriter::_narrow(dc_dw);
+  }
+
+  DDS::DataReaderListener_var ac_listener(
+    new MeasurementUpdateDataReaderListenerImpl<tms::ac::MeasurementUpdate>(*this));
+  DDS::DataReaderListener_var dc_listener(
+    new MeasurementUpdateDataReaderListenerImpl<tms::dc::MeasurementUpdate>(*this));
+  DDS::DataReader_var ac_dr = create_reader(ac_topic, tms::topic::TOPIC_AC_MEASUREMENT_UPDATE, ac_listener);
+  DDS::DataReader_var dc_dr = create_reader(dc_topic, tms::topic::TOPIC_DC_MEASUREMENT_UPDATE, dc_listener);
+  if (!ac_dr || !dc_dr) {
+    return DDS::RETCODE_ERROR;
+  }
+  return DDS::RETCODE_OK;
+}
+
+void MeasurementAggregator::managed_devices(ManagedDevices cb)
+{
+  SimpleGuard g(m_);
+  managed_devices_ = cb;
+}
+
+MeasurementAggregator::Device& MeasurementAggregator::device(const tms::Identity& pd_id, bool dc)
+{
+  auto it = devices_.find(pd_id);
+  if (it == devices_.end() || it->second.dc != dc) {
+    if (it != devices_.end()) {
+      devices_.erase(it);
+    }
+    it = devices_.emplace(std::piecewise_construct, std::forward_as_tuple(pd_id),
+                          std::forward_as_tuple(dc, config_.window.count(), config_.max_samples)).first;
+  }
+  return it->second;
+}
+
+template <typename Seq>
+void MeasurementAggregator::ingest_i(const Seq& updates, const DDS::SampleInfoSeq& infos)
+{
+  using Update = typename Seq::value_type;
+  constexpr bool dc = std::is_same_v<Update, tms::dc::MeasurementUpdate>;
+
+  SimpleGuard g(m_);
+  const uint64_t batch = ++stats_.batches;
+  touched_.clear();
+
+  for (size_t i = 0; i < updates.size(); ++i) {
+    if (!infos[i].valid_data) {
+      continue;
+    }
+    const Update& update = updates[i];
+    Device& dev = device(update.deviceId(), dc);
+    const auto& ppms = measurements(update);
+    const double time = to_seconds(update.timeMeasured());
+
+    // A different set of ports, or a time before all the samples in the
+    // window, which means the device restarted, starts a new window.
+    bool reset = dev.ports.size() != ppms.size();
+    for (size_t p = 0; !reset && p < ppms.size(); ++p) {
+      reset = dev.ports[p] != ppms[p].portNumber();
+    }
+    if (dev.window.size()) {
+      const double newest = dev.window.newest_time();
+      if (time < newest - config_.window.count()) {
+        reset = true;
+      } else if (!reset && time < newest) {
+        ++stats_.dropped;
+        continue;
+      }
+    }
+    if (reset) {
+      dev.ports.resize(ppms.size());
+      for (size_t p = 0; p < ppms.size(); ++p) {
+        dev.ports[p] = ppms[p].portNumber();
+      }
+      dev.window.reset(ppms.size());
+      dev.summary_real_power.assign(ppms.size(), 0.0f);
+      dev.summary_reactive_power.assign(ppms.size(), 0.0f);
+      dev.summary_time = 0.0;
+    }
+
+    const size_t slot = dev.window.push(time);
+    for (size_t p = 0; p < ppms.size(); ++p) {
+      set_channels(dev.window, slot, p, ppms[p]);
+    }
+    ++dev.fresh;
+    ++stats_.samples;
+
+    if (dev.batch != batch) {
+      dev.batch = batch;
+      touched_.push_back(&dev);
+    }
+    dev.batch_index = i;
+  }
+
+  // Only the last sample of each device in the batch is copied for its summary
+  for (Device* dev : touched_) {
+    if constexpr (dc) {
+      dev->last_dc = updates[dev->batch_index];
+    } else {
+      dev->last_ac = updates[dev->batch_index];
+    }
+  }
+  stats_.devices = devices_.size();
+}
+
+void MeasurementAggregator::ingest(const tms::ac::MeasurementUpdateSeq& updates, const DDS::SampleInfoSeq& infos)
+{
+  ingest_i(updates, infos);
+}
+
+void MeasurementAggregator::ingest(const tms::dc::MeasurementUpdateSeq& updates, const DDS::SampleInfoSeq& infos)
+{
+  ingest_i(updates, infos);
+}
+
+void MeasurementAggregator::summarize(Device& dev)
+{
+  const double newest = dev.window.newest_time();
+  const double dt = dev.summary_time > 0 ? newest - dev.summary_time : 0.0;
+  const auto rate_of_change = [dt](float to, float from) {
+    return dt > 0 ? static_cast<float>((to - from) / dt) : 0.0f;
+  };
+
+  // The summary is the last sample with the aggregates in place of the
+  // measurements of the first line, and the other lines left as they were.
+  if (dev.dc) {
+    if (dc_count_ == dc_summaries_.size()) {
+      dc_summaries_.emplace_back();
+    }
+    tms::dc::MeasurementUpdate& summary = dc_summaries_[dc_count_++];
+    summary = dev.last_dc;
+    auto& ppms = measurements(summary);
+    for (size_t p = 0; p < ppms.size() && p < dev.window.ports(); ++p) {
+      auto& ppm = ppms[p];
+      if (ppm.line().empty()) {
+        continue;
+      }
+      const float power = dev.window.aggregate(p, MeasurementWindow::REAL_POWER).mean;
+      float other_lines = 0.0f;
+      for (size_t l = 1; l < ppm.line().size(); ++l) {
+        other_lines += ppm.line()[l].power();
+      }
+      auto& line = ppm.line()[0];
+      line.voltage(dev.window.aggregate(p, MeasurementWindow::VOLTAGE).rms);
+      line.amperage(dev.window.aggregate(p, MeasurementWindow::AMPERAGE).rms);
+      line.power(power - other_lines);
+      ppm.powerRateOfChange(rate_of_change(power, dev.summary_real_power[p]));
+      dev.summary_real_power[p] = power;
+    }
+  } else {
+    if (ac_count_ == ac_summaries_.size()) {
+      ac_summaries_.emplace_back();
+    }
+    tms::ac::MeasurementUpdate& summary = ac_summaries_[ac_count_++];
+    summary = dev.last_ac;
+    auto& ppms = measurements(summary);
+    for (size_t p = 0; p < ppms.size() && p < dev.window.ports(); ++p) {
+      auto& ppm = ppms[p];
+      if (ppm.line().empty()) {
+        continue;
+      }
+      const float real_power = dev.window.aggregate(p, MeasurementWindow::REAL_POWER).mean;
+      const float reactive_power = dev.window.aggregate(p, MeasurementWindow::REACTIVE_POWER).mean;
+      float other_real = 0.0f, other_reactive = 0.0f;
+      for (size_t l = 1; l < ppm.line().size(); ++l) {
+        other_real += ppm.line()[l].realPower();
+        other_reactive += ppm.line()[l].reactivePower();
+      }
+      auto& line = ppm.line()[0];
+      line.voltage(dev.window.aggregate(p, MeasurementWindow::VOLTAGE).rms);
+      line.amperage(dev.window.aggregate(p, MeasurementWindow::AMPERAGE).rms);
+      line.frequency(dev.window.aggregate(p, MeasurementWindow::FREQUENCY).mean);
+      line.realPower(real_power - other_real);
+      line.reactivePower(reactive_power - other_reactive);
+      if (line.realPower() != 0.0f || line.reactivePower() != 0.0f) {
+        line.phaseOffset(std::atan2(line.reactivePower(), line.realPower()));
+      }
+      ppm.realPowerRateOfChange(rate_of_change(real_power, dev.summary_real_power[p]));
+      ppm.reactivePowerRateOfChange(rate_of_change(reactive_power, dev.summary_reactive_power[p]));
+      dev.summary_real_power[p] = real_power;
+      dev.summary_reactive_power[p] = reactive_power;
+    }
+  }
+
+  dev.summary_time = newest;
+  dev.fresh = 0;
+  ++stats_.summaries;
+}
+
+size_t MeasurementAggregator::summarize()
+{
+  // The callback takes the locks of its owner, so it's called without m_
+  ManagedDevices managed_devices;
+  {
+    SimpleGuard g(m_);
+    managed_devices = managed_devices_;
+  }
+  std::vector<tms::Identity> managed;
+  if (managed_devices) {
+    managed = managed_devices();
+  }
+
+  SimpleGuard g(m_);
+  ac_count_ = 0;
+  dc_count_ = 0;
+
+  const auto summarize_if_fresh = [&](Device& dev) {
+    if (dev.fresh && dev.window.size()) {
+      summarize(dev);
+    }
+  };
+
+  if (managed_devices) {
+    for (const tms::Identity& pd_id : managed) {
+      const auto it = devices_.find(pd_id);
+      if (it != devices_.end()) {
+        summarize_if_fresh(it->second);
+      }
+    }
+  } else {
+    for (auto& pair : devices_) {
+      summarize_if_fresh(pair.second);
+    }
+  }
+  return ac_count_ + dc_count_;
+}
+
+void MeasurementAggregator::publish()
+{
+  // Summaries are built under m_ and written without it, so taking samples
+  // isn't held up by the writes. Only the timer publishes, under lock_.
+  Guard g(lock_);
+  summarize();
+
+  uint64_t failed = 0;
+  DDS::ReturnCode_t last_error = DDS::RETCODE_OK;
+  const auto write = [&](auto& dw, const auto& summary) {
+    const DDS::ReturnCode_t rc = dw->write(summary, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ++failed;
+      last_error = rc;
+    }
+  };
+  if (ac_dw_) {
+    for (size_t i = 0; i < ac_count_; ++i) {
+      write(ac_dw_, ac_summaries_[i]);
+    }
+  }
+  if (dc_dw_) {
+    for (size_t i = 0; i < dc_count_; ++i) {
+      write(dc_dw_, dc_summaries_[i]);
+    }
+  }
+  if (failed) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: MeasurementAggregator::publish: "
+               "%Q summaries failed to write: %C\n", failed, OpenDDS::DCPS::retcode_to_string(last_error)));
+  }
+}
+
+std::vector<MeasurementAggregator::PortAggregates> MeasurementAggregator::aggregates(const tms::Identity& pd_id) const
+{
+  std::vector<PortAggregates> result;
+  SimpleGuard g(m_);
+  const auto it = devices_.find(pd_id);
+  if (it == devices_.end() || it->second.window.size() == 0) {
+    return result;
+  }
+
+  const Device& dev = it->second;
+  result.resize(dev.window.ports());
+  for (size_t p = 0; p < result.size(); ++p) {
+    result[p].port = dev.ports[p];
+    for (int ch = 0; ch < MeasurementWindow::CHANNELS; ++ch) {
+      result[p].channels[ch] = dev.window.aggregate(p, static_cast<MeasurementWindow::Channel>(ch));
+    }
+  }
+  return result;
+}
+
+MeasurementAggregator::Stats MeasurementAggregator::stats() const
+{
+  SimpleGuard g(m_);
+  return stats_;
+}
+
+void MeasurementAggregator::log_stats() const
+{
+  const Stats s = stats();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: MeasurementAggregator::log_stats: %B devices, %Q samples in %Q batches, "
+             "%Q dropped, %Q summaries\n", s.devices, s.samples, s.batches, s.dropped, s.summaries));
+}
+
+void MeasurementAggregator::start()
+{
+  Guard g(lock_);
+  if (!enabled() || get_timer<PublishSummaryEvent>()->active()) {
+    return;
+  }
+  schedule(PublishSummaryEvent(), config_.summary_period);
+}
+
+void MeasurementAggregator::stop()
+{
+  Guard g(lock_);
+  if (!get_timer<PublishSummaryEvent>()->active()) {
+    return;
+  }
+  cancel<PublishSummaryEvent>();
+  log_stats();
+}
+
+void MeasurementAggregator::timer_fired(Timer<PublishSummaryEvent>&)
+{
+  publish();
+}
+
+void MeasurementAggregator::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
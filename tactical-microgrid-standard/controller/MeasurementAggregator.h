@@ -0,0 +1,150 @@
+#ifndef CONTROLLER_MEASUREMENT_AGGREGATOR_H
+#define CONTROLLER_MEASUREMENT_AGGREGATOR_H
+
+#include "MeasurementWindow.h"
+
+#include <common/TimerHandler.h>
+#include <common/mil-std-3071_data_modelTypeSupportImpl.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct PublishSummaryEvent {
+  static const char* name() { return "PublishSummary"; }
+};
+
+/**
+ * Consumes the AcMeasurementUpdate and DcMeasurementUpdate samples of the
+ * power devices and publishes them at a lower rate as AcSummaryMeasurementUpdate
+ * and DcSummaryMeasurementUpdate. Samples are taken from the readers in batches
+ * and added to a MeasurementWindow per device. Each summary has the rolling
+ * aggregates of the device over the window: the RMS voltage and amperage and
+ * the mean frequency and power, with the rates of change of the mean power
+ * between summaries. The min, max, mean and RMS of every channel can also be
+ * queried.
+ */
+class MeasurementAggregator : public TimerHandler<PublishSummaryEvent> {
+public:
+  struct Config {
+    // Time between summaries. None are published if zero.
+    Sec summary_period = Sec(1);
+    // Measurements aggregated in each summary, in the time of the devices
+    Sec window = Sec(1);
+    // Upper bound on the samples kept per device
+    size_t max_samples = 4096;
+    // Samples the readers keep per device between takes
+    int reader_depth = 64;
+  };
+
+  struct Stats {
+    size_t devices = 0;
+    uint64_t samples = 0;
+    uint64_t batches = 0;
+    // Samples older than the newest of their device, which came out of order
+    uint64_t dropped = 0;
+    uint64_t summaries = 0;
+  };
+
+  struct PortAggregates {
+    tms::PowerPortNumber port = 0;
+    Aggregate channels[MeasurementWindow::CHANNELS];
+  };
+
+  using ManagedDevices = std::function<std::vector<tms::Identity>()>;
+
+  MeasurementAggregator(const tms::Identity& mc_id, ACE_Reactor* reactor, const Config& config);
+  ~MeasurementAggregator();
+
+  bool enabled() const
+  {
+    return config_.summary_period.count() > 0;
+  }
+
+  // Create the readers of the measurements and the writers of the summaries, if enabled
+  DDS::ReturnCode_t init(DDS::DomainParticipant_ptr dp);
+
+  // Devices to publish summaries for, e.g. those that selected this controller.
+  // Summaries are published for all devices if this isn't set.
+  void managed_devices(ManagedDevices cb);
+
+  // Add a batch of samples taken from a reader
+  void ingest(const tms::ac::MeasurementUpdateSeq& updates, const DDS::SampleInfoSeq& infos);
+  void ingest(const tms::dc::MeasurementUpdateSeq& updates, const DDS::SampleInfoSeq& infos);
+
+  // Build the summaries of the devices that got samples since their last
+  // summary and return how many were built. publish() also writes them.
+  size_t summarize();
+  void publish();
+
+  // Rolling aggregates of each port of a device, none if it has no samples
+  std::vector<PortAggregates> aggregates(const tms::Identity& pd_id) const;
+
+  Stats stats() const;
+  void log_stats() const;
+
+  void start();
+  void stop();
+
+private:
+  struct Device {
+    Device(bool dc, double window, size_t max_samples)
+      : dc(dc)
+      , window(window, max_samples)
+    {
+    }
+
+    const bool dc;
+    MeasurementWindow window;
+    std::vector<tms::PowerPortNumber> ports;
+
+    // The last sample, which the summary starts from
+    tms::ac::MeasurementUpdate last_ac;
+    tms::dc::MeasurementUpdate last_dc;
+
+    // Samples added since the last summary
+    uint64_t fresh = 0;
+
+    // Batch in which the device last got a sample, and its index in the batch
+    uint64_t batch = 0;
+    size_t batch_index = 0;
+
+    // Mean powers of each port in the last summary and the time of its newest sample
+    std::vector<float> summary_real_power;
+    std::vector<float> summary_reactive_power;
+    double summary_time = 0.0;
+  };
+
+  template <typename Seq>
+  void ingest_i(const Seq& updates, const DDS::SampleInfoSeq& infos);
+
+  // Caller must hold m_
+  Device& device(const tms::Identity& pd_id, bool dc);
+  void summarize(Device& dev);
+
+  void timer_fired(Timer<PublishSummaryEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  const tms::Identity mc_id_;
+  const Config config_;
+
+  DDS::Subscriber_var sub_;
+  tms::ac::MeasurementUpdateDataWriter_var ac_dw_;
+  tms::dc::MeasurementUpdateDataWriter_var dc_dw_;
+
+  mutable SimpleMutex m_{"MeasurementAggregator"};
+  std::unordered_map<tms::Identity, Device> devices_;
+  ManagedDevices managed_devices_;
+  Stats stats_;
+
+  // Devices with samples in the current batch
+  std::vector<Device*> touched_;
+
+  // Summaries built by the last summarize()
+  std::vector<tms::ac::MeasurementUpdate> ac_summaries_;
+  std::vector<tms::dc::MeasurementUpdate> dc_summaries_;
+  size_t ac_count_ = 0;
+  size_t dc_count_ = 0;
+};
+
+#endif
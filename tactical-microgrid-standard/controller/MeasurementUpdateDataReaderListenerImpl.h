@@ -0,0 +1,51 @@
+#ifndef MEASUREMENT_UPDATE_DATA_READER_LISTENER_IMPL_H
+#define MEASUREMENT_UPDATE_DATA_READER_LISTENER_IMPL_H
+
+#include "common/DataReaderListenerBase.h"
+#include "MeasurementAggregator.h"
+
+// Takes AC or DC measurement updates in batches and passes them to the aggregator
+template <typename Update>
+class MeasurementUpdateDataReaderListenerImpl : public DataReaderListenerBase {
+public:
+  using Traits = OpenDDS::DCPS::DDSTraits<Update>;
+  using DataReader = typename Traits::DataReaderType;
+  using MessageSequence = typename Traits::MessageSequenceType;
+
+  explicit MeasurementUpdateDataReaderListenerImpl(MeasurementAggregator& aggregator)
+    : DataReaderListenerBase("tms::MeasurementUpdate - DataReaderListenerImpl")
+    , aggregator_(aggregator) {}
+
+  virtual ~MeasurementUpdateDataReaderListenerImpl() = default;
+
+  void on_data_available(DDS::DataReader_ptr reader) final
+  {
+    typename DataReader::_var_type typed_reader = DataReader::_narrow(reader);
+    if (!typed_reader) {
+      return;
+    }
+
+    // The listener of a reader isn't called concurrently, so the sequences are
+    // kept between calls to reuse their storage.
+    const DDS::ReturnCode_t rc = typed_reader->take(data_, info_seq_, DDS::LENGTH_UNLIMITED,
+                                                    DDS::ANY_SAMPLE_STATE, DDS::ANY_VIEW_STATE, DDS::ANY_INSTANCE_STATE);
+    if (rc == DDS::RETCODE_NO_DATA) {
+      return;
+    }
+    if (rc != DDS::RETCODE_OK) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: MeasurementUpdateDataReaderListenerImpl::on_data_available: "
+                 "take data failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+      return;
+    }
+
+    record_queue_depth(data_.length());
+    aggregator_.ingest(data_, info_seq_);
+  }
+
+private:
+  MeasurementAggregator& aggregator_;
+  MessageSequence data_;
+  DDS::SampleInfoSeq info_seq_;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "MeasurementWindow.h"
+
+#include <algorithm>
+#include <cmath>
+
+void AggregateKernel::add(const float* values, size_t n)
+{
+  if (n == 0) {
+    return;
+  }
+
+  float lane_min[lanes], lane_max[lanes], lane_sum[lanes], lane_sum_sq[lanes];
+  for (size_t l = 0; l < lanes; ++l) {
+    lane_min[l] = lane_max[l] = values[0];
+    lane_sum[l] = lane_sum_sq[l] = 0.0f;
+  }
+
+  size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (size_t l = 0; l < lanes; ++l) {
+      const float v = values[i + l];
+      lane_min[l] = v < lane_min[l] ? v : lane_min[l];
+      lane_max[l] = v > lane_max[l] ? v : lane_max[l];
+      lane_sum[l] += v;
+      lane_sum_sq[l] += v * v;
+    }
+  }
+
+  float run_min = lane_min[0], run_max = lane_max[0];
+  double run_sum = 0.0, run_sum_sq = 0.0;
+  for (size_t l = 0; l < lanes; ++l) {
+    run_min = std::min(run_min, lane_min[l]);
+    run_max = std::max(run_max, lane_max[l]);
+    run_sum += lane_sum[l];
+    run_sum_sq += lane_sum_sq[l];
+  }
+  for (; i < n; ++i) {
+    const float v = values[i];
+    run_min = std::min(run_min, v);
+    run_max = std::max(run_max, v);
+    run_sum += v;
+    run_sum_sq += static_cast<double>(v) * v;
+  }
+
+  min = count ? std::min(min, run_min) : run_min;
+  max = count ? std::max(max, run_max) : run_max;
+  sum += run_sum;
+  sum_sq += run_sum_sq;
+  count += n;
+}
+
+Aggregate AggregateKernel::result() const
+{
+  Aggregate agg;
+  if (count) {
+    agg.min = min;
+    agg.max = max;
+    agg.mean = static_cast<float>(sum / count);
+    agg.rms = static_cast<float>(std::sqrt(sum_sq / count));
+    agg.count = count;
+  }
+  return agg;
+}
+
+MeasurementWindow::MeasurementWindow(double window, size_t max_capacity)
+  : window_(window)
+  , max_capacity_(std::max(initial_capacity, max_capacity))
+{
+}
+
+void MeasurementWindow::reset(size_t ports)
+{
+  ports_ = ports;
+  capacity_ = initial_capacity;
+  head_ = 0;
+  count_ = 0;
+  times_.assign(capacity_, 0.0);
+  data_.assign(ports_ * CHANNELS * capacity_, 0.0f);
+}
+
+size_t MeasurementWindow::push(double time)
+{
+  if (capacity_ == 0) {
+    reset(ports_);
+  }
+
+  // When full, the oldest sample is at the head. Keep it if it's still needed.
+  if (count_ == capacity_ && times_[head_] >= time - window_ && capacity_ * 2 <= max_capacity_) {
+    grow();
+  }
+
+  const size_t slot = head_;
+  times_[slot] = time;
+  head_ = (head_ + 1) & (capacity_ - 1);
+  count_ = std::min(count_ + 1, capacity_);
+  return slot;
+}
+
+void MeasurementWindow::grow()
+{
+  // Unroll the ring so the oldest sample comes first
+  const size_t capacity = capacity_ * 2;
+  std::vector<double> times(capacity, 0.0);
+  std::vector<float> data(ports_ * CHANNELS * capacity, 0.0f);
+  for (size_t i = 0; i < count_; ++i) {
+    times[i] = times_[(head_ + i) & (capacity_ - 1)];
+  }
+  for (size_t array = 0; array < ports_ * CHANNELS; ++array) {
+    const float* from = &data_[array * capacity_];
+    float* to = &data[array * capacity];
+    std::copy(from + head_, from + capacity_, to);
+    std::copy(from, from + head_, to + (capacity_ - head_));
+  }
+  times_.swap(times);
+  data_.swap(data);
+  head_ = count_;
+  capacity_ = capacity;
+}
+
+size_t MeasurementWindow::window_start() const
+{
+  // Times only go up, so the first sample within the window is found by bisecting
+  const size_t mask = capacity_ - 1;
+  const size_t oldest = (head_ + capacity_ - count_) & mask;
+  const double cutoff = newest_time() - window_;
+  size_t lo = 0, hi = count_ - 1;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+    if (times_[(oldest + mid) & mask] < cutoff) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+Aggregate MeasurementWindow::aggregate(size_t port, Channel channel) const
+{
+  if (count_ == 0 || port >= ports_) {
+    return Aggregate();
+  }
+
+  const size_t start = window_start();
+  const size_t n = count_ - start;
+  const size_t first = (head_ + capacity_ - count_ + start) & (capacity_ - 1);
+  const float* values = &data_[(port * CHANNELS + channel) * capacity_];
+
+  // The samples wrap around the end of the ring at most once
+  AggregateKernel kernel;
+  const size_t until_end = std::min(n, capacity_ - first);
+  kernel.add(values + first, until_end);
+  kernel.add(values, n - until_end);
+  return kernel.result();
+}
@@ -0,0 +1,111 @@
+#ifndef CONTROLLER_MEASUREMENT_WINDOW_H
+#define CONTROLLER_MEASUREMENT_WINDOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Rolling aggregates of one quantity over a window of samples
+struct Aggregate {
+  float min = 0.0f;
+  float max = 0.0f;
+  float mean = 0.0f;
+  float rms = 0.0f;
+  size_t count = 0;
+};
+
+/**
+ * Min, max, sum and sum of squares of a run of floats. The run is processed in
+ * independent lanes without branches, so the compiler can keep each lane in a
+ * SIMD register instead of going through the samples one after the other.
+ */
+struct AggregateKernel {
+  static constexpr size_t lanes = 8;
+
+  float min = 0.0f;
+  float max = 0.0f;
+  double sum = 0.0;
+  double sum_sq = 0.0;
+  size_t count = 0;
+
+  void add(const float* values, size_t n);
+  Aggregate result() const;
+};
+
+/**
+ * Ring buffers of the measurements of the ports of one device, kept as
+ * structure of arrays: each channel of each port has its own contiguous array
+ * of samples, so aggregating a channel reads only that channel. The buffers
+ * start small and double, up to a limit, while the oldest sample is still in
+ * the window, so their size follows the rate of the device.
+ */
+class MeasurementWindow {
+public:
+  enum Channel {
+    // Of the first line of the port: the hot line for AC and the positive one for DC
+    VOLTAGE,
+    AMPERAGE,
+    FREQUENCY,
+    // Summed over the lines of the port
+    REAL_POWER,
+    REACTIVE_POWER,
+    CHANNELS
+  };
+
+  static constexpr size_t initial_capacity = 16;
+
+  // Window length in the seconds of the sample times
+  MeasurementWindow(double window, size_t max_capacity);
+
+  // Forget the samples and use a new number of ports
+  void reset(size_t ports);
+
+  size_t ports() const
+  {
+    return ports_;
+  }
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+  // Samples in the window
+  size_t size() const
+  {
+    return count_;
+  }
+
+  double newest_time() const
+  {
+    return count_ ? times_[(head_ + capacity_ - 1) & (capacity_ - 1)] : 0.0;
+  }
+
+  // Add a sample and return its slot. The caller then sets each channel of each port with set().
+  size_t push(double time);
+
+  void set(size_t slot, size_t port, Channel channel, float value)
+  {
+    data_[(port * CHANNELS + channel) * capacity_ + slot] = value;
+  }
+
+  // Aggregate of a channel over the samples within the window of the newest one
+  Aggregate aggregate(size_t port, Channel channel) const;
+
+private:
+  // Index of the oldest sample in the window
+  size_t window_start() const;
+
+  void grow();
+
+  const double window_;
+  const size_t max_capacity_;
+  size_t ports_ = 0;
+  size_t capacity_ = 0;
+  size_t head_ = 0;
+  size_t count_ = 0;
+  std::vector<double> times_;
+  std::vector<float> data_;
+};
+
+#endif
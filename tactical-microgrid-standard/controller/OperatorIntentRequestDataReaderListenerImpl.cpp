@@ -13,27 +13,36 @@ void OperatorIntentRequestDataReaderListenerImpl::on_data_available(DDS::DataRea
     return;
   }
 
+  record_queue_depth(data.length());
+
   const tms::Identity& mc_id = cli_server_.get_controller().id();
 
-  tms::Identity target_device;
-  tms::OperatorPriorityType opt;
+  // Handle every device of every intent taken at once in a single batch
+  CLIServer::DeviceOpts devices;
+  CLIServer::DeviceRanks ranks;
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const tms::OperatorIntent& oi = data[i].desiredOperatorIntent();
       if (oi.requestId().requestingDeviceId() == mc_id) {
-        for (size_t i = 0; i < oi.devices().size(); ++i) {
-          const tms::Identity& device_id = oi.devices()[i].deviceId();
-          if (!device_id.empty()) {
-            target_device = device_id;
-            opt = oi.devices()[i].priority().priorityType();
-            break;
+        for (const tms::DeviceIntent& di : oi.devices()) {
+          if (di.deviceId().empty()) {
+            continue;
+          }
+          // A numeric rank only sets the priority of the device for load shedding
+          if (di.priority().priorityType() == tms::OperatorPriorityType::OPT_NUMERIC_RANK) {
+            ranks.push_back(std::make_pair(di.deviceId(), di.priority().numericRank()));
+          } else {
+            devices.push_back(std::make_pair(di.deviceId(), di.priority().priorityType()));
           }
         }
       }
     }
   }
 
-  if (!target_device.empty()) {
-    cli_server_.start_stop_device(target_device, opt);
+  if (!ranks.empty()) {
+    cli_server_.rank_devices(ranks);
+  }
+  if (!devices.empty()) {
+    cli_server_.start_stop_devices(devices);
   }
 }
@@ -0,0 +1,61 @@
+#ifndef CONTROLLER_POWER_CONNECTIONS_H
+#define CONTROLLER_POWER_CONNECTIONS_H
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <unordered_map>
+#include <vector>
+
+// Power connections of each power device in a topology, keyed by the power device's ID.
+using PowerConnections = std::unordered_map<tms::Identity, powersim::ConnectedDeviceSeq>;
+
+struct PowerConnectionsDiff {
+  // Power connections that are new or different
+  std::vector<powersim::PowerConnection> changed;
+  // Power devices that no longer have power connections
+  std::vector<tms::Identity> removed;
+
+  bool empty() const
+  {
+    return changed.empty() && removed.empty();
+  }
+};
+
+inline bool same_connections(const powersim::ConnectedDeviceSeq& a, const powersim::ConnectedDeviceSeq& b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].id() != b[i].id() || a[i].role() != b[i].role()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Replace current with the connections of the topology and return what changed.
+inline PowerConnectionsDiff update_connections(PowerConnections& current, const powersim::PowerTopology& pt)
+{
+  PowerConnectionsDiff diff;
+  PowerConnections updated;
+  updated.reserve(pt.connections().size());
+  for (const powersim::PowerConnection& pc : pt.connections()) {
+    auto it = current.find(pc.pd_id());
+    if (it == current.end() || !same_connections(it->second, pc.connected_devices())) {
+      diff.changed.push_back(pc);
+    }
+    updated[pc.pd_id()] = pc.connected_devices();
+  }
+
+  for (const auto& pair : current) {
+    if (updated.count(pair.first) == 0) {
+      diff.removed.push_back(pair.first);
+    }
+  }
+
+  current.swap(updated);
+  return diff;
+}
+
+#endif
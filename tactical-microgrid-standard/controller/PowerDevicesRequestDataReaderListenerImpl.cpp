@@ -1,4 +1,7 @@
 #include "PowerDevicesRequestDataReaderListenerImpl.h"
+#include "common/Metrics.h"
+
+#include <set>
 
 void PowerDevicesRequestDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
 {
@@ -13,10 +16,14 @@ void PowerDevicesRequestDataReaderListenerImpl::on_data_available(DDS::DataReade
     return;
   }
 
+  record_queue_depth(data.length());
+
   const Controller& mc = cli_server_.get_controller();
   const tms::Identity id = mc.id();
 
-  bool my_request = false;
+  // Rounds of requests to reply to, one reply each even if a client's request
+  // was written more than once
+  std::set<uint64_t> seqnums;
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (data[i].mc_id() != id) {
       if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
@@ -27,12 +34,11 @@ void PowerDevicesRequestDataReaderListenerImpl::on_data_available(DDS::DataReade
     }
 
     if (info_seq[i].valid_data) {
-      my_request = true;
-      break;
+      seqnums.insert(data[i].seqnum());
     }
   }
 
-  if (!my_request) {
+  if (seqnums.empty()) {
     // None of these requests are for me.
     return;
   }
@@ -54,9 +60,13 @@ void PowerDevicesRequestDataReaderListenerImpl::on_data_available(DDS::DataReade
   }
 
   cli::PowerDevicesReplyDataWriter_var pdreply_writer = cli_server_.get_PowerDevicesReply_writer();
-  rc = pdreply_writer->write(reply, DDS::HANDLE_NIL);
-  if (rc != DDS::RETCODE_OK) {
-    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: PowerDevicesRequestDataReaderListenerImpl::on_data_available: "
-               "write PowerDevicesReply failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+  for (const uint64_t seqnum : seqnums) {
+    reply.seqnum(seqnum);
+    rc = pdreply_writer->write(reply, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: PowerDevicesRequestDataReaderListenerImpl::on_data_available: "
+                 "write PowerDevicesReply failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+    }
   }
 }
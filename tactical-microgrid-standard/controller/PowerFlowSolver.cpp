@@ -0,0 +1,314 @@
+#include "PowerFlowSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+PowerFlowSolver::PowerFlowSolver(const Config& config)
+  : config_(config)
+{
+}
+
+std::optional<double> PowerFlowSolver::rated_demand(const tms::DeviceInfo& di)
+{
+  if (di.powerDevice().has_value() && di.powerDevice()->load().has_value() &&
+      di.powerDevice()->load()->maxRealPower() > 0) {
+    return di.powerDevice()->load()->maxRealPower();
+  }
+  return std::nullopt;
+}
+
+std::optional<double> PowerFlowSolver::rated_capacity(const tms::DeviceInfo& di)
+{
+  if (di.powerDevice().has_value() && di.powerDevice()->source().has_value() &&
+      di.powerDevice()->source()->loadSharing().maxRealPower() > 0) {
+    return di.powerDevice()->source()->loadSharing().maxRealPower();
+  }
+  return std::nullopt;
+}
+
+void PowerFlowSolver::set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices)
+{
+  SimpleGuard guard(m_);
+  buses_.clear();
+  bus_index_.clear();
+  branches_.clear();
+
+  auto bus_of = [&](const tms::Identity& id, std::optional<tms::DeviceRole> role) {
+    auto it = bus_index_.find(id);
+    if (it != bus_index_.end()) {
+      return it->second;
+    }
+
+    Bus bus;
+    bus.id = id;
+    // A device the controller doesn't know yet is treated as a distribution
+    // device, i.e. a bus without injection.
+    bus.role = role.value_or(tms::DeviceRole::ROLE_DISTRIBUTION);
+    const auto dev = devices.find(id);
+    if (dev != devices.end()) {
+      const tms::DeviceInfo& di = dev->second.device_info();
+      bus.role = di.role();
+      bus.operational = dev->second.essl() == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+      bus.demand = rated_demand(di).value_or(config_.default_load_demand);
+      bus.capacity = rated_capacity(di).value_or(config_.default_source_capacity);
+    } else {
+      bus.demand = config_.default_load_demand;
+      bus.capacity = config_.default_source_capacity;
+    }
+
+    const size_t index = buses_.size();
+    buses_.push_back(bus);
+    bus_index_.insert(std::make_pair(id, index));
+    return index;
+  };
+
+  // Connections are usually listed by both devices, so keep each pair once
+  std::set<std::pair<size_t, size_t>> pairs;
+  for (const powersim::PowerConnection& pc : pt.connections()) {
+    const size_t from = bus_of(pc.pd_id(), std::nullopt);
+    for (const powersim::ConnectedDevice& cd : pc.connected_devices()) {
+      const size_t to = bus_of(cd.id(), cd.role());
+      if (from != to) {
+        pairs.insert(std::make_pair(std::min(from, to), std::max(from, to)));
+      }
+    }
+  }
+
+  bus_branches_.assign(buses_.size(), std::vector<size_t>());
+  branches_.reserve(pairs.size());
+  for (const auto& pair : pairs) {
+    bus_branches_[pair.first].push_back(branches_.size());
+    bus_branches_[pair.second].push_back(branches_.size());
+    branches_.push_back(Branch{pair.first, pair.second});
+  }
+
+  needs_factor_ = true;
+}
+
+void PowerFlowSolver::set_levels(const EsslUpdates& updates)
+{
+  SimpleGuard guard(m_);
+  for (const auto& update : updates) {
+    const auto it = bus_index_.find(update.first);
+    if (it == bus_index_.end()) {
+      continue;
+    }
+
+    Bus& bus = buses_[it->second];
+    const bool operational = update.second == tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+    if (bus.operational == operational) {
+      continue;
+    }
+    bus.operational = operational;
+    if (bus.role == tms::DeviceRole::ROLE_DISTRIBUTION) {
+      // Opens or closes its branches
+      needs_factor_ = true;
+    }
+  }
+}
+
+void PowerFlowSolver::refactor()
+{
+  const auto start = std::chrono::steady_clock::now();
+  needs_factor_ = false;
+  factored_ = false;
+
+  // Islands of buses connected by closed branches. The first bus found in an
+  // island is its reference and gets no row in the reduced matrix.
+  island_count_ = 0;
+  size_t rows = 0;
+  std::vector<bool> seen(buses_.size(), false);
+  std::vector<size_t> queue;
+  for (size_t b = 0; b < buses_.size(); ++b) {
+    if (seen[b]) {
+      continue;
+    }
+    seen[b] = true;
+    buses_[b].island = island_count_;
+    buses_[b].row = none;
+    queue.assign(1, b);
+    for (size_t q = 0; q < queue.size(); ++q) {
+      for (const size_t br : bus_branches_[queue[q]]) {
+        const Branch& branch = branches_[br];
+        if (!closed(branch)) {
+          continue;
+        }
+        const size_t other = branch.from == queue[q] ? branch.to : branch.from;
+        if (!seen[other]) {
+          seen[other] = true;
+          buses_[other].island = island_count_;
+          buses_[other].row = rows++;
+          queue.push_back(other);
+        }
+      }
+    }
+    ++island_count_;
+  }
+
+  // Reduced susceptance matrix, one column per bus that has a row
+  SparseLdl::Matrix a;
+  a.n = rows;
+  a.col_start.assign(rows + 1, 0);
+  std::vector<size_t> bus_of_row(rows);
+  for (size_t b = 0; b < buses_.size(); ++b) {
+    if (buses_[b].row != none) {
+      bus_of_row[buses_[b].row] = b;
+    }
+  }
+  for (size_t r = 0; r < rows; ++r) {
+    const size_t b = bus_of_row[r];
+    double diagonal = 0.0;
+    for (const size_t br : bus_branches_[b]) {
+      const Branch& branch = branches_[br];
+      if (!closed(branch)) {
+        continue;
+      }
+      diagonal += config_.branch_susceptance;
+      const size_t other_row = buses_[branch.from == b ? branch.to : branch.from].row;
+      if (other_row != none) {
+        a.row.push_back(other_row);
+        a.value.push_back(-config_.branch_susceptance);
+      }
+    }
+    a.row.push_back(r);
+    a.value.push_back(diagonal);
+    a.col_start[r + 1] = a.row.size();
+  }
+
+  ldl_.analyze(a);
+  factored_ = ldl_.factor(a);
+  if (!factored_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: PowerFlowSolver::refactor: susceptance matrix of %B buses is singular\n", rows));
+  }
+
+  ++stats_.factorizations;
+  stats_.buses = buses_.size();
+  stats_.branches = branches_.size();
+  stats_.islands = island_count_;
+  stats_.factor_nonzeros = ldl_.factor_nonzeros();
+  stats_.last_factor_time = std::chrono::steady_clock::now() - start;
+}
+
+bool PowerFlowSolver::changed(const powersim::PowerFlow& a, const powersim::PowerFlow& b) const
+{
+  const double angle_tolerance = config_.tolerance / config_.branch_susceptance;
+  if (a.energized() != b.energized() ||
+      std::fabs(a.injection() - b.injection()) > config_.tolerance ||
+      std::fabs(a.angle() - b.angle()) > angle_tolerance ||
+      a.flows().size() != b.flows().size()) {
+    return true;
+  }
+  for (size_t i = 0; i < a.flows().size(); ++i) {
+    if (a.flows()[i].to() != b.flows()[i].to() ||
+        std::fabs(a.flows()[i].power() - b.flows()[i].power()) > config_.tolerance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PowerFlowUpdate PowerFlowSolver::solve(const tms::Identity& mc_id)
+{
+  SimpleGuard guard(m_);
+  if (needs_factor_) {
+    refactor();
+  }
+
+  PowerFlowUpdate update;
+  if (!factored_) {
+    return update;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Operational demand and source capacity of each island
+  std::vector<double> demand(island_count_, 0.0);
+  std::vector<double> capacity(island_count_, 0.0);
+  for (const Bus& bus : buses_) {
+    if (!bus.operational) {
+      continue;
+    }
+    if (bus.role == tms::DeviceRole::ROLE_LOAD) {
+      demand[bus.island] += bus.demand;
+    } else if (bus.role == tms::DeviceRole::ROLE_SOURCE) {
+      capacity[bus.island] += bus.capacity;
+    }
+  }
+
+  // Injections of the buses. An island without an operational source is dead.
+  std::vector<double> injection(buses_.size(), 0.0);
+  std::vector<double> x(ldl_.size(), 0.0);
+  for (size_t b = 0; b < buses_.size(); ++b) {
+    const Bus& bus = buses_[b];
+    if (!bus.operational || capacity[bus.island] <= 0.0) {
+      continue;
+    }
+    if (bus.role == tms::DeviceRole::ROLE_LOAD) {
+      injection[b] = -bus.demand;
+    } else if (bus.role == tms::DeviceRole::ROLE_SOURCE) {
+      injection[b] = demand[bus.island] * bus.capacity / capacity[bus.island];
+    }
+    if (bus.row != none) {
+      x[bus.row] = injection[b];
+    }
+  }
+
+  ldl_.solve(x);
+  angles_.assign(buses_.size(), 0.0);
+  for (size_t b = 0; b < buses_.size(); ++b) {
+    if (buses_[b].row != none) {
+      angles_[b] = x[buses_[b].row];
+    }
+  }
+
+  std::unordered_map<tms::Identity, powersim::PowerFlow> results;
+  results.reserve(buses_.size());
+  for (size_t b = 0; b < buses_.size(); ++b) {
+    const Bus& bus = buses_[b];
+    powersim::PowerFlow pf;
+    pf.pd_id(bus.id);
+    pf.mc_id(mc_id);
+    pf.energized(is_closed(bus) && bus.operational && capacity[bus.island] > 0.0);
+    pf.injection(injection[b]);
+    pf.angle(angles_[b]);
+    for (const size_t br : bus_branches_[b]) {
+      const Branch& branch = branches_[br];
+      if (!closed(branch)) {
+        continue;
+      }
+      const size_t other = branch.from == b ? branch.to : branch.from;
+      powersim::BranchFlow flow;
+      flow.to(buses_[other].id);
+      flow.power(config_.branch_susceptance * (angles_[b] - angles_[other]));
+      pf.flows().push_back(flow);
+    }
+
+    // Keep what was reported for results within the tolerance, so small
+    // changes can't add up without being reported.
+    const auto it = reported_.find(bus.id);
+    if (it == reported_.end() || changed(it->second, pf)) {
+      update.changed.push_back(pf);
+      results.insert(std::make_pair(bus.id, std::move(pf)));
+    } else {
+      results.insert(*it);
+    }
+  }
+
+  for (const auto& pair : reported_) {
+    if (results.count(pair.first) == 0) {
+      update.removed.push_back(pair.first);
+    }
+  }
+  reported_.swap(results);
+
+  ++stats_.solves;
+  stats_.last_solve_time = std::chrono::steady_clock::now() - start;
+  return update;
+}
+
+PowerFlowSolver::Stats PowerFlowSolver::stats() const
+{
+  SimpleGuard guard(m_);
+  return stats_;
+}
@@ -0,0 +1,142 @@
+#ifndef CONTROLLER_POWER_FLOW_SOLVER_H
+#define CONTROLLER_POWER_FLOW_SOLVER_H
+
+#include "Common.h"
+#include "SparseLdl.h"
+
+#include <common/TimerHandler.h>
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+struct PowerFlowUpdate {
+  // Results that are new or changed
+  std::vector<powersim::PowerFlow> changed;
+  // Power devices that are no longer in the topology
+  std::vector<tms::Identity> removed;
+
+  bool empty() const
+  {
+    return changed.empty() && removed.empty();
+  }
+};
+
+/**
+ * DC power flow over the power topology of a controller.
+ *
+ * Each power device is a bus and each power connection a branch with the same
+ * susceptance. Operational loads draw their rated power and the operational
+ * sources of each island share the island's demand in proportion to their
+ * rated power. A distribution device that is not operational opens all of its
+ * branches. Bus angles come from solving the reduced susceptance matrix, with
+ * the first bus of each island as its reference, and branch flows from the
+ * angle differences.
+ *
+ * The matrix only depends on which branches are closed, so it is factored
+ * again only when the topology or the energy level of a distribution device
+ * changes. Starting or stopping a source or a load only changes the injections
+ * and is solved with the existing factorization.
+ */
+class PowerFlowSolver {
+public:
+  struct Config {
+    // Susceptance of every power connection in W/rad
+    double branch_susceptance = 1e5;
+    // Power of loads and sources whose DeviceInfo doesn't give their rating, in W
+    double default_load_demand = 1000.0;
+    double default_source_capacity = 10000.0;
+    // Results that changed less than this aren't reported as changed, in W and rad
+    double tolerance = 1e-3;
+  };
+
+  struct Stats {
+    size_t buses = 0;
+    size_t branches = 0;
+    size_t islands = 0;
+    size_t factor_nonzeros = 0;
+    uint64_t factorizations = 0;
+    uint64_t solves = 0;
+    Sec last_factor_time = Sec(0);
+    Sec last_solve_time = Sec(0);
+  };
+
+  PowerFlowSolver()
+    : PowerFlowSolver(Config())
+  {
+  }
+
+  explicit PowerFlowSolver(const Config& config);
+
+  // Rated power of a load or a source from its DeviceInfo, if it gives one
+  static std::optional<double> rated_demand(const tms::DeviceInfo& di);
+  static std::optional<double> rated_capacity(const tms::DeviceInfo& di);
+
+  // Replace the network with a topology. Roles, ratings and energy levels
+  // come from the devices known to the controller.
+  void set_topology(const powersim::PowerTopology& pt, const PowerDevices& devices);
+
+  void set_levels(const EsslUpdates& updates);
+
+  // Solve the power flow and return the results of the devices that changed
+  // since the last call, stamped with mc_id.
+  PowerFlowUpdate solve(const tms::Identity& mc_id);
+
+  Stats stats() const;
+
+private:
+  struct Bus {
+    tms::Identity id;
+    tms::DeviceRole role = tms::DeviceRole::ROLE_LOAD;
+    bool operational = true;
+    double demand = 0.0;
+    double capacity = 0.0;
+    size_t island = 0;
+    // Row in the reduced matrix, or none for the reference bus of an island
+    size_t row = 0;
+  };
+
+  struct Branch {
+    size_t from;
+    size_t to;
+  };
+
+  static constexpr size_t none = static_cast<size_t>(-1);
+
+  bool closed(const Branch& branch) const
+  {
+    return is_closed(buses_[branch.from]) && is_closed(buses_[branch.to]);
+  }
+
+  static bool is_closed(const Bus& bus)
+  {
+    return bus.role != tms::DeviceRole::ROLE_DISTRIBUTION || bus.operational;
+  }
+
+  bool changed(const powersim::PowerFlow& a, const powersim::PowerFlow& b) const;
+
+  // Find the islands of closed branches and build and factor the reduced matrix
+  void refactor();
+
+  Config config_;
+  mutable SimpleMutex m_{"PowerFlowSolver"};
+
+  std::vector<Bus> buses_;
+  std::unordered_map<tms::Identity, size_t> bus_index_;
+  std::vector<Branch> branches_;
+  // Branches of each bus, as indexes into branches_
+  std::vector<std::vector<size_t>> bus_branches_;
+
+  size_t island_count_ = 0;
+  SparseLdl ldl_;
+  bool factored_ = false;
+  bool needs_factor_ = true;
+
+  std::vector<double> angles_;
+  std::unordered_map<tms::Identity, powersim::PowerFlow> reported_;
+  Stats stats_;
+};
+
+#endif
@@ -13,6 +13,8 @@ void PowerTopologyDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr
     return;
   }
 
+  record_queue_depth(data.length());
+
   // Propagate the power connections to each power device
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
@@ -21,17 +23,11 @@ void PowerTopologyDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr
         continue;
       }
 
-      const auto& connections = pt.connections();
-      for (CORBA::ULong j = 0; j < connections.size(); ++j) {
-        const powersim::PowerConnection& pc = connections[j];
-        const DDS::ReturnCode_t rc = cli_server_.get_PowerConnection_writer()->write(pc, DDS::HANDLE_NIL);
-        if (rc != DDS::RETCODE_OK) {
-          ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: PowerTopologyDataReaderListenerImpl::on_data_available:"
-                     " write PowerConnection to device \"%C\" failed: %C\n", pc.pd_id().c_str(),
-                     OpenDDS::DCPS::retcode_to_string(rc)));
-          return;
-        }
-      }
+      cli_server_.distribute_topology(pt);
+      cli_server_.update_islands(pt);
+      cli_server_.update_contingencies(pt);
+      cli_server_.update_power_flow(pt);
+      cli_server_.update_load_shedding(pt);
       break;
     }
   }
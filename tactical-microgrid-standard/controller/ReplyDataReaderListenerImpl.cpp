@@ -13,6 +13,8 @@ void ReplyDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
     return;
   }
 
+  record_queue_depth(data.length());
+
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const tms::Reply& reply = data[i];
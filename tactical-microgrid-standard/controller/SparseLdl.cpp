@@ -0,0 +1,171 @@
+#include "SparseLdl.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <utility>
+
+std::vector<size_t> SparseLdl::minimum_degree_order(const Matrix& a)
+{
+  const size_t n = a.n;
+
+  // Elimination graph as sorted adjacency lists without the diagonal
+  std::vector<std::vector<size_t>> adj(n);
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t p = a.col_start[j]; p < a.col_start[j + 1]; ++p) {
+      const size_t i = a.row[p];
+      if (i != j) {
+        adj[i].push_back(j);
+        adj[j].push_back(i);
+      }
+    }
+  }
+
+  std::set<std::pair<size_t, size_t>> by_degree;
+  for (size_t i = 0; i < n; ++i) {
+    std::sort(adj[i].begin(), adj[i].end());
+    adj[i].erase(std::unique(adj[i].begin(), adj[i].end()), adj[i].end());
+    by_degree.insert(std::make_pair(adj[i].size(), i));
+  }
+
+  // Eliminating a node connects its neighbors with each other
+  std::vector<size_t> order;
+  order.reserve(n);
+  std::vector<size_t> merged;
+  while (!by_degree.empty()) {
+    const size_t v = by_degree.begin()->second;
+    by_degree.erase(by_degree.begin());
+    order.push_back(v);
+
+    const std::vector<size_t> neighbors = std::move(adj[v]);
+    adj[v].clear();
+    for (const size_t u : neighbors) {
+      by_degree.erase(std::make_pair(adj[u].size(), u));
+      merged.clear();
+      std::set_union(adj[u].begin(), adj[u].end(), neighbors.begin(), neighbors.end(), std::back_inserter(merged));
+      merged.erase(std::remove_if(merged.begin(), merged.end(),
+                                  [u, v](size_t w) { return w == u || w == v; }), merged.end());
+      adj[u].swap(merged);
+      by_degree.insert(std::make_pair(adj[u].size(), u));
+    }
+  }
+  return order;
+}
+
+void SparseLdl::analyze(const Matrix& a)
+{
+  const size_t n = a.n;
+  perm_ = minimum_degree_order(a);
+  inv_perm_.assign(n, 0);
+  for (size_t k = 0; k < n; ++k) {
+    inv_perm_[perm_[k]] = k;
+  }
+
+  // Elimination tree and number of entries in each column of the factor
+  parent_.assign(n, none);
+  col_count_.assign(n, 0);
+  flag_.assign(n, none);
+  for (size_t k = 0; k < n; ++k) {
+    flag_[k] = k;
+    const size_t kk = perm_[k];
+    for (size_t p = a.col_start[kk]; p < a.col_start[kk + 1]; ++p) {
+      for (size_t i = inv_perm_[a.row[p]]; i < k && flag_[i] != k; i = parent_[i]) {
+        if (parent_[i] == none) {
+          parent_[i] = k;
+        }
+        ++col_count_[i];
+        flag_[i] = k;
+      }
+    }
+  }
+
+  col_start_.assign(n + 1, 0);
+  for (size_t k = 0; k < n; ++k) {
+    col_start_[k + 1] = col_start_[k] + col_count_[k];
+  }
+  l_row_.assign(col_start_[n], 0);
+  l_value_.assign(col_start_[n], 0.0);
+  d_.assign(n, 0.0);
+  y_.assign(n, 0.0);
+  pattern_.assign(n, 0);
+  work_.assign(n, 0.0);
+}
+
+bool SparseLdl::factor(const Matrix& a)
+{
+  const size_t n = perm_.size();
+  for (size_t k = 0; k < n; ++k) {
+    // Pattern of row k of L, i.e. the nodes reachable in the elimination tree
+    // from the entries of column k of the upper triangle
+    y_[k] = 0.0;
+    size_t top = n;
+    flag_[k] = k;
+    col_count_[k] = 0;
+    const size_t kk = perm_[k];
+    for (size_t p = a.col_start[kk]; p < a.col_start[kk + 1]; ++p) {
+      size_t i = inv_perm_[a.row[p]];
+      if (i > k) {
+        continue;
+      }
+      y_[i] += a.value[p];
+      size_t len = 0;
+      for (; flag_[i] != k; i = parent_[i]) {
+        pattern_[len++] = i;
+        flag_[i] = k;
+      }
+      while (len > 0) {
+        pattern_[--top] = pattern_[--len];
+      }
+    }
+
+    // Sparse triangular solve for row k of L and the k-th pivot
+    d_[k] = y_[k];
+    y_[k] = 0.0;
+    for (; top < n; ++top) {
+      const size_t i = pattern_[top];
+      const double yi = y_[i];
+      y_[i] = 0.0;
+      const size_t end = col_start_[i] + col_count_[i];
+      for (size_t p = col_start_[i]; p < end; ++p) {
+        y_[l_row_[p]] -= l_value_[p] * yi;
+      }
+      const double l_ki = yi / d_[i];
+      d_[k] -= l_ki * yi;
+      l_row_[end] = k;
+      l_value_[end] = l_ki;
+      ++col_count_[i];
+    }
+
+    if (!(d_[k] > 0.0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SparseLdl::solve(std::vector<double>& x) const
+{
+  const size_t n = perm_.size();
+  for (size_t k = 0; k < n; ++k) {
+    work_[k] = x[perm_[k]];
+  }
+  for (size_t j = 0; j < n; ++j) {
+    const double yj = work_[j];
+    for (size_t p = col_start_[j]; p < col_start_[j + 1]; ++p) {
+      work_[l_row_[p]] -= l_value_[p] * yj;
+    }
+  }
+  for (size_t j = 0; j < n; ++j) {
+    work_[j] /= d_[j];
+  }
+  for (size_t j = n; j-- > 0;) {
+    double yj = work_[j];
+    for (size_t p = col_start_[j]; p < col_start_[j + 1]; ++p) {
+      yj -= l_value_[p] * work_[l_row_[p]];
+    }
+    work_[j] = yj;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    x[perm_[k]] = work_[k];
+  }
+}
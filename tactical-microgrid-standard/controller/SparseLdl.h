@@ -0,0 +1,70 @@
+#ifndef CONTROLLER_SPARSE_LDL_H
+#define CONTROLLER_SPARSE_LDL_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Sparse LDL' factorization of a symmetric positive definite matrix, used to
+ * solve power flow over large topologies.
+ *
+ * analyze() orders the matrix with minimum degree to limit fill-in and
+ * computes the structure of the factor. factor() computes the numeric factor
+ * using the up-looking algorithm of Davis' LDL. Both only need repeating when
+ * the pattern or the values of the matrix change; solve() can then be called
+ * for any number of right-hand sides.
+ */
+class SparseLdl {
+public:
+  // Symmetric matrix in compressed sparse column form. Both triangles may be
+  // given; only the upper triangle of the permuted matrix is used.
+  struct Matrix {
+    size_t n = 0;
+    // Column j has the entries col_start[j] to col_start[j + 1] - 1
+    std::vector<size_t> col_start;
+    std::vector<size_t> row;
+    std::vector<double> value;
+  };
+
+  // Fill-reducing ordering of the pattern of a, i.e. order[k] is the k-th column to eliminate
+  static std::vector<size_t> minimum_degree_order(const Matrix& a);
+
+  void analyze(const Matrix& a);
+
+  // Returns false if the matrix is not positive definite, e.g. it is singular.
+  bool factor(const Matrix& a);
+
+  // Solve A x = b where b is given in x
+  void solve(std::vector<double>& x) const;
+
+  size_t size() const
+  {
+    return perm_.size();
+  }
+
+  // Number of off-diagonal entries in the factor
+  size_t factor_nonzeros() const
+  {
+    return col_start_.empty() ? 0 : col_start_.back();
+  }
+
+private:
+  static constexpr size_t none = static_cast<size_t>(-1);
+
+  std::vector<size_t> perm_;
+  std::vector<size_t> inv_perm_;
+  std::vector<size_t> parent_;
+  std::vector<size_t> col_start_;
+  std::vector<size_t> col_count_;
+  std::vector<size_t> l_row_;
+  std::vector<double> l_value_;
+  std::vector<double> d_;
+
+  // Scratch space for factor() and solve()
+  std::vector<double> y_;
+  std::vector<size_t> pattern_;
+  std::vector<size_t> flag_;
+  mutable std::vector<double> work_;
+};
+
+#endif
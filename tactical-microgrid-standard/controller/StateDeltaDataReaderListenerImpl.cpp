@@ -0,0 +1,23 @@
+#include "StateDeltaDataReaderListenerImpl.h"
+
+void StateDeltaDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
+{
+  mcstate::StateDeltaSeq data;
+  DDS::SampleInfoSeq info_seq;
+  mcstate::StateDeltaDataReader_var typed_reader = mcstate::StateDeltaDataReader::_narrow(reader);
+  DDS::ReturnCode_t rc = typed_reader->take(data, info_seq, DDS::LENGTH_UNLIMITED,
+                                            DDS::ANY_SAMPLE_STATE, DDS::ANY_VIEW_STATE, DDS::ANY_INSTANCE_STATE);
+  if (rc != DDS::RETCODE_OK) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: StateDeltaDataReaderListenerImpl::on_data_available: "
+               "take data failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+    return;
+  }
+
+  record_queue_depth(data.length());
+
+  for (CORBA::ULong i = 0; i < data.length(); ++i) {
+    if (info_seq[i].valid_data) {
+      replicator_.receive_delta(data[i], info_seq[i]);
+    }
+  }
+}
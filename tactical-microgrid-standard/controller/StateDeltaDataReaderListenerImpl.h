@@ -0,0 +1,21 @@
+#ifndef STATE_DELTA_DATA_READER_LISTENER_IMPL_H
+#define STATE_DELTA_DATA_READER_LISTENER_IMPL_H
+
+#include "common/DataReaderListenerBase.h"
+#include "StateReplicator.h"
+
+class StateDeltaDataReaderListenerImpl : public DataReaderListenerBase {
+public:
+  explicit StateDeltaDataReaderListenerImpl(StateReplicator& replicator)
+    : DataReaderListenerBase("mcstate::StateDelta - DataReaderListenerImpl")
+    , replicator_(replicator) {}
+
+  virtual ~StateDeltaDataReaderListenerImpl() = default;
+
+  void on_data_available(DDS::DataReader_ptr reader) final;
+
+private:
+  StateReplicator& replicator_;
+};
+
+#endif
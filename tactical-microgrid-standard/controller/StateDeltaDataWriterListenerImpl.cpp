@@ -0,0 +1,12 @@
+#include "StateDeltaDataWriterListenerImpl.h"
+
+void StateDeltaDataWriterListenerImpl::on_publication_matched(DDS::DataWriter_ptr writer,
+                                                              const DDS::PublicationMatchedStatus& status)
+{
+  DataWriterListenerBase::on_publication_matched(writer, status);
+
+  // A new peer controller only receives deltas from now on, so bring it up to date first.
+  if (status.current_count_change > 0) {
+    replicator_.send_snapshot();
+  }
+}
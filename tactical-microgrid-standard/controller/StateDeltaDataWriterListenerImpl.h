@@ -0,0 +1,21 @@
+#ifndef STATE_DELTA_DATA_WRITER_LISTENER_IMPL_H
+#define STATE_DELTA_DATA_WRITER_LISTENER_IMPL_H
+
+#include "common/DataWriterListenerBase.h"
+#include "StateReplicator.h"
+
+class StateDeltaDataWriterListenerImpl : public DataWriterListenerBase {
+public:
+  explicit StateDeltaDataWriterListenerImpl(StateReplicator& replicator)
+    : DataWriterListenerBase("mcstate::StateDelta - DataWriterListenerImpl")
+    , replicator_(replicator) {}
+
+  virtual ~StateDeltaDataWriterListenerImpl() = default;
+
+  void on_publication_matched(DDS::DataWriter_ptr writer, const DDS::PublicationMatchedStatus& status) final;
+
+private:
+  StateReplicator& replicator_;
+};
+
+#endif
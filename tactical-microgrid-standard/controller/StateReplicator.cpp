@@ -0,0 +1,293 @@
+#include "StateReplicator.h"
+#include "CLIServer.h"
+#include "StateDeltaDataReaderListenerImpl.h"
+#include "StateDeltaDataWriterListenerImpl.h"
+#include "common/Metrics.h"
+#include "common/Utils.h"
+
+#include <algorithm>
+
+namespace {
+  powersim::PowerConnection make_connection(const tms::Identity& pd_id, const powersim::ConnectedDeviceSeq& cds)
+  {
+    powersim::PowerConnection pc;
+    pc.pd_id(pd_id);
+    pc.connected_devices(cds);
+    return pc;
+  }
+}
+
+StateReplicator::StateReplicator(Controller& mc, CLIServer& cli_server)
+  : controller_(mc)
+  , cli_server_(cli_server)
+{
+}
+
+DDS::ReturnCode_t StateReplicator::init(DDS::DomainParticipant_ptr sim_dp, DDS::Publisher_ptr pub, DDS::Subscriber_ptr sub)
+{
+  mcstate::StateDeltaTypeSupport_var sd_ts = new mcstate::StateDeltaTypeSupportImpl;
+  if (DDS::RETCODE_OK != sd_ts->register_type(sim_dp, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: StateReplicator::init: register_type StateDelta failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  CORBA::String_var sd_type_name = sd_ts->get_type_name();
+  DDS::Topic_var sd_topic = sim_dp->create_topic(mcstate::TOPIC_CONTROLLER_STATE_DELTA.c_str(),
+                                                 sd_type_name,
+                                                 TOPIC_QOS_DEFAULT,
+                                                 nullptr,
+                                                 ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!sd_topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: StateReplicator::init: create_topic \"%C\" failed\n",
+               mcstate::TOPIC_CONTROLLER_STATE_DELTA.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  // All deltas from a controller are samples of the same instance, so none of them
+  // can be replaced by a later one before it is delivered.
+  DDS::DataReaderQos dr_qos;
+  sub->get_default_datareader_qos(dr_qos);
+  dr_qos.reliability.kind = DDS::ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+  dr_qos.history.kind = DDS::HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS;
+
+  DDS::DataReaderListener_var sd_dr_listener(new StateDeltaDataReaderListenerImpl(*this));
+  DDS::DataReader_var sd_dr_base = sub->create_datareader(sd_topic,
+                                                          dr_qos,
+                                                          sd_dr_listener,
+                                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!sd_dr_base) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: StateReplicator::init: create_datareader for topic \"%C\" failed\n",
+               mcstate::TOPIC_CONTROLLER_STATE_DELTA.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  DDS::DataWriterQos dw_qos;
+  pub->get_default_datawriter_qos(dw_qos);
+  dw_qos.reliability.kind = DDS::ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+  dw_qos.history.kind = DDS::HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS;
+
+  DDS::DataWriter_var sd_dw_base = pub->create_datawriter(sd_topic,
+                                                          dw_qos,
+                                                          nullptr,
+                                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!sd_dw_base) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: StateReplicator::init: create_datawriter for topic \"%C\" failed\n",
+               mcstate::TOPIC_CONTROLLER_STATE_DELTA.c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+
+  {
+    SimpleGuard guard(m_);
+    delta_dw_ = mcstate::StateDeltaDataWriter::_narrow(sd_dw_base);
+    if (!delta_dw_) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: StateReplicator::init: StateDeltaDataWriter narrow failed\n"));
+      return DDS::RETCODE_ERROR;
+    }
+  }
+
+  // The listener is set after the writer is ready so that no match is missed.
+  DDS::DataWriterListener_var sd_dw_listener(new StateDeltaDataWriterListenerImpl(*this));
+  sd_dw_base->set_listener(sd_dw_listener, DDS::PUBLICATION_MATCHED_STATUS);
+
+  controller_.set_device_changed_callback([this](const cli::PowerDeviceInfo& pdi) { device_changed(pdi); });
+  controller_.set_takeover_callback([this](const tms::Identity& pd_id, const tms::Identity& prev_mc_id, Sec age) {
+    takeover(pd_id, prev_mc_id, age);
+  });
+
+  // Peers matched before the listener was set
+  send_snapshot();
+
+  return DDS::RETCODE_OK;
+}
+
+void StateReplicator::device_changed(const cli::PowerDeviceInfo& pdi)
+{
+  // The peers only accept the state of a device from its active controller
+  if (pdi.master_id() != controller_.id()) {
+    return;
+  }
+
+  mcstate::StateDelta delta;
+  delta.devices().push_back(pdi);
+
+  SimpleGuard guard(m_);
+  write(delta);
+}
+
+void StateReplicator::connections_changed(const PowerConnectionsDiff& diff)
+{
+  if (diff.empty()) {
+    return;
+  }
+
+  mcstate::StateDelta delta;
+  delta.connections().assign(diff.changed.begin(), diff.changed.end());
+  delta.removed_connections().assign(diff.removed.begin(), diff.removed.end());
+
+  SimpleGuard guard(m_);
+  write(delta);
+}
+
+void StateReplicator::send_snapshot()
+{
+  mcstate::StateDelta delta;
+  delta.snapshot(true);
+
+  // Only the devices managed by this controller, the peers have their own view of the rest
+  const tms::Identity mc_id = controller_.id();
+  const PowerDevices pdvs = controller_.power_devices();
+  for (const auto& pair : pdvs) {
+    if (pair.second.master_id() == mc_id) {
+      delta.devices().push_back(pair.second);
+    }
+  }
+
+  // Hold the distributed topology so that no change to it is written before the snapshot
+  cli_server_.visit_distributed_topology([&](const PowerConnections& pcs) {
+    for (const auto& pair : pcs) {
+      delta.connections().push_back(make_connection(pair.first, pair.second));
+    }
+    SimpleGuard guard(m_);
+    write(delta);
+  });
+}
+
+void StateReplicator::write(mcstate::StateDelta& delta)
+{
+  // Must be called with m_ held so that deltas are written in the order of their sequence numbers.
+  if (!delta_dw_) {
+    return;
+  }
+
+  delta.mc_id(controller_.id());
+  delta.seqnum(++seqnum_);
+
+  const DDS::ReturnCode_t rc = delta_dw_->write(delta, DDS::HANDLE_NIL);
+  if (rc != DDS::RETCODE_OK) {
+    Metrics::instance().write_failed();
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: StateReplicator::write: write delta %Q failed: %C\n",
+               delta.seqnum(), OpenDDS::DCPS::retcode_to_string(rc)));
+  }
+}
+
+void StateReplicator::receive_delta(const mcstate::StateDelta& delta, const DDS::SampleInfo& si)
+{
+  const tms::Identity& peer_id = delta.mc_id();
+  if (peer_id == controller_.id()) {
+    return;
+  }
+
+  const Sec lag = Utils::time_since(si.source_timestamp);
+  const TimePoint now = Clock::now();
+  {
+    SimpleGuard guard(m_);
+    PeerState& peer = peers_[peer_id];
+    if (delta.snapshot()) {
+      peer.topology.clear();
+      peer.synced = true;
+    } else if (peer.synced && delta.seqnum() != peer.last_seqnum + 1) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: StateReplicator::receive_delta: "
+                 "expected delta %Q from controller \"%C\", got %Q. State is stale until its next snapshot\n",
+                 peer.last_seqnum + 1, peer_id.c_str(), delta.seqnum()));
+      peer.synced = false;
+    }
+
+    // Ask the peer for a snapshot, and again with a later delta if it doesn't come
+    if (!peer.synced && now - peer.resync_requested >= resync_interval) {
+      peer.resync_requested = now;
+      mcstate::StateDelta request;
+      request.resync().push_back(peer_id);
+      write(request);
+    }
+
+    peer.last_seqnum = delta.seqnum();
+    peer.last_received = now;
+    peer.last_lag = lag;
+    if (lag > peer.max_lag) {
+      peer.max_lag = lag;
+    }
+
+    for (const powersim::PowerConnection& pc : delta.connections()) {
+      peer.topology[pc.pd_id()] = pc.connected_devices();
+    }
+    for (const tms::Identity& pd_id : delta.removed_connections()) {
+      peer.topology.erase(pd_id);
+    }
+  }
+
+  // A peer missed deltas from this controller
+  const tms::Identity mc_id = controller_.id();
+  if (std::find(delta.resync().begin(), delta.resync().end(), mc_id) != delta.resync().end()) {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: StateReplicator::receive_delta: controller \"%C\" asked for a snapshot\n",
+               peer_id.c_str()));
+    send_snapshot();
+  }
+
+  EsslUpdates updates;
+  for (const cli::PowerDeviceInfo& pdi : delta.devices()) {
+    if (controller_.apply_replicated_device(pdi, peer_id)) {
+      updates.push_back(std::make_pair(pdi.device_info().deviceId(), pdi.essl()));
+    }
+  }
+
+  // The islands of this controller's loads may have changed with the peer's devices
+  if (!updates.empty()) {
+    cli_server_.levels_changed(updates);
+    cli_server_.shed_loads();
+  }
+
+  if (OpenDDS::DCPS::DCPS_debug_level >= 5) {
+    ACE_DEBUG((LM_DEBUG, "(%P|%t) DEBUG: StateReplicator::receive_delta: %C %Q from controller \"%C\": "
+               "%B device(s), %B connection(s), %B removed, replication lag %f s\n",
+               delta.snapshot() ? "snapshot" : "delta", delta.seqnum(), peer_id.c_str(),
+               delta.devices().size(), delta.connections().size(), delta.removed_connections().size(),
+               lag.count()));
+  }
+}
+
+void StateReplicator::takeover(const tms::Identity& pd_id, const tms::Identity& prev_mc_id, Sec selection_age)
+{
+  bool known_peer = false;
+  bool synced = false;
+  std::optional<powersim::ConnectedDeviceSeq> peer_connections;
+  Sec state_age(0);
+  Sec last_lag(0);
+  Sec max_lag(0);
+  {
+    SimpleGuard guard(m_);
+    auto peer_it = peers_.find(prev_mc_id);
+    if (peer_it != peers_.end()) {
+      const PeerState& peer = peer_it->second;
+      known_peer = true;
+      synced = peer.synced;
+      state_age = Clock::now() - peer.last_received;
+      last_lag = peer.last_lag;
+      max_lag = peer.max_lag;
+
+      auto conn_it = peer.topology.find(pd_id);
+      if (conn_it != peer.topology.end()) {
+        peer_connections = conn_it->second;
+      }
+    }
+  }
+
+  // Adopt the power connections that the previous controller distributed for this device,
+  // unless deltas from it were missed since its last snapshot and they may be stale.
+  // CLIServer streams them back through connections_changed, so m_ can't be held here.
+  const bool adopted = synced && peer_connections && cli_server_.adopt_connections(pd_id, *peer_connections);
+
+  if (known_peer && !synced) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: StateReplicator::takeover: device \"%C\" failed over from controller \"%C\" "
+               "(takeover %f s after selection), whose replicated state is stale and wasn't adopted\n",
+               pd_id.c_str(), prev_mc_id.c_str(), selection_age.count()));
+  } else if (known_peer) {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: StateReplicator::takeover: device \"%C\" failed over from controller \"%C\" "
+               "(takeover %f s after selection, replicated state %f s old, replication lag %f s, max %f s%C)\n",
+               pd_id.c_str(), prev_mc_id.c_str(), selection_age.count(), state_age.count(), last_lag.count(),
+               max_lag.count(), adopted ? ", power connections adopted" : ""));
+  } else {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: StateReplicator::takeover: device \"%C\" failed over from controller \"%C\" "
+               "(takeover %f s after selection, no replicated state from that controller)\n",
+               pd_id.c_str(), prev_mc_id.c_str(), selection_age.count()));
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef CONTROLLER_STATE_REPLICATOR_H
+#define CONTROLLER_STATE_REPLICATOR_H
+
+#include "Controller.h"
+#include "PowerConnections.h"
+
+#include <controller/ControllerStateTypeSupportImpl.h>
+
+#include <unordered_map>
+
+class CLIServer;
+
+// Streams the state of the power devices managed by this controller and the power topology
+// it distributed to the other microgrid controllers on the simulation domain, and keeps the
+// state streamed by them. When a power device fails over to this controller, its state is
+// already here.
+class StateReplicator {
+public:
+  StateReplicator(Controller& mc, CLIServer& cli_server);
+
+  DDS::ReturnCode_t init(DDS::DomainParticipant_ptr sim_dp, DDS::Publisher_ptr pub, DDS::Subscriber_ptr sub);
+
+  // Local changes to be streamed to the peer controllers. Only devices managed by this
+  // controller are streamed. Changes to the power connections are passed by CLIServer
+  // while it holds the lock of the distributed topology.
+  void device_changed(const cli::PowerDeviceInfo& pdi);
+  void connections_changed(const PowerConnectionsDiff& diff);
+
+  // Send the complete state of this controller, e.g. when a new peer is discovered
+  void send_snapshot();
+
+  // Apply a delta streamed by a peer controller. After a delta from a peer was
+  // missed, its state is stale and the peer is asked for a snapshot, again with
+  // its deltas at most every resync_interval until the snapshot arrives.
+  void receive_delta(const mcstate::StateDelta& delta, const DDS::SampleInfo& si);
+
+  // A power device has failed over to this controller from a peer. Its power
+  // connections are only adopted from a peer whose state is in sync.
+  void takeover(const tms::Identity& pd_id, const tms::Identity& prev_mc_id, Sec selection_age);
+
+private:
+  struct PeerState {
+    PowerConnections topology;
+    uint64_t last_seqnum = 0;
+    bool synced = false;
+    TimePoint resync_requested;
+    TimePoint last_received;
+    Sec last_lag = Sec(0);
+    Sec max_lag = Sec(0);
+  };
+
+  void write(mcstate::StateDelta& delta);
+
+  // Time between requests for a snapshot from a peer that isn't in sync
+  static constexpr Sec resync_interval = Sec(1);
+
+  Controller& controller_;
+  CLIServer& cli_server_;
+  mcstate::StateDeltaDataWriter_var delta_dw_;
+
+  mutable SimpleMutex m_{"StateReplicator"};
+  uint64_t seqnum_ = 0;
+  std::unordered_map<tms::Identity, PeerState> peers_;
+};
+
+#endif
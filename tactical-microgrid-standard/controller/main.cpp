@@ -1,14 +1,23 @@
 #include "Controller.h"
 #include "CLIServer.h"
+#include "MeasurementAggregator.h"
+
+#include <common/MetricsExporter.h>
+#include <historian/Historian.h>
 
 #include <ace/Get_Opt.h>
 
+#include <memory>
+
 int main(int argc, char* argv[])
 {
   DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
   const char* mc_id = nullptr;
+  MeasurementAggregator::Config aggregator_config;
+  Historian::Config historian_config;
+  int metrics_port = -1;
 
-  ACE_Get_Opt get_opt(argc, argv, "i:d:");
+  ACE_Get_Opt get_opt(argc, argv, "i:d:S:W:H:E:");
   int c;
   while ((c = get_opt()) != -1) {
     switch (c) {
@@ -18,13 +27,26 @@ int main(int argc, char* argv[])
     case 'd':
       domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
       break;
+    case 'S':
+      aggregator_config.summary_period = Sec(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'W':
+      aggregator_config.window = Sec(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'H':
+      historian_config.store.dir = get_opt.opt_arg();
+      break;
+    case 'E':
+      metrics_port = ACE_OS::atoi(get_opt.opt_arg());
+      break;
     default:
       break;
     }
   }
 
-  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || mc_id == nullptr) {
-    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Microgrid_Controller_Id\n", argv[0]));
+  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || mc_id == nullptr || metrics_port > 65535) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Microgrid_Controller_Id "
+               "[-S summary_period_sec (0 disables)] [-W window_sec] [-H historian_dir] [-E metrics_port]\n", argv[0]));
     return 1;
   }
 
@@ -32,5 +54,31 @@ int main(int argc, char* argv[])
   controller.init(domain_id, argc, argv);
   CLIServer cli_server(controller);
 
-  return controller.run();
+  MetricsExporter exporter(mc_id);
+  if (metrics_port >= 0 && !exporter.start(static_cast<u_short>(metrics_port))) {
+    return 1;
+  }
+
+  // Summarize the measurements of the devices that selected this controller
+  MeasurementAggregator aggregator(mc_id, controller.get_reactor(), aggregator_config);
+  aggregator.managed_devices([&controller] { return controller.managed_devices(); });
+  if (aggregator.init(controller.get_domain_participant()) == DDS::RETCODE_OK) {
+    aggregator.start();
+  }
+
+  // Record the history of the domain alongside the controller
+  std::unique_ptr<Historian> historian;
+  if (!historian_config.store.dir.empty()) {
+    historian.reset(new Historian(controller.get_reactor(), historian_config));
+    if (historian->init(controller.get_domain_participant()) == DDS::RETCODE_OK) {
+      historian->start();
+    }
+  }
+
+  const int status = controller.run();
+  if (historian) {
+    historian->stop();
+  }
+  aggregator.stop();
+  return status;
 }
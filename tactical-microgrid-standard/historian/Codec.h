@@ -0,0 +1,140 @@
+#ifndef HISTORIAN_CODEC_H
+#define HISTORIAN_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Compression of the columns of a block of samples. Times are stored as the
+ * difference between consecutive deltas, which is zero for samples published
+ * at a steady rate. Values are stored as the XOR of their bits with those of
+ * the previous value, which is zero for a repeated value and has mostly
+ * trailing zeros for a small change. Both are written as varints.
+ */
+namespace Codec {
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// Returns false if the varint runs past end
+inline bool get_varint(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+{
+  value = 0;
+  for (unsigned shift = 0; pos < end && shift < 64; shift += 7) {
+    const uint8_t byte = *pos++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline uint64_t zigzag(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Times are relative to a base, the first time of the block, so they start small
+class TimeEncoder {
+public:
+  explicit TimeEncoder(int64_t base = 0)
+    : prev_(base)
+  {
+  }
+
+  void add(std::vector<uint8_t>& out, int64_t time)
+  {
+    const int64_t delta = time - prev_;
+    put_varint(out, zigzag(delta - prev_delta_));
+    prev_ = time;
+    prev_delta_ = delta;
+  }
+
+private:
+  int64_t prev_;
+  int64_t prev_delta_ = 0;
+};
+
+class TimeDecoder {
+public:
+  explicit TimeDecoder(int64_t base = 0)
+    : prev_(base)
+  {
+  }
+
+  bool next(const uint8_t*& pos, const uint8_t* end, int64_t& time)
+  {
+    uint64_t raw;
+    if (!get_varint(pos, end, raw)) {
+      return false;
+    }
+    prev_delta_ += unzigzag(raw);
+    prev_ += prev_delta_;
+    time = prev_;
+    return true;
+  }
+
+private:
+  int64_t prev_;
+  int64_t prev_delta_ = 0;
+};
+
+// The XOR is written shifted right by its trailing zeros, with the count in the low 5 bits
+class ValueEncoder {
+public:
+  void add(std::vector<uint8_t>& out, float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    const uint32_t x = bits ^ prev_;
+    prev_ = bits;
+    if (x == 0) {
+      put_varint(out, 0);
+      return;
+    }
+    unsigned zeros = 0;
+    while (!(x & (1u << zeros))) {
+      ++zeros;
+    }
+    put_varint(out, (static_cast<uint64_t>(x >> zeros) << 5) | zeros);
+  }
+
+private:
+  uint32_t prev_ = 0;
+};
+
+class ValueDecoder {
+public:
+  bool next(const uint8_t*& pos, const uint8_t* end, float& value)
+  {
+    uint64_t raw;
+    if (!get_varint(pos, end, raw)) {
+      return false;
+    }
+    if (raw) {
+      prev_ ^= static_cast<uint32_t>((raw >> 5) << (raw & 0x1f));
+    }
+    std::memcpy(&value, &prev_, sizeof value);
+    return true;
+  }
+
+private:
+  uint32_t prev_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include "Historian.h"
+
+#include <common/CallbackDataReaderListenerImpl.h>
+#include <common/QosHelper.h>
+
+#include <dds/DCPS/Marked_Default_Qos.h>
+
+namespace {
+
+const std::vector<const char*> ac_quantities = {"voltage", "amperage", "frequency", "realPower", "reactivePower"};
+const std::vector<const char*> dc_quantities = {"voltage", "amperage", "power"};
+const std::vector<const char*> storage_quantities = {"internalVoltage", "availableEnergy", "holdTime",
+                                                     "stateOfCharge", "maxChargeRate", "maxDischargeRate"};
+const std::vector<const char*> metric_quantities = {""};
+
+template <typename Sample>
+bool create_reader(DDS::DomainParticipant_ptr dp, DDS::Subscriber_ptr sub, const std::string& topic_name,
+                   int depth, typename CallbackDataReaderListenerImpl<Sample>::Callback callback)
+{
+  using TypeSupportImpl = typename OpenDDS::DCPS::DDSTraits<Sample>::TypeSupportImplType;
+
+  typename TypeSupportImpl::_var_type ts = new TypeSupportImpl;
+  if (DDS::RETCODE_OK != ts->register_type(dp, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Historian::init: register_type for \"%C\" failed\n",
+               topic_name.c_str()));
+    return false;
+  }
+
+  CORBA::String_var type_name = ts->get_type_name();
+  DDS::Topic_var topic = dp->create_topic(topic_name.c_str(),
+                                          type_name,
+                                          TOPIC_QOS_DEFAULT,
+                                          nullptr,
+                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Historian::init: create_topic \"%C\" failed\n", topic_name.c_str()));
+    return false;
+  }
+
+  // Keep the samples of periodic topics that arrive between two takes instead of only the last
+  DDS::DataReaderQos dr_qos = Qos::DataReader::fn_map.at(topic_name)("historian");
+  if (depth > 0) {
+    dr_qos.history.kind = DDS::KEEP_LAST_HISTORY_QOS;
+    dr_qos.history.depth = depth;
+  }
+  DDS::DataReaderListener_var listener(new CallbackDataReaderListenerImpl<Sample>(topic_name, callback));
+  DDS::DataReader_var dr = sub->create_datareader(topic, dr_qos, listener, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!dr) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Historian::init: create_datareader for topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return false;
+  }
+  return true;
+}
+
+std::string prefix(const tms::Identity& device_id, const std::string& topic)
+{
+  std::string p;
+  p.reserve(device_id.size() + topic.size() + 8);
+  p += device_id;
+  p += '/';
+  p += topic;
+  return p;
+}
+
+std::string prefix(const tms::Identity& device_id, const std::string& topic, tms::PowerPortNumber port)
+{
+  return prefix(device_id, topic) + '/' + std::to_string(port);
+}
+
+template <typename Update>
+const auto& measurements(const Update& update)
+{
+  return update.internalMeasurement().empty() ? update.externalMeasurement() : update.internalMeasurement();
+}
+
+}
+
+Historian::Historian(ACE_Reactor* reactor, const Config& config)
+  : TimerHandler(reactor, "Historian")
+  , config_(config)
+  , store_(config.store)
+{
+}
+
+Historian::~Historian()
+{
+  stop();
+
+  // The listeners of the readers refer to this, and the participant may outlive it
+  if (sub_) {
+    sub_->delete_contained_entities();
+  }
+}
+
+DDS::ReturnCode_t Historian::init(DDS::DomainParticipant_ptr dp)
+{
+  if (!store_.open()) {
+    return DDS::RETCODE_ERROR;
+  }
+
+  const DDS::SubscriberQos sub_qos = Qos::Subscriber::get_qos();
+  sub_ = dp->create_subscriber(sub_qos, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!sub_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: Historian::init: create_subscriber with TMS QoS failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  const auto measurement_reader = [&](const std::string& topic_name, auto sample) {
+    using Sample = decltype(sample);
+    return create_reader<Sample>(dp, sub_, topic_name, config_.reader_depth,
+      [this, topic_name](const Sample& mu, const DDS::SampleInfo& si) {
+        if (si.valid_data) {
+          record(mu, topic_name, sample_time(si));
+        }
+      });
+  };
+
+  const bool ok =
+    measurement_reader(tms::topic::TOPIC_AC_MEASUREMENT_UPDATE, tms::ac::MeasurementUpdate()) &&
+    measurement_reader(tms::topic::TOPIC_DC_MEASUREMENT_UPDATE, tms::dc::MeasurementUpdate()) &&
+    measurement_reader(tms::topic::TOPIC_AC_SUMMARY_MEASUREMENT_UPDATE, tms::ac::MeasurementUpdate()) &&
+    measurement_reader(tms::topic::TOPIC_DC_SUMMARY_MEASUREMENT_UPDATE, tms::dc::MeasurementUpdate()) &&
+    create_reader<tms::StorageUpdate>(dp, sub_, tms::topic::TOPIC_STORAGE_UPDATE, config_.reader_depth,
+      [this](const tms::StorageUpdate& su, const DDS::SampleInfo& si) {
+        if (si.valid_data) {
+          record(su, sample_time(si));
+        }
+      }) &&
+    create_reader<tms::MetricParameterState>(dp, sub_, tms::topic::TOPIC_METRIC_PARAMETER_STATE, 0,
+      [this](const tms::MetricParameterState& mps, const DDS::SampleInfo& si) {
+        if (si.valid_data) {
+          record(mps, sample_time(si));
+        }
+      });
+  return ok ? DDS::RETCODE_OK : DDS::RETCODE_ERROR;
+}
+
+History::Time Historian::to_time(TimePoint tp)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+History::Time Historian::sample_time(const DDS::SampleInfo& si)
+{
+  if (si.source_timestamp.sec == 0 && si.source_timestamp.nanosec == 0) {
+    return to_time(Clock::now());
+  }
+  return static_cast<History::Time>(si.source_timestamp.sec) * 1000000000 + si.source_timestamp.nanosec;
+}
+
+const Historian::SeriesIds& Historian::series(const std::string& prefix, const std::vector<const char*>& quantities)
+{
+  SimpleGuard g(series_mutex_);
+  const auto it = series_.find(prefix);
+  if (it != series_.end()) {
+    return it->second;
+  }
+
+  SeriesIds ids;
+  for (const char* quantity : quantities) {
+    ids.push_back(store_.series(*quantity ? prefix + '/' + quantity : prefix));
+  }
+  return series_.emplace(prefix, std::move(ids)).first->second;
+}
+
+void Historian::record(const tms::ac::MeasurementUpdate& mu, const std::string& topic, History::Time time)
+{
+  for (const auto& ppm : measurements(mu)) {
+    if (ppm.line().empty()) {
+      continue;
+    }
+    float real_power = 0.0f, reactive_power = 0.0f;
+    for (const auto& line : ppm.line()) {
+      real_power += line.realPower();
+      reactive_power += line.reactivePower();
+    }
+    const auto& line = ppm.line()[0];
+    const SeriesIds& ids = series(prefix(mu.deviceId(), topic, ppm.portNumber()), ac_quantities);
+    store_.append(ids[0], time, line.voltage());
+    store_.append(ids[1], time, line.amperage());
+    store_.append(ids[2], time, line.frequency());
+    store_.append(ids[3], time, real_power);
+    store_.append(ids[4], time, reactive_power);
+  }
+}
+
+void Historian::record(const tms::dc::MeasurementUpdate& mu, const std::string& topic, History::Time time)
+{
+  for (const auto& ppm : measurements(mu)) {
+    if (ppm.line().empty()) {
+      continue;
+    }
+    float power = 0.0f;
+    for (const auto& line : ppm.line()) {
+      power += line.power();
+    }
+    const auto& line = ppm.line()[0];
+    const SeriesIds& ids = series(prefix(mu.deviceId(), topic, ppm.portNumber()), dc_quantities);
+    store_.append(ids[0], time, line.voltage());
+    store_.append(ids[1], time, line.amperage());
+    store_.append(ids[2], time, power);
+  }
+}
+
+void Historian::record(const tms::StorageUpdate& su, History::Time time)
+{
+  const SeriesIds& ids = series(prefix(su.deviceId(), tms::topic::TOPIC_STORAGE_UPDATE), storage_quantities);
+  store_.append(ids[0], time, su.internalVoltage());
+  store_.append(ids[1], time, su.availableEnergy());
+  store_.append(ids[2], time, su.holdTime());
+  if (su.stateOfCharge()) {
+    store_.append(ids[3], time, *su.stateOfCharge());
+  }
+  if (su.maxChargeRate()) {
+    store_.append(ids[4], time, *su.maxChargeRate());
+  }
+  if (su.maxDischargeRate()) {
+    store_.append(ids[5], time, *su.maxDischargeRate());
+  }
+}
+
+void Historian::record(const tms::MetricParameterState& mps, History::Time time)
+{
+  const std::string device_prefix = prefix(mps.deviceId(), tms::topic::TOPIC_METRIC_PARAMETER_STATE);
+  for (const auto& pv : mps.metricParameters()) {
+    const SeriesIds& ids = series(device_prefix + '/' + pv.name(), metric_quantities);
+    store_.append(ids[0], time, pv.value());
+  }
+}
+
+void Historian::start()
+{
+  Guard g(lock_);
+  if (get_timer<FlushHistoryEvent>()->active()) {
+    return;
+  }
+  schedule(FlushHistoryEvent(), config_.flush_period);
+}
+
+void Historian::stop()
+{
+  Guard g(lock_);
+  if (!get_timer<FlushHistoryEvent>()->active()) {
+    return;
+  }
+  cancel<FlushHistoryEvent>();
+  store_.close();
+  log_stats();
+}
+
+void Historian::log_stats() const
+{
+  const SeriesStore::Stats s = store_.stats();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: Historian::log_stats: %B series, %Q points, %Q in %Q blocks "
+             "of %Q bytes in %B segments, %Q dropped\n", s.series, s.points, s.stored_points, s.blocks,
+             s.stored_bytes, s.segments, s.dropped));
+}
+
+void Historian::timer_fired(Timer<FlushHistoryEvent>&)
+{
+  const auto max_age = std::chrono::duration_cast<Clock::duration>(config_.max_age);
+  store_.flush(to_time(Clock::now() - max_age));
+}
+
+void Historian::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
@@ -0,0 +1,81 @@
+#ifndef HISTORIAN_HISTORIAN_H
+#define HISTORIAN_HISTORIAN_H
+
+#include "SeriesStore.h"
+
+#include <common/TimerHandler.h>
+#include <common/mil-std-3071_data_modelTypeSupportImpl.h>
+
+#include <unordered_map>
+
+struct FlushHistoryEvent {
+  static const char* name() { return "FlushHistory"; }
+};
+
+/**
+ * Records the measurement, storage and metric topics of the TMS domain into a
+ * SeriesStore, with one series per device and quantity named like
+ * "<device>/<topic>/<port>/<quantity>", or "<device>/<topic>/<quantity>" for
+ * the topics without ports. Samples are recorded at their source timestamps.
+ *
+ * AC and DC ports have the voltage, amperage and (AC) frequency of their first
+ * line and their power summed over the lines. A storage device has its
+ * internal voltage, available energy, hold time and the optional state of
+ * charge and charge rates. Each metric parameter is a series of its own.
+ */
+class TMS_Historian_Export Historian : public TimerHandler<FlushHistoryEvent> {
+public:
+  struct Config {
+    SeriesStore::Config store;
+    // How often the samples kept in memory are checked
+    Sec flush_period = Sec(10);
+    // Samples kept in memory longer than this are written even if their block isn't full
+    Sec max_age = Sec(60);
+    // Samples the readers keep per device between takes
+    int reader_depth = 64;
+  };
+
+  Historian(ACE_Reactor* reactor, const Config& config);
+  ~Historian();
+
+  // Open the store and subscribe to the topics
+  DDS::ReturnCode_t init(DDS::DomainParticipant_ptr dp);
+
+  void start();
+  void stop();
+
+  SeriesStore& store()
+  {
+    return store_;
+  }
+
+  void record(const tms::ac::MeasurementUpdate& mu, const std::string& topic, History::Time time);
+  void record(const tms::dc::MeasurementUpdate& mu, const std::string& topic, History::Time time);
+  void record(const tms::StorageUpdate& su, History::Time time);
+  void record(const tms::MetricParameterState& mps, History::Time time);
+
+  // The source timestamp of a sample, or now if it has none
+  static History::Time sample_time(const DDS::SampleInfo& si);
+
+  static History::Time to_time(TimePoint tp);
+
+private:
+  using SeriesIds = std::vector<SeriesStore::SeriesId>;
+
+  // Series of the quantities under a prefix, created on first use
+  const SeriesIds& series(const std::string& prefix, const std::vector<const char*>& quantities);
+
+  void log_stats() const;
+
+  void timer_fired(Timer<FlushHistoryEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  const Config config_;
+  SeriesStore store_;
+  DDS::Subscriber_var sub_;
+
+  SimpleMutex series_mutex_{"Historian::series"};
+  std::unordered_map<std::string, SeriesIds> series_;
+};
+
+#endif
@@ -0,0 +1,498 @@
+#include "SeriesStore.h"
+#include "Codec.h"
+
+#include <ace/Dirent.h>
+#include <ace/OS_NS_sys_stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace History;
+
+namespace {
+
+constexpr size_t align8(size_t n)
+{
+  return (n + 7) & ~static_cast<size_t>(7);
+}
+
+// Aggregates the points and blocks of consecutive buckets in time order
+class BucketAccumulator {
+public:
+  BucketAccumulator(Time from, Time width, std::vector<Bucket>& out)
+    : from_(from)
+    , width_(width)
+    , out_(out)
+  {
+  }
+
+  int64_t index(Time time) const
+  {
+    return (time - from_) / width_;
+  }
+
+  void add(int64_t index, float min, float max, double sum, uint64_t count)
+  {
+    if (index != index_) {
+      finish();
+      index_ = index;
+      min_ = min;
+      max_ = max;
+    } else {
+      min_ = std::min(min_, min);
+      max_ = std::max(max_, max);
+    }
+    sum_ += sum;
+    count_ += count;
+  }
+
+  void finish()
+  {
+    if (count_) {
+      Bucket bucket;
+      bucket.time = from_ + index_ * width_;
+      bucket.min = min_;
+      bucket.max = max_;
+      bucket.mean = static_cast<float>(sum_ / count_);
+      bucket.count = count_;
+      out_.push_back(bucket);
+    }
+    sum_ = 0.0;
+    count_ = 0;
+  }
+
+private:
+  const Time from_;
+  const Time width_;
+  std::vector<Bucket>& out_;
+  int64_t index_ = -1;
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+  double sum_ = 0.0;
+  uint64_t count_ = 0;
+};
+
+}
+
+SeriesStore::SeriesStore(const Config& config)
+  : config_(config)
+{
+}
+
+SeriesStore::~SeriesStore()
+{
+  close();
+}
+
+std::string SeriesStore::segment_path(uint32_t number) const
+{
+  char name[32];
+  std::snprintf(name, sizeof name, "/segment-%06u.dat", number);
+  return config_.dir + name;
+}
+
+std::string SeriesStore::catalog_path() const
+{
+  return config_.dir + "/series.txt";
+}
+
+bool SeriesStore::open(bool read_only)
+{
+  SimpleGuard g(mutex_);
+  read_only_ = read_only;
+
+  if (!read_only_ && ACE_OS::mkdir(config_.dir.c_str()) == -1 && errno != EEXIST) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: SeriesStore::open: mkdir \"%C\" failed: %m\n", config_.dir.c_str()));
+    return false;
+  }
+
+  std::ifstream catalog(catalog_path());
+  std::string line;
+  while (std::getline(catalog, line)) {
+    std::istringstream fields(line);
+    SeriesId id;
+    std::string name;
+    if (fields >> id && fields.get() == ' ' && std::getline(fields, name) && !name.empty()) {
+      add_series(name, id);
+    }
+  }
+
+  // Segments are numbered in the order they were started
+  std::vector<uint32_t> numbers;
+  ACE_Dirent dir;
+  if (dir.open(ACE_TEXT_CHAR_TO_TCHAR(config_.dir.c_str())) == -1) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: SeriesStore::open: can't read directory \"%C\": %m\n",
+               config_.dir.c_str()));
+    return false;
+  }
+  for (ACE_DIRENT* entry = dir.read(); entry; entry = dir.read()) {
+    unsigned number;
+    char dot;
+    if (std::sscanf(ACE_TEXT_ALWAYS_CHAR(entry->d_name), "segment-%u%c", &number, &dot) == 2 && dot == '.') {
+      numbers.push_back(number);
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+
+  for (const uint32_t number : numbers) {
+    Segment segment;
+    segment.number = number;
+    if (!map_segment(segment, false)) {
+      continue;
+    }
+    scan_segment(segment);
+    segments_.push_back(std::move(segment));
+  }
+  stats_.segments = segments_.size();
+  return true;
+}
+
+bool SeriesStore::map_segment(Segment& segment, bool create)
+{
+  const std::string path = segment_path(segment.number);
+  segment.map.reset(new ACE_Mem_Map);
+  const int rc = read_only_ ?
+    segment.map->map(ACE_TEXT_CHAR_TO_TCHAR(path.c_str()), static_cast<size_t>(-1), O_RDONLY,
+                     ACE_DEFAULT_FILE_PERMS, PROT_READ, ACE_MAP_SHARED) :
+    segment.map->map(ACE_TEXT_CHAR_TO_TCHAR(path.c_str()), config_.segment_size, O_RDWR | (create ? O_CREAT : 0),
+                     ACE_DEFAULT_FILE_PERMS, PROT_RDWR, ACE_MAP_SHARED);
+  if (rc == -1 || !segment.map->addr()) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: SeriesStore::map_segment: can't map \"%C\": %m\n", path.c_str()));
+    segment.map.reset();
+    return false;
+  }
+  return true;
+}
+
+void SeriesStore::scan_segment(Segment& seg)
+{
+  const size_t size = seg.map->size();
+  size_t offset = 0;
+  while (offset + sizeof(BlockHeader) <= size) {
+    const BlockHeader* h = reinterpret_cast<const BlockHeader*>(seg.base() + offset);
+    if (h->magic != block_magic) {
+      break;
+    }
+    const size_t length = sizeof(BlockHeader) + align8(size_t(h->time_bytes) + h->value_bytes);
+    if (offset + length > size) {
+      break;
+    }
+    if (h->series < series_.size()) {
+      Series& series = series_[h->series];
+      series.blocks.push_back(BlockRef{seg.number, offset, h->first, h->last});
+      series.last = std::max(series.last, h->last);
+    }
+    ++stats_.blocks;
+    stats_.stored_points += h->count;
+    stats_.stored_bytes += size_t(h->time_bytes) + h->value_bytes;
+    offset += length;
+  }
+  seg.used = offset;
+}
+
+bool SeriesStore::start_segment()
+{
+  // Make room by removing the oldest segment and its blocks from the index
+  while (config_.max_segments && segments_.size() >= config_.max_segments) {
+    Segment& oldest = segments_.front();
+    for (Series& series : series_) {
+      while (!series.blocks.empty() && series.blocks.front().segment == oldest.number) {
+        const BlockHeader* h = header(series.blocks.front());
+        --stats_.blocks;
+        stats_.stored_points -= h->count;
+        stats_.stored_bytes -= size_t(h->time_bytes) + h->value_bytes;
+        series.blocks.pop_front();
+      }
+    }
+    oldest.map->remove();
+    segments_.pop_front();
+  }
+
+  Segment segment;
+  segment.number = segments_.empty() ? 1 : segments_.back().number + 1;
+  if (!map_segment(segment, true)) {
+    return false;
+  }
+  segments_.push_back(std::move(segment));
+  stats_.segments = segments_.size();
+  return true;
+}
+
+const SeriesStore::BlockHeader* SeriesStore::header(const BlockRef& ref) const
+{
+  // Blocks only refer to segments still mapped, which are ordered by number
+  const auto it = std::lower_bound(segments_.begin(), segments_.end(), ref.segment,
+                                   [](const Segment& segment, uint32_t number) { return segment.number < number; });
+  return reinterpret_cast<const BlockHeader*>(it->base() + ref.offset);
+}
+
+void SeriesStore::write_block(SeriesId id, Series& series)
+{
+  if (series.points.empty()) {
+    return;
+  }
+
+  BlockHeader h = {};
+  h.series = id;
+  h.count = static_cast<uint32_t>(series.points.size());
+  h.first = series.points.front().time;
+  h.last = series.points.back().time;
+  h.min = h.max = series.points.front().value;
+
+  times_buf_.clear();
+  values_buf_.clear();
+  Codec::TimeEncoder times(h.first);
+  Codec::ValueEncoder values;
+  for (const Point& p : series.points) {
+    times.add(times_buf_, p.time);
+    values.add(values_buf_, p.value);
+    h.min = std::min(h.min, p.value);
+    h.max = std::max(h.max, p.value);
+    h.sum += p.value;
+  }
+  h.time_bytes = static_cast<uint32_t>(times_buf_.size());
+  h.value_bytes = static_cast<uint32_t>(values_buf_.size());
+
+  const size_t length = sizeof(BlockHeader) + align8(times_buf_.size() + values_buf_.size());
+  if (length > config_.segment_size) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: SeriesStore::write_block: block of %B bytes for \"%C\" "
+               "doesn't fit in a segment\n", length, series.name.c_str()));
+    series.points.clear();
+    return;
+  }
+  if (segments_.empty() || segments_.back().used + length > config_.segment_size) {
+    if (!start_segment()) {
+      series.points.clear();
+      return;
+    }
+  }
+
+  // The columns go first and the magic number of the header last, so a reader
+  // in another process or after a crash never sees a partial block.
+  Segment& segment = segments_.back();
+  char* const block = segment.base() + segment.used;
+  std::copy(times_buf_.begin(), times_buf_.end(), block + sizeof(BlockHeader));
+  std::copy(values_buf_.begin(), values_buf_.end(), block + sizeof(BlockHeader) + times_buf_.size());
+  std::memcpy(block, &h, sizeof h);
+  std::atomic_thread_fence(std::memory_order_release);
+  *reinterpret_cast<volatile uint32_t*>(block) = block_magic;
+
+  series.blocks.push_back(BlockRef{segment.number, segment.used, h.first, h.last});
+  segment.used += length;
+  ++stats_.blocks;
+  stats_.stored_points += h.count;
+  stats_.stored_bytes += times_buf_.size() + values_buf_.size();
+  series.points.clear();
+}
+
+void SeriesStore::close()
+{
+  if (!read_only_) {
+    flush();
+  }
+}
+
+SeriesStore::SeriesId SeriesStore::add_series(const std::string& name, SeriesId id)
+{
+  if (id >= series_.size()) {
+    series_.resize(id + 1);
+  }
+  series_[id].name = name;
+  series_[id].points.reserve(config_.block_points);
+  ids_[name] = id;
+  stats_.series = ids_.size();
+  return id;
+}
+
+SeriesStore::SeriesId SeriesStore::series(const std::string& name)
+{
+  SimpleGuard g(mutex_);
+  const auto it = ids_.find(name);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+
+  const SeriesId id = add_series(name, static_cast<SeriesId>(series_.size()));
+  if (!read_only_) {
+    std::ofstream catalog(catalog_path(), std::ios::app);
+    catalog << id << ' ' << name << '\n';
+    if (!catalog) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: SeriesStore::series: can't add \"%C\" to the catalog\n",
+                 name.c_str()));
+    }
+  }
+  return id;
+}
+
+bool SeriesStore::find(const std::string& name, SeriesId& id) const
+{
+  SimpleGuard g(mutex_);
+  const auto it = ids_.find(name);
+  if (it == ids_.end()) {
+    return false;
+  }
+  id = it->second;
+  return true;
+}
+
+std::vector<std::string> SeriesStore::series_names() const
+{
+  std::vector<std::string> names;
+  SimpleGuard g(mutex_);
+  names.reserve(ids_.size());
+  for (const auto& pair : ids_) {
+    names.push_back(pair.first);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+void SeriesStore::append(SeriesId id, Time time, float value)
+{
+  SimpleGuard g(mutex_);
+  if (read_only_ || id >= series_.size()) {
+    return;
+  }
+
+  // Blocks are indexed by time, so each series only goes forward
+  Series& series = series_[id];
+  if (time < series.last) {
+    ++stats_.dropped;
+    return;
+  }
+  series.points.push_back(Point{time, value});
+  series.last = time;
+  ++stats_.points;
+  if (series.points.size() >= config_.block_points) {
+    write_block(id, series);
+  }
+}
+
+void SeriesStore::flush(Time cutoff)
+{
+  SimpleGuard g(mutex_);
+  if (read_only_) {
+    return;
+  }
+  for (SeriesId id = 0; id < series_.size(); ++id) {
+    Series& series = series_[id];
+    if (!series.points.empty() && series.points.front().time < cutoff) {
+      write_block(id, series);
+    }
+  }
+  if (!segments_.empty()) {
+    segments_.back().map->sync();
+  }
+}
+
+void SeriesStore::decode(const BlockRef& ref, Time from, Time to, std::vector<Point>& out) const
+{
+  const BlockHeader* h = header(ref);
+  const uint8_t* times = reinterpret_cast<const uint8_t*>(h + 1);
+  const uint8_t* const times_end = times + h->time_bytes;
+  const uint8_t* values = times_end;
+  const uint8_t* const values_end = values + h->value_bytes;
+
+  Codec::TimeDecoder time_decoder(h->first);
+  Codec::ValueDecoder value_decoder;
+  for (uint32_t i = 0; i < h->count; ++i) {
+    Point p;
+    if (!time_decoder.next(times, times_end, p.time) || !value_decoder.next(values, values_end, p.value)) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: SeriesStore::decode: block at %B of segment %u is corrupt\n",
+                 ref.offset, ref.segment));
+      return;
+    }
+    if (p.time >= to) {
+      return;
+    }
+    if (p.time >= from) {
+      out.push_back(p);
+    }
+  }
+}
+
+std::vector<Point> SeriesStore::range(SeriesId id, Time from, Time to) const
+{
+  std::vector<Point> points;
+  SimpleGuard g(mutex_);
+  if (id >= series_.size()) {
+    return points;
+  }
+
+  const Series& series = series_[id];
+  auto it = std::partition_point(series.blocks.begin(), series.blocks.end(),
+                                 [from](const BlockRef& ref) { return ref.last < from; });
+  for (; it != series.blocks.end() && it->first < to; ++it) {
+    decode(*it, from, to, points);
+  }
+  for (const Point& p : series.points) {
+    if (p.time >= from && p.time < to) {
+      points.push_back(p);
+    }
+  }
+  return points;
+}
+
+std::vector<Bucket> SeriesStore::downsample(SeriesId id, Time from, Time to, Time width) const
+{
+  std::vector<Bucket> buckets;
+  SimpleGuard g(mutex_);
+  if (id >= series_.size() || width <= 0) {
+    return buckets;
+  }
+
+  const Series& series = series_[id];
+  Time first;
+  if (!series.blocks.empty()) {
+    first = series.blocks.front().first;
+  } else if (!series.points.empty()) {
+    first = series.points.front().time;
+  } else {
+    return buckets;
+  }
+
+  // Buckets are aligned to from, or to the epoch if the range is unbounded, but
+  // start at the one holding the first point so that the indexes can't overflow.
+  if (from == min_time) {
+    const Time offset = first % width;
+    from = first - (offset < 0 ? offset + width : offset);
+  } else if (first > from) {
+    const uint64_t offset = static_cast<uint64_t>(first) - static_cast<uint64_t>(from);
+    from = first - static_cast<Time>(offset % static_cast<uint64_t>(width));
+  }
+
+  BucketAccumulator acc(from, width, buckets);
+  std::vector<Point> points;
+  auto it = std::partition_point(series.blocks.begin(), series.blocks.end(),
+                                 [from](const BlockRef& ref) { return ref.last < from; });
+  for (; it != series.blocks.end() && it->first < to; ++it) {
+    // A block within the range and a single bucket needs only its header
+    if (it->first >= from && it->last < to && acc.index(it->first) == acc.index(it->last)) {
+      const BlockHeader* h = header(*it);
+      acc.add(acc.index(h->first), h->min, h->max, h->sum, h->count);
+      continue;
+    }
+    points.clear();
+    decode(*it, from, to, points);
+    for (const Point& p : points) {
+      acc.add(acc.index(p.time), p.value, p.value, p.value, 1);
+    }
+  }
+  for (const Point& p : series.points) {
+    if (p.time >= from && p.time < to) {
+      acc.add(acc.index(p.time), p.value, p.value, p.value, 1);
+    }
+  }
+  acc.finish();
+  return buckets;
+}
+
+SeriesStore::Stats SeriesStore::stats() const
+{
+  SimpleGuard g(mutex_);
+  return stats_;
+}
@@ -0,0 +1,192 @@
+#ifndef HISTORIAN_SERIES_STORE_H
+#define HISTORIAN_SERIES_STORE_H
+
+#include "TMS_Historian_export.h"
+
+#include <common/ProfiledMutex.h>
+
+#include <ace/Mem_Map.h>
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace History {
+
+// Times are in nanoseconds since the Unix epoch
+using Time = int64_t;
+
+constexpr Time min_time = std::numeric_limits<Time>::min();
+constexpr Time max_time = std::numeric_limits<Time>::max();
+
+struct Point {
+  Time time;
+  float value;
+};
+
+struct Bucket {
+  // Start of the bucket
+  Time time = 0;
+  float min = 0.0f;
+  float max = 0.0f;
+  float mean = 0.0f;
+  uint64_t count = 0;
+};
+
+}
+
+/**
+ * Append-only store of named series of float samples in a directory.
+ *
+ * Samples are kept per series in memory until they fill a block, which is
+ * then compressed with the Codec and appended to the current segment, a
+ * fixed-size file that is memory-mapped. A block starts with a header with
+ * the series, the time range and the min, max and sum of its values, and its
+ * time and value columns follow. The header is completed last, so a block cut
+ * short by a crash isn't read back. When the segment is full, a new one is
+ * started and the oldest ones beyond a limit are removed.
+ *
+ * The blocks of each series are indexed in memory by time, and the index is
+ * rebuilt by scanning the block headers when the store is opened. A range query
+ * only decodes the blocks that overlap the range, and a downsampled query uses
+ * the statistics of the header for the blocks that fall within a single bucket.
+ * The names of the series are appended to a catalog file as they're created.
+ */
+class TMS_Historian_Export SeriesStore {
+public:
+  struct Config {
+    std::string dir;
+    // Bytes of each segment file
+    size_t segment_size = 64 * 1024 * 1024;
+    // Segments kept, the oldest are removed beyond this. Unlimited if zero.
+    size_t max_segments = 16;
+    // Samples per block
+    size_t block_points = 1024;
+  };
+
+  struct Stats {
+    size_t series = 0;
+    size_t segments = 0;
+    uint64_t blocks = 0;
+    uint64_t points = 0;
+    // Points in blocks and compressed bytes of their columns
+    uint64_t stored_points = 0;
+    uint64_t stored_bytes = 0;
+    // Points older than the last of their series, which aren't stored
+    uint64_t dropped = 0;
+  };
+
+  using SeriesId = uint32_t;
+
+  explicit SeriesStore(const Config& config);
+  ~SeriesStore();
+
+  // Open the segments and catalog in the directory, creating it if writable
+  bool open(bool read_only = false);
+
+  // Write the points kept in memory to blocks and sync the current segment
+  void close();
+
+  bool read_only() const
+  {
+    return read_only_;
+  }
+
+  // Find or create a series
+  SeriesId series(const std::string& name);
+
+  bool find(const std::string& name, SeriesId& id) const;
+  std::vector<std::string> series_names() const;
+
+  void append(SeriesId id, History::Time time, float value);
+
+  // Write the points of series whose oldest point in memory is before the
+  // cutoff to blocks and sync the segment. Stores opened read-only only scan the
+  // blocks at open, so the points are visible to those opened afterwards.
+  void flush(History::Time cutoff = History::max_time);
+
+  // Points of a series in [from, to)
+  std::vector<History::Point> range(SeriesId id, History::Time from, History::Time to) const;
+
+  // Aggregates of a series in [from, to) over buckets of a width starting at from,
+  // or at multiples of the width if from is min_time, the empty ones left out
+  std::vector<History::Bucket> downsample(SeriesId id, History::Time from, History::Time to,
+                                            History::Time width) const;
+
+  Stats stats() const;
+
+private:
+  struct BlockHeader {
+    uint32_t magic;
+    SeriesId series;
+    uint32_t count;
+    uint32_t time_bytes;
+    uint32_t value_bytes;
+    uint32_t reserved;
+    History::Time first;
+    History::Time last;
+    float min;
+    float max;
+    double sum;
+  };
+
+  static constexpr uint32_t block_magic = 0x4b4c4254; // "TBLK"
+
+  struct Segment {
+    uint32_t number = 0;
+    std::unique_ptr<ACE_Mem_Map> map;
+    size_t used = 0;
+
+    char* base() const
+    {
+      return static_cast<char*>(map->addr());
+    }
+  };
+
+  struct BlockRef {
+    uint32_t segment;
+    size_t offset;
+    History::Time first;
+    History::Time last;
+  };
+
+  struct Series {
+    std::string name;
+    std::deque<BlockRef> blocks;
+    std::vector<History::Point> points;
+    History::Time last = History::min_time;
+  };
+
+  std::string segment_path(uint32_t number) const;
+  std::string catalog_path() const;
+
+  bool map_segment(Segment& segment, bool create);
+  void scan_segment(Segment& segment);
+  bool start_segment();
+
+  // Caller must hold mutex_
+  void write_block(SeriesId id, Series& series);
+  const BlockHeader* header(const BlockRef& ref) const;
+  void decode(const BlockRef& ref, History::Time from, History::Time to,
+              std::vector<History::Point>& out) const;
+  SeriesId add_series(const std::string& name, SeriesId id);
+
+  const Config config_;
+  bool read_only_ = false;
+
+  mutable SimpleMutex mutex_{"SeriesStore"};
+  std::vector<Series> series_;
+  std::unordered_map<std::string, SeriesId> ids_;
+  std::deque<Segment> segments_;
+  Stats stats_;
+
+  // Reused to encode the columns of a block
+  std::vector<uint8_t> times_buf_;
+  std::vector<uint8_t> values_buf_;
+};
+
+#endif
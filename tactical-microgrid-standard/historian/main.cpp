@@ -0,0 +1,172 @@
+#include "Historian.h"
+
+#include <common/Handshaking.h>
+
+#include <ace/Get_Opt.h>
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace {
+
+// Joins the domain for the historian and runs its reactor until interrupted
+class HistorianParticipant : public Handshaking {
+public:
+  explicit HistorianParticipant(const tms::Identity& id)
+    : Handshaking(id)
+  {
+  }
+
+  int run()
+  {
+    reactor_->register_handler(SIGINT, this);
+    return reactor_->run_reactor_event_loop() == 0 ? 0 : 1;
+  }
+
+  int handle_signal(int, siginfo_t*, ucontext_t*) override
+  {
+    reactor_->end_reactor_event_loop();
+    return -1;
+  }
+};
+
+// Seconds since the epoch, or before now if not positive
+History::Time parse_time(const char* arg)
+{
+  const double seconds = ACE_OS::strtod(arg, nullptr);
+  const History::Time t = static_cast<History::Time>(seconds * 1e9);
+  return seconds > 0 ? t : Historian::to_time(Clock::now()) + t;
+}
+
+void print_time(History::Time t)
+{
+  std::printf("%" PRId64 ".%09" PRId64, t / 1000000000, t % 1000000000);
+}
+
+int query(const SeriesStore::Config& config, const char* series, History::Time from, History::Time to,
+          double bucket)
+{
+  SeriesStore store(config);
+  if (!store.open(true)) {
+    return 1;
+  }
+
+  if (!series) {
+    for (const std::string& name : store.series_names()) {
+      std::printf("%s\n", name.c_str());
+    }
+    return 0;
+  }
+
+  SeriesStore::SeriesId id;
+  if (!store.find(series, id)) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: no series \"%C\" in \"%C\"\n", series, config.dir.c_str()));
+    return 1;
+  }
+
+  if (bucket > 0) {
+    std::printf("time,min,max,mean,count\n");
+    for (const History::Bucket& b : store.downsample(id, from, to, static_cast<History::Time>(bucket * 1e9))) {
+      print_time(b.time);
+      std::printf(",%g,%g,%g,%" PRIu64 "\n", b.min, b.max, b.mean, b.count);
+    }
+  } else {
+    std::printf("time,value\n");
+    for (const History::Point& p : store.range(id, from, to)) {
+      print_time(p.time);
+      std::printf(",%g\n", p.value);
+    }
+  }
+  return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
+  const char* historian_id = "historian";
+  Historian::Config config;
+  bool list = false;
+  const char* series = nullptr;
+  History::Time from = History::min_time;
+  History::Time to = History::max_time;
+  double bucket = 0;
+
+  ACE_Get_Opt get_opt(argc, argv, "d:i:o:F:ls:f:t:b:");
+  if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("dir", 'o', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("flush-period", 'F', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("list", 'l', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("series", 's', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("from", 'f', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("to", 't', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("bucket", 'b', ACE_Get_Opt::ARG_REQUIRED) != 0) {
+    return 1;
+  }
+
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'd':
+      domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
+      break;
+    case 'i':
+      historian_id = get_opt.opt_arg();
+      break;
+    case 'o':
+      config.store.dir = get_opt.opt_arg();
+      break;
+    case 'F':
+      config.flush_period = Sec(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'l':
+      list = true;
+      break;
+    case 's':
+      series = get_opt.opt_arg();
+      break;
+    case 'f':
+      from = parse_time(get_opt.opt_arg());
+      break;
+    case 't':
+      to = parse_time(get_opt.opt_arg());
+      break;
+    case 'b':
+      bucket = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    default:
+      break;
+    }
+  }
+
+  const bool record = domain_id != OpenDDS::DOMAIN_UNKNOWN;
+  if (config.store.dir.empty() || record == (list || series) || config.flush_period.count() <= 0) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -o Directory -d DDS_Domain_Id [-i Historian_Id] [-F Flush_Period_Sec]\n"
+               "       %C -o Directory -l\n"
+               "       %C -o Directory -s Series [-f From] [-t To] [-b Bucket_Sec]\n"
+               "  -d: record the measurement, storage and metric topics of the domain\n"
+               "  -l: list the recorded series\n"
+               "  -s: print the points of a series as CSV, or their aggregates over buckets with -b\n"
+               "  -f, -t: seconds since the epoch, or before now if negative\n", argv[0], argv[0], argv[0]));
+    return 1;
+  }
+
+  if (!record) {
+    return query(config.store, series, from, to, bucket);
+  }
+
+  HistorianParticipant participant(historian_id);
+  if (participant.join_domain(domain_id, argc, argv) != DDS::RETCODE_OK) {
+    return 1;
+  }
+  Historian historian(participant.get_reactor(), config);
+  if (historian.init(participant.get_domain_participant()) != DDS::RETCODE_OK) {
+    return 1;
+  }
+  historian.start();
+  const int status = participant.run();
+  historian.stop();
+  return status;
+}
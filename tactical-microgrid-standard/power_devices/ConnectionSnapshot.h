@@ -0,0 +1,110 @@
+#ifndef TMS_CONNECTION_SNAPSHOT_H
+#define TMS_CONNECTION_SNAPSHOT_H
+
+#include "PowerSimTypeSupportImpl.h"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Immutable set of the devices connected to a power device. A new snapshot is
+ * built each time the connections change and is shared with the readers, so
+ * they don't copy the connections or hold a lock while using them.
+ *
+ * Each connected device is interned to a small index, so checking whether a
+ * device is an input or on a power path is a hash lookup plus an array access
+ * instead of a scan comparing strings.
+ */
+class ConnectionSnapshot {
+public:
+  using Index = uint32_t;
+  static constexpr Index NONE = ~Index(0);
+
+  ConnectionSnapshot() = default;
+
+  ConnectionSnapshot(powersim::ConnectedDeviceSeq in, powersim::ConnectedDeviceSeq out)
+    : in_(std::move(in))
+    , out_(std::move(out))
+  {
+    for (const auto& dev : in_) {
+      is_input_[intern(dev.id())] = true;
+    }
+    out_index_.reserve(out_.size());
+    for (const auto& dev : out_) {
+      out_index_.push_back(intern(dev.id()));
+    }
+  }
+
+  // The index refers to the strings of this object, so it can't be copied.
+  ConnectionSnapshot(const ConnectionSnapshot&) = delete;
+  ConnectionSnapshot& operator=(const ConnectionSnapshot&) = delete;
+
+  const powersim::ConnectedDeviceSeq& in() const
+  {
+    return in_;
+  }
+
+  const powersim::ConnectedDeviceSeq& out() const
+  {
+    return out_;
+  }
+
+  bool empty() const
+  {
+    return in_.empty() && out_.empty();
+  }
+
+  // Number of distinct connected devices, i.e. the upper bound of the indexes
+  size_t size() const
+  {
+    return ids_.size();
+  }
+
+  // Index of a connected device, or NONE if the device isn't connected
+  Index index(const std::string& id) const
+  {
+    const auto it = index_.find(std::string_view(id));
+    return it == index_.end() ? NONE : it->second;
+  }
+
+  std::string_view id(Index index) const
+  {
+    return ids_[index];
+  }
+
+  bool is_input(Index index) const
+  {
+    return is_input_[index];
+  }
+
+  // Index of the i-th device of out()
+  Index out_index(size_t i) const
+  {
+    return out_index_[i];
+  }
+
+private:
+  Index intern(const std::string& id)
+  {
+    const auto it = index_.find(std::string_view(id));
+    if (it != index_.end()) {
+      return it->second;
+    }
+    const Index index = static_cast<Index>(ids_.size());
+    index_.emplace(std::string_view(id), index);
+    ids_.push_back(id);
+    is_input_.push_back(false);
+    return index;
+  }
+
+  const powersim::ConnectedDeviceSeq in_;
+  const powersim::ConnectedDeviceSeq out_;
+  std::unordered_map<std::string_view, Index> index_;
+  std::vector<std::string_view> ids_;
+  std::vector<bool> is_input_;
+  std::vector<Index> out_index_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TMS_CURRENT_METER_H
+#define TMS_CURRENT_METER_H
+
+#include "common/TimerHandler.h"
+#include "PowerSimTypeSupportImpl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+/**
+ * Measures the simulated current going through a power port. Each source
+ * sends its current as a stream of samples along each power path, so the
+ * current at a port is the sum of the latest amperage of every path that
+ * still carries samples. A path stops counting once it's been quiet for a few
+ * of its own sample intervals, e.g. when its source stops. Thread-safe.
+ */
+class CurrentMeter {
+public:
+  // A path is quiet after this many of its sample intervals without a sample
+  static constexpr double quiet_intervals = 3.0;
+
+  // Shortest time a path can be quiet, so jitter at high rates doesn't drop it
+  static constexpr Sec min_quiet{0.5};
+
+  // Time a path can be quiet until its interval is known
+  static constexpr Sec initial_quiet{3};
+
+  void add(const powersim::ElectricCurrent& ec, TimePoint now = Clock::now())
+  {
+    const uint64_t key = path_key(ec.power_path());
+    SimpleGuard guard(m_);
+    auto it = paths_.find(key);
+    if (it == paths_.end()) {
+      paths_.insert(std::make_pair(key, Path{ec.amperage(), now, initial_quiet}));
+      return;
+    }
+    Path& path = it->second;
+    // Samples that arrive together don't shrink it all at once
+    path.quiet = std::max({min_quiet, Sec(now - path.last) * quiet_intervals, path.quiet / 2});
+    path.amperage = ec.amperage();
+    path.last = now;
+  }
+
+  // Current at the port now, forgetting the paths that went quiet
+  float amperage(TimePoint now = Clock::now())
+  {
+    SimpleGuard guard(m_);
+    float sum = 0.0f;
+    for (auto it = paths_.begin(); it != paths_.end();) {
+      if (now - it->second.last > it->second.quiet) {
+        it = paths_.erase(it);
+      } else {
+        sum += it->second.amperage;
+        ++it;
+      }
+    }
+    return sum;
+  }
+
+private:
+  struct Path {
+    float amperage;
+    TimePoint last;
+    Sec quiet;
+  };
+
+  // Paths are told apart by a hash of their ids, so adding a sample doesn't allocate
+  static uint64_t path_key(const powersim::IdentitySeq& path)
+  {
+    uint64_t key = 0;
+    for (const tms::Identity& id : path) {
+      key ^= std::hash<tms::Identity>()(id) + 0x9e3779b97f4a7c15ull + (key << 6) + (key >> 2);
+    }
+    return key;
+  }
+
+  SimpleMutex m_{"CurrentMeter"};
+  std::unordered_map<uint64_t, Path> paths_;
+};
+
+#endif
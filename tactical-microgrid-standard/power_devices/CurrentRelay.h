@@ -0,0 +1,178 @@
+#ifndef TMS_CURRENT_RELAY_H
+#define TMS_CURRENT_RELAY_H
+
+#include "ConnectionSnapshot.h"
+
+#include <ace/Log_Msg.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Counters of the simulated current handled by a distribution device. The drop
+// counters going up steadily means the topology has a loop or a path that is
+// too long for the hop limit.
+struct RelayStats {
+  std::atomic<uint64_t> received{0};
+  std::atomic<uint64_t> relayed{0};
+  std::atomic<uint64_t> dropped_not_input{0};
+  std::atomic<uint64_t> dropped_loop{0};
+  std::atomic<uint64_t> dropped_hop_limit{0};
+  std::atomic<uint64_t> split_horizon{0};
+  std::atomic<uint64_t> no_output{0};
+};
+
+/**
+ * Relays simulated current from the input of a distribution device to its
+ * outputs without forming loops: current whose power path already contains
+ * this device is dropped, the power path can't grow past the hop limit, and
+ * current is never sent back to the device it came from (split horizon) or
+ * to any other device already on the path.
+ *
+ * The sample is relayed in place: its power path grows by one entry which is
+ * overwritten for each output, so relaying allocates nothing in the common
+ * case. The scratch state is reused across calls, so an instance must only be
+ * used by one thread at a time.
+ */
+class CurrentRelay {
+public:
+  // Default upper bound on the number of devices in a power path
+  static const size_t DEFAULT_MAX_HOPS = 32;
+
+  explicit CurrentRelay(const tms::Identity& id, size_t max_hops = DEFAULT_MAX_HOPS, bool verbose = false)
+    : id_(id)
+    , max_hops_(max_hops)
+    , verbose_(verbose)
+  {
+  }
+
+  size_t max_hops() const
+  {
+    return max_hops_;
+  }
+
+  const RelayStats& stats() const
+  {
+    return stats_;
+  }
+
+  // Relay ec, which is modified, to the outputs in conns. write is called with
+  // the sample for each output and returns whether it was written. Returns the
+  // number of outputs the sample was written to.
+  template <typename Write>
+  size_t relay(powersim::ElectricCurrent& ec, const ConnectionSnapshot& conns, Write&& write)
+  {
+    auto& power_path = ec.power_path();
+    const size_t length = power_path.size();
+    if (length < 2) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CurrentRelay::relay: Invalid power path (length %B)\n", length));
+      return 0;
+    }
+
+    // Check that the simulated current is for this device
+    if (power_path[length - 1] != id_) {
+      return 0;
+    }
+    ++stats_.received;
+
+    // Check that it comes from a device connected to an input power port
+    const ConnectionSnapshot::Index from = conns.index(power_path[length - 2]);
+    if (from == ConnectionSnapshot::NONE || !conns.is_input(from)) {
+      count_drop(stats_.dropped_not_input, "not from an input device");
+      return 0;
+    }
+
+    // A current that already went through this device has looped back to it.
+    // Also mark the connected devices it went through.
+    on_path_.assign(conns.size(), false);
+    for (size_t i = 0; i < length - 1; ++i) {
+      if (power_path[i] == id_) {
+        count_drop(stats_.dropped_loop, "power path loops back to this device");
+        return 0;
+      }
+      const ConnectionSnapshot::Index index = conns.index(power_path[i]);
+      if (index != ConnectionSnapshot::NONE) {
+        on_path_[index] = true;
+      }
+    }
+
+    // Relaying adds a device to the path, so that must stay within the hop limit.
+    if (length + 1 > max_hops_) {
+      count_drop(stats_.dropped_hop_limit, "power path would exceed the hop limit");
+      return 0;
+    }
+
+    targets_.clear();
+    for (size_t i = 0; i < conns.out().size(); ++i) {
+      const ConnectionSnapshot::Index index = conns.out_index(i);
+      if (index == from) {
+        ++stats_.split_horizon;
+      } else if (on_path_[index]) {
+        count_drop(stats_.dropped_loop, "output device is already on the power path");
+      } else {
+        targets_.push_back(i);
+      }
+    }
+    if (targets_.empty()) {
+      ++stats_.no_output;
+      return 0;
+    }
+
+    // For simulation purpose, we just split the amperage evenly over the output ports it goes to
+    const float out_amps = ec.amperage() / targets_.size();
+    ec.amperage(out_amps);
+    power_path.emplace_back();
+
+    size_t relayed = 0;
+    for (const size_t i : targets_) {
+      const tms::Identity& out_id = conns.out()[i].id();
+      ec.next_hop(out_id);
+      power_path.back() = out_id;
+      if (write(ec)) {
+        ++relayed;
+      }
+
+      if (verbose_) {
+        const std::string from_id(conns.id(from));
+        ACE_DEBUG((LM_DEBUG, "=== (%T) Relaying power from device \"%C\" to device \"%C\" -- %f Amps...\n",
+                   from_id.c_str(), out_id.c_str(), out_amps));
+      }
+    }
+    stats_.relayed += relayed;
+    return relayed;
+  }
+
+  void log_stats() const
+  {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: CurrentRelay::log_stats: \"%C\": "
+               "received %Q, relayed %Q, dropped %Q not from an input, %Q looping, %Q over %B hops, "
+               "%Q split horizon, %Q without output\n",
+               id_.c_str(), stats_.received.load(), stats_.relayed.load(),
+               stats_.dropped_not_input.load(), stats_.dropped_loop.load(),
+               stats_.dropped_hop_limit.load(), max_hops_,
+               stats_.split_horizon.load(), stats_.no_output.load()));
+  }
+
+private:
+  // Count a dropped sample and warn on the first one and then every time the
+  // count doubles, so a storm doesn't also flood the log.
+  static void count_drop(std::atomic<uint64_t>& counter, const char* reason)
+  {
+    const uint64_t count = ++counter;
+    if ((count & (count - 1)) == 0) {
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CurrentRelay::count_drop: "
+                 "dropped %Q electric current sample(s) so far: %C\n", count, reason));
+    }
+  }
+
+  const tms::Identity id_;
+  const size_t max_hops_;
+  const bool verbose_;
+  RelayStats stats_;
+
+  // Scratch state reused by relay()
+  std::vector<bool> on_path_;
+  std::vector<size_t> targets_;
+};
+
+#endif
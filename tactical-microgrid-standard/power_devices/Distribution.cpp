@@ -1,13 +1,17 @@
 #include "PowerDevice.h"
+#include "CurrentRelay.h"
+#include "CurrentMeter.h"
+#include "MeasurementPublisher.h"
 #include "PowerSimTypeSupportImpl.h"
 #include "common/DataReaderListenerBase.h"
+#include "common/Metrics.h"
+#include "common/MetricsExporter.h"
 #include "common/Utils.h"
 
 #include <dds/DCPS/Marked_Default_Qos.h>
 
 #include <ace/Get_Opt.h>
 
-
 class DistributionDevice;
 
 class ElectricCurrentDataReaderListenerImpl : public DataReaderListenerBase {
@@ -28,11 +32,20 @@ private:
 
 class DistributionDevice : public PowerDevice {
 public:
-  explicit DistributionDevice(const tms::Identity& id, bool verbose = false)
+  DistributionDevice(const tms::Identity& id, const MeasurementPublisher::Config& measurement_config,
+                     bool verbose = false, size_t max_hops = CurrentRelay::DEFAULT_MAX_HOPS)
     : PowerDevice(id, tms::DeviceRole::ROLE_DISTRIBUTION, verbose)
+    , relay_(id, max_hops, verbose)
+    , measurements_(id, reactor_, measurement_config, ports,
+                    [this](size_t port) { return port == in_port ? in_meter_.amperage() : out_meter_.amperage(); })
   {
   }
 
+  // The current received is metered on the first port and the current relayed on the second
+  static constexpr size_t in_port = 0;
+  static constexpr size_t out_port = 1;
+  static constexpr size_t ports = 2;
+
   DDS::ReturnCode_t init(DDS::DomainId_t domain_id, int argc = 0, char* argv[] = nullptr)
   {
     DDS::ReturnCode_t rc = PowerDevice::init(domain_id, argc, argv);
@@ -92,8 +105,14 @@ public:
       return DDS::RETCODE_ERROR;
     }
 
+    // Only receive the current addressed to this device
+    DDS::TopicDescription_var ec_topic_to_me = electric_current_to_me(ec_topic);
+    if (!ec_topic_to_me) {
+      return DDS::RETCODE_ERROR;
+    }
+
     DDS::DataReaderListener_var ec_listener(new ElectricCurrentDataReaderListenerImpl(*this));
-    DDS::DataReader_var ec_dr_base = sim_sub->create_datareader(ec_topic,
+    DDS::DataReader_var ec_dr_base = sim_sub->create_datareader(ec_topic_to_me,
                                                                 DATAREADER_QOS_DEFAULT,
                                                                 ec_listener,
                                                                 ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
@@ -103,7 +122,15 @@ public:
       return DDS::RETCODE_ERROR;
     }
 
-    return DDS::RETCODE_OK;;
+    return measurements_.init(get_domain_participant());
+  }
+
+  int run() override
+  {
+    measurements_.start();
+    const int ret = run_i();
+    measurements_.stop();
+    return ret;
   }
 
   powersim::ElectricCurrentDataWriter_var get_electric_current_data_writer() const
@@ -111,20 +138,38 @@ public:
     return ec_dw_;
   }
 
+  CurrentRelay& relay()
+  {
+    return relay_;
+  }
+
+  CurrentMeter& in_meter()
+  {
+    return in_meter_;
+  }
+
+  CurrentMeter& out_meter()
+  {
+    return out_meter_;
+  }
+
 private:
   tms::DeviceInfo populate_device_info() const override
   {
     auto device_info = get_device_info();
     device_info.role() = tms::DeviceRole::ROLE_DISTRIBUTION;
     device_info.product() = Utils::get_ProductInfo();
-    device_info.topics() = Utils::get_TopicInfo({}, {}, {});
+    device_info.topics() = Utils::get_TopicInfo(
+      measurements_.enabled() ? tms::TopicList{ measurements_.topic() } : tms::TopicList(), {}, {});
 
     tms::PowerDeviceInfo pdi;
     {
-      // Distribution has >= 2 ports. For this app, we don't use
-      // the power ports information, so we just create 2 identical ports here.
-      const tms::PowerPortInfo tmp_port;
-      pdi.powerPorts() = { tmp_port, tmp_port };
+      // Distribution has >= 2 ports. For this app, one port stands for all the
+      // inputs and the other for all the outputs, as far as metering goes.
+      pdi.powerPorts().resize(ports);
+      for (size_t i = 0; i < ports; ++i) {
+        measurements_.describe(pdi.powerPorts()[i], i);
+      }
       tms::DistributionInfo dist_info;
       {
         dist_info.features() = { tms::DistributionFeature::DISTF_FEEDER,
@@ -137,6 +182,10 @@ private:
   }
 
   powersim::ElectricCurrentDataWriter_var ec_dw_;
+  CurrentRelay relay_;
+  CurrentMeter in_meter_;
+  CurrentMeter out_meter_;
+  MeasurementPublisher measurements_;
 };
 
 void ElectricCurrentDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
@@ -157,57 +206,27 @@ void ElectricCurrentDataReaderListenerImpl::on_data_available(DDS::DataReader_pt
     return;
   }
 
-  const powersim::ConnectedDeviceSeq& connected_devices_in = dist_dev_.connected_devices_in();
-  const powersim::ConnectedDeviceSeq& connected_devices_out = dist_dev_.connected_devices_out();
+  // Relay each sample in place, using the same connections for the whole batch
+  const std::shared_ptr<const ConnectionSnapshot> connections = dist_dev_.connections();
+  const powersim::ElectricCurrentDataWriter_var writer = dist_dev_.get_electric_current_data_writer();
+  CurrentMeter& out_meter = dist_dev_.out_meter();
+  const auto write = [&writer, &out_meter](const powersim::ElectricCurrent& ec) {
+    const DDS::ReturnCode_t rc = writer->write(ec, DDS::HANDLE_NIL);
+    if (rc != DDS::RETCODE_OK) {
+      Metrics::instance().write_failed();
+      ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: ElectricCurrentDataReaderListenerImpl::on_data_available: "
+                 "write ElectricCurrent failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+      return false;
+    }
+    out_meter.add(ec);
+    return true;
+  };
 
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
-      const powersim::ElectricCurrent& ec = data[i];
-      const size_t length = ec.power_path().size();
-      if (length < 2) {
-        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: ElectricCurrentDataReaderListenerImpl::on_data_available: Invalid power path (length %u)\n", length));
-        continue;
-      }
-
-      const tms::Identity& from = ec.power_path()[length - 2];
-      const tms::Identity& to = ec.power_path()[length - 1];
-
-      // Check that the simulated current is for this device
-      if (to != dist_dev_.get_device_id()) {
-        continue;
-      }
-
-      // Check that it comes from a device connected to an input power port
-      bool found_in_dev = false;
-      for (const auto& in_dev : connected_devices_in) {
-        if (in_dev.id() == from) {
-          found_in_dev = true;
-          break;
-        }
-      }
-      if (!found_in_dev) {
-        continue;
-      }
-
-      // For simulation purpose, we just split the amperage evenly over all output ports
-      const auto out_amps = ec.amperage() / connected_devices_out.size();
-
-      // Relay to all devices connected to the output power ports
-      for (const auto& out_dev : connected_devices_out) {
-        powersim::ElectricCurrent relay_ec = ec;
-        relay_ec.power_path().push_back(out_dev.id());
-        relay_ec.amperage() = out_amps;
-        const DDS::ReturnCode_t rc = dist_dev_.get_electric_current_data_writer()->write(relay_ec, DDS::HANDLE_NIL);
-        if (rc != DDS::RETCODE_OK) {
-          ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: ElectricCurrentDataReaderListenerImpl::on_data_available: "
-                     "write ElectricCurrent failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
-        }
-
-        if (dist_dev_.verbose()) {
-          ACE_DEBUG((LM_DEBUG, "=== (%T) Relaying power from device \"%C\" to device \"%C\" -- %f Amps...\n",
-                     from.c_str(), out_dev.id().c_str(), out_amps));
-        }
-      }
+      // Metered before relaying, which changes the sample
+      dist_dev_.in_meter().add(data[i]);
+      dist_dev_.relay().relay(data[i], *connections, write);
     }
   }
 }
@@ -217,11 +236,19 @@ int main(int argc, char* argv[])
   DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
   const char* dist_id = nullptr;
   bool verbose = false;
+  size_t max_hops = CurrentRelay::DEFAULT_MAX_HOPS;
+  MeasurementPublisher::Config measurement_config;
+  int metrics_port = -1;
 
-  ACE_Get_Opt get_opt(argc, argv, "d:i:v");
+  ACE_Get_Opt get_opt(argc, argv, "d:i:m:M:V:DvE:");
   if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
       get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
-      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0) {
+      get_opt.long_option("max-hops", 'm', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("measurement-rate", 'M', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("voltage", 'V', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("dc", 'D', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("metrics-port", 'E', ACE_Get_Opt::ARG_REQUIRED) != 0) {
     return 1;
   }
 
@@ -234,22 +261,48 @@ int main(int argc, char* argv[])
     case 'd':
       domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
       break;
+    case 'm':
+      max_hops = static_cast<size_t>(ACE_OS::atoi(get_opt.opt_arg()));
+      break;
+    case 'M':
+      measurement_config.rate = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'V':
+      measurement_config.voltage = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'D':
+      measurement_config.dc = true;
+      break;
     case 'v':
       verbose = true;
       break;
+    case 'E':
+      metrics_port = ACE_OS::atoi(get_opt.opt_arg());
+      break;
     default:
       break;
     }
   }
 
-  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || dist_id == nullptr) {
-    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Distribution_Device_Id [-v]\n", argv[0]));
+  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || dist_id == nullptr || max_hops < 2 ||
+      measurement_config.rate < 0 || measurement_config.voltage < 0 || metrics_port > 65535) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Distribution_Device_Id [-m Max_Hops (>= 2)] "
+               "[-M Measurements_Per_Second] [-V Voltage] [-D] [-v] [-E Metrics_Port]\n"
+               "  -M: rate of the measurement updates, 0 for none (default 1)\n"
+               "  -D: measure DC ports instead of AC ones\n"
+               "  -E: serve Prometheus metrics at http://127.0.0.1:Metrics_Port/metrics\n", argv[0]));
     return 1;
   }
 
-  DistributionDevice dist_dev(dist_id, verbose);
+  DistributionDevice dist_dev(dist_id, measurement_config, verbose, max_hops);
   if (dist_dev.init(domain_id, argc, argv) != DDS::RETCODE_OK) {
     return 1;
   }
-  return dist_dev.run();
+  MetricsExporter exporter(dist_id);
+  if (metrics_port >= 0 && !exporter.start(static_cast<u_short>(metrics_port))) {
+    return 1;
+  }
+  const int ret = dist_dev.run();
+  dist_dev.relay().log_stats();
+  return ret;
 }
@@ -1,6 +1,7 @@
 #include "EnergyStartStopRequestDataReaderListenerImpl.h"
 #include "PowerDevice.h"
 
+#include <common/Metrics.h>
 #include <common/mil-std-3071_data_modelTypeSupportImpl.h>
 
 
@@ -17,6 +18,8 @@ void EnergyStartStopRequestDataReaderListenerImpl::on_data_available(DDS::DataRe
     return;
   }
 
+  record_queue_depth(data.length());
+
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const tms::EnergyStartStopRequest& essr = data[i];
@@ -43,6 +46,7 @@ void EnergyStartStopRequestDataReaderListenerImpl::on_data_available(DDS::DataRe
 
         const DDS::ReturnCode_t rc = power_device_.reply_dw()->write(reply, DDS::HANDLE_NIL);
         if (rc != DDS::RETCODE_OK) {
+          Metrics::instance().write_failed();
           ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: EnergyStartStopRequestDataReaderListenerImpl::on_data_available: "
                      "write reply failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
         }
@@ -1,6 +1,10 @@
 #include "PowerDevice.h"
+#include "ProfilePlayer.h"
+#include "CurrentMeter.h"
+#include "MeasurementPublisher.h"
 #include "PowerSimTypeSupportImpl.h"
 #include "common/DataReaderListenerBase.h"
+#include "common/MetricsExporter.h"
 #include "common/Utils.h"
 
 #include <dds/DCPS/Marked_Default_Qos.h>
@@ -27,11 +31,18 @@ private:
 
 class LoadDevice : public PowerDevice {
 public:
-  explicit LoadDevice(const tms::Identity& id, bool verbose = false)
+  LoadDevice(const tms::Identity& id, const MeasurementPublisher::Config& measurement_config,
+             float max_power = default_max_power, const ProfilePlayer* profile = nullptr, bool verbose = false)
     : PowerDevice(id, tms::DeviceRole::ROLE_LOAD, verbose)
+    , max_power_(max_power)
+    , profile_(profile)
+    , measurements_(id, reactor_, measurement_config, 1, [this](size_t) { return meter_.amperage(); })
   {
   }
 
+  // Default rated power demand in W
+  static constexpr float default_max_power = 1000.0f;
+
   DDS::ReturnCode_t init(DDS::DomainId_t domain_id, int argc = 0, char* argv[] = nullptr)
   {
     DDS::ReturnCode_t rc = PowerDevice::init(domain_id, argc, argv);
@@ -66,8 +77,14 @@ public:
       return DDS::RETCODE_ERROR;
     }
 
+    // Only receive the current addressed to this device
+    DDS::TopicDescription_var ec_topic_to_me = electric_current_to_me(ec_topic);
+    if (!ec_topic_to_me) {
+      return DDS::RETCODE_ERROR;
+    }
+
     DDS::DataReaderListener_var ec_listener(new ElectricCurrentDataReaderListenerImpl(*this));
-    DDS::DataReader_var ec_dr_base = sim_sub->create_datareader(ec_topic,
+    DDS::DataReader_var ec_dr_base = sim_sub->create_datareader(ec_topic_to_me,
                                                                 DATAREADER_QOS_DEFAULT,
                                                                 ec_listener.in(),
                                                                 ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
@@ -76,7 +93,15 @@ public:
                  powersim::TOPIC_ELECTRIC_CURRENT.c_str()));
       return DDS::RETCODE_ERROR;
     }
-    return DDS::RETCODE_OK;
+    return measurements_.init(get_domain_participant());
+  }
+
+  int run() override
+  {
+    measurements_.start();
+    const int ret = run_i();
+    measurements_.stop();
+    return ret;
   }
 
   tms::Identity connected_dev_id() const
@@ -88,21 +113,37 @@ public:
     return connected_devs[0].id();
   }
 
+  // Current the load demands now according to its profile, if it has one
+  std::optional<float> demand() const
+  {
+    return profile_ ? profile_->value() : std::nullopt;
+  }
+
+  // Current the load receives through its port
+  CurrentMeter& meter()
+  {
+    return meter_;
+  }
+
 private:
   tms::DeviceInfo populate_device_info() const override
   {
     auto device_info = get_device_info();
     device_info.role() = tms::DeviceRole::ROLE_LOAD;
     device_info.product() = Utils::get_ProductInfo();
-    device_info.topics() = Utils::get_TopicInfo({}, {}, {});
+    device_info.topics() = Utils::get_TopicInfo(
+      measurements_.enabled() ? tms::TopicList{ measurements_.topic() } : tms::TopicList(), {}, {});
 
     tms::PowerDeviceInfo pdi;
     {
-      pdi.powerPorts() = { tms::PowerPortInfo() };
+      tms::PowerPortInfo port;
+      measurements_.describe(port, 0);
+      pdi.powerPorts() = { port };
       tms::LoadInfo load_info;
       {
         // Pick a feature for the demo purpose.
         load_info.features() = { tms::LoadFeature::LOADF_DEMAND_RESPONSE };
+        load_info.maxRealPower() = max_power_;
       }
       pdi.load() = load_info;
     }
@@ -111,6 +152,10 @@ private:
   }
 
   tms::EnergyStartStopLevel essl_ = tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
+  const float max_power_;
+  const ProfilePlayer* const profile_;
+  CurrentMeter meter_;
+  MeasurementPublisher measurements_;
 };
 
 void ElectricCurrentDataReaderListenerImpl::on_data_available(DDS::DataReader_ptr reader)
@@ -131,6 +176,9 @@ void ElectricCurrentDataReaderListenerImpl::on_data_available(DDS::DataReader_pt
     return;
   }
 
+  // Meter all the current received, but only log it once per batch
+  const tms::Identity connected_dev_id = load_dev_.connected_dev_id();
+  bool logged = false;
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const powersim::ElectricCurrent& ec = data[i];
@@ -144,11 +192,18 @@ void ElectricCurrentDataReaderListenerImpl::on_data_available(DDS::DataReader_pt
       const tms::Identity& from = power_path[path_length - 2];
       const tms::Identity& to = power_path[path_length - 1];
 
-      if (from == load_dev_.connected_dev_id() && to == load_dev_.get_device_id()) {
-        if (load_dev_.verbose()) {
-          ACE_DEBUG((LM_INFO, "=== (%T) Receiving power from \"%C\" -- %f Amps...\n", from.c_str(), ec.amperage()));
+      if (from == connected_dev_id && to == load_dev_.get_device_id()) {
+        load_dev_.meter().add(ec);
+        if (load_dev_.verbose() && !logged) {
+          logged = true;
+          const std::optional<float> demand = load_dev_.demand();
+          if (demand) {
+            ACE_DEBUG((LM_INFO, "=== (%T) Receiving power from \"%C\" -- %f Amps of %f Amps demanded...\n",
+                       from.c_str(), ec.amperage(), *demand));
+          } else {
+            ACE_DEBUG((LM_INFO, "=== (%T) Receiving power from \"%C\" -- %f Amps...\n", from.c_str(), ec.amperage()));
+          }
         }
-        break;
       }
     }
   }
@@ -159,11 +214,24 @@ int main(int argc, char* argv[])
   DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
   const char* load_id = nullptr;
   bool verbose = false;
+  float max_power = LoadDevice::default_max_power;
+  ProfilePlayer::Config profile_config;
+  MeasurementPublisher::Config measurement_config;
+  int metrics_port = -1;
 
-  ACE_Get_Opt get_opt(argc, argv, "d:i:v");
+  ACE_Get_Opt get_opt(argc, argv, "d:i:P:f:c:S:oM:V:DvE:");
   if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
       get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
-      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0) {
+      get_opt.long_option("max-power", 'P', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile", 'f', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-column", 'c', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-speed", 'S', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-once", 'o', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("measurement-rate", 'M', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("voltage", 'V', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("dc", 'D', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("metrics-port", 'E', ACE_Get_Opt::ARG_REQUIRED) != 0) {
     return 1;
   }
 
@@ -176,22 +244,67 @@ int main(int argc, char* argv[])
     case 'd':
       domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
       break;
+    case 'P':
+      max_power = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'f':
+      profile_config.path = get_opt.opt_arg();
+      break;
+    case 'c':
+      profile_config.column = get_opt.opt_arg();
+      break;
+    case 'S':
+      profile_config.speed = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'o':
+      profile_config.loop = false;
+      break;
+    case 'M':
+      measurement_config.rate = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'V':
+      measurement_config.voltage = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'D':
+      measurement_config.dc = true;
+      break;
     case 'v':
       verbose = true;
       break;
+    case 'E':
+      metrics_port = ACE_OS::atoi(get_opt.opt_arg());
+      break;
     default:
       break;
     }
   }
 
-  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || load_id == nullptr) {
-    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Load_Device_Id [-v]\n", argv[0]));
+  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || load_id == nullptr || max_power <= 0 ||
+      measurement_config.rate < 0 || measurement_config.voltage < 0 || metrics_port > 65535) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Load_Device_Id [-P Max_Power_Watts] "
+               "[-f Profile_File [-c Profile_Column] [-S Profile_Speed] [-o]] "
+               "[-M Measurements_Per_Second] [-V Voltage] [-D] [-v] [-E Metrics_Port]\n"
+               "  -f: take the demanded current from the column of the device in the profile\n"
+               "  -o: play the profile once instead of in a loop\n"
+               "  -M: rate of the measurement updates, 0 for none (default 1)\n"
+               "  -D: measure a DC port instead of an AC one\n"
+               "  -E: serve Prometheus metrics at http://127.0.0.1:Metrics_Port/metrics\n", argv[0]));
+    return 1;
+  }
+
+  ProfilePlayer profile;
+  if (!profile_config.path.empty() && !profile.open(profile_config, load_id)) {
     return 1;
   }
 
-  LoadDevice load_dev(load_id, verbose);
+  LoadDevice load_dev(load_id, measurement_config, max_power, profile.is_open() ? &profile : nullptr, verbose);
   if (load_dev.init(domain_id, argc, argv) != DDS::RETCODE_OK) {
     return 1;
   }
+  MetricsExporter exporter(load_id);
+  if (metrics_port >= 0 && !exporter.start(static_cast<u_short>(metrics_port))) {
+    return 1;
+  }
+  profile.start();
   return load_dev.run();
 }
@@ -0,0 +1,274 @@
+#include "MeasurementPublisher.h"
+#include "common/Metrics.h"
+#include "common/QosHelper.h"
+
+#include <dds/DCPS/Marked_Default_Qos.h>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+
+template <typename Update>
+DDS::DataWriter_var create_writer(DDS::DomainParticipant_ptr dp, DDS::Publisher_ptr pub,
+                                  const std::string& topic_name, const tms::Identity& device_id)
+{
+  using TypeSupportImpl = typename OpenDDS::DCPS::DDSTraits<Update>::TypeSupportImplType;
+
+  typename TypeSupportImpl::_var_type ts = new TypeSupportImpl;
+  if (DDS::RETCODE_OK != ts->register_type(dp, "")) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementPublisher::init: register_type for \"%C\" failed\n",
+               topic_name.c_str()));
+    return nullptr;
+  }
+
+  CORBA::String_var type_name = ts->get_type_name();
+  DDS::Topic_var topic = dp->create_topic(topic_name.c_str(),
+                                          type_name,
+                                          TOPIC_QOS_DEFAULT,
+                                          nullptr,
+                                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementPublisher::init: create_topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return nullptr;
+  }
+
+  const DDS::DataWriterQos& dw_qos = Qos::DataWriter::fn_map.at(topic_name)(device_id);
+  DDS::DataWriter_var dw = pub->create_datawriter(topic,
+                                                  dw_qos,
+                                                  nullptr,
+                                                  ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!dw) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementPublisher::init: create_datawriter for topic \"%C\" failed\n",
+               topic_name.c_str()));
+  }
+  return dw;
+}
+
+tms::ClockMonotonic to_clock_monotonic(std::chrono::steady_clock::time_point t)
+{
+  using namespace std::chrono;
+  const auto since_epoch = t.time_since_epoch();
+  const seconds s = duration_cast<seconds>(since_epoch);
+  tms::ClockMonotonic cm;
+  cm.seconds(static_cast<uint32_t>(s.count()));
+  cm.nanoseconds(static_cast<uint32_t>(duration_cast<nanoseconds>(since_epoch - s).count()));
+  return cm;
+}
+
+}
+
+MeasurementPublisher::MeasurementPublisher(const tms::Identity& device_id, ACE_Reactor* reactor,
+                                           const Config& config, size_t ports, Reader reader)
+  : TimerHandler(reactor, "MeasurementPublisher")
+  , device_id_(device_id)
+  , config_(config)
+  , reader_(reader)
+  , previous_(ports, 0.0f)
+  , readings_(ports, 0.0f)
+  , ports_(ports)
+{
+  if (config_.voltage <= 0) {
+    config_.voltage = config_.dc ? default_dc_voltage : default_ac_voltage;
+  }
+
+  // Each port has a single-phase AC line or the two lines of a 2-wire DC circuit
+  if (config_.dc) {
+    dc_update_.deviceId(device_id);
+    dc_update_.internalMeasurement().resize(ports);
+    for (size_t i = 0; i < ports; ++i) {
+      dc_update_.internalMeasurement()[i].portNumber(static_cast<tms::PowerPortNumber>(i + 1));
+      dc_update_.internalMeasurement()[i].line().resize(2);
+    }
+  } else {
+    ac_update_.deviceId(device_id);
+    ac_update_.internalMeasurement().resize(ports);
+    for (size_t i = 0; i < ports; ++i) {
+      ac_update_.internalMeasurement()[i].portNumber(static_cast<tms::PowerPortNumber>(i + 1));
+      ac_update_.internalMeasurement()[i].line().resize(1);
+    }
+  }
+}
+
+MeasurementPublisher::~MeasurementPublisher()
+{
+  stop();
+}
+
+const std::string& MeasurementPublisher::topic() const
+{
+  return config_.dc ? tms::topic::TOPIC_DC_MEASUREMENT_UPDATE : tms::topic::TOPIC_AC_MEASUREMENT_UPDATE;
+}
+
+DDS::ReturnCode_t MeasurementPublisher::init(DDS::DomainParticipant_ptr dp)
+{
+  if (!enabled()) {
+    return DDS::RETCODE_OK;
+  }
+
+  Guard g(lock_);
+  const DDS::PublisherQos pub_qos = Qos::Publisher::get_qos();
+  pub_ = dp->create_publisher(pub_qos, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!pub_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementPublisher::init: create_publisher with TMS QoS failed\n"));
+    return DDS::RETCODE_ERROR;
+  }
+
+  if (config_.dc) {
+    DDS::DataWriter_var dw = create_writer<tms::dc::MeasurementUpdate>(dp, pub_, topic(), device_id_);
+    dc_dw_ = tms::dc::MeasurementUpdateDataWriter::_narrow(dw);
+  } else {
+    DDS::DataWriter_var dw = create_writer<tms::ac::MeasurementUpdate>(dp, pub_, topic(), device_id_);
+    ac_dw_ = tms::ac::MeasurementUpdateDataWriter::_narrow(dw);
+  }
+  if (!ac_dw_ && !dc_dw_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: MeasurementPublisher::init: no data writer for \"%C\"\n",
+               topic().c_str()));
+    return DDS::RETCODE_ERROR;
+  }
+  return DDS::RETCODE_OK;
+}
+
+void MeasurementPublisher::describe(tms::PowerPortInfo& port, size_t index) const
+{
+  port.portNumber(static_cast<tms::PowerPortNumber>(index + 1));
+  port.wiring(config_.dc ? tms::CircuitWiring::WIRING_DC : tms::CircuitWiring::WIRING_AC_SINGLE);
+  port.hasInternalMeter(enabled());
+}
+
+void MeasurementPublisher::start()
+{
+  Guard g(lock_);
+  if (!enabled() || get_timer<PublishMeasurementEvent>()->active()) {
+    return;
+  }
+  last_tick_ = last_update_ = Steady::now();
+  pacer_.start(config_.rate, last_tick_);
+  for (size_t i = 0; i < readings_.size(); ++i) {
+    readings_[i] = reader_(i);
+    ports_[i] = PortState();
+  }
+  schedule(PublishMeasurementEvent(), pacer_.tick_period());
+}
+
+void MeasurementPublisher::stop()
+{
+  Guard g(lock_);
+  if (!get_timer<PublishMeasurementEvent>()->active()) {
+    return;
+  }
+  cancel<PublishMeasurementEvent>();
+  report();
+}
+
+void MeasurementPublisher::report() const
+{
+  Guard g(lock_);
+  pacer_.report("MeasurementPublisher", "\"" + device_id_ + "\" " + topic());
+}
+
+void MeasurementPublisher::measure_ac(tms::ac::PowerPortMeasurement& ppm, PortState& state,
+                                      float amperage, double dt) const
+{
+  const float phase_offset = std::acos(config_.power_factor);
+  const float apparent_power = config_.voltage * amperage;
+  const float real_power = apparent_power * config_.power_factor;
+  const float reactive_power = apparent_power * std::sin(phase_offset);
+
+  tms::ac::PowerLineMeasurement& line = ppm.line()[0];
+  line.voltage(config_.voltage);
+  line.frequency(ac_frequency);
+  line.amperage(amperage);
+  line.phaseOffset(phase_offset);
+  line.realPower(real_power);
+  line.reactivePower(reactive_power);
+  ppm.realPowerRateOfChange(dt > 0 ? static_cast<float>((real_power - state.real_power) / dt) : 0.0f);
+  ppm.reactivePowerRateOfChange(dt > 0 ? static_cast<float>((reactive_power - state.reactive_power) / dt) : 0.0f);
+
+  state.real_power = real_power;
+  state.reactive_power = reactive_power;
+}
+
+void MeasurementPublisher::measure_dc(tms::dc::PowerPortMeasurement& ppm, PortState& state,
+                                      float amperage, double dt) const
+{
+  // The current returns on the negative line, which is at 0 V
+  const float power = config_.voltage * amperage;
+  tms::dc::PowerLineMeasurement& positive = ppm.line()[0];
+  positive.voltage(config_.voltage);
+  positive.amperage(amperage);
+  positive.power(power);
+  tms::dc::PowerLineMeasurement& negative = ppm.line()[1];
+  negative.voltage(0.0f);
+  negative.amperage(-amperage);
+  negative.power(0.0f);
+  ppm.powerRateOfChange(dt > 0 ? static_cast<float>((power - state.real_power) / dt) : 0.0f);
+
+  state.real_power = power;
+}
+
+template <typename Update, typename DataWriter>
+void MeasurementPublisher::write(Update& update, DataWriter* dw, uint64_t count, Steady::time_point now)
+{
+  const auto since_last_tick = now - last_tick_;
+
+  PublicationBatch batch(pub_, count);
+  for (uint64_t k = 1; k <= count; ++k) {
+    const double fraction = static_cast<double>(k) / count;
+    const Steady::time_point t = last_tick_ + std::chrono::duration_cast<Steady::duration>(since_last_tick * fraction);
+    // The first update after starting has nothing to change from
+    const double dt = pacer_.written() > 0 ? Sec(t - last_update_).count() : 0.0;
+    update.timeMeasured(to_clock_monotonic(t));
+
+    auto& measurements = update.internalMeasurement();
+    for (size_t i = 0; i < measurements.size(); ++i) {
+      const float amperage = static_cast<float>(previous_[i] + (readings_[i] - previous_[i]) * fraction);
+      if constexpr (std::is_same_v<Update, tms::dc::MeasurementUpdate>) {
+        measure_dc(measurements[i], ports_[i], amperage, dt);
+      } else {
+        measure_ac(measurements[i], ports_[i], amperage, dt);
+      }
+    }
+    last_update_ = t;
+
+    const DDS::ReturnCode_t rc = dw->write(update, DDS::HANDLE_NIL);
+    if (rc == DDS::RETCODE_OK) {
+      pacer_.sent();
+    } else {
+      Metrics::instance().write_failed();
+      if (pacer_.failed()) {
+        ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: MeasurementPublisher::write: "
+                   "write %C failed: %C\n", topic().c_str(), OpenDDS::DCPS::retcode_to_string(rc)));
+      }
+    }
+  }
+}
+
+void MeasurementPublisher::timer_fired(Timer<PublishMeasurementEvent>&)
+{
+  const Steady::time_point now = Steady::now();
+  const uint64_t count = pacer_.due(now);
+  if (count == 0) {
+    return;
+  }
+
+  // The updates of the batch go from the readings of the last tick to these
+  previous_.swap(readings_);
+  for (size_t i = 0; i < readings_.size(); ++i) {
+    readings_[i] = reader_(i);
+  }
+
+  if (dc_dw_) {
+    write(dc_update_, dc_dw_.in(), count, now);
+  } else if (ac_dw_) {
+    write(ac_update_, ac_dw_.in(), count, now);
+  }
+  last_tick_ = now;
+}
+
+void MeasurementPublisher::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
@@ -0,0 +1,111 @@
+#ifndef TMS_MEASUREMENT_PUBLISHER_H
+#define TMS_MEASUREMENT_PUBLISHER_H
+
+#include "common/TimerHandler.h"
+#include "common/mil-std-3071_data_modelTypeSupportImpl.h"
+#include "PowerSim_Idl_export.h"
+#include "RatePacer.h"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+struct PublishMeasurementEvent {
+  static const char* name() { return "PublishMeasurement"; }
+};
+
+/**
+ * Publishes the measurements of the power ports of a simulated device on
+ * AcMeasurementUpdate or DcMeasurementUpdate from a timer on the device's
+ * reactor. Each port has an internal meter reading the amperage the device
+ * simulates through it, at a nominal voltage.
+ *
+ * Like the simulated current, updates are paced by a RatePacer. The times of
+ * the updates of a batch are spread over the time since the last tick and
+ * their amperages are interpolated between the readings of the two ticks.
+ */
+class PowerSim_Idl_Export MeasurementPublisher : public TimerHandler<PublishMeasurementEvent> {
+public:
+  struct Config {
+    // Updates per second, each with all the ports. None are published if zero.
+    double rate = 1.0;
+    bool dc = false;
+    // Nominal voltage in V, or the default for the type of current if zero
+    float voltage = 0.0f;
+    // Ratio of real to apparent power of AC ports
+    float power_factor = 0.95f;
+  };
+
+  static constexpr float default_ac_voltage = 120.0f;
+  static constexpr float default_dc_voltage = 48.0f;
+  static constexpr float ac_frequency = 60.0f;
+
+  // Reads the amperage through a port, from 0 to the number of ports
+  using Reader = std::function<float(size_t port)>;
+
+  MeasurementPublisher(const tms::Identity& device_id, ACE_Reactor* reactor, const Config& config,
+                       size_t ports, Reader reader);
+
+  ~MeasurementPublisher();
+
+  bool enabled() const
+  {
+    return config_.rate > 0;
+  }
+
+  // The topic the measurements are published on
+  const std::string& topic() const;
+
+  // Create the data writer on the TMS domain, if enabled
+  DDS::ReturnCode_t init(DDS::DomainParticipant_ptr dp);
+
+  // Describe the wiring and metering of a port for the device info
+  void describe(tms::PowerPortInfo& port, size_t index) const;
+
+  void start();
+  void stop();
+
+  // Log the requested rate and the rate achieved since the publisher was started
+  void report() const;
+
+private:
+  using Steady = std::chrono::steady_clock;
+
+  struct PortState {
+    float real_power = 0.0f;
+    float reactive_power = 0.0f;
+  };
+
+  // Update the measurement of a port to the given amperage at the given time
+  void measure_ac(tms::ac::PowerPortMeasurement& ppm, PortState& state, float amperage, double dt) const;
+  void measure_dc(tms::dc::PowerPortMeasurement& ppm, PortState& state, float amperage, double dt) const;
+
+  template <typename Update, typename DataWriter>
+  void write(Update& update, DataWriter* dw, uint64_t count, Steady::time_point now);
+
+  void timer_fired(Timer<PublishMeasurementEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  const tms::Identity device_id_;
+  Config config_;
+  const Reader reader_;
+
+  DDS::Publisher_var pub_;
+  tms::ac::MeasurementUpdateDataWriter_var ac_dw_;
+  tms::dc::MeasurementUpdateDataWriter_var dc_dw_;
+
+  // Updates reused for every write, one of them used
+  tms::ac::MeasurementUpdate ac_update_;
+  tms::dc::MeasurementUpdate dc_update_;
+
+  // Readings of the ports at the last two ticks, and what was published last
+  std::vector<float> previous_;
+  std::vector<float> readings_;
+  std::vector<PortState> ports_;
+
+  RatePacer pacer_;
+  Steady::time_point last_tick_;
+  Steady::time_point last_update_;
+};
+
+#endif
@@ -13,6 +13,8 @@ void PowerConnectionDataReaderListenerImpl::on_data_available(DDS::DataReader_pt
     return;
   }
 
+  record_queue_depth(data.length());
+
   for (CORBA::ULong i = 0; i < data.length(); ++i) {
     if (info_seq[i].valid_data) {
       const powersim::PowerConnection& pc = data[i];
@@ -21,7 +23,15 @@ void PowerConnectionDataReaderListenerImpl::on_data_available(DDS::DataReader_pt
       }
 
       pd_.connected_devices(pc.connected_devices());
-      break;
+    } else if (info_seq[i].instance_state == DDS::NOT_ALIVE_DISPOSED_INSTANCE_STATE) {
+      // The controller removed this device from the power topology
+      powersim::PowerConnection key;
+      if (typed_reader->get_key_value(key, info_seq[i].instance_handle) != DDS::RETCODE_OK ||
+          key.pd_id() != pd_.get_device_id()) {
+        continue;
+      }
+
+      pd_.connected_devices(powersim::ConnectedDeviceSeq());
     }
   }
-}
\ No newline at end of file
+}
@@ -192,9 +192,11 @@ DDS::ReturnCode_t PowerDevice::init(DDS::DomainId_t domain, int argc, char* argv
     return DDS::RETCODE_ERROR;
   }
 
+  // Get the connections distributed before this device started
   DDS::DataReaderQos dr_qos;
   sim_sub->get_default_datareader_qos(dr_qos);
   dr_qos.reliability.kind = DDS::RELIABLE_RELIABILITY_QOS;
+  dr_qos.durability.kind = DDS::TRANSIENT_LOCAL_DURABILITY_QOS;
 
   DDS::DataReaderListener_var pc_listener(new PowerConnectionDataReaderListenerImpl(*this));
   DDS::DataReader_var pc_dr_base = sim_sub->create_datareader(pc_topic,
@@ -212,6 +214,30 @@ DDS::ReturnCode_t PowerDevice::init(DDS::DomainId_t domain, int argc, char* argv
   return send_device_info(di);
 }
 
+DDS::TopicDescription_var PowerDevice::electric_current_to_me(DDS::Topic_ptr ec_topic)
+{
+  const std::string cft_name = powersim::TOPIC_ELECTRIC_CURRENT + " to " + get_device_id();
+  std::string device_param;
+  if (!Utils::filter_string_parameter(get_device_id(), device_param)) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: PowerDevice::electric_current_to_me: "
+               "device id \"%C\" can't be used in a content filter\n", get_device_id().c_str()));
+    return nullptr;
+  }
+  DDS::StringSeq params(1);
+  params.length(1);
+  params[0] = device_param.c_str();
+  DDS::ContentFilteredTopic_var cft = sim_participant_->create_contentfilteredtopic(cft_name.c_str(),
+                                                                                     ec_topic,
+                                                                                     "next_hop = %0",
+                                                                                     params);
+  if (!cft) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: PowerDevice::electric_current_to_me: "
+               "create_contentfilteredtopic \"%C\" failed\n", cft_name.c_str()));
+    return nullptr;
+  }
+  return DDS::TopicDescription::_duplicate(cft);
+}
+
 tms::DeviceInfo PowerDevice::populate_device_info() const
 {
   auto di = get_device_info();
@@ -239,34 +265,36 @@ void PowerDevice::got_device_info(const tms::DeviceInfo& di, const DDS::SampleIn
 
 void PowerDevice::wait_for_connections()
 {
-  std::unique_lock<std::mutex> lock(connected_devices_m_);
-  connected_devices_cv_.wait(lock, [this] { return !connected_devices_in_.empty() || !connected_devices_out_.empty(); });
+  std::unique_lock<SimpleMutex> lock(connected_devices_m_);
+  connected_devices_cv_.wait(lock, [this] { return !connections_->empty(); });
 }
 
 void PowerDevice::connected_devices(const powersim::ConnectedDeviceSeq& devices)
 {
-  std::lock_guard<std::mutex> guard(connected_devices_m_);
+  // The given devices replace the current connections, so build the new lists first.
+  powersim::ConnectedDeviceSeq devices_in;
+  powersim::ConnectedDeviceSeq devices_out;
 
   for (size_t i = 0; i < devices.size(); ++i) {
     switch (role_) {
     case tms::DeviceRole::ROLE_SOURCE:
       // Source device has a single out port
-      if (!connected_devices_out_.empty()) {
+      if (!devices_out.empty()) {
         ACE_ERROR((LM_NOTICE, "(%P|%t) NOTICE: PowerDevice::connected_devices: Source \"%C\" already connects to \"%C\". Replace with \"%C\"\n",
-                   get_device_id().c_str(), connected_devices_out_[0].id().c_str(), devices[i].id().c_str()));
-        connected_devices_out_[0] = devices[i];
+                   get_device_id().c_str(), devices_out[0].id().c_str(), devices[i].id().c_str()));
+        devices_out[0] = devices[i];
       } else {
-        connected_devices_out_.push_back(devices[i]);
+        devices_out.push_back(devices[i]);
       }
       break;
     case tms::DeviceRole::ROLE_LOAD:
       // Load device has a single in port.
-      if (!connected_devices_in_.empty()) {
+      if (!devices_in.empty()) {
         ACE_ERROR((LM_NOTICE, "(%P|%t) NOTICE: PowerDevice::connected_devices: Load \"%C\" already connects to \"%C\". Replace with \"%C\"\n",
-                   get_device_id().c_str(), connected_devices_in_[0].id().c_str(), devices[i].id().c_str()));
-        connected_devices_in_[0] = devices[i];
+                   get_device_id().c_str(), devices_in[0].id().c_str(), devices[i].id().c_str()));
+        devices_in[0] = devices[i];
       } else {
-        connected_devices_in_.push_back(devices[i]);
+        devices_in.push_back(devices[i]);
       }
       break;
     case tms::DeviceRole::ROLE_DISTRIBUTION:
@@ -274,14 +302,14 @@ void PowerDevice::connected_devices(const powersim::ConnectedDeviceSeq& devices)
         const tms::DeviceRole other_role = devices[i].role();
         if (other_role == tms::DeviceRole::ROLE_SOURCE) {
           // Can only receive power from the other device
-          connected_devices_in_.push_back(devices[i]);
+          devices_in.push_back(devices[i]);
         } else if (other_role == tms::DeviceRole::ROLE_LOAD) {
           // Can only send power to the other device
-          connected_devices_out_.push_back(devices[i]);
+          devices_out.push_back(devices[i]);
         } else if (other_role == tms::DeviceRole::ROLE_DISTRIBUTION) {
           // Can both send to and receive power from the other distribution device
-          connected_devices_in_.push_back(devices[i]);
-          connected_devices_out_.push_back(devices[i]);
+          devices_in.push_back(devices[i]);
+          devices_out.push_back(devices[i]);
         } else {
           // Should never happen, but just ignore this other device
           ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: PowerDevice::connected_devices: Unsupported device role (\"%C\") of other device!\n",
@@ -296,5 +324,9 @@ void PowerDevice::connected_devices(const powersim::ConnectedDeviceSeq& devices)
       return;
     }
   }
+
+  auto connections = std::make_shared<const ConnectionSnapshot>(std::move(devices_in), std::move(devices_out));
+  SimpleGuard guard(connected_devices_m_);
+  connections_ = std::move(connections);
   connected_devices_cv_.notify_one();
 }
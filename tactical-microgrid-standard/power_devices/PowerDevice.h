@@ -3,10 +3,12 @@
 
 #include "common/Handshaking.h"
 #include "common/ControllerSelector.h"
+#include "ConnectionSnapshot.h"
 #include "PowerSimTypeSupportImpl.h"
 #include "PowerSim_Idl_export.h"
 
 #include <condition_variable>
+#include <memory>
 #include <thread>
 
 class PowerSim_Idl_Export PowerDevice : public Handshaking {
@@ -31,16 +33,22 @@ public:
     return run_i();
   }
 
+  // The current connections of this device. The snapshot stays valid and
+  // unchanged while it's held, even if the connections change meanwhile.
+  std::shared_ptr<const ConnectionSnapshot> connections() const
+  {
+    SimpleGuard guard(connected_devices_m_);
+    return connections_;
+  }
+
   powersim::ConnectedDeviceSeq connected_devices_in() const
   {
-    std::lock_guard<std::mutex> guard(connected_devices_m_);
-    return connected_devices_in_;
+    return connections()->in();
   }
 
   powersim::ConnectedDeviceSeq connected_devices_out() const
   {
-    std::lock_guard<std::mutex> guard(connected_devices_m_);
-    return connected_devices_out_;
+    return connections()->out();
   }
 
   // Wait for power connections to be established
@@ -63,13 +71,13 @@ public:
   // the change in energy level for that particular power device.
   virtual void energy_level(tms::EnergyStartStopLevel essl)
   {
-    std::lock_guard<std::mutex> guard(essl_m_);
+    SimpleGuard guard(essl_m_);
     essl_ = essl;
   }
 
   tms::EnergyStartStopLevel energy_level() const
   {
-    std::lock_guard<std::mutex> guard(essl_m_);
+    SimpleGuard guard(essl_m_);
     return essl_;
   }
 
@@ -100,16 +108,16 @@ protected:
   // Concrete power device should override this function depending on their role.
   virtual tms::DeviceInfo populate_device_info() const;
 
-  std::condition_variable connected_devices_cv_;
-  mutable std::mutex connected_devices_m_;
+  // Content-filtered topic for the simulated electric current whose next hop is this device
+  DDS::TopicDescription_var electric_current_to_me(DDS::Topic_ptr ec_topic);
 
-  // List of devices that can send power to this device.
-  // Load device has at most one connected device in this list.
-  powersim::ConnectedDeviceSeq connected_devices_in_;
+  std::condition_variable_any connected_devices_cv_;
+  mutable SimpleMutex connected_devices_m_{"PowerDevice::connected_devices"};
 
-  // List of devices that this device can send power to.
-  // Source device has at most one connected device in this list.
-  powersim::ConnectedDeviceSeq connected_devices_out_;
+  // Devices that can send power to this device (in) and that this device can
+  // send power to (out). Load device has at most one connected device in the
+  // in list and source device has at most one in the out list.
+  std::shared_ptr<const ConnectionSnapshot> connections_ = std::make_shared<const ConnectionSnapshot>();
 
   // Participant containing entities for simulation topics
   DDS::DomainParticipant_var sim_participant_;
@@ -117,7 +125,7 @@ protected:
   // Data writer for sending tms::Reply. Used for tms::EnergyStartStopRequest, for example.
   tms::ReplyDataWriter_var reply_dw_;
 
-  mutable std::mutex essl_m_;
+  mutable SimpleMutex essl_m_{"PowerDevice::essl"};
   tms::EnergyStartStopLevel essl_ = tms::EnergyStartStopLevel::ESSL_OPERATIONAL;
 
   // Whether to print power simulation messages
@@ -0,0 +1,132 @@
+// Converts a CSV time series into a profile file for the -f option of Source
+// and Load. The first row names the columns: a time column followed by a
+// column per device id. Each following row has the time in seconds and the
+// current of each device in A. Rows must be evenly spaced in time.
+
+#include "ProfilePlayer.h"
+
+#include <ace/Get_Opt.h>
+#include <ace/Log_Msg.h>
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::vector<std::string> split(const std::string& line)
+{
+  std::vector<std::string> fields;
+  std::istringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    const size_t begin = field.find_first_not_of(" \t\r");
+    const size_t end = field.find_last_not_of(" \t\r");
+    fields.push_back(begin == std::string::npos ? std::string() : field.substr(begin, end - begin + 1));
+  }
+  return fields;
+}
+
+bool parse_number(const std::string& field, double& value)
+{
+  char* end = nullptr;
+  value = ACE_OS::strtod(field.c_str(), &end);
+  return !field.empty() && *end == '\0' && std::isfinite(value);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const char* in_path = nullptr;
+  const char* out_path = nullptr;
+
+  ACE_Get_Opt get_opt(argc, argv, "i:o:");
+  if (get_opt.long_option("input", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("output", 'o', ACE_Get_Opt::ARG_REQUIRED) != 0) {
+    return 1;
+  }
+
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'i':
+      in_path = get_opt.opt_arg();
+      break;
+    case 'o':
+      out_path = get_opt.opt_arg();
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (in_path == nullptr || out_path == nullptr) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -i Input_CSV -o Output_Profile\n", argv[0]));
+    return 1;
+  }
+
+  std::ifstream in(in_path);
+  if (!in) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: can't open \"%C\"\n", in_path));
+    return 1;
+  }
+
+  std::string line;
+  std::getline(in, line);
+  const std::vector<std::string> header = split(line);
+  if (header.size() < 2) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: \"%C\" needs a time column and at least one device column\n", in_path));
+    return 1;
+  }
+  const std::vector<tms::Identity> ids(header.begin() + 1, header.end());
+
+  std::vector<double> times;
+  std::vector<std::vector<float>> columns(ids.size());
+  size_t line_number = 1;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+
+    const std::vector<std::string> fields = split(line);
+    double time = 0;
+    if (fields.size() != header.size() || !parse_number(fields[0], time)) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: \"%C\" line %B: expected a time and %B value(s)\n",
+                 in_path, line_number, ids.size()));
+      return 1;
+    }
+    times.push_back(time);
+    for (size_t col = 0; col < ids.size(); ++col) {
+      double value = 0;
+      if (!parse_number(fields[col + 1], value)) {
+        ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: \"%C\" line %B: invalid value for \"%C\"\n",
+                   in_path, line_number, ids[col].c_str()));
+        return 1;
+      }
+      columns[col].push_back(static_cast<float>(value));
+    }
+  }
+
+  // A single row is a constant profile
+  double period = 1.0;
+  if (times.size() > 1) {
+    period = (times.back() - times.front()) / (times.size() - 1);
+    for (size_t i = 1; i < times.size(); ++i) {
+      if (!(period > 0) || std::abs(times[i] - times[i - 1] - period) > 0.01 * period) {
+        ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: \"%C\": rows must be evenly spaced in time, "
+                   "row %B is %f s after the previous one instead of %f s\n",
+                   in_path, i + 1, times[i] - times[i - 1], period));
+        return 1;
+      }
+    }
+  }
+
+  if (!ProfileFile::write(out_path, Sec(period), ids, columns)) {
+    return 1;
+  }
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: wrote %B sample(s) of %B device(s), %f s apart, to \"%C\"\n",
+             times.size(), ids.size(), period, out_path));
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "ProfilePlayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// Columns start at a multiple of this from the start of the file
+constexpr size_t column_alignment = 8;
+
+size_t data_offset(uint64_t columns, uint64_t id_size)
+{
+  const size_t end_of_ids = sizeof(ProfileHeader) + columns * id_size;
+  return (end_of_ids + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+}
+
+bool ProfileFile::open(const std::string& path)
+{
+  header_ = nullptr;
+  if (map_.map(path.c_str(), static_cast<size_t>(-1), O_RDONLY, ACE_DEFAULT_FILE_PERMS,
+               PROT_READ, ACE_MAP_PRIVATE) == -1) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::open: can't map \"%C\": %m\n", path.c_str()));
+    return false;
+  }
+
+  const size_t size = map_.size();
+  const char* const base = static_cast<const char*>(map_.addr());
+  const ProfileHeader* const header = reinterpret_cast<const ProfileHeader*>(base);
+  if (size < sizeof(ProfileHeader) ||
+      std::memcmp(header->magic, ProfileHeader::expected_magic, sizeof header->magic) != 0) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::open: \"%C\" is not a profile\n", path.c_str()));
+    return false;
+  }
+  if (header->byte_order != ProfileHeader::expected_byte_order ||
+      header->version != ProfileHeader::current_version) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::open: \"%C\" has version %u or a different byte order, "
+               "expected version %u\n", path.c_str(), header->version, ProfileHeader::current_version));
+    return false;
+  }
+  if (header->id_size == 0 || header->samples == 0 || !(header->period > 0) || !std::isfinite(header->period)) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::open: \"%C\" has no samples or no period\n", path.c_str()));
+    return false;
+  }
+
+  // Check the sizes without overflowing for corrupt headers
+  const uint64_t max_samples = (size / sizeof(float)) / std::max<uint64_t>(header->columns, 1);
+  if (header->columns > size / header->id_size || header->samples > max_samples ||
+      data_offset(header->columns, header->id_size) + header->columns * header->samples * sizeof(float) > size) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::open: \"%C\" is truncated\n", path.c_str()));
+    return false;
+  }
+
+  header_ = header;
+  ids_ = base + sizeof(ProfileHeader);
+  data_ = reinterpret_cast<const float*>(base + data_offset(header->columns, header->id_size));
+  return true;
+}
+
+std::string ProfileFile::id(size_t column) const
+{
+  const char* const id = ids_ + column * header_->id_size;
+  return std::string(id, strnlen(id, header_->id_size));
+}
+
+const float* ProfileFile::column(const tms::Identity& id) const
+{
+  for (size_t c = 0; c < columns(); ++c) {
+    if (this->id(c) == id) {
+      return data_ + c * header_->samples;
+    }
+  }
+  return nullptr;
+}
+
+bool ProfileFile::write(const std::string& path, Sec period,
+                        const std::vector<tms::Identity>& ids, const std::vector<std::vector<float>>& columns)
+{
+  if (ids.size() != columns.size() || columns.empty() || columns[0].empty() || !(period.count() > 0)) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::write: need a period and a column of samples per device\n"));
+    return false;
+  }
+  for (size_t c = 0; c < ids.size(); ++c) {
+    if (ids[c].empty() || ids[c].size() >= ProfileHeader::default_id_size) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::write: device id \"%C\" is empty or longer than %u bytes\n",
+                 ids[c].c_str(), ProfileHeader::default_id_size - 1));
+      return false;
+    }
+    if (columns[c].size() != columns[0].size()) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::write: column of \"%C\" has %B sample(s), expected %B\n",
+                 ids[c].c_str(), columns[c].size(), columns[0].size()));
+      return false;
+    }
+  }
+
+  ProfileHeader header = {};
+  std::memcpy(header.magic, ProfileHeader::expected_magic, sizeof header.magic);
+  header.byte_order = ProfileHeader::expected_byte_order;
+  header.version = ProfileHeader::current_version;
+  header.columns = static_cast<uint32_t>(ids.size());
+  header.id_size = ProfileHeader::default_id_size;
+  header.samples = columns[0].size();
+  header.period = period.count();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof header);
+  std::vector<char> id(header.id_size);
+  for (const tms::Identity& device_id : ids) {
+    std::fill(id.begin(), id.end(), '\0');
+    std::memcpy(id.data(), device_id.data(), device_id.size());
+    out.write(id.data(), id.size());
+  }
+  const size_t padding = data_offset(header.columns, header.id_size) - sizeof header - ids.size() * header.id_size;
+  out.write(std::string(padding, '\0').data(), padding);
+  for (const auto& column : columns) {
+    out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(float));
+  }
+
+  out.close();
+  if (!out) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfileFile::write: writing \"%C\" failed\n", path.c_str()));
+    return false;
+  }
+  return true;
+}
+
+bool ProfilePlayer::open(const Config& config, const tms::Identity& device_id)
+{
+  config_ = config;
+  samples_ = nullptr;
+  if (!(config.speed > 0)) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfilePlayer::open: speed must be positive\n"));
+    return false;
+  }
+  if (!file_.open(config.path)) {
+    return false;
+  }
+
+  const tms::Identity& column = config.column.empty() ? device_id : config.column;
+  samples_ = file_.column(column);
+  if (!samples_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: ProfilePlayer::open: \"%C\" has no column for \"%C\"\n",
+               config.path.c_str(), column.c_str()));
+    return false;
+  }
+  return true;
+}
+
+std::optional<float> ProfilePlayer::value(TimePoint now) const
+{
+  if (!samples_) {
+    return std::nullopt;
+  }
+
+  const size_t n = file_.samples();
+  double position = std::max(0.0, Sec(now - start_).count() / period().count());
+  if (config_.loop) {
+    position = std::fmod(position, static_cast<double>(n));
+  } else if (position >= n - 1) {
+    return samples_[n - 1];
+  }
+
+  // After the last sample comes the first one when looping
+  const size_t i = static_cast<size_t>(position);
+  const size_t next = i + 1 < n ? i + 1 : 0;
+  const float fraction = static_cast<float>(position - i);
+  return samples_[i] + (samples_[next] - samples_[i]) * fraction;
+}
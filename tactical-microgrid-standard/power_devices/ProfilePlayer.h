@@ -0,0 +1,125 @@
+#ifndef TMS_PROFILE_PLAYER_H
+#define TMS_PROFILE_PLAYER_H
+
+#include "common/TimerHandler.h"
+#include "common/mil-std-3071_data_modelTypeSupportImpl.h"
+#include "PowerSim_Idl_export.h"
+
+#include <ace/Mem_Map.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Header of a profile file. A profile holds a column of samples for each
+ * device, taken at a fixed period. After the header come the device ids of the
+ * columns, id_size bytes each and padded with NUL, and then the columns one
+ * after the other, each with the given number of samples as 32-bit floats. The
+ * file is in the byte order of the host that wrote it.
+ *
+ * Samples are currents in A: what a source supplies or a load demands.
+ */
+struct ProfileHeader {
+  static constexpr char expected_magic[8] = {'T', 'M', 'S', 'P', 'R', 'O', 'F', '\0'};
+  static constexpr uint32_t expected_byte_order = 0x01020304;
+  static constexpr uint32_t current_version = 1;
+  static constexpr uint32_t default_id_size = 64;
+
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t version;
+  uint32_t columns;
+  uint32_t id_size;
+  uint64_t samples;
+  // Time between samples in seconds
+  double period;
+  uint64_t reserved;
+};
+
+/**
+ * A profile file mapped into memory. The samples are read in place, so opening
+ * a profile doesn't depend on its length and playing it doesn't allocate.
+ */
+class PowerSim_Idl_Export ProfileFile {
+public:
+  // Logs why a file can't be used and returns false
+  bool open(const std::string& path);
+
+  size_t columns() const
+  {
+    return header_ ? header_->columns : 0;
+  }
+
+  size_t samples() const
+  {
+    return header_ ? header_->samples : 0;
+  }
+
+  Sec period() const
+  {
+    return Sec(header_ ? header_->period : 0);
+  }
+
+  std::string id(size_t column) const;
+
+  // Samples of a device, or null if the profile has no column for it
+  const float* column(const tms::Identity& id) const;
+
+  // Write a profile with a column of the same number of samples per device
+  static bool write(const std::string& path, Sec period,
+                    const std::vector<tms::Identity>& ids, const std::vector<std::vector<float>>& columns);
+
+private:
+  ACE_Mem_Map map_;
+  const ProfileHeader* header_ = nullptr;
+  const char* ids_ = nullptr;
+  const float* data_ = nullptr;
+};
+
+/**
+ * Plays the column of one device in a profile in real time or scaled, from the
+ * time it is started. Values between samples are interpolated linearly. At the
+ * end, the profile starts over or stays at its last sample.
+ */
+class PowerSim_Idl_Export ProfilePlayer {
+public:
+  struct Config {
+    std::string path;
+    // Column to play, the id of the device by default
+    tms::Identity column;
+    // Profile time that passes per second, e.g. 60 plays a minute per second
+    double speed = 1.0;
+    bool loop = true;
+  };
+
+  bool open(const Config& config, const tms::Identity& device_id);
+
+  bool is_open() const
+  {
+    return samples_ != nullptr;
+  }
+
+  void start(TimePoint now = Clock::now())
+  {
+    start_ = now;
+  }
+
+  // Time between samples in real time
+  Sec period() const
+  {
+    return file_.period() / config_.speed;
+  }
+
+  // Value of the profile at the given time, or none if it isn't open
+  std::optional<float> value(TimePoint now = Clock::now()) const;
+
+private:
+  Config config_;
+  ProfileFile file_;
+  const float* samples_ = nullptr;
+  TimePoint start_;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef TMS_RATE_PACER_H
+#define TMS_RATE_PACER_H
+
+#include "common/TimerHandler.h"
+
+#include <dds/DdsDcpsPublicationC.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * Paces samples written from a timer at a rate. Timers don't tick faster than
+ * max_tick_rate, so at higher rates each tick writes the samples that are due
+ * since the last one as a batch, and the rate is kept over time rather than
+ * per tick. Samples due beyond max_ticks_behind ticks' worth, e.g. after the
+ * reactor stalled, are skipped instead of written in one burst. Not
+ * thread-safe, the owner of the timer serializes the calls.
+ */
+class RatePacer {
+public:
+  using Steady = std::chrono::steady_clock;
+
+  // Timers don't tick faster than this; higher rates write batches
+  static constexpr double max_tick_rate = 100.0;
+
+  // Samples due beyond this many ticks' worth are skipped
+  static constexpr double max_ticks_behind = 4.0;
+
+  // Start over at a rate in samples per second, with one sample due right away
+  void start(double rate, Steady::time_point now = Steady::now())
+  {
+    rate_ = rate;
+    run_start_ = start_ = now;
+    due_base_ = 1.0;
+    sent_ = 0;
+    failed_ = 0;
+    skipped_ = 0;
+  }
+
+  // Continue at another rate from now on, keeping what is due at the old one
+  void rate(double rate, Steady::time_point now = Steady::now())
+  {
+    due_base_ += Sec(now - start_).count() * rate_;
+    start_ = now;
+    rate_ = rate;
+  }
+
+  double rate() const
+  {
+    return rate_;
+  }
+
+  Sec tick_period() const
+  {
+    return Sec(rate_ > max_tick_rate ? 1.0 / max_tick_rate : 1.0 / std::max(rate_, 1e-6));
+  }
+
+  // Samples to write at a tick. Those beyond the cap are counted as skipped.
+  uint64_t due(Steady::time_point now = Steady::now())
+  {
+    const uint64_t due = static_cast<uint64_t>(due_base_ + Sec(now - start_).count() * rate_);
+    const uint64_t done = sent_ + failed_ + skipped_;
+    if (due <= done) {
+      return 0;
+    }
+    const uint64_t count = due - done;
+    const uint64_t max_batch = std::max<uint64_t>(1, static_cast<uint64_t>(max_ticks_behind * rate_ * tick_period().count()));
+    if (count > max_batch) {
+      skipped_ += count - max_batch;
+      return max_batch;
+    }
+    return count;
+  }
+
+  void sent()
+  {
+    ++sent_;
+  }
+
+  // Returns whether this is the first failure since the start, the one worth logging
+  bool failed()
+  {
+    return ++failed_ == 1;
+  }
+
+  void skipped(uint64_t count)
+  {
+    skipped_ += count;
+  }
+
+  // Samples written, successfully or not, since the start
+  uint64_t written() const
+  {
+    return sent_ + failed_;
+  }
+
+  // Log the rate requested and the rate achieved since the start, e.g. for
+  // owner "CurrentEmitter" and what "\"source-1\""
+  void report(const char* owner, const std::string& what, Steady::time_point now = Steady::now()) const
+  {
+    const double elapsed = Sec(now - run_start_).count();
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: %C::report: %C: requested %.1f Hz, achieved %.1f Hz "
+               "(%Q sent, %Q failed, %Q skipped in %.1f s)\n", owner, what.c_str(),
+               rate_, elapsed > 0 ? sent_ / elapsed : 0.0, sent_, failed_, skipped_, elapsed));
+  }
+
+private:
+  double rate_ = 0.0;
+
+  // When the pacer was started and the samples handled since then
+  Steady::time_point run_start_;
+  uint64_t sent_ = 0;
+  uint64_t failed_ = 0;
+  uint64_t skipped_ = 0;
+
+  // When the rate last changed and the samples due by then
+  Steady::time_point start_;
+  double due_base_ = 0.0;
+};
+
+/**
+ * Suspends the publications of a publisher while a batch of more than one
+ * sample is written, so the transport can send them together.
+ */
+class PublicationBatch {
+public:
+  PublicationBatch(DDS::Publisher_ptr pub, uint64_t count)
+    : pub_(count > 1 ? pub : nullptr)
+  {
+    if (pub_) {
+      pub_->suspend_publications();
+    }
+  }
+
+  ~PublicationBatch()
+  {
+    if (pub_) {
+      pub_->resume_publications();
+    }
+  }
+
+  PublicationBatch(const PublicationBatch&) = delete;
+  PublicationBatch& operator=(const PublicationBatch&) = delete;
+
+private:
+  DDS::Publisher_ptr pub_;
+};
+
+#endif
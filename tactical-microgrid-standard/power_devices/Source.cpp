@@ -1,22 +1,240 @@
 #include "PowerDevice.h"
+#include "ProfilePlayer.h"
+#include "MeasurementPublisher.h"
+#include "RatePacer.h"
 #include "PowerSimTypeSupportImpl.h"
+#include "common/Metrics.h"
+#include "common/MetricsExporter.h"
 #include "common/QosHelper.h"
+#include "common/TimerHandler.h"
 #include "common/Utils.h"
 
 #include <dds/DCPS/Marked_Default_Qos.h>
 
 #include <ace/Get_Opt.h>
 
-#include <thread>
-#include <chrono>
+#include <algorithm>
+
+struct EmitCurrentEvent {
+  static const char* name() { return "EmitCurrent"; }
+};
+
+struct ReportRateEvent {
+  static const char* name() { return "ReportRate"; }
+};
+
+struct PlayProfileEvent {
+  static const char* name() { return "PlayProfile"; }
+};
+
+/**
+ * Sends the simulated current of a source device from a timer on the device's
+ * reactor, paced by a RatePacer. With a proportional rate, the configured rate is
+ * for the nominal amperage and scales with the amperage actually sent. With a
+ * profile, the amperage follows the profile instead of staying constant.
+ */
+class CurrentEmitter : public TimerHandler<EmitCurrentEvent, ReportRateEvent, PlayProfileEvent> {
+public:
+  struct Config {
+    // Samples per second
+    double rate = 1.0;
+    bool proportional = false;
+    float amperage = 10.0f;
+    // Log the achieved rate this often, or never if zero
+    Sec report_period = Sec(0);
+    // Started profile to take the amperage from, if any
+    const ProfilePlayer* profile = nullptr;
+  };
+
+  static constexpr float nominal_amperage = 10.0f;
+
+  CurrentEmitter(PowerDevice& device, ACE_Reactor* reactor, const Config& config)
+    : TimerHandler(reactor, "CurrentEmitter")
+    , device_(device)
+    , config_(config)
+  {
+  }
+
+  ~CurrentEmitter()
+  {
+    stop();
+  }
+
+  void writer(DDS::Publisher_ptr pub, powersim::ElectricCurrentDataWriter_ptr dw)
+  {
+    Guard g(lock_);
+    pub_ = DDS::Publisher::_duplicate(pub);
+    dw_ = powersim::ElectricCurrentDataWriter::_duplicate(dw);
+  }
+
+  double requested_rate() const
+  {
+    Guard g(lock_);
+    return requested_rate_i();
+  }
+
+  // Amperage sent while the emitter is started, or zero
+  float amperage() const
+  {
+    Guard g(lock_);
+    return started_ ? config_.amperage : 0.0f;
+  }
+
+  void start()
+  {
+    Guard g(lock_);
+    if (get_timer<EmitCurrentEvent>()->active()) {
+      return;
+    }
+    started_ = true;
+    if (config_.profile) {
+      config_.amperage = config_.profile->value(Clock::now()).value_or(0.0f);
+      schedule(PlayProfileEvent(), profile_tick_period());
+    }
+    pacer_.start(requested_rate_i());
+    schedule(EmitCurrentEvent(), pacer_.tick_period());
+    if (config_.report_period.count() > 0) {
+      schedule(ReportRateEvent(), config_.report_period, config_.report_period);
+    }
+  }
+
+  void stop()
+  {
+    Guard g(lock_);
+    if (!get_timer<EmitCurrentEvent>()->active()) {
+      return;
+    }
+    cancel<EmitCurrentEvent>();
+    cancel<ReportRateEvent>();
+    cancel<PlayProfileEvent>();
+    started_ = false;
+    report();
+  }
+
+  // Change the amperage sent. A proportional rate follows it.
+  void amperage(float amperage)
+  {
+    Guard g(lock_);
+    if (config_.amperage == amperage) {
+      return;
+    }
+    if (config_.proportional && get_timer<EmitCurrentEvent>()->active()) {
+      config_.amperage = amperage;
+      pacer_.rate(requested_rate_i());
+      reschedule_tick();
+    } else {
+      config_.amperage = amperage;
+    }
+  }
+
+  // Log the requested rate and the rate achieved since the emitter was started
+  void report() const
+  {
+    Guard g(lock_);
+    pacer_.report("CurrentEmitter", "\"" + device_.get_device_id() + "\"");
+  }
+
+private:
+  double requested_rate_i() const
+  {
+    return config_.proportional ? config_.rate * config_.amperage / nominal_amperage : config_.rate;
+  }
+
+  // The amperage follows the profile at its own resolution, up to the tick rate
+  Sec profile_tick_period() const
+  {
+    return std::max(config_.profile->period(), Sec(1.0 / RatePacer::max_tick_rate));
+  }
+
+  void reschedule_tick()
+  {
+    auto timer = get_timer<EmitCurrentEvent>();
+    cancel<EmitCurrentEvent>(timer);
+    timer->period = pacer_.tick_period();
+    timer->delay = Sec(0);
+    schedule<EmitCurrentEvent>(timer);
+  }
+
+  void timer_fired(Timer<EmitCurrentEvent>&)
+  {
+    const uint64_t count = pacer_.due();
+    if (count == 0) {
+      return;
+    }
+
+    const std::shared_ptr<const ConnectionSnapshot> connections = device_.connections();
+    if (connections->out().empty() || !dw_) {
+      // Nothing to send to yet
+      pacer_.skipped(count);
+      return;
+    }
+
+    const tms::Identity& to = connections->out()[0].id();
+    if (sample_.next_hop() != to || sample_.power_path().size() != 2) {
+      sample_.next_hop(to);
+      sample_.power_path({device_.get_device_id(), to});
+    }
+    sample_.amperage(config_.amperage);
+
+    {
+      PublicationBatch batch(pub_, count);
+      for (uint64_t i = 0; i < count; ++i) {
+        const DDS::ReturnCode_t rc = dw_->write(sample_, DDS::HANDLE_NIL);
+        if (rc == DDS::RETCODE_OK) {
+          pacer_.sent();
+        } else {
+          Metrics::instance().write_failed();
+          if (pacer_.failed()) {
+            ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: CurrentEmitter::timer_fired: "
+                       "write ElectricCurrent failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
+          }
+        }
+      }
+    }
+
+    if (device_.verbose()) {
+      ACE_DEBUG((LM_DEBUG, "=== (%T) Sending power to device \"%C\" -- %f Amps (%Q sample(s))...\n",
+                 to.c_str(), config_.amperage, count));
+    }
+  }
+
+  void timer_fired(Timer<ReportRateEvent>&)
+  {
+    report();
+  }
+
+  void timer_fired(Timer<PlayProfileEvent>&)
+  {
+    amperage(config_.profile->value().value_or(0.0f));
+  }
+
+  void any_timer_fired(AnyTimer timer) final
+  {
+    std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+  }
+
+  PowerDevice& device_;
+  Config config_;
+  DDS::Publisher_var pub_;
+  powersim::ElectricCurrentDataWriter_var dw_;
+  powersim::ElectricCurrent sample_;
+  bool started_ = false;
+  RatePacer pacer_;
+};
 
 class SourceDevice : public PowerDevice {
 public:
-  explicit SourceDevice(const tms::Identity& id, bool verbose = false)
+  SourceDevice(const tms::Identity& id, const CurrentEmitter::Config& config,
+               const MeasurementPublisher::Config& measurement_config, float max_power, bool verbose = false)
     : PowerDevice(id, tms::DeviceRole::ROLE_SOURCE, verbose)
+    , emitter_(*this, reactor_, config)
+    , max_power_(max_power)
+    , measurements_(id, reactor_, measurement_config, 1, [this](size_t) { return output_amperage(); })
   {
   }
 
+  // Default rated output power in W
+  static constexpr float default_max_power = 10000.0f;
   DDS::ReturnCode_t init(DDS::DomainId_t domain_id, int argc = 0, char* argv[] = nullptr)
   {
     DDS::ReturnCode_t rc = PowerDevice::init(domain_id, argc, argv);
@@ -63,86 +281,47 @@ public:
       return DDS::RETCODE_ERROR;
     }
 
-    ec_dw_ = powersim::ElectricCurrentDataWriter::_narrow(ec_dw_base);
-    if (!ec_dw_) {
+    powersim::ElectricCurrentDataWriter_var ec_dw = powersim::ElectricCurrentDataWriter::_narrow(ec_dw_base);
+    if (!ec_dw) {
       ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: SourceDevice::init: ElectricCurrentDataWriter narrow failed\n"));
       return DDS::RETCODE_ERROR;
     }
 
-    return DDS::RETCODE_OK;
+    emitter_.writer(sim_pub, ec_dw);
+    return measurements_.init(dp);
   }
 
-  bool shutdown() const
+  // Current the source supplies through its port
+  float output_amperage() const
   {
-    std::lock_guard<std::mutex> guard(shutdown_m_);
-    return shutdown_;
+    return connections()->out().empty() ? 0.0f : emitter_.amperage();
   }
 
   int handle_signal(int, siginfo_t*, ucontext_t*) override
   {
-    {
-      std::lock_guard<std::mutex> guard(shutdown_m_);
-      shutdown_ = true;
-    }
-
     reactor_->end_reactor_event_loop();
     return -1;
   }
 
-  tms::EnergyStartStopLevel energy_level() const
-  {
-    std::lock_guard<std::mutex> guard(essl_m_);
-    return essl_;
-  }
-
   void energy_level(tms::EnergyStartStopLevel essl) override
   {
-    std::lock_guard<std::mutex> guard(essl_m_);
-    essl_ = essl;
-    essl_cv_.notify_one();
-  }
-
-  void wait_for_operational_energy_level()
-  {
-    std::unique_lock<std::mutex> lock(essl_m_);
-    essl_cv_.wait(lock, [this] { return essl_ == tms::EnergyStartStopLevel::ESSL_OPERATIONAL; });
-  }
-
-  void simulate_power_flow()
-  {
-    wait_for_connections();
-    const powersim::ConnectedDeviceSeq& connected_devs = connected_devices_out();
-
-    while (!shutdown()) {
-      wait_for_operational_energy_level();
-
-      while (!shutdown() && energy_level() == tms::EnergyStartStopLevel::ESSL_OPERATIONAL) {
-        powersim::ElectricCurrent ec;
-        ec.power_path().push_back(get_device_id());
-        ec.power_path().push_back(connected_devs[0].id());
-        ec.amperage() = 10.0f;
-        const DDS::ReturnCode_t rc = ec_dw_->write(ec, DDS::HANDLE_NIL);
-        if (rc != DDS::RETCODE_OK) {
-          ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: SourceDevice::simulate_power_flow: "
-                    "write ElectricCurrent failed: %C\n", OpenDDS::DCPS::retcode_to_string(rc)));
-        }
-
-        if (verbose_) {
-          ACE_DEBUG((LM_DEBUG, "=== (%T) Sending power to device \"%C\" -- %f Amps...\n",
-                     connected_devs[0].id().c_str(), ec.amperage()));
-        }
-
-        // Frequency of messages can be proportional to the power measure?
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-      }
+    PowerDevice::energy_level(essl);
+    if (essl == tms::EnergyStartStopLevel::ESSL_OPERATIONAL) {
+      emitter_.start();
+    } else {
+      emitter_.stop();
     }
   }
 
   int run() override
   {
-    std::thread sim_thr(&SourceDevice::simulate_power_flow, this);
+    if (energy_level() == tms::EnergyStartStopLevel::ESSL_OPERATIONAL) {
+      emitter_.start();
+    }
+    measurements_.start();
     const int ret = run_i();
-    sim_thr.join();
+    measurements_.stop();
+    emitter_.stop();
     return ret;
   }
 
@@ -152,17 +331,21 @@ private:
     auto device_info = get_device_info();
     device_info.role() = tms::DeviceRole::ROLE_SOURCE;
     device_info.product() = Utils::get_ProductInfo();
-    device_info.topics() = Utils::get_TopicInfo({}, {}, { tms::topic::TOPIC_ENERGY_START_STOP_REQUEST });
+    device_info.topics() = Utils::get_TopicInfo(measured_topics(), {}, { tms::topic::TOPIC_ENERGY_START_STOP_REQUEST });
 
     tms::PowerDeviceInfo pdi;
     {
       // The spec require 1 power port entry for source device
-      pdi.powerPorts() = { tms::PowerPortInfo() };
+      tms::PowerPortInfo port;
+      measurements_.describe(port, 0);
+      pdi.powerPorts() = { port };
       tms::SourceInfo source_info;
       {
         source_info.features() = { tms::SourceFeature::SRCF_GENSET, tms::SourceFeature::SRCF_SOLAR };
         source_info.supportedEnergyStartStopLevels() = { tms::EnergyStartStopLevel::ESSL_OFF,
                                                          tms::EnergyStartStopLevel::ESSL_OPERATIONAL };
+        // The controller sheds loads when this isn't enough for them
+        source_info.loadSharing().maxRealPower() = max_power_;
       }
       pdi.source() = source_info;
     }
@@ -170,14 +353,14 @@ private:
     return device_info;
   }
 
-  // For graceful shutdown of the device
-  mutable std::mutex shutdown_m_;
-  bool shutdown_ = false;
-
-  // For managing changes in energy level while the device is running
-  std::condition_variable essl_cv_;
+  tms::TopicList measured_topics() const
+  {
+    return measurements_.enabled() ? tms::TopicList{ measurements_.topic() } : tms::TopicList();
+  }
 
-  powersim::ElectricCurrentDataWriter_var ec_dw_;
+  CurrentEmitter emitter_;
+  const float max_power_;
+  MeasurementPublisher measurements_;
 };
 
 
@@ -186,11 +369,29 @@ int main(int argc, char *argv[])
   DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
   const char *src_id = nullptr;
   bool verbose = false;
+  CurrentEmitter::Config config;
+  float max_power = SourceDevice::default_max_power;
+  ProfilePlayer::Config profile_config;
+  MeasurementPublisher::Config measurement_config;
+  int metrics_port = -1;
 
-  ACE_Get_Opt get_opt(argc, argv, "d:i:v");
+  ACE_Get_Opt get_opt(argc, argv, "d:i:r:pa:R:P:f:c:S:oM:V:DvE:");
   if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
       get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
-      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0) {
+      get_opt.long_option("rate", 'r', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("proportional", 'p', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("amperage", 'a', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("report", 'R', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("max-power", 'P', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile", 'f', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-column", 'c', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-speed", 'S', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("profile-once", 'o', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("measurement-rate", 'M', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("voltage", 'V', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("dc", 'D', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("verbose", 'v', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("metrics-port", 'E', ACE_Get_Opt::ARG_REQUIRED) != 0) {
     return 1;
   }
 
@@ -203,22 +404,84 @@ int main(int argc, char *argv[])
     case 'd':
       domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
       break;
+    case 'r':
+      config.rate = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'p':
+      config.proportional = true;
+      break;
+    case 'a':
+      config.amperage = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'R':
+      config.report_period = Sec(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'P':
+      max_power = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'f':
+      profile_config.path = get_opt.opt_arg();
+      break;
+    case 'c':
+      profile_config.column = get_opt.opt_arg();
+      break;
+    case 'S':
+      profile_config.speed = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'o':
+      profile_config.loop = false;
+      break;
+    case 'M':
+      measurement_config.rate = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'V':
+      measurement_config.voltage = static_cast<float>(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    case 'D':
+      measurement_config.dc = true;
+      break;
     case 'v':
       verbose = true;
       break;
+    case 'E':
+      metrics_port = ACE_OS::atoi(get_opt.opt_arg());
+      break;
     default:
       break;
     }
   }
 
-  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || src_id == nullptr) {
-    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Source_Device_Id [-v]\n", argv[0]));
+  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || src_id == nullptr || config.rate <= 0 || config.amperage <= 0 ||
+      max_power <= 0 || measurement_config.rate < 0 || measurement_config.voltage < 0 || metrics_port > 65535) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -i Source_Device_Id [-r Samples_Per_Second] [-p] "
+               "[-a Amperage] [-R Report_Period_Seconds] [-P Max_Power_Watts] "
+               "[-f Profile_File [-c Profile_Column] [-S Profile_Speed] [-o]] "
+               "[-M Measurements_Per_Second] [-V Voltage] [-D] [-v] [-E Metrics_Port]\n"
+               "  -p: the rate is for %.0f A and scales with the amperage\n"
+               "  -f: take the amperage from the column of the device in the profile\n"
+               "  -o: play the profile once instead of in a loop\n"
+               "  -M: rate of the measurement updates, 0 for none (default 1)\n"
+               "  -D: measure a DC port instead of an AC one\n"
+               "  -E: serve Prometheus metrics at http://127.0.0.1:Metrics_Port/metrics\n", argv[0], CurrentEmitter::nominal_amperage));
     return 1;
   }
 
-  SourceDevice src_dev(src_id, verbose);
+  ProfilePlayer profile;
+  if (!profile_config.path.empty()) {
+    if (!profile.open(profile_config, src_id)) {
+      return 1;
+    }
+    config.profile = &profile;
+  }
+
+  SourceDevice src_dev(src_id, config, measurement_config, max_power, verbose);
   if (src_dev.init(domain_id, argc, argv) != DDS::RETCODE_OK) {
     return 1;
   }
+  MetricsExporter exporter(src_id);
+  if (metrics_port >= 0 && !exporter.start(static_cast<u_short>(metrics_port))) {
+    return 1;
+  }
+  profile.start();
   return src_dev.run();
 }
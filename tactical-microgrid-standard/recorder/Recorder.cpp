@@ -0,0 +1,67 @@
+#include "TrafficParticipant.h"
+#include "TrafficRecorder.h"
+
+#include <ace/Get_Opt.h>
+
+int main(int argc, char* argv[])
+{
+  DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
+  const char* recorder_id = "recorder";
+  const char* path = nullptr;
+  TrafficRecorder::Config config;
+
+  ACE_Get_Opt get_opt(argc, argv, "d:i:o:F:");
+  if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("output", 'o', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("flush-period", 'F', ACE_Get_Opt::ARG_REQUIRED) != 0) {
+    return 1;
+  }
+
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'd':
+      domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
+      break;
+    case 'i':
+      recorder_id = get_opt.opt_arg();
+      break;
+    case 'o':
+      path = get_opt.opt_arg();
+      break;
+    case 'F':
+      config.flush_period = Sec(ACE_OS::strtod(get_opt.opt_arg(), nullptr));
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (domain_id == OpenDDS::DOMAIN_UNKNOWN || !path || config.flush_period.count() <= 0) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -d DDS_Domain_Id -o Log_File [-i Recorder_Id] [-F Flush_Period_Sec]\n"
+               "  Records every sample of the TMS domain and its simulation domain until interrupted\n",
+               argv[0]));
+    return 1;
+  }
+
+  TrafficLog::Writer log;
+  if (!log.open(path)) {
+    return 1;
+  }
+
+  TrafficParticipant participant(recorder_id);
+  if (participant.join(domain_id, argc, argv) != DDS::RETCODE_OK) {
+    return 1;
+  }
+
+  TrafficRecorder recorder(participant.get_reactor(), log, config);
+  if (recorder.add_domain(participant.get_domain_participant(), TrafficLog::Domain::Tms) != DDS::RETCODE_OK ||
+      recorder.add_domain(participant.get_sim_participant(), TrafficLog::Domain::Sim) != DDS::RETCODE_OK) {
+    return 1;
+  }
+  recorder.start();
+  const int status = participant.run();
+  recorder.stop();
+  return status;
+}
@@ -0,0 +1,152 @@
+#include "TrafficParticipant.h"
+#include "TrafficReplayer.h"
+
+#include <ace/Get_Opt.h>
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+void list(const TrafficLog::Reader& log)
+{
+  const double seconds = log.samples() ? (log.last_time() - log.first_time()) / 1e9 : 0.0;
+  std::printf("%" PRIu64 " samples over %.3f s, %" PRIu64 " bytes, %zu devices\n",
+              log.samples(), seconds, log.bytes(), log.devices().size());
+  std::printf("samples,topic,type\n");
+  for (size_t i = 0; i < log.topics().size(); ++i) {
+    const TrafficLog::Topic& topic = log.topics()[i];
+    std::printf("%" PRIu64 ",%s,%s\n", log.topic_samples()[i], topic.display_name().c_str(),
+                topic.type_name.c_str());
+  }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  DDS::DomainId_t domain_id = OpenDDS::DOMAIN_UNKNOWN;
+  const char* replayer_id = "replayer";
+  const char* path = nullptr;
+  bool list_only = false;
+  double begin = 0.0;
+  double end = -1.0;
+  double wait = 2.0;
+  TrafficReplayer::Config config;
+
+  ACE_Get_Opt get_opt(argc, argv, "d:i:f:ls:T:D:b:e:kw:");
+  if (get_opt.long_option("domain", 'd', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("id", 'i', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("file", 'f', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("list", 'l', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("speed", 's', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("topic", 'T', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("device", 'D', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("begin", 'b', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("end", 'e', ACE_Get_Opt::ARG_REQUIRED) != 0 ||
+      get_opt.long_option("keep-timestamps", 'k', ACE_Get_Opt::NO_ARG) != 0 ||
+      get_opt.long_option("wait", 'w', ACE_Get_Opt::ARG_REQUIRED) != 0) {
+    return 1;
+  }
+
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'd':
+      domain_id = static_cast<DDS::DomainId_t>(ACE_OS::atoi(get_opt.opt_arg()));
+      break;
+    case 'i':
+      replayer_id = get_opt.opt_arg();
+      break;
+    case 'f':
+      path = get_opt.opt_arg();
+      break;
+    case 'l':
+      list_only = true;
+      break;
+    case 's':
+      config.speed = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'T':
+      config.topics.insert(get_opt.opt_arg());
+      break;
+    case 'D':
+      config.devices.insert(get_opt.opt_arg());
+      break;
+    case 'b':
+      begin = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'e':
+      end = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    case 'k':
+      config.keep_timestamps = true;
+      break;
+    case 'w':
+      wait = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (!path || (!list_only && domain_id == OpenDDS::DOMAIN_UNKNOWN) || config.speed < 0) {
+    ACE_ERROR((LM_ERROR, "Usage: %C -f Log_File -l\n"
+               "       %C -f Log_File -d DDS_Domain_Id [-i Replayer_Id] [-s Speed] [-T Topic]... [-D Device]...\n"
+               "          [-b Begin_Sec] [-e End_Sec] [-k] [-w Wait_Sec]\n"
+               "  -l: list the topics recorded in the log\n"
+               "  -s: multiple of the recorded pace, 0 replays as fast as possible (default 1)\n"
+               "  -T, -D: replay only these topics (\"name\" or \"tms:name\", \"sim:name\") and devices\n"
+               "  -b, -e: replay from and until these seconds after the first sample\n"
+               "  -k: keep the recorded source timestamps\n"
+               "  -w: seconds to wait for readers before replaying (default 2)\n"
+               "Only samples with data are replayed, not the disposals and unregistrations of instances.\n",
+               argv[0], argv[0]));
+    return 1;
+  }
+
+  TrafficLog::Reader log;
+  if (!log.open(path)) {
+    return 1;
+  }
+  if (list_only) {
+    list(log);
+    return 0;
+  }
+  config.from = log.first_time() + static_cast<TrafficLog::Time>(begin * 1e9);
+  if (end >= 0) {
+    config.to = log.first_time() + static_cast<TrafficLog::Time>(end * 1e9);
+  }
+
+  TrafficParticipant participant(replayer_id);
+  if (participant.join(domain_id, argc, argv) != DDS::RETCODE_OK) {
+    return 1;
+  }
+
+  TrafficReplayer replayer(log, config);
+  if (replayer.init(participant.get_domain_participant(), participant.get_sim_participant()) != DDS::RETCODE_OK) {
+    return 1;
+  }
+
+  std::atomic<bool> interrupted{false};
+  participant.on_interrupt([&replayer, &interrupted] {
+    interrupted = true;
+    replayer.stop();
+  });
+
+  // Give the readers time to match, since the samples written before are lost to them
+  for (double waited = 0.0; waited < wait && !interrupted; waited += 0.1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: Replayer: %d readers matched\n", replayer.matched()));
+
+  const TrafficReplayer::Stats stats = replayer.run();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: Replayer: %Q samples, %Q bytes in %.3f s (%.0f samples/s), "
+             "at most %.3f s behind, %Q failed, %Q disposals and unregistrations skipped\n",
+             stats.samples, stats.bytes, stats.seconds, stats.seconds > 0 ? stats.samples / stats.seconds : 0.0,
+             stats.max_lag, stats.failed, stats.skipped));
+  return stats.failed ? 1 : 0;
+}
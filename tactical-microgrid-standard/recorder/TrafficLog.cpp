@@ -0,0 +1,298 @@
+#include "TrafficLog.h"
+
+#include <ace/Log_Msg.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace TrafficLog {
+
+namespace {
+
+// Buffered before writing to the file
+constexpr size_t buffer_size = 1 << 20;
+
+struct TopicBody {
+  uint8_t domain;
+  uint8_t has_keys;
+  uint8_t reliability;
+  uint8_t durability;
+  uint8_t ownership;
+};
+
+void append_string(std::string& out, const std::string& s)
+{
+  const uint16_t size = static_cast<uint16_t>(std::min<size_t>(s.size(), 0xffff));
+  out.append(reinterpret_cast<const char*>(&size), sizeof size);
+  out.append(s, 0, size);
+}
+
+bool read_string(const char*& pos, const char* end, std::string& s)
+{
+  uint16_t size;
+  if (end - pos < static_cast<ptrdiff_t>(sizeof size)) {
+    return false;
+  }
+  std::memcpy(&size, pos, sizeof size);
+  pos += sizeof size;
+  if (end - pos < size) {
+    return false;
+  }
+  s.assign(pos, size);
+  pos += size;
+  return true;
+}
+
+}
+
+const char Reader::magic[8] = {'T', 'M', 'S', 'T', 'R', 'A', 'F', '1'};
+
+const char* domain_name(Domain domain)
+{
+  return domain == Domain::Sim ? "sim" : "tms";
+}
+
+std::string Topic::display_name() const
+{
+  return std::string(domain_name(domain)) + ':' + name;
+}
+
+Writer::~Writer()
+{
+  close();
+}
+
+bool Writer::open(const std::string& path)
+{
+  SimpleGuard g(mutex_);
+  file_ = std::fopen(path.c_str(), "wbx");
+  if (!file_) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficLog::Writer::open: can't create \"%C\": %m\n", path.c_str()));
+    return false;
+  }
+  buffer_.reserve(buffer_size);
+  buffer_.insert(buffer_.end(), std::begin(Reader::magic), std::end(Reader::magic));
+  return true;
+}
+
+void Writer::close()
+{
+  flush();
+  SimpleGuard g(mutex_);
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+uint16_t Writer::topic(const Topic& topic)
+{
+  SimpleGuard g(mutex_);
+  const auto key = std::make_pair(topic.domain, topic.name);
+  const auto it = topics_.find(key);
+  if (it != topics_.end()) {
+    return it->second;
+  }
+
+  const uint16_t index = static_cast<uint16_t>(topics_.size());
+  const TopicBody fixed{static_cast<uint8_t>(topic.domain), topic.has_keys, topic.reliability,
+                        topic.durability, topic.ownership};
+  std::string names;
+  append_string(names, topic.name);
+  append_string(names, topic.type_name);
+
+  RecordHeader header{};
+  header.kind = TOPIC_RECORD;
+  header.topic = index;
+  write_record(header, &fixed, sizeof fixed, names.data(), names.size());
+  topics_.emplace(key, index);
+  stats_.topics = topics_.size();
+  return index;
+}
+
+uint16_t Writer::device(const std::string& device_id)
+{
+  if (device_id.empty()) {
+    return no_device;
+  }
+
+  SimpleGuard g(mutex_);
+  const auto it = devices_.find(device_id);
+  if (it != devices_.end()) {
+    return it->second;
+  }
+  if (devices_.size() >= no_device) {
+    return no_device;
+  }
+
+  const uint16_t index = static_cast<uint16_t>(devices_.size());
+  RecordHeader header{};
+  header.kind = DEVICE_RECORD;
+  header.device = index;
+  write_record(header, device_id.data(), device_id.size());
+  devices_.emplace(device_id, index);
+  stats_.devices = devices_.size();
+  return index;
+}
+
+void Writer::write(uint16_t topic, uint16_t device, uint8_t message_id, uint8_t flags, Time time,
+                   const ACE_Message_Block* payload)
+{
+  RecordHeader header{};
+  header.kind = SAMPLE_RECORD;
+  header.message_id = message_id;
+  header.flags = flags;
+  header.topic = topic;
+  header.device = device;
+  header.time = time;
+
+  SimpleGuard g(mutex_);
+  if (!file_) {
+    return;
+  }
+  header.size = static_cast<uint32_t>(payload ? payload->total_length() : 0);
+  write_record(header, nullptr, 0);
+  for (const ACE_Message_Block* mb = payload; mb; mb = mb->cont()) {
+    buffer_.insert(buffer_.end(), mb->rd_ptr(), mb->rd_ptr() + mb->length());
+  }
+  ++stats_.samples;
+  if (buffer_.size() >= buffer_size) {
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    buffer_.clear();
+  }
+}
+
+void Writer::write_record(RecordHeader header, const void* body1, size_t size1, const void* body2, size_t size2)
+{
+  if (header.kind != SAMPLE_RECORD) {
+    header.size = static_cast<uint32_t>(size1 + size2);
+  }
+  const char* h = reinterpret_cast<const char*>(&header);
+  buffer_.insert(buffer_.end(), h, h + sizeof header);
+  if (size1) {
+    buffer_.insert(buffer_.end(), static_cast<const char*>(body1), static_cast<const char*>(body1) + size1);
+  }
+  if (size2) {
+    buffer_.insert(buffer_.end(), static_cast<const char*>(body2), static_cast<const char*>(body2) + size2);
+  }
+  stats_.bytes += sizeof header + header.size;
+}
+
+void Writer::flush()
+{
+  SimpleGuard g(mutex_);
+  if (!file_) {
+    return;
+  }
+  if (!buffer_.empty()) {
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    buffer_.clear();
+  }
+  std::fflush(file_);
+}
+
+Writer::Stats Writer::stats() const
+{
+  SimpleGuard g(mutex_);
+  return stats_;
+}
+
+bool Reader::open(const std::string& path)
+{
+  map_.reset(new ACE_Mem_Map);
+  if (map_->map(ACE_TEXT_CHAR_TO_TCHAR(path.c_str()), static_cast<size_t>(-1), O_RDONLY,
+                ACE_DEFAULT_FILE_PERMS, PROT_READ, ACE_MAP_SHARED) == -1 || !map_->addr()) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficLog::Reader::open: can't map \"%C\": %m\n", path.c_str()));
+    return false;
+  }
+  const size_t size = map_->size();
+  if (size < sizeof magic || std::memcmp(base(), magic, sizeof magic) != 0) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficLog::Reader::open: \"%C\" isn't a traffic log\n", path.c_str()));
+    return false;
+  }
+
+  size_t offset = begin();
+  Time latest = 0;
+  while (offset + sizeof(RecordHeader) <= size) {
+    const RecordHeader* h = header(offset);
+    if (h->size > size - offset - sizeof(RecordHeader)) {
+      break;
+    }
+    if (h->kind == SAMPLE_RECORD) {
+      if (h->topic >= topics_.size()) {
+        break;
+      }
+      if (samples_ % index_interval == 0) {
+        index_.emplace_back(latest, offset);
+      }
+      const Time time = h->time;
+      latest = samples_ ? std::max(latest, time) : time;
+      first_time_ = samples_ ? std::min(first_time_, time) : time;
+      ++topic_samples_[h->topic];
+      ++samples_;
+    } else if (!define(*h, base() + offset + sizeof(RecordHeader))) {
+      break;
+    }
+    offset += sizeof(RecordHeader) + h->size;
+  }
+  end_ = offset;
+  last_time_ = latest;
+  return true;
+}
+
+bool Reader::define(const RecordHeader& h, const char* body)
+{
+  const char* const end = body + h.size;
+  if (h.kind == TOPIC_RECORD) {
+    TopicBody fixed;
+    if (h.topic != topics_.size() || h.size < sizeof fixed) {
+      return false;
+    }
+    std::memcpy(&fixed, body, sizeof fixed);
+    Topic topic;
+    topic.domain = static_cast<Domain>(fixed.domain);
+    topic.has_keys = fixed.has_keys;
+    topic.reliability = fixed.reliability;
+    topic.durability = fixed.durability;
+    topic.ownership = fixed.ownership;
+    body += sizeof fixed;
+    if (!read_string(body, end, topic.name) || !read_string(body, end, topic.type_name)) {
+      return false;
+    }
+    topics_.push_back(std::move(topic));
+    topic_samples_.push_back(0);
+    return true;
+  }
+  if (h.kind == DEVICE_RECORD) {
+    if (h.device != devices_.size()) {
+      return false;
+    }
+    devices_.emplace_back(body, h.size);
+    return true;
+  }
+  return false;
+}
+
+size_t Reader::seek(Time from) const
+{
+  // The samples before an index entry are all earlier than its time
+  const auto it = std::lower_bound(index_.begin(), index_.end(), from,
+    [](const std::pair<Time, size_t>& entry, Time t) { return entry.first < t; });
+  return it == index_.begin() ? begin() : std::prev(it)->second;
+}
+
+bool Reader::next(size_t& offset, Sample& sample) const
+{
+  while (offset < end_) {
+    const RecordHeader* h = header(offset);
+    offset += sizeof(RecordHeader) + h->size;
+    if (h->kind == SAMPLE_RECORD) {
+      sample.header = h;
+      sample.payload = reinterpret_cast<const char*>(h + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+}
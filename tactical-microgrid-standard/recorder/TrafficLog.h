@@ -0,0 +1,220 @@
+#ifndef RECORDER_TRAFFIC_LOG_H
+#define RECORDER_TRAFFIC_LOG_H
+
+#include <common/ProfiledMutex.h>
+
+#include <ace/Mem_Map.h>
+#include <ace/Message_Block.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Log of the samples recorded on the TMS and simulation domains.
+ *
+ * The log is a file starting with a magic string and followed by records,
+ * each with a fixed-size header and the bytes of its body. Topics and devices
+ * are defined by a record the first time they're used, and samples refer to
+ * them by index. The body of a sample is its serialized payload as received,
+ * so it can be written again without knowing its type.
+ *
+ * The reader maps the file and scans the record headers to build the tables
+ * of topics and devices and a sparse index of the sample times, and it stops
+ * at the first record cut short if the recorder didn't get to finish it.
+ */
+namespace TrafficLog {
+
+// Nanoseconds since the Unix epoch
+using Time = int64_t;
+
+enum class Domain : uint8_t {
+  Tms,
+  Sim,
+};
+
+const char* domain_name(Domain domain);
+
+enum RecordKind : uint8_t {
+  TOPIC_RECORD,
+  DEVICE_RECORD,
+  SAMPLE_RECORD,
+};
+
+// Flags of a sample record
+enum : uint8_t {
+  BYTE_ORDER_FLAG = 1,
+  CDR_ENCAPSULATION_FLAG = 2,
+  KEY_FIELDS_ONLY_FLAG = 4,
+};
+
+constexpr uint16_t no_device = 0xffff;
+
+#pragma pack(push, 1)
+struct RecordHeader {
+  // Bytes of the body following the header
+  uint32_t size;
+  uint8_t kind;
+  // OpenDDS::DCPS::MessageId of a sample
+  uint8_t message_id;
+  uint8_t flags;
+  uint8_t reserved;
+  uint16_t topic;
+  uint16_t device;
+  Time time;
+};
+#pragma pack(pop)
+
+struct Topic {
+  Domain domain = Domain::Tms;
+  std::string name;
+  std::string type_name;
+  bool has_keys = true;
+  // Kinds of the QoS policies of the writers that were recorded
+  uint8_t reliability = 0;
+  uint8_t durability = 0;
+  uint8_t ownership = 0;
+
+  std::string display_name() const;
+};
+
+struct Sample {
+  const RecordHeader* header = nullptr;
+  const char* payload = nullptr;
+};
+
+class Writer {
+public:
+  struct Stats {
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+    size_t topics = 0;
+    size_t devices = 0;
+  };
+
+  Writer() = default;
+  ~Writer();
+
+  // Create a log, failing if the file already exists
+  bool open(const std::string& path);
+  void close();
+
+  // Index of a topic, defined in the log the first time
+  uint16_t topic(const Topic& topic);
+
+  // Index of a device, no_device if empty or there are too many
+  uint16_t device(const std::string& device_id);
+
+  void write(uint16_t topic, uint16_t device, uint8_t message_id, uint8_t flags, Time time,
+             const ACE_Message_Block* payload);
+
+  // Write the buffered records to the file
+  void flush();
+
+  Stats stats() const;
+
+private:
+  // Caller must hold mutex_
+  void write_record(RecordHeader header, const void* body1, size_t size1, const void* body2 = nullptr,
+                    size_t size2 = 0);
+
+  mutable SimpleMutex mutex_{"TrafficLog::Writer"};
+  std::FILE* file_ = nullptr;
+  std::vector<char> buffer_;
+  std::map<std::pair<Domain, std::string>, uint16_t> topics_;
+  std::map<std::string, uint16_t> devices_;
+  Stats stats_;
+};
+
+class Reader {
+public:
+  // Index of sample records every this many samples
+  static constexpr size_t index_interval = 1024;
+
+  Reader() = default;
+
+  bool open(const std::string& path);
+
+  const std::vector<Topic>& topics() const
+  {
+    return topics_;
+  }
+
+  const std::vector<std::string>& devices() const
+  {
+    return devices_;
+  }
+
+  // Samples of each topic
+  const std::vector<uint64_t>& topic_samples() const
+  {
+    return topic_samples_;
+  }
+
+  uint64_t samples() const
+  {
+    return samples_;
+  }
+
+  uint64_t bytes() const
+  {
+    return end_;
+  }
+
+  Time first_time() const
+  {
+    return first_time_;
+  }
+
+  Time last_time() const
+  {
+    return last_time_;
+  }
+
+  // Offset of the first record to read for the samples from a time on
+  size_t seek(Time from) const;
+
+  // Read the sample at or after an offset and advance the offset past it,
+  // false at the end of the log
+  bool next(size_t& offset, Sample& sample) const;
+
+  static size_t begin()
+  {
+    return sizeof magic;
+  }
+
+  static const char magic[8];
+
+private:
+  const RecordHeader* header(size_t offset) const
+  {
+    return reinterpret_cast<const RecordHeader*>(base() + offset);
+  }
+
+  const char* base() const
+  {
+    return static_cast<const char*>(map_->addr());
+  }
+
+  bool define(const RecordHeader& header, const char* body);
+
+  std::unique_ptr<ACE_Mem_Map> map_;
+  // Offset past the last complete record
+  size_t end_ = 0;
+  std::vector<Topic> topics_;
+  std::vector<std::string> devices_;
+  std::vector<uint64_t> topic_samples_;
+  uint64_t samples_ = 0;
+  Time first_time_ = 0;
+  Time last_time_ = 0;
+
+  // Latest time so far and offset of every index_interval-th sample
+  std::vector<std::pair<Time, size_t>> index_;
+};
+
+}
+
+#endif
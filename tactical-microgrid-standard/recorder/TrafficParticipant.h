@@ -0,0 +1,78 @@
+#ifndef RECORDER_TRAFFIC_PARTICIPANT_H
+#define RECORDER_TRAFFIC_PARTICIPANT_H
+
+#include <common/Handshaking.h>
+#include <common/Utils.h>
+
+#include <functional>
+
+// Joins a TMS domain and its simulation domain without taking part in them,
+// and runs the reactor until interrupted
+class TrafficParticipant : public Handshaking {
+public:
+  explicit TrafficParticipant(const tms::Identity& id)
+    : Handshaking(id)
+  {
+  }
+
+  ~TrafficParticipant()
+  {
+    delete_entities(sim_participant_);
+  }
+
+  DDS::ReturnCode_t join(DDS::DomainId_t domain_id, int argc, char* argv[])
+  {
+    const DDS::ReturnCode_t rc = join_domain(domain_id, argc, argv);
+    if (rc != DDS::RETCODE_OK) {
+      return rc;
+    }
+
+    sim_participant_ = get_participant_factory()->create_participant(Utils::get_sim_domain_id(domain_id),
+                                                                     PARTICIPANT_QOS_DEFAULT,
+                                                                     nullptr,
+                                                                     ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!sim_participant_) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficParticipant::join: create simulation participant failed\n"));
+      return DDS::RETCODE_ERROR;
+    }
+    Utils::setup_sim_transport(sim_participant_);
+    reactor_->register_handler(SIGINT, this);
+    return DDS::RETCODE_OK;
+  }
+
+  DDS::DomainParticipant_var get_sim_participant() const
+  {
+    return sim_participant_;
+  }
+
+  // Called from the signal handler when interrupted
+  void on_interrupt(std::function<void()> callback)
+  {
+    on_interrupt_ = callback;
+  }
+
+  int run()
+  {
+    return reactor_->run_reactor_event_loop() == 0 ? 0 : 1;
+  }
+
+  int handle_signal(int, siginfo_t*, ucontext_t*) override
+  {
+    if (on_interrupt_) {
+      on_interrupt_();
+    }
+    reactor_->end_reactor_event_loop();
+    return -1;
+  }
+
+private:
+  void delete_extra_entities() override
+  {
+    delete_entities(sim_participant_);
+  }
+
+  DDS::DomainParticipant_var sim_participant_;
+  std::function<void()> on_interrupt_;
+};
+
+#endif
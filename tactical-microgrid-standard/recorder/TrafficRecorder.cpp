@@ -0,0 +1,241 @@
+#include "TrafficRecorder.h"
+
+#include <dds/DCPS/BuiltInTopicUtils.h>
+#include <dds/DCPS/DCPS_Utils.h>
+#include <dds/DCPS/DataSampleHeader.h>
+#include <dds/DCPS/Marked_Default_Qos.h>
+#include <dds/DCPS/RawDataSample.h>
+#include <dds/DCPS/Service_Participant.h>
+#include <dds/DCPS/XTypes/Utils.h>
+#include <dds/DCPS/debug.h>
+
+namespace {
+
+// The first string key of a sample, which is the device of the TMS topics and
+// the device, next hop or controller of the simulation topics
+std::string key_device(DDS::DynamicData_ptr dd)
+{
+  DDS::DynamicType_var type = dd->type();
+  const CORBA::ULong count = type->get_member_count();
+  for (CORBA::ULong i = 0; i < count; ++i) {
+    DDS::DynamicTypeMember_var member;
+    DDS::MemberDescriptor_var md;
+    if (type->get_member_by_index(member, i) != DDS::RETCODE_OK ||
+        member->get_descriptor(md) != DDS::RETCODE_OK || !md->is_key()) {
+      continue;
+    }
+    DDS::DynamicType_var member_type = md->type();
+    const DDS::DynamicType_var base_type = OpenDDS::XTypes::get_base_type(member_type);
+    if (base_type->get_kind() != OpenDDS::XTypes::TK_STRING8) {
+      continue;
+    }
+    CORBA::String_var value;
+    if (dd->get_string_value(value, md->id()) == DDS::RETCODE_OK) {
+      return value.in();
+    }
+  }
+  return std::string();
+}
+
+}
+
+void TrafficRecorder::Listener::on_sample_data_received(OpenDDS::DCPS::Recorder* recorder,
+                                                        const OpenDDS::DCPS::RawDataSample& sample)
+{
+  recorder_.received(recorder, sample);
+}
+
+void TrafficRecorder::Listener::on_recorder_matched(OpenDDS::DCPS::Recorder*,
+                                                    const DDS::SubscriptionMatchedStatus& status)
+{
+  if (OpenDDS::DCPS::DCPS_debug_level >= 8) {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: TrafficRecorder::on_recorder_matched: %d writers\n",
+               status.current_count));
+  }
+}
+
+TrafficRecorder::TrafficRecorder(ACE_Reactor* reactor, TrafficLog::Writer& log, const Config& config)
+  : TimerHandler(reactor, "TrafficRecorder")
+  , log_(log)
+  , config_(config)
+  , listener_(OpenDDS::DCPS::make_rch<Listener>(*this))
+{
+}
+
+TrafficRecorder::~TrafficRecorder()
+{
+  stop();
+
+  SimpleGuard g(recorders_mutex_);
+  for (const auto& recorder : recorders_) {
+    TheServiceParticipant->delete_recorder(recorder.first);
+  }
+  recorders_.clear();
+}
+
+DDS::ReturnCode_t TrafficRecorder::add_domain(DDS::DomainParticipant_ptr dp, TrafficLog::Domain domain)
+{
+  DDS::Subscriber_var bit_sub = dp->get_builtin_subscriber();
+  DDS::DataReader_var dr = bit_sub ? bit_sub->lookup_datareader(OpenDDS::DCPS::BUILT_IN_PUBLICATION_TOPIC) : nullptr;
+  DDS::PublicationBuiltinTopicDataDataReader_var publications =
+    DDS::PublicationBuiltinTopicDataDataReader::_narrow(dr);
+  if (!publications) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficRecorder::add_domain: no built-in publication reader "
+               "on the %C domain, are the built-in topics disabled?\n", TrafficLog::domain_name(domain)));
+    return DDS::RETCODE_ERROR;
+  }
+
+  Guard g(lock_);
+  Participant participant;
+  participant.dp = DDS::DomainParticipant::_duplicate(dp);
+  participant.domain = domain;
+  participant.publications = publications;
+  participants_.push_back(participant);
+  return DDS::RETCODE_OK;
+}
+
+void TrafficRecorder::start()
+{
+  Guard g(lock_);
+  if (get_timer<DiscoverTopicsEvent>()->active()) {
+    return;
+  }
+  schedule(DiscoverTopicsEvent(), config_.discover_period);
+  schedule(FlushTrafficEvent(), config_.flush_period);
+}
+
+void TrafficRecorder::stop()
+{
+  Guard g(lock_);
+  if (!get_timer<DiscoverTopicsEvent>()->active()) {
+    return;
+  }
+  cancel<DiscoverTopicsEvent>();
+  cancel<FlushTrafficEvent>();
+  log_.flush();
+
+  const TrafficLog::Writer::Stats s = log_.stats();
+  ACE_DEBUG((LM_INFO, "(%P|%t) INFO: TrafficRecorder::stop: recorded %Q samples of %B topics and %B devices, "
+             "%Q bytes\n", s.samples, s.topics, s.devices, s.bytes));
+}
+
+void TrafficRecorder::discover(Participant& participant)
+{
+  DDS::PublicationBuiltinTopicDataSeq data;
+  DDS::SampleInfoSeq infos;
+  const DDS::ReturnCode_t rc = participant.publications->take(data, infos, DDS::LENGTH_UNLIMITED,
+    DDS::NOT_READ_SAMPLE_STATE, DDS::ANY_VIEW_STATE, DDS::ALIVE_INSTANCE_STATE);
+  if (rc == DDS::RETCODE_NO_DATA) {
+    return;
+  }
+  if (rc != DDS::RETCODE_OK) {
+    ACE_ERROR((LM_WARNING, "(%P|%t) WARNING: TrafficRecorder::discover: take failed (%C)\n",
+               OpenDDS::DCPS::retcode_to_string(rc)));
+    return;
+  }
+
+  for (CORBA::ULong i = 0; i < data.length(); ++i) {
+    if (infos[i].valid_data && participant.topics.count(data[i].topic_name.in()) == 0) {
+      record(participant, data[i]);
+    }
+  }
+  participant.publications->return_loan(data, infos);
+}
+
+void TrafficRecorder::record(Participant& participant, const DDS::PublicationBuiltinTopicData& publication)
+{
+  const std::string topic_name = publication.topic_name.in();
+  participant.topics.insert(topic_name);
+
+  // The entity kind of the writer tells if its type has keys
+  const bool has_keys = publication.key.value[15] == OpenDDS::DCPS::ENTITYKIND_USER_WRITER_WITH_KEY;
+  DDS::Topic_var topic = TheServiceParticipant->create_typeless_topic(participant.dp, topic_name.c_str(),
+    publication.type_name.in(), has_keys, TOPIC_QOS_DEFAULT, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!topic) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficRecorder::record: create_typeless_topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return;
+  }
+
+  // Request what the writer offers so that it matches. Writers of the topic
+  // with other partitions or ownership than the first one aren't recorded.
+  DDS::SubscriberQos sub_qos;
+  participant.dp->get_default_subscriber_qos(sub_qos);
+  sub_qos.presentation = publication.presentation;
+  sub_qos.partition = publication.partition;
+  DDS::DataReaderQos dr_qos = TheServiceParticipant->initial_DataReaderQos();
+  dr_qos.reliability.kind = publication.reliability.kind;
+  dr_qos.durability.kind = publication.durability.kind;
+  dr_qos.ownership.kind = publication.ownership.kind;
+
+  TrafficLog::Topic log_topic;
+  log_topic.domain = participant.domain;
+  log_topic.name = topic_name;
+  log_topic.type_name = publication.type_name.in();
+  log_topic.has_keys = has_keys;
+  log_topic.reliability = static_cast<uint8_t>(publication.reliability.kind);
+  log_topic.durability = static_cast<uint8_t>(publication.durability.kind);
+  log_topic.ownership = static_cast<uint8_t>(publication.ownership.kind);
+
+  const RecordedTopic recorded{log_.topic(log_topic), has_keys};
+
+  // Samples received before the recorder is added wait for it
+  SimpleGuard g(recorders_mutex_);
+  OpenDDS::DCPS::Recorder_ptr recorder =
+    TheServiceParticipant->create_recorder(participant.dp, topic, sub_qos, dr_qos, listener_);
+  if (!recorder) {
+    ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficRecorder::record: create_recorder for topic \"%C\" failed\n",
+               topic_name.c_str()));
+    return;
+  }
+  recorders_[recorder] = recorded;
+  if (OpenDDS::DCPS::DCPS_debug_level > 0) {
+    ACE_DEBUG((LM_INFO, "(%P|%t) INFO: TrafficRecorder::record: recording \"%C\" on the %C domain\n",
+               topic_name.c_str(), TrafficLog::domain_name(participant.domain)));
+  }
+}
+
+void TrafficRecorder::received(OpenDDS::DCPS::Recorder* recorder, const OpenDDS::DCPS::RawDataSample& sample)
+{
+  RecordedTopic topic;
+  {
+    SimpleGuard g(recorders_mutex_);
+    const auto it = recorders_.find(recorder);
+    if (it == recorders_.end()) {
+      return;
+    }
+    topic = it->second;
+  }
+
+  uint16_t device = TrafficLog::no_device;
+  if (topic.has_keys && sample.message_id_ == OpenDDS::DCPS::SAMPLE_DATA) {
+    DDS::DynamicData_var dd = recorder->get_dynamic_data(sample);
+    if (dd) {
+      device = log_.device(key_device(dd));
+    }
+  }
+
+  const uint8_t flags = (sample.sample_byte_order_ ? TrafficLog::BYTE_ORDER_FLAG : 0) |
+    (sample.header_.cdr_encapsulation_ ? TrafficLog::CDR_ENCAPSULATION_FLAG : 0) |
+    (sample.header_.key_fields_only_ ? TrafficLog::KEY_FIELDS_ONLY_FLAG : 0);
+  const TrafficLog::Time time =
+    static_cast<TrafficLog::Time>(sample.source_timestamp_.sec) * 1000000000 + sample.source_timestamp_.nanosec;
+  log_.write(topic.index, device, static_cast<uint8_t>(sample.message_id_), flags, time, sample.sample_.get());
+}
+
+void TrafficRecorder::timer_fired(Timer<DiscoverTopicsEvent>&)
+{
+  for (Participant& participant : participants_) {
+    discover(participant);
+  }
+}
+
+void TrafficRecorder::timer_fired(Timer<FlushTrafficEvent>&)
+{
+  log_.flush();
+}
+
+void TrafficRecorder::any_timer_fired(AnyTimer timer)
+{
+  std::visit([&](auto&& value) { this->timer_fired(*value); }, timer);
+}
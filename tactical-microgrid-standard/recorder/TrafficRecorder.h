@@ -0,0 +1,98 @@
+#ifndef RECORDER_TRAFFIC_RECORDER_H
+#define RECORDER_TRAFFIC_RECORDER_H
+
+#include "TrafficLog.h"
+
+#include <common/TimerHandler.h>
+
+#include <dds/DCPS/Recorder.h>
+#include <dds/DdsDcpsCoreTypeSupportImpl.h>
+
+#include <map>
+#include <set>
+
+struct DiscoverTopicsEvent {
+  static const char* name() { return "DiscoverTopics"; }
+};
+
+struct FlushTrafficEvent {
+  static const char* name() { return "FlushTraffic"; }
+};
+
+/**
+ * Records every sample published on the domains it's given to a TrafficLog.
+ *
+ * The publications discovered on each domain are read from the built-in
+ * topic periodically, and a recorder is created for each new topic with the
+ * QoS of the first writer seen, so it matches the writers of the topic like
+ * their regular readers do. The recorders receive the serialized samples
+ * without needing the types, and the device of a sample is read from the first
+ * string key of its type when the type is known through discovery.
+ */
+class TrafficRecorder : public TimerHandler<DiscoverTopicsEvent, FlushTrafficEvent> {
+public:
+  struct Config {
+    // How often new publications are looked for
+    Sec discover_period = Sec(1);
+    // How often the log is written to the file
+    Sec flush_period = Sec(1);
+  };
+
+  TrafficRecorder(ACE_Reactor* reactor, TrafficLog::Writer& log, const Config& config);
+  ~TrafficRecorder();
+
+  DDS::ReturnCode_t add_domain(DDS::DomainParticipant_ptr dp, TrafficLog::Domain domain);
+
+  void start();
+  void stop();
+
+private:
+  class Listener : public OpenDDS::DCPS::RecorderListener {
+  public:
+    explicit Listener(TrafficRecorder& recorder)
+      : recorder_(recorder)
+    {
+    }
+
+    void on_sample_data_received(OpenDDS::DCPS::Recorder* recorder,
+                                 const OpenDDS::DCPS::RawDataSample& sample) override;
+
+    void on_recorder_matched(OpenDDS::DCPS::Recorder* recorder,
+                             const DDS::SubscriptionMatchedStatus& status) override;
+
+  private:
+    TrafficRecorder& recorder_;
+  };
+
+  struct Participant {
+    DDS::DomainParticipant_var dp;
+    TrafficLog::Domain domain;
+    DDS::PublicationBuiltinTopicDataDataReader_var publications;
+    std::set<std::string> topics;
+  };
+
+  struct RecordedTopic {
+    uint16_t index;
+    bool has_keys;
+  };
+
+  void discover(Participant& participant);
+  void record(Participant& participant, const DDS::PublicationBuiltinTopicData& publication);
+  void received(OpenDDS::DCPS::Recorder* recorder, const OpenDDS::DCPS::RawDataSample& sample);
+
+  void timer_fired(Timer<DiscoverTopicsEvent>&);
+  void timer_fired(Timer<FlushTrafficEvent>&);
+  void any_timer_fired(AnyTimer timer) final;
+
+  TrafficLog::Writer& log_;
+  const Config config_;
+  OpenDDS::DCPS::RecorderListener_rch listener_;
+  std::vector<Participant> participants_;
+
+  // The recorders are only added to by the reactor thread, but looked up by
+  // the threads receiving samples
+  mutable SimpleMutex recorders_mutex_{"TrafficRecorder::recorders"};
+  std::map<OpenDDS::DCPS::Recorder*, RecordedTopic> recorders_;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "TrafficReplayer.h"
+
+#include <dds/DCPS/DataSampleHeader.h>
+#include <dds/DCPS/Marked_Default_Qos.h>
+#include <dds/DCPS/RawDataSample.h>
+#include <dds/DCPS/Service_Participant.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+DDS::Time_t to_dds_time(TrafficLog::Time t)
+{
+  DDS::Time_t ts;
+  ts.sec = static_cast<CORBA::Long>(t / 1000000000);
+  ts.nanosec = static_cast<CORBA::ULong>(t % 1000000000);
+  return ts;
+}
+
+}
+
+TrafficReplayer::TrafficReplayer(const TrafficLog::Reader& log, const Config& config)
+  : log_(log)
+  , config_(config)
+  , listener_(OpenDDS::DCPS::make_rch<Listener>(matched_))
+{
+}
+
+TrafficReplayer::~TrafficReplayer()
+{
+  for (const OpenDDS::DCPS::Replayer_ptr replayer : replayers_) {
+    if (replayer) {
+      TheServiceParticipant->delete_replayer(replayer);
+    }
+  }
+}
+
+bool TrafficReplayer::selected(const TrafficLog::Topic& topic) const
+{
+  return config_.topics.empty() || config_.topics.count(topic.name) || config_.topics.count(topic.display_name());
+}
+
+DDS::ReturnCode_t TrafficReplayer::init(DDS::DomainParticipant_ptr tms_dp, DDS::DomainParticipant_ptr sim_dp)
+{
+  for (const std::string& device : log_.devices()) {
+    devices_.push_back(config_.devices.empty() || config_.devices.count(device));
+  }
+
+  for (const TrafficLog::Topic& topic : log_.topics()) {
+    replayers_.push_back(nullptr);
+    if (!selected(topic)) {
+      continue;
+    }
+
+    DDS::DomainParticipant_ptr dp = topic.domain == TrafficLog::Domain::Sim ? sim_dp : tms_dp;
+    DDS::Topic_var dds_topic = TheServiceParticipant->create_typeless_topic(dp, topic.name.c_str(),
+      topic.type_name.c_str(), topic.has_keys, TOPIC_QOS_DEFAULT, nullptr, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!dds_topic) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficReplayer::init: create_typeless_topic \"%C\" failed\n",
+                 topic.display_name().c_str()));
+      return DDS::RETCODE_ERROR;
+    }
+
+    DDS::PublisherQos pub_qos;
+    dp->get_default_publisher_qos(pub_qos);
+    DDS::DataWriterQos dw_qos = TheServiceParticipant->initial_DataWriterQos();
+    dw_qos.reliability.kind = static_cast<DDS::ReliabilityQosPolicyKind>(topic.reliability);
+    dw_qos.durability.kind = static_cast<DDS::DurabilityQosPolicyKind>(topic.durability);
+    dw_qos.ownership.kind = static_cast<DDS::OwnershipQosPolicyKind>(topic.ownership);
+
+    replayers_.back() = TheServiceParticipant->create_replayer(dp, dds_topic, pub_qos, dw_qos, listener_);
+    if (!replayers_.back()) {
+      ACE_ERROR((LM_ERROR, "(%P|%t) ERROR: TrafficReplayer::init: create_replayer for topic \"%C\" failed\n",
+                 topic.display_name().c_str()));
+      return DDS::RETCODE_ERROR;
+    }
+  }
+  return DDS::RETCODE_OK;
+}
+
+TrafficReplayer::Stats TrafficReplayer::run()
+{
+  using Steady = std::chrono::steady_clock;
+  const bool paced = config_.speed > 0;
+  const auto start = Steady::now();
+
+  Stats stats;
+  bool started = false;
+  TrafficLog::Time first = 0;
+  TrafficLog::Time latest = 0;
+  TrafficLog::Sample sample;
+  for (size_t offset = log_.seek(config_.from); !stop_ && log_.next(offset, sample);) {
+    const TrafficLog::RecordHeader& h = *sample.header;
+    const TrafficLog::Time time = h.time;
+    const OpenDDS::DCPS::Replayer_ptr replayer = replayers_[h.topic];
+    if (!replayer || time < config_.from || time >= config_.to ||
+        (!config_.devices.empty() && (h.device >= devices_.size() || !devices_[h.device]))) {
+      continue;
+    }
+    if (h.message_id != OpenDDS::DCPS::SAMPLE_DATA) {
+      ++stats.skipped;
+      continue;
+    }
+
+    // Samples of different writers can be slightly out of order, which
+    // doesn't set the pace back
+    if (paced) {
+      if (!started) {
+        first = latest = time;
+        started = true;
+      }
+      latest = std::max(latest, time);
+      const auto due = start + std::chrono::duration_cast<Steady::duration>(
+        std::chrono::duration<double>((latest - first) / 1e9 / config_.speed));
+      const auto now = Steady::now();
+      if (due > now) {
+        std::this_thread::sleep_until(due);
+      } else {
+        stats.max_lag = std::max(stats.max_lag, std::chrono::duration<double>(now - due).count());
+      }
+    }
+
+    OpenDDS::DCPS::RawDataSample raw;
+    raw.message_id_ = OpenDDS::DCPS::SAMPLE_DATA;
+    raw.header_.message_id_ = OpenDDS::DCPS::SAMPLE_DATA;
+    raw.sample_byte_order_ = h.flags & TrafficLog::BYTE_ORDER_FLAG;
+    raw.header_.byte_order_ = raw.sample_byte_order_;
+    raw.header_.cdr_encapsulation_ = h.flags & TrafficLog::CDR_ENCAPSULATION_FLAG;
+    raw.header_.key_fields_only_ = h.flags & TrafficLog::KEY_FIELDS_ONLY_FLAG;
+    raw.source_timestamp_ = config_.keep_timestamps ? to_dds_time(time) :
+      to_dds_time(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    raw.header_.source_timestamp_sec_ = raw.source_timestamp_.sec;
+    raw.header_.source_timestamp_nanosec_ = raw.source_timestamp_.nanosec;
+
+    // Refers to the payload in the mapped log without copying it
+    ACE_Message_Block* payload = new ACE_Message_Block(sample.payload, h.size);
+    payload->wr_ptr(h.size);
+    raw.sample_.reset(payload);
+
+    if (replayer->write(raw) == DDS::RETCODE_OK) {
+      ++stats.samples;
+      stats.bytes += h.size;
+    } else {
+      ++stats.failed;
+    }
+  }
+
+  stats.seconds = std::chrono::duration<double>(Steady::now() - start).count();
+  return stats;
+}
@@ -0,0 +1,102 @@
+#ifndef RECORDER_TRAFFIC_REPLAYER_H
+#define RECORDER_TRAFFIC_REPLAYER_H
+
+#include "TrafficLog.h"
+
+#include <dds/DCPS/Replayer.h>
+
+#include <atomic>
+#include <limits>
+#include <set>
+
+/**
+ * Republishes the samples of a TrafficLog on the TMS and simulation domains.
+ *
+ * A replayer is created for each recorded topic that isn't filtered out, with
+ * the reliability, durability and ownership of the writers that were
+ * recorded, and the samples are written as they were serialized. They're
+ * paced by their source timestamps, scaled by the speed, or written as fast as
+ * the replayers take them. The payloads refer to the mapped log, so the reader
+ * must outlive the replayer.
+ *
+ * Only samples with data are replayed. OpenDDS replayers write every sample as
+ * data, so the recorded disposals and unregistrations of instances are skipped
+ * and counted instead, and readers keep those instances alive.
+ */
+class TrafficReplayer {
+public:
+  struct Config {
+    // Multiple of the recorded rate, or as fast as possible if zero
+    double speed = 1.0;
+    // Source timestamps of the samples replayed, in [from, to)
+    TrafficLog::Time from = std::numeric_limits<TrafficLog::Time>::min();
+    TrafficLog::Time to = std::numeric_limits<TrafficLog::Time>::max();
+    // Topics, as "name" or "domain:name", and devices replayed, all if empty
+    std::set<std::string> topics;
+    std::set<std::string> devices;
+    // Write the recorded source timestamps instead of the times of the replay
+    bool keep_timestamps = false;
+  };
+
+  struct Stats {
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+    uint64_t failed = 0;
+    // Disposals and unregistrations, which can't be replayed
+    uint64_t skipped = 0;
+    double seconds = 0.0;
+    // Most the replay fell behind the recorded pace
+    double max_lag = 0.0;
+  };
+
+  TrafficReplayer(const TrafficLog::Reader& log, const Config& config);
+  ~TrafficReplayer();
+
+  DDS::ReturnCode_t init(DDS::DomainParticipant_ptr tms_dp, DDS::DomainParticipant_ptr sim_dp);
+
+  // Readers matched by the replayers so far
+  int matched() const
+  {
+    return matched_;
+  }
+
+  // Replay the log on the calling thread until its end or stop()
+  Stats run();
+
+  void stop()
+  {
+    stop_ = true;
+  }
+
+private:
+  class Listener : public OpenDDS::DCPS::ReplayerListener {
+  public:
+    explicit Listener(std::atomic<int>& matched)
+      : matched_(matched)
+    {
+    }
+
+    void on_replayer_matched(OpenDDS::DCPS::Replayer*, const DDS::PublicationMatchedStatus& status) override
+    {
+      matched_ += status.current_count_change;
+    }
+
+  private:
+    std::atomic<int>& matched_;
+  };
+
+  bool selected(const TrafficLog::Topic& topic) const;
+
+  const TrafficLog::Reader& log_;
+  const Config config_;
+  std::atomic<int> matched_{0};
+  std::atomic<bool> stop_{false};
+  OpenDDS::DCPS::ReplayerListener_rch listener_;
+
+  // Replayer of each topic of the log, null if filtered out
+  std::vector<OpenDDS::DCPS::Replayer_ptr> replayers_;
+  // Whether each device of the log is replayed
+  std::vector<bool> devices_;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TMS_BENCH_FLEET_H
+#define TMS_BENCH_FLEET_H
+
+// Power devices and topologies shared by the benchmarks of the controller
+
+#include <controller/Common.h>
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Fleet {
+  powersim::PowerTopology topology;
+  PowerDevices devices;
+  // Sources and distribution devices, whose loss can split the topology
+  std::vector<tms::Identity> switchable;
+  std::vector<tms::Identity> sources;
+};
+
+// Add an operational device. The max_power of loads and sources is their rated power.
+inline void add_device(Fleet& fleet, const tms::Identity& id, tms::DeviceRole role, float max_power = 0,
+                       const std::optional<tms::Identity>& master_id = std::nullopt)
+{
+  cli::PowerDeviceInfo pdi;
+  pdi.device_info().deviceId(id);
+  pdi.device_info().role(role);
+  tms::PowerDeviceInfo pd;
+  if (role == tms::DeviceRole::ROLE_LOAD) {
+    tms::LoadInfo load;
+    load.maxRealPower(max_power);
+    pd.load(load);
+  } else if (role == tms::DeviceRole::ROLE_SOURCE) {
+    tms::SourceInfo source;
+    source.loadSharing().maxRealPower(max_power);
+    pd.source(source);
+  }
+  pdi.device_info().powerDevice(pd);
+  pdi.essl(tms::EnergyStartStopLevel::ESSL_OPERATIONAL);
+  pdi.master_id(master_id);
+  fleet.devices.insert(std::make_pair(id, pdi));
+  if (role != tms::DeviceRole::ROLE_LOAD) {
+    fleet.switchable.push_back(id);
+  }
+  if (role == tms::DeviceRole::ROLE_SOURCE) {
+    fleet.sources.push_back(id);
+  }
+}
+
+inline void connect(Fleet& fleet, const tms::Identity& id, const tms::Identity& other)
+{
+  powersim::PowerConnection pc;
+  pc.pd_id(id);
+  powersim::ConnectedDevice cd;
+  cd.id(other);
+  cd.role(fleet.devices.at(other).device_info().role());
+  pc.connected_devices().push_back(cd);
+  fleet.topology.connections().push_back(pc);
+}
+
+inline tms::Identity dist_id(size_t i)
+{
+  return "dist-" + std::to_string(i);
+}
+
+// Add distribution devices dist-<i>, each with a load load-<i> of 500 to 5000 W
+// and every tenth with a source source-<i> of 25 kW. The distribution devices
+// are left for the caller to connect.
+inline void add_feeder_devices(Fleet& fleet, size_t dists, std::mt19937& rng)
+{
+  using tms::DeviceRole;
+  std::uniform_real_distribution<float> power(500.0f, 5000.0f);
+  for (size_t i = 0; i < dists; ++i) {
+    const std::string n = std::to_string(i);
+    add_device(fleet, dist_id(i), DeviceRole::ROLE_DISTRIBUTION);
+    add_device(fleet, "load-" + n, DeviceRole::ROLE_LOAD, power(rng));
+    connect(fleet, dist_id(i), "load-" + n);
+    if (i % 10 == 0) {
+      add_device(fleet, "source-" + n, DeviceRole::ROLE_SOURCE, 25000.0f);
+      connect(fleet, dist_id(i), "source-" + n);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,198 @@
+// Measures how long ContingencyAnalyzer takes to analyze a topology from
+// scratch and after the energy level of one device changed, as the topology
+// grows. The distribution devices of the Fleet are in a number of separate
+// feeders, each a random tree with a few ties closing loops. Up to 1000 distribution devices per
+// feeder, the results are checked against removing each device in turn and
+// searching the whole topology again.
+
+#include "Fleet.h"
+
+#include <controller/ContingencyAnalyzer.h>
+
+#include <ace/Get_Opt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+Fleet make_fleet(size_t dists, size_t feeders)
+{
+  Fleet fleet;
+  std::mt19937 rng(static_cast<unsigned>(dists));
+  add_feeder_devices(fleet, dists, rng);
+
+  // Device i belongs to feeder i % feeders
+  for (size_t i = 0; i < dists; ++i) {
+    const size_t index = i / feeders;
+    if (index > 0) {
+      connect(fleet, dist_id(i), dist_id((rng() % index) * feeders + i % feeders));
+      if (index % 20 == 0) {
+        connect(fleet, dist_id(i), dist_id((rng() % index) * feeders + i % feeders));
+      }
+    }
+  }
+  return fleet;
+}
+
+// Unserved demand of each switchable device's loss, found by stopping it and
+// searching the topology again
+std::unordered_map<tms::Identity, double> brute_force(const Fleet& fleet)
+{
+  TopologyGraph::Builder builder;
+  builder.add_topology(fleet.topology);
+  TopologyGraph graph = builder.build();
+  std::vector<double> rating(graph.size(), 0);
+  for (TopologyGraph::Node u = 0; u < graph.size(); ++u) {
+    const tms::DeviceInfo& di = fleet.devices.at(graph.id(u)).device_info();
+    if (di.role() == tms::DeviceRole::ROLE_LOAD) {
+      rating[u] = di.powerDevice()->load()->maxRealPower();
+      graph.set_active(u, false);
+    } else if (di.role() == tms::DeviceRole::ROLE_SOURCE) {
+      rating[u] = di.powerDevice()->source()->loadSharing().maxRealPower();
+    }
+  }
+
+  auto unserved = [&]() {
+    const TopologyGraph::Energization e = graph.energization();
+    std::vector<double> capacity(e.sources.size(), 0);
+    std::vector<double> demand(e.sources.size(), 0);
+    double lost = 0;
+    for (TopologyGraph::Node u = 0; u < graph.size(); ++u) {
+      if (graph.role(u) == tms::DeviceRole::ROLE_SOURCE && graph.active(u)) {
+        capacity[e.component[u]] += rating[u];
+      } else if (graph.role(u) == tms::DeviceRole::ROLE_LOAD) {
+        auto v = graph.neighbors_begin(u);
+        while (v != graph.neighbors_end(u) && e.component[*v] == TopologyGraph::NONE) {
+          ++v;
+        }
+        if (v == graph.neighbors_end(u)) {
+          lost += rating[u];
+        } else {
+          demand[e.component[*v]] += rating[u];
+        }
+      }
+    }
+    double total = lost;
+    for (size_t c = 0; c < capacity.size(); ++c) {
+      total += e.sources[c].empty() ? demand[c] : std::max(0.0, demand[c] - capacity[c]);
+    }
+    return total;
+  };
+
+  std::unordered_map<tms::Identity, double> result;
+  const double base = unserved();
+  for (const tms::Identity& id : fleet.switchable) {
+    const TopologyGraph::Node n = graph.index(id);
+    graph.set_active(n, false);
+    result[id] = std::max(0.0, unserved() - base);
+    graph.set_active(n, true);
+  }
+  return result;
+}
+
+bool check(const Fleet& fleet, const ContingencyAnalyzer& analyzer)
+{
+  const auto expected = brute_force(fleet);
+  std::unordered_map<tms::Identity, double> found;
+  for (const Contingency& c : analyzer.ranking()) {
+    found[c.device] = c.unserved;
+  }
+  for (const auto& pair : expected) {
+    const auto it = found.find(pair.first);
+    const double got = it == found.end() ? 0.0 : it->second;
+    if (std::abs(got - pair.second) > 1e-3 * std::max(1.0, pair.second)) {
+      std::cerr << "Loss of " << pair.first << " leaves " << pair.second << " W unserved, but the analyzer found "
+                << got << " W" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_dists = 100000;
+  size_t feeders = 16;
+  size_t threads = 0;
+  size_t updates = 200;
+
+  ACE_Get_Opt get_opt(argc, argv, "n:f:t:u:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_dists = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'f':
+      feeders = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 't':
+      threads = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'u':
+      updates = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0]
+                << " [-n max_distribution_devices] [-f feeders] [-t threads] [-u updates]" << std::endl;
+      return 1;
+    }
+  }
+  if (feeders == 0 || updates == 0) {
+    std::cerr << "Need at least one feeder and one update" << std::endl;
+    return 1;
+  }
+
+  ContingencyAnalyzer::Config config;
+  config.threads = threads;
+  std::cout << std::setw(10) << "devices" << std::setw(10) << "islands" << std::setw(10) << "spofs"
+            << std::setw(12) << "full ms" << std::setw(12) << "update ms" << std::setw(12) << "max ms"
+            << std::endl;
+
+  for (size_t dists = 100; dists <= max_dists; dists *= 10) {
+    Fleet fleet = make_fleet(dists, feeders);
+    ContingencyAnalyzer analyzer(config);
+    analyzer.set_topology(fleet.topology, fleet.devices);
+    auto start = Steady::now();
+    analyzer.analyze();
+    const double full_ms = std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+    if (dists / feeders <= 1000 && !check(fleet, analyzer)) {
+      return 1;
+    }
+
+    // Stop a random device and start it again
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, fleet.switchable.size() - 1);
+    double sum_ms = 0;
+    double max_ms = 0;
+    for (size_t u = 0; u < updates; ++u) {
+      const tms::Identity& id = fleet.switchable[pick(rng)];
+      for (const auto essl : {tms::EnergyStartStopLevel::ESSL_OFF, tms::EnergyStartStopLevel::ESSL_OPERATIONAL}) {
+        start = Steady::now();
+        analyzer.set_levels(EsslUpdates(1, std::make_pair(id, essl)));
+        analyzer.analyze();
+        const double ms = std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+        sum_ms += ms;
+        max_ms = std::max(max_ms, ms);
+      }
+    }
+
+    const ContingencyAnalyzer::Stats stats = analyzer.stats();
+    std::cout << std::setw(10) << stats.devices << std::setw(10) << stats.islands
+              << std::setw(10) << stats.single_points_of_failure
+              << std::fixed << std::setprecision(3) << std::setw(12) << full_ms
+              << std::setw(12) << sum_ms / (2 * updates) << std::setw(12) << max_ms << std::endl;
+  }
+
+  return 0;
+}
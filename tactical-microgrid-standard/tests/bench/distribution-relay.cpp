@@ -0,0 +1,174 @@
+// Measures how many simulated current relays a distribution device can do per
+// second on one core, without DDS in the way. "copying" is the relay path as it
+// was before CurrentRelay: copy the connections under a lock, scan them for the
+// sender and copy the sample for each output. "in place" is CurrentRelay.
+
+#include <power_devices/CurrentRelay.h>
+
+#include <ace/Get_Opt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+const tms::Identity dist_id = "dist";
+
+powersim::ConnectedDeviceSeq make_devices(const std::string& prefix, size_t count)
+{
+  powersim::ConnectedDeviceSeq devices;
+  for (size_t i = 0; i < count; ++i) {
+    powersim::ConnectedDevice dev;
+    dev.id(prefix + std::to_string(i));
+    dev.role(tms::DeviceRole::ROLE_DISTRIBUTION);
+    devices.push_back(dev);
+  }
+  return devices;
+}
+
+powersim::ElectricCurrent make_sample(size_t path_length, const tms::Identity& from)
+{
+  powersim::ElectricCurrent ec;
+  ec.amperage(10.0f);
+  ec.next_hop(dist_id);
+  for (size_t i = 0; i + 2 < path_length; ++i) {
+    ec.power_path().push_back("upstream-device-" + std::to_string(i));
+  }
+  ec.power_path().push_back(from);
+  ec.power_path().push_back(dist_id);
+  return ec;
+}
+
+// Count the bytes "written" so the compiler can't drop the relay work
+struct Sink {
+  size_t writes = 0;
+  size_t bytes = 0;
+
+  bool operator()(const powersim::ElectricCurrent& ec)
+  {
+    ++writes;
+    bytes += ec.power_path().back().size();
+    return true;
+  }
+};
+
+struct Copying {
+  std::mutex m;
+  powersim::ConnectedDeviceSeq in;
+  powersim::ConnectedDeviceSeq out;
+
+  size_t relay(const powersim::ElectricCurrent& ec, Sink& sink)
+  {
+    powersim::ConnectedDeviceSeq devices_in;
+    powersim::ConnectedDeviceSeq devices_out;
+    {
+      std::lock_guard<std::mutex> guard(m);
+      devices_in = in;
+    }
+    {
+      std::lock_guard<std::mutex> guard(m);
+      devices_out = out;
+    }
+
+    const auto& path = ec.power_path();
+    const tms::Identity& from = path[path.size() - 2];
+    if (path.back() != dist_id ||
+        std::none_of(devices_in.begin(), devices_in.end(), [&](const auto& d) { return d.id() == from; })) {
+      return 0;
+    }
+
+    const float out_amps = ec.amperage() / devices_out.size();
+    size_t relayed = 0;
+    for (const auto& out_dev : devices_out) {
+      powersim::ElectricCurrent relay_ec = ec;
+      relay_ec.next_hop(out_dev.id());
+      relay_ec.power_path().push_back(out_dev.id());
+      relay_ec.amperage(out_amps);
+      relayed += sink(relay_ec);
+    }
+    return relayed;
+  }
+};
+
+template <typename Fn>
+void report(const char* name, size_t outputs, size_t iterations, Fn&& relay_once)
+{
+  const auto start = std::chrono::steady_clock::now();
+  size_t relayed = 0;
+  for (size_t i = 0; i < iterations; ++i) {
+    relayed += relay_once();
+  }
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << std::setw(10) << name << std::setw(10) << outputs << std::setw(12) << relayed
+            << std::setw(16) << std::fixed << std::setprecision(0) << relayed / secs
+            << std::setw(12) << std::setprecision(1) << 1e9 * secs / relayed << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t iterations = 200000;
+  size_t inputs = 4;
+  size_t max_outputs = 16;
+  size_t path_length = 6;
+
+  ACE_Get_Opt get_opt(argc, argv, "i:n:o:p:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'i':
+      iterations = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'n':
+      inputs = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'o':
+      max_outputs = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'p':
+      path_length = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-i iterations] [-n inputs] [-o max_outputs] [-p path_length]" << std::endl;
+      return 1;
+    }
+  }
+  if (inputs == 0 || path_length < 2) {
+    std::cerr << "Need at least one input and a path length of at least 2" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(10) << "relay" << std::setw(10) << "outputs" << std::setw(12) << "relays"
+            << std::setw(16) << "relays/s/core" << std::setw(12) << "ns/relay" << std::endl;
+
+  for (size_t outputs = 1; outputs <= max_outputs; outputs *= 2) {
+    const powersim::ConnectedDeviceSeq in = make_devices("in", inputs);
+    const powersim::ConnectedDeviceSeq out = make_devices("out", outputs);
+    const powersim::ElectricCurrent sample = make_sample(path_length, in.back().id());
+
+    Copying copying;
+    copying.in = in;
+    copying.out = out;
+    Sink copying_sink;
+    report("copying", outputs, iterations, [&] { return copying.relay(sample, copying_sink); });
+
+    // The relay grows the path by one entry, so undo that to reuse the sample.
+    const ConnectionSnapshot snapshot(in, out);
+    CurrentRelay relay(dist_id, path_length + 1);
+    powersim::ElectricCurrent ec = sample;
+    Sink in_place_sink;
+    report("in place", outputs, iterations, [&] {
+      const size_t relayed = relay.relay(ec, snapshot, in_place_sink);
+      ec.power_path().pop_back();
+      ec.next_hop(dist_id);
+      ec.amperage(10.0f);
+      return relayed;
+    });
+  }
+
+  return 0;
+}
@@ -0,0 +1,250 @@
+// Measures how many powersim::ElectricCurrent samples are delivered to simulated
+// power devices, and the CPU time this takes, as the number of devices grows.
+// Each device has its own participant and reader, like the separate device
+// processes do. In "unfiltered" mode every device reads the whole topic and
+// checks whether the sample is addressed to it. In "filtered" mode each device
+// reads a content-filtered topic on next_hop, as Load and Distribution do.
+
+#include <power_devices/PowerSimTypeSupportImpl.h>
+#include <common/DataReaderListenerBase.h>
+#include <common/Utils.h>
+
+#include <dds/DCPS/Marked_Default_Qos.h>
+#include <dds/DCPS/Service_Participant.h>
+#include <dds/DCPS/transport/framework/TransportRegistry.h>
+
+#include <ace/Get_Opt.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const DDS::DomainId_t bench_domain = 91;
+
+struct Counters {
+  std::atomic<uint64_t> delivered{0};
+  std::atomic<uint64_t> addressed{0};
+};
+
+class CountingListener : public DataReaderListenerBase {
+public:
+  CountingListener(const tms::Identity& id, Counters& counters)
+    : DataReaderListenerBase("powersim::ElectricCurrent - CountingListener")
+    , id_(id)
+    , counters_(counters)
+  {
+  }
+
+  void on_data_available(DDS::DataReader_ptr reader) final
+  {
+    powersim::ElectricCurrentSeq data;
+    DDS::SampleInfoSeq info_seq;
+    powersim::ElectricCurrentDataReader_var typed_reader = powersim::ElectricCurrentDataReader::_narrow(reader);
+    if (typed_reader->take(data, info_seq, DDS::LENGTH_UNLIMITED, DDS::ANY_SAMPLE_STATE,
+                           DDS::ANY_VIEW_STATE, DDS::ANY_INSTANCE_STATE) != DDS::RETCODE_OK) {
+      return;
+    }
+
+    for (CORBA::ULong i = 0; i < data.length(); ++i) {
+      if (!info_seq[i].valid_data) {
+        continue;
+      }
+      counters_.delivered.fetch_add(1);
+      // Same check the devices do without a filter
+      const auto& path = data[i].power_path();
+      if (!path.empty() && path.back() == id_) {
+        counters_.addressed.fetch_add(1);
+      }
+    }
+  }
+
+private:
+  const tms::Identity id_;
+  Counters& counters_;
+};
+
+struct Result {
+  uint64_t delivered = 0;
+  uint64_t addressed = 0;
+  double wall_ms = 0;
+  double cpu_ms = 0;
+};
+
+DDS::Topic_var create_topic(DDS::DomainParticipant_ptr dp)
+{
+  powersim::ElectricCurrentTypeSupport_var ts = new powersim::ElectricCurrentTypeSupportImpl;
+  if (ts->register_type(dp, "") != DDS::RETCODE_OK) {
+    return nullptr;
+  }
+  CORBA::String_var type_name = ts->get_type_name();
+  return dp->create_topic(powersim::TOPIC_ELECTRIC_CURRENT.c_str(), type_name, TOPIC_QOS_DEFAULT, nullptr,
+                          ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+}
+
+bool run(DDS::DomainParticipantFactory_ptr dpf, size_t devices, size_t samples, bool filtered, Result& result)
+{
+  std::vector<DDS::DomainParticipant_var> participants;
+  Counters counters;
+
+  DDS::DomainParticipant_var src_dp = dpf->create_participant(bench_domain, PARTICIPANT_QOS_DEFAULT, nullptr,
+                                                              ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  if (!src_dp) {
+    return false;
+  }
+  participants.push_back(src_dp);
+
+  DDS::Topic_var src_topic = create_topic(src_dp);
+  DDS::Publisher_var pub = src_dp->create_publisher(PUBLISHER_QOS_DEFAULT, nullptr,
+                                                    ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  DDS::DataWriterQos dw_qos;
+  pub->get_default_datawriter_qos(dw_qos);
+  dw_qos.reliability.kind = DDS::RELIABLE_RELIABILITY_QOS;
+  dw_qos.history.kind = DDS::KEEP_ALL_HISTORY_QOS;
+  DDS::DataWriter_var dw_base = pub->create_datawriter(src_topic, dw_qos, nullptr,
+                                                       ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+  powersim::ElectricCurrentDataWriter_var dw = powersim::ElectricCurrentDataWriter::_narrow(dw_base);
+  if (!dw) {
+    return false;
+  }
+
+  for (size_t d = 0; d < devices; ++d) {
+    const tms::Identity id = "dev" + std::to_string(d);
+    DDS::DomainParticipant_var dp = dpf->create_participant(bench_domain, PARTICIPANT_QOS_DEFAULT, nullptr,
+                                                            ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!dp) {
+      return false;
+    }
+    participants.push_back(dp);
+
+    DDS::Topic_var topic = create_topic(dp);
+    DDS::TopicDescription_var td = DDS::TopicDescription::_duplicate(topic);
+    if (filtered) {
+      std::string id_param;
+      if (!Utils::filter_string_parameter(id, id_param)) {
+        return false;
+      }
+      DDS::StringSeq params(1);
+      params.length(1);
+      params[0] = id_param.c_str();
+      DDS::ContentFilteredTopic_var cft = dp->create_contentfilteredtopic(
+        (powersim::TOPIC_ELECTRIC_CURRENT + " to " + id).c_str(), topic, "next_hop = %0", params);
+      td = DDS::TopicDescription::_duplicate(cft);
+    }
+
+    DDS::Subscriber_var sub = dp->create_subscriber(SUBSCRIBER_QOS_DEFAULT, nullptr,
+                                                    ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    DDS::DataReaderQos dr_qos;
+    sub->get_default_datareader_qos(dr_qos);
+    dr_qos.reliability.kind = DDS::RELIABLE_RELIABILITY_QOS;
+    dr_qos.history.kind = DDS::KEEP_ALL_HISTORY_QOS;
+    DDS::DataReaderListener_var listener(new CountingListener(id, counters));
+    DDS::DataReader_var dr = sub->create_datareader(td, dr_qos, listener, ::OpenDDS::DCPS::DEFAULT_STATUS_MASK);
+    if (!dr) {
+      return false;
+    }
+  }
+
+  // Wait for the writer to match every device
+  const auto match_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  DDS::PublicationMatchedStatus matched;
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    dw->get_publication_matched_status(matched);
+  } while (static_cast<size_t>(matched.current_count) < devices && std::chrono::steady_clock::now() < match_deadline);
+  if (static_cast<size_t>(matched.current_count) < devices) {
+    std::cerr << "Only " << matched.current_count << " of " << devices << " devices matched" << std::endl;
+    return false;
+  }
+
+  const std::clock_t cpu_start = std::clock();
+  const auto wall_start = std::chrono::steady_clock::now();
+
+  powersim::ElectricCurrent ec;
+  ec.amperage(10.0f);
+  for (size_t s = 0; s < samples; ++s) {
+    const tms::Identity to = "dev" + std::to_string(s % devices);
+    ec.next_hop(to);
+    ec.power_path({"src", to});
+    dw->write(ec, DDS::HANDLE_NIL);
+  }
+
+  const auto done_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+  while (counters.addressed.load() < samples && std::chrono::steady_clock::now() < done_deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Let samples to other devices that are still in flight arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+  result.cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  result.delivered = counters.delivered.load();
+  result.addressed = counters.addressed.load();
+
+  for (auto& dp : participants) {
+    dp->delete_contained_entities();
+    dpf->delete_participant(dp);
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_devices = 64;
+  size_t samples = 2000;
+
+  DDS::DomainParticipantFactory_var dpf = TheParticipantFactoryWithArgs(argc, argv);
+  TheServiceParticipant->set_default_discovery(OpenDDS::DCPS::Discovery::DEFAULT_RTPS);
+  OpenDDS::DCPS::TransportConfig_rch config = TheTransportRegistry->create_config("bench_config");
+  config->instances_.push_back(TheTransportRegistry->create_inst("bench_rtps", "rtps_udp"));
+  TheTransportRegistry->global_config(config);
+
+  ACE_Get_Opt get_opt(argc, argv, "n:s:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_devices = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 's':
+      samples = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n max_devices] [-s samples]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::setw(8) << "devices" << std::setw(12) << "mode" << std::setw(10) << "samples"
+            << std::setw(12) << "delivered" << std::setw(12) << "per sample"
+            << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms" << std::setw(14) << "cpu us/sample" << std::endl;
+
+  for (size_t devices = 4; devices <= max_devices; devices *= 2) {
+    for (const bool filtered : {false, true}) {
+      Result result;
+      if (!run(dpf, devices, samples, filtered, result)) {
+        std::cerr << "Run with " << devices << " devices failed" << std::endl;
+        return 1;
+      }
+      std::cout << std::fixed << std::setprecision(1)
+                << std::setw(8) << devices << std::setw(12) << (filtered ? "filtered" : "unfiltered")
+                << std::setw(10) << samples << std::setw(12) << result.delivered
+                << std::setw(12) << static_cast<double>(result.delivered) / samples
+                << std::setw(12) << result.wall_ms << std::setw(12) << result.cpu_ms
+                << std::setw(14) << 1000.0 * result.cpu_ms / samples << std::endl;
+      if (result.addressed < samples) {
+        std::cerr << "Only " << result.addressed << " of " << samples << " samples reached their device" << std::endl;
+      }
+    }
+  }
+
+  TheServiceParticipant->shutdown();
+  return 0;
+}
@@ -0,0 +1,170 @@
+// Measures the SeriesStore of the historian: how fast points are appended, how
+// many bytes they take once compressed, and how long range and downsampled
+// queries and reopening the store take. Each series is a 10 Hz measurement of
+// a device, either a steady value with a little noise or a slow oscillation.
+// The points read back are checked against the ones appended.
+
+#include <historian/SeriesStore.h>
+
+#include <ace/Dirent.h>
+#include <ace/Get_Opt.h>
+#include <ace/OS_NS_unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+constexpr History::Time start_time = 1700000000LL * 1000000000;
+constexpr History::Time period = 100000000; // 10 Hz
+
+double ms_since(Steady::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+}
+
+float value_at(size_t series, size_t i, std::mt19937& rng)
+{
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  return series % 2 ? 120.0f + noise(rng) : 10.0f + 5.0f * std::sin(0.001f * i + series);
+}
+
+void remove_dir(const std::string& dir)
+{
+  ACE_Dirent entries;
+  if (entries.open(ACE_TEXT_CHAR_TO_TCHAR(dir.c_str())) == 0) {
+    for (ACE_DIRENT* entry = entries.read(); entry; entry = entries.read()) {
+      const std::string name = ACE_TEXT_ALWAYS_CHAR(entry->d_name);
+      if (name != "." && name != "..") {
+        ACE_OS::unlink((dir + "/" + name).c_str());
+      }
+    }
+    entries.close();
+  }
+  ACE_OS::rmdir(dir.c_str());
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t series_count = 100;
+  size_t points = 100000;
+  SeriesStore::Config config;
+  config.dir = "historian-bench-" + std::to_string(ACE_OS::getpid());
+  config.max_segments = 0;
+
+  ACE_Get_Opt get_opt(argc, argv, "s:n:o:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 's':
+      series_count = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'n':
+      points = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'o':
+      config.dir = get_opt.opt_arg();
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-s series] [-n points_per_series] [-o new_directory]" << std::endl;
+      return 1;
+    }
+  }
+  if (series_count == 0 || points < 1000) {
+    std::cerr << "Need at least one series and 1000 points" << std::endl;
+    return 1;
+  }
+
+  int status = 0;
+  {
+    SeriesStore store(config);
+    if (!store.open()) {
+      return 1;
+    }
+
+    std::vector<SeriesStore::SeriesId> ids;
+    for (size_t s = 0; s < series_count; ++s) {
+      ids.push_back(store.series("device-" + std::to_string(s) + "/AcMeasurementUpdate/1/voltage"));
+    }
+
+    // Points of all series are interleaved like they arrive from the devices
+    std::mt19937 rng(1);
+    auto start = Steady::now();
+    for (size_t i = 0; i < points; ++i) {
+      for (size_t s = 0; s < series_count; ++s) {
+        store.append(ids[s], start_time + i * period, value_at(s, i, rng));
+      }
+    }
+    store.flush();
+    const double append_ms = ms_since(start);
+
+    const SeriesStore::Stats stats = store.stats();
+    std::cout << std::setw(10) << "series" << std::setw(12) << "points" << std::setw(14) << "M points/s"
+              << std::setw(14) << "bytes/point" << std::setw(10) << "blocks" << std::endl;
+    std::cout << std::setw(10) << stats.series << std::setw(12) << stats.points
+              << std::fixed << std::setprecision(2)
+              << std::setw(14) << stats.points / append_ms / 1e3
+              << std::setw(14) << static_cast<double>(stats.stored_bytes) / stats.stored_points
+              << std::setw(10) << stats.blocks << std::endl << std::endl;
+  }
+
+  // Reopen read-only like a query from another process
+  SeriesStore store(config);
+  auto start = Steady::now();
+  if (!store.open(true)) {
+    return 1;
+  }
+  const double open_ms = ms_since(start);
+
+  SeriesStore::SeriesId id;
+  store.find("device-1/AcMeasurementUpdate/1/voltage", id);
+  const History::Time end_time = start_time + points * period;
+  const History::Time minute = 600 * period;
+
+  std::cout << std::setw(24) << "query" << std::setw(12) << "results" << std::setw(12) << "ms" << std::endl;
+  const auto report = [](const char* query, size_t results, double ms) {
+    std::cout << std::setw(24) << query << std::setw(12) << results << std::setprecision(3)
+              << std::setw(12) << ms << std::endl;
+  };
+  report("reopen", store.stats().blocks, open_ms);
+
+  start = Steady::now();
+  const auto last_minute = store.range(id, end_time - minute, end_time);
+  report("range, last minute", last_minute.size(), ms_since(start));
+
+  start = Steady::now();
+  const auto all = store.range(id, History::min_time, History::max_time);
+  report("range, all", all.size(), ms_since(start));
+
+  start = Steady::now();
+  const auto per_hour = store.downsample(id, start_time, end_time, 60 * minute);
+  report("downsample, 1 h buckets", per_hour.size(), ms_since(start));
+
+  start = Steady::now();
+  const auto per_second = store.downsample(id, start_time, end_time, 10 * period);
+  report("downsample, 1 s buckets", per_second.size(), ms_since(start));
+
+  // Replay the values of the series and compare
+  std::mt19937 rng(1);
+  for (size_t i = 0; i < points && status == 0; ++i) {
+    for (size_t s = 0; s < series_count; ++s) {
+      const float value = value_at(s, i, rng);
+      if (s == 1 && (all.size() != points || all[i].time != start_time + History::Time(i) * period ||
+                     all[i].value != value)) {
+        std::cerr << "Point " << i << " of " << all.size() << " doesn't match what was appended" << std::endl;
+        status = 1;
+        break;
+      }
+    }
+  }
+
+  remove_dir(config.dir);
+  return status;
+}
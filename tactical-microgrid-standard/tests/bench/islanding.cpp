@@ -0,0 +1,123 @@
+// Measures how long IslandingDetector takes to apply the energy level change of
+// one device as the topology grows. The distribution devices of the Fleet are
+// in a ring with a few cross connections. Random distribution devices and sources are stopped and started
+// again, which splits and merges islands. At the end, the number of islands is
+// checked against a search of the whole topology.
+
+#include "Fleet.h"
+
+#include <controller/IslandingDetector.h>
+
+#include <ace/Get_Opt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+Fleet make_fleet(size_t dists)
+{
+  Fleet fleet;
+  std::mt19937 rng(dists);
+  add_feeder_devices(fleet, dists, rng);
+  std::uniform_int_distribution<size_t> pick(0, dists - 1);
+  for (size_t i = 0; i < dists; ++i) {
+    connect(fleet, dist_id(i), dist_id((i + 1) % dists));
+    if (i % 50 == 0) {
+      connect(fleet, dist_id(i), dist_id(pick(rng)));
+    }
+  }
+  return fleet;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_dists = 100000;
+  size_t updates = 2000;
+
+  ACE_Get_Opt get_opt(argc, argv, "n:u:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_dists = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'u':
+      updates = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n max_distribution_devices] [-u updates]" << std::endl;
+      return 1;
+    }
+  }
+  if (updates == 0) {
+    std::cerr << "Need at least one update" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(10) << "devices" << std::setw(10) << "islands" << std::setw(10) << "changes"
+            << std::setw(14) << "topology ms" << std::setw(12) << "mean us" << std::setw(12) << "p99 us"
+            << std::setw(12) << "max us" << std::endl;
+
+  for (size_t dists = 100; dists <= max_dists; dists *= 10) {
+    Fleet fleet = make_fleet(dists);
+    IslandingDetector detector;
+    auto start = Steady::now();
+    detector.set_topology(fleet.topology, fleet.devices);
+    const double topology_ms = std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+
+    // Stop random devices, and start them again once a few are stopped
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, fleet.switchable.size() - 1);
+    std::vector<tms::Identity> stopped;
+    std::vector<double> times_us;
+    times_us.reserve(updates);
+    size_t changes = 0;
+    for (size_t u = 0; u < updates; ++u) {
+      EsslUpdates update;
+      if (stopped.size() < 8) {
+        stopped.push_back(fleet.switchable[pick(rng)]);
+        update.push_back(std::make_pair(stopped.back(), tms::EnergyStartStopLevel::ESSL_OFF));
+      } else {
+        std::swap(stopped[rng() % stopped.size()], stopped.back());
+        update.push_back(std::make_pair(stopped.back(), tms::EnergyStartStopLevel::ESSL_OPERATIONAL));
+        stopped.pop_back();
+      }
+      fleet.devices.at(update[0].first).essl(update[0].second);
+
+      start = Steady::now();
+      changes += detector.set_levels(update).size();
+      times_us.push_back(std::chrono::duration<double, std::micro>(Steady::now() - start).count());
+    }
+
+    std::sort(times_us.begin(), times_us.end());
+    double sum_us = 0;
+    for (const double t : times_us) {
+      sum_us += t;
+    }
+
+    const IslandingDetector::Stats stats = detector.stats();
+    std::cout << std::setw(10) << stats.devices << std::setw(10) << stats.islands << std::setw(10) << changes
+              << std::fixed << std::setprecision(3) << std::setw(14) << topology_ms
+              << std::setprecision(1) << std::setw(12) << sum_us / times_us.size()
+              << std::setw(12) << times_us[times_us.size() * 99 / 100]
+              << std::setw(12) << times_us.back() << std::endl;
+
+    IslandingDetector fresh;
+    fresh.set_topology(fleet.topology, fleet.devices);
+    if (fresh.stats().islands != stats.islands) {
+      std::cerr << "Tracked " << stats.islands << " islands, but the topology has "
+                << fresh.stats().islands << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
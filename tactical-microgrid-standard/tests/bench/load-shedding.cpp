@@ -0,0 +1,125 @@
+// Measures how long LoadShedder takes to plan as the fleet grows. Each
+// distribution device has one source and a number of loads with random rated
+// power and operator priority, and the distribution devices are in a chain so
+// all devices are in one island. Half of the sources are stopped, which forces
+// loads to be shed, and then started again, which restores them.
+
+#include "Fleet.h"
+
+#include <controller/LoadShedder.h>
+
+#include <ace/Get_Opt.h>
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+const tms::Identity mc_id = "mc";
+
+struct Loads {
+  Fleet fleet;
+  std::vector<std::pair<tms::Identity, int16_t>> ranks;
+};
+
+// Sources are rated so that all loads fit with a margin
+Loads make_fleet(size_t loads, size_t loads_per_dist)
+{
+  using tms::DeviceRole;
+  Loads result;
+  Fleet& fleet = result.fleet;
+  std::mt19937 rng(static_cast<unsigned>(loads));
+  std::uniform_real_distribution<float> power(500.0f, 5000.0f);
+  std::uniform_int_distribution<int> rank(0, 9);
+  const size_t dists = (loads + loads_per_dist - 1) / loads_per_dist;
+  for (size_t d = 0; d < dists; ++d) {
+    const tms::Identity source = "source-" + std::to_string(d);
+    add_device(fleet, dist_id(d), DeviceRole::ROLE_DISTRIBUTION, 0, mc_id);
+    add_device(fleet, source, DeviceRole::ROLE_SOURCE, 3000.0f * loads_per_dist, mc_id);
+    connect(fleet, dist_id(d), source);
+    if (d > 0) {
+      connect(fleet, dist_id(d), dist_id(d - 1));
+    }
+    for (size_t l = d * loads_per_dist; l < std::min(loads, (d + 1) * loads_per_dist); ++l) {
+      const tms::Identity load = "load-" + std::to_string(l);
+      add_device(fleet, load, DeviceRole::ROLE_LOAD, power(rng), mc_id);
+      connect(fleet, dist_id(d), load);
+      result.ranks.push_back(std::make_pair(load, static_cast<int16_t>(rank(rng))));
+    }
+  }
+  return result;
+}
+
+void set_sources(Fleet& fleet, tms::EnergyStartStopLevel essl)
+{
+  for (size_t i = 0; i < fleet.sources.size(); i += 2) {
+    fleet.devices.at(fleet.sources[i]).essl(essl);
+  }
+}
+
+void set_loads(Fleet& fleet, const std::vector<tms::Identity>& loads, tms::EnergyStartStopLevel essl)
+{
+  for (const tms::Identity& id : loads) {
+    fleet.devices.at(id).essl(essl);
+  }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_loads = 100000;
+  size_t loads_per_dist = 20;
+  double budget_ms = 1.0;
+
+  ACE_Get_Opt get_opt(argc, argv, "n:l:b:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_loads = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'l':
+      loads_per_dist = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'b':
+      budget_ms = ACE_OS::strtod(get_opt.opt_arg(), nullptr);
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n max_loads] [-l loads_per_distribution_device] [-b budget_ms]" << std::endl;
+      return 1;
+    }
+  }
+  if (loads_per_dist == 0) {
+    std::cerr << "Need at least one load per distribution device" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(10) << "loads" << std::setw(10) << "shed" << std::setw(12) << "shed ms"
+            << std::setw(10) << "restored" << std::setw(12) << "restore ms" << std::setw(10) << "complete" << std::endl;
+
+  for (size_t loads = 100; loads <= max_loads; loads *= 10) {
+    Loads generated = make_fleet(loads, loads_per_dist);
+    Fleet& fleet = generated.fleet;
+    LoadShedder::Config config;
+    config.budget = Sec(budget_ms / 1e3);
+    LoadShedder shedder(config);
+    shedder.set_topology(fleet.topology, fleet.devices);
+    shedder.set_ranks(generated.ranks);
+
+    set_sources(fleet, tms::EnergyStartStopLevel::ESSL_OFF);
+    const LoadShedPlan shed = shedder.plan(fleet.devices, mc_id);
+    set_loads(fleet, shed.shed, tms::EnergyStartStopLevel::ESSL_OFF);
+
+    set_sources(fleet, tms::EnergyStartStopLevel::ESSL_OPERATIONAL);
+    const LoadShedPlan restore = shedder.plan(fleet.devices, mc_id);
+
+    std::cout << std::setw(10) << loads << std::setw(10) << shed.shed.size()
+              << std::fixed << std::setprecision(3) << std::setw(12) << shed.plan_time.count() * 1e3
+              << std::setw(10) << restore.restore.size() << std::setw(12) << restore.plan_time.count() * 1e3
+              << std::setw(10) << (shed.complete && restore.complete ? "yes" : "no") << std::endl;
+  }
+
+  return 0;
+}
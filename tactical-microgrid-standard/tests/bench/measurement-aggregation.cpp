@@ -0,0 +1,166 @@
+// Measures how many measurement samples MeasurementAggregator takes per second
+// on one core, and how long building the summaries of all devices takes. Each
+// device publishes a one-port AC or DC measurement at 1 kHz, and the samples of
+// all devices are interleaved in batches like a reader returns them. At the end,
+// the aggregates of a device are checked against a direct computation over the
+// samples in its window.
+
+#include <controller/MeasurementAggregator.h>
+
+#include <ace/Get_Opt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+constexpr double sample_rate = 1000.0;
+
+float amperage_at(size_t device, size_t sample)
+{
+  return 10.0f + 5.0f * std::sin(0.01f * sample + device);
+}
+
+tms::ClockMonotonic clock_at(size_t sample)
+{
+  const uint64_t ns = static_cast<uint64_t>(sample * (1e9 / sample_rate));
+  tms::ClockMonotonic cm;
+  cm.seconds(static_cast<uint32_t>(ns / 1000000000));
+  cm.nanoseconds(static_cast<uint32_t>(ns % 1000000000));
+  return cm;
+}
+
+template <typename Seq>
+void make_batch(Seq& updates, DDS::SampleInfoSeq& infos, size_t lines, size_t first_device, size_t count)
+{
+  updates.resize(count);
+  infos.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto& update = updates[i];
+    update.deviceId("device-" + std::to_string(first_device + 2 * i));
+    update.internalMeasurement().resize(1);
+    update.internalMeasurement()[0].portNumber(1);
+    update.internalMeasurement()[0].line().resize(lines);
+    infos[i].valid_data = true;
+  }
+}
+
+void set_ac(tms::ac::MeasurementUpdate& update, size_t device, size_t sample)
+{
+  const float amperage = amperage_at(device, sample);
+  update.timeMeasured(clock_at(sample));
+  auto& line = update.internalMeasurement()[0].line()[0];
+  line.voltage(120.0f);
+  line.frequency(60.0f);
+  line.amperage(amperage);
+  line.realPower(114.0f * amperage);
+  line.reactivePower(37.5f * amperage);
+}
+
+void set_dc(tms::dc::MeasurementUpdate& update, size_t device, size_t sample)
+{
+  const float amperage = amperage_at(device, sample);
+  update.timeMeasured(clock_at(sample));
+  auto& lines = update.internalMeasurement()[0].line();
+  lines[0].voltage(48.0f);
+  lines[0].amperage(amperage);
+  lines[0].power(48.0f * amperage);
+  lines[1].voltage(0.0f);
+  lines[1].amperage(-amperage);
+  lines[1].power(0.0f);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_devices = 1000;
+  size_t samples = 2000;
+
+  ACE_Get_Opt get_opt(argc, argv, "n:s:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_devices = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 's':
+      samples = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n max_devices] [-s samples_per_device]" << std::endl;
+      return 1;
+    }
+  }
+  if (max_devices < 2 || samples == 0) {
+    std::cerr << "Need at least two devices and one sample" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(10) << "devices" << std::setw(12) << "samples" << std::setw(14) << "M samples/s"
+            << std::setw(12) << "ns/sample" << std::setw(12) << "summaries" << std::setw(14) << "summary ms"
+            << std::endl;
+
+  MeasurementAggregator::Config config;
+  config.max_samples = 4096;
+
+  for (size_t devices = 10; devices <= max_devices; devices *= 10) {
+    MeasurementAggregator aggregator("bench-mc", nullptr, config);
+
+    // Even devices are AC and odd ones DC, each reader batch has one sample of each of its devices
+    const size_t per_kind = devices / 2;
+    tms::ac::MeasurementUpdateSeq ac_batch;
+    tms::dc::MeasurementUpdateSeq dc_batch;
+    DDS::SampleInfoSeq ac_infos, dc_infos;
+    make_batch(ac_batch, ac_infos, 1, 0, per_kind);
+    make_batch(dc_batch, dc_infos, 2, 1, per_kind);
+
+    Steady::duration ingest_time{0};
+    for (size_t s = 0; s < samples; ++s) {
+      for (size_t i = 0; i < per_kind; ++i) {
+        set_ac(ac_batch[i], 2 * i, s);
+        set_dc(dc_batch[i], 2 * i + 1, s);
+      }
+      const auto start = Steady::now();
+      aggregator.ingest(ac_batch, ac_infos);
+      aggregator.ingest(dc_batch, dc_infos);
+      ingest_time += Steady::now() - start;
+    }
+
+    const auto start = Steady::now();
+    const size_t summaries = aggregator.summarize();
+    const double summary_ms = std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+
+    const MeasurementAggregator::Stats stats = aggregator.stats();
+    const double ingest_s = std::chrono::duration<double>(ingest_time).count();
+    std::cout << std::setw(10) << stats.devices << std::setw(12) << stats.samples
+              << std::fixed << std::setprecision(2) << std::setw(14) << stats.samples / ingest_s / 1e6
+              << std::setprecision(1) << std::setw(12) << ingest_s * 1e9 / stats.samples
+              << std::setw(12) << summaries << std::setprecision(3) << std::setw(14) << summary_ms << std::endl;
+
+    // The window of a device holds the samples within a window length of the
+    // newest, give or take the one on the edge due to rounding of the times.
+    const size_t device = 1;
+    const size_t in_window = std::min<size_t>(samples, static_cast<size_t>(config.window.count() * sample_rate) + 1);
+    const auto aggregates = aggregator.aggregates("device-" + std::to_string(device));
+    const Aggregate amperage = aggregates.empty() ? Aggregate() : aggregates[0].channels[MeasurementWindow::AMPERAGE];
+    double sum_sq = 0.0;
+    for (size_t s = samples - std::min(amperage.count, samples); s < samples; ++s) {
+      sum_sq += static_cast<double>(amperage_at(device, s)) * amperage_at(device, s);
+    }
+    const float expected = amperage.count ? static_cast<float>(std::sqrt(sum_sq / amperage.count)) : 0.0f;
+    if (amperage.count + 1 < in_window || amperage.count > in_window ||
+        std::abs(amperage.rms - expected) > 1e-3f * expected) {
+      std::cerr << "Aggregated RMS amperage " << amperage.rms << " over " << amperage.count
+                << " samples, but expected " << expected << " over " << in_window << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
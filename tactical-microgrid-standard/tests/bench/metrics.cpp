@@ -0,0 +1,111 @@
+// Measures the cost of recording a metric from several threads at once: a
+// shared std::atomic counter and AtomicHistogram against ShardedCounter and
+// ShardedHistogram, which every thread records to in its own shard. Reading the
+// sharded metrics sums the shards, so that is measured too, and the totals are
+// checked against what was recorded.
+
+#include <common/ShardedMetrics.h>
+
+#include <ace/Get_Opt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+// ns per record of each thread
+template <typename Record>
+double run_threads(size_t threads, size_t records, Record record)
+{
+  std::vector<std::thread> workers;
+  std::atomic<bool> go{false};
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&go, &record, records] {
+      while (!go) {
+      }
+      for (size_t i = 0; i < records; ++i) {
+        record(i);
+      }
+    });
+  }
+  const auto start = Steady::now();
+  go = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return std::chrono::duration<double, std::nano>(Steady::now() - start).count() / records;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t records = 10000000;
+
+  ACE_Get_Opt get_opt(argc, argv, "t:n:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 't':
+      max_threads = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'n':
+      records = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-t max_threads] [-n records_per_thread]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::setw(8) << "threads" << std::setw(14) << "atomic ns" << std::setw(14) << "sharded ns"
+            << std::setw(16) << "atomic hist ns" << std::setw(16) << "sharded hist ns"
+            << std::setw(12) << "read us" << std::endl;
+
+  int status = 0;
+  uint64_t expected = 0;
+  std::atomic<uint64_t> atomic_counter{0};
+  AtomicHistogram atomic_histogram;
+  ShardedCounter sharded_counter;
+  ShardedHistogram sharded_histogram;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    const double atomic_ns = run_threads(threads, records, [&](size_t) {
+      atomic_counter.fetch_add(1, std::memory_order_relaxed);
+    });
+    const double sharded_ns = run_threads(threads, records, [&](size_t) {
+      sharded_counter.add();
+    });
+    const double atomic_hist_ns = run_threads(threads, records, [&](size_t i) {
+      atomic_histogram.record_us(i & 1023);
+    });
+    const double sharded_hist_ns = run_threads(threads, records, [&](size_t i) {
+      sharded_histogram.record_us(i & 1023);
+    });
+    expected += threads * records;
+
+    const auto start = Steady::now();
+    const uint64_t count = sharded_counter.value();
+    const Histogram h = sharded_histogram.snapshot();
+    const double read_us = std::chrono::duration<double, std::micro>(Steady::now() - start).count();
+
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(2)
+              << std::setw(14) << atomic_ns << std::setw(14) << sharded_ns
+              << std::setw(16) << atomic_hist_ns << std::setw(16) << sharded_hist_ns
+              << std::setw(12) << read_us << std::endl;
+    if (count != expected || h.count() != expected || count != atomic_counter.load() ||
+        h.sum_us() != atomic_histogram.snapshot().sum_us()) {
+      std::cerr << "Sharded totals don't match: counted " << count << " and recorded " << h.count()
+                << " of " << expected << std::endl;
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,124 @@
+// Measures how long TopologyGraph takes to build from a power topology and to
+// answer energization and path queries as the topology grows. The topology is
+// a ring of distribution devices, each with a load and every tenth with a
+// source, plus a few cross connections, so it has loops like a meshed
+// microgrid. Switching one device off and on again shows the cost of an
+// incremental update followed by a new energization query.
+
+#include <common/TopologyGraph.h>
+
+#include <ace/Get_Opt.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+TopologyGraph::Builder make_topology(size_t dists)
+{
+  using tms::DeviceRole;
+  TopologyGraph::Builder builder;
+  std::mt19937 rng(dists);
+  std::uniform_int_distribution<size_t> pick(0, dists - 1);
+  auto dist = [](size_t i) { return "dist-" + std::to_string(i); };
+  for (size_t i = 0; i < dists; ++i) {
+    builder.add_connection(dist(i), DeviceRole::ROLE_DISTRIBUTION,
+                           dist((i + 1) % dists), DeviceRole::ROLE_DISTRIBUTION);
+    builder.add_connection(dist(i), DeviceRole::ROLE_DISTRIBUTION,
+                           "load-" + std::to_string(i), DeviceRole::ROLE_LOAD);
+    if (i % 10 == 0) {
+      builder.add_connection(dist(i), DeviceRole::ROLE_DISTRIBUTION,
+                             "source-" + std::to_string(i), DeviceRole::ROLE_SOURCE);
+    }
+    if (i % 4 == 0) {
+      builder.add_connection(dist(i), DeviceRole::ROLE_DISTRIBUTION,
+                             dist(pick(rng)), DeviceRole::ROLE_DISTRIBUTION);
+    }
+  }
+  return builder;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t max_dists = 1000000;
+  size_t queries = 10;
+
+  ACE_Get_Opt get_opt(argc, argv, "n:q:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      max_dists = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'q':
+      queries = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n max_distribution_devices] [-q queries]" << std::endl;
+      return 1;
+    }
+  }
+  if (queries == 0) {
+    std::cerr << "Need at least one query" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::setw(10) << "devices" << std::setw(12) << "connections"
+            << std::setw(12) << "build ms" << std::setw(14) << "energize ms"
+            << std::setw(12) << "path ms" << std::setw(14) << "toggle ms" << std::endl;
+
+  for (size_t dists = 10; dists <= max_dists; dists *= 10) {
+    const TopologyGraph::Builder builder = make_topology(dists);
+    auto start = Clock::now();
+    TopologyGraph graph = builder.build();
+    const double build_ms = ms_since(start);
+
+    size_t energized = 0;
+    start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+      const TopologyGraph::Energization e = graph.energization();
+      energized += e.energized(graph.index("load-" + std::to_string(q % dists)));
+    }
+    const double energize_ms = ms_since(start) / queries;
+
+    // From a load to the load furthest around the ring
+    const TopologyGraph::Node from = graph.index("load-0");
+    const TopologyGraph::Node to = graph.index("load-" + std::to_string(dists / 2));
+    size_t path_length = 0;
+    start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+      path_length += graph.path(from, to).size();
+    }
+    const double path_ms = ms_since(start) / queries;
+
+    const TopologyGraph::Node toggled = graph.index("dist-" + std::to_string(dists / 3));
+    start = Clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+      graph.set_active(toggled, q % 2 != 0);
+      energized += graph.energization().energized(toggled);
+    }
+    const double toggle_ms = ms_since(start) / queries;
+
+    std::cout << std::setw(10) << graph.size() << std::setw(12) << graph.connection_count()
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << build_ms << std::setw(14) << energize_ms
+              << std::setw(12) << path_ms << std::setw(14) << toggle_ms << std::endl;
+    if (energized == 0 || path_length == 0) {
+      std::cerr << "Unexpected results for " << dists << " distribution devices" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
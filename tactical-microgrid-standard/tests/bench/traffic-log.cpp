@@ -0,0 +1,151 @@
+// Measures the TrafficLog of the recorder: how fast samples are written to it,
+// how long the replayer takes to open it and scan its index, and how fast it
+// reads the samples back, from the start and from a time in the middle. The
+// samples are payloads of 64 to 512 bytes from 100 devices over 20 topics at
+// 1 kHz, and their bytes are checked when they're read back.
+
+#include <recorder/TrafficLog.h>
+
+#include <ace/Get_Opt.h>
+#include <ace/OS_NS_unistd.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Steady = std::chrono::steady_clock;
+
+constexpr TrafficLog::Time start_time = 1700000000LL * 1000000000;
+constexpr TrafficLog::Time period = 1000000; // 1 kHz
+constexpr size_t topic_count = 20;
+constexpr size_t device_count = 100;
+
+double ms_since(Steady::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Steady::now() - start).count();
+}
+
+char payload_byte(size_t sample, size_t i)
+{
+  return static_cast<char>(sample * 31 + i);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  size_t samples = 2000000;
+  std::string path = "traffic-bench-" + std::to_string(ACE_OS::getpid()) + ".log";
+
+  ACE_Get_Opt get_opt(argc, argv, "n:o:");
+  int c;
+  while ((c = get_opt()) != -1) {
+    switch (c) {
+    case 'n':
+      samples = ACE_OS::atoi(get_opt.opt_arg());
+      break;
+    case 'o':
+      path = get_opt.opt_arg();
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << " [-n samples] [-o new_file]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<size_t> sizes(samples);
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<size_t> size_dist(64, 512);
+  for (size_t& size : sizes) {
+    size = size_dist(rng);
+  }
+
+  double write_ms;
+  uint64_t bytes;
+  {
+    TrafficLog::Writer log;
+    if (!log.open(path)) {
+      return 1;
+    }
+    std::vector<uint16_t> topics, devices;
+    for (size_t t = 0; t < topic_count; ++t) {
+      TrafficLog::Topic topic;
+      topic.domain = t % 2 ? TrafficLog::Domain::Sim : TrafficLog::Domain::Tms;
+      topic.name = "Topic " + std::to_string(t);
+      topic.type_name = "bench::Sample";
+      topics.push_back(log.topic(topic));
+    }
+    for (size_t d = 0; d < device_count; ++d) {
+      devices.push_back(log.device("device-" + std::to_string(d)));
+    }
+
+    ACE_Message_Block payload(512);
+    auto start = Steady::now();
+    for (size_t s = 0; s < samples; ++s) {
+      payload.reset();
+      for (size_t i = 0; i < sizes[s]; ++i) {
+        *payload.wr_ptr() = payload_byte(s, i);
+        payload.wr_ptr(1);
+      }
+      log.write(topics[s % topic_count], devices[s % device_count], 0, TrafficLog::BYTE_ORDER_FLAG,
+                start_time + s * period, &payload);
+    }
+    log.close();
+    write_ms = ms_since(start);
+    bytes = log.stats().bytes;
+  }
+
+  std::cout << std::setw(24) << "" << std::setw(12) << "samples" << std::setw(12) << "ms"
+            << std::setw(14) << "M samples/s" << std::setw(10) << "MB/s" << std::endl;
+  const auto report = [&](const char* what, size_t count, double ms) {
+    std::cout << std::setw(24) << what << std::setw(12) << count << std::fixed << std::setprecision(1)
+              << std::setw(12) << ms << std::setprecision(2) << std::setw(14) << count / ms / 1e3
+              << std::setprecision(0) << std::setw(10) << bytes / ms / 1e3 * count / samples << std::endl;
+  };
+  report("write", samples, write_ms);
+
+  TrafficLog::Reader log;
+  auto start = Steady::now();
+  if (!log.open(path)) {
+    return 1;
+  }
+  report("open", log.samples(), ms_since(start));
+
+  int status = 0;
+  const auto read_from = [&](size_t first, const char* what) {
+    start = Steady::now();
+    size_t s = first;
+    TrafficLog::Sample sample;
+    uint64_t checksum = 0, expected = 0;
+    for (size_t offset = log.seek(start_time + first * period); log.next(offset, sample);) {
+      const TrafficLog::Time time = sample.header->time;
+      if (time < start_time + TrafficLog::Time(first) * period) {
+        continue;
+      }
+      if (time != start_time + TrafficLog::Time(s) * period || sample.header->size != sizes[s]) {
+        std::cerr << "Sample " << s << " doesn't match what was written" << std::endl;
+        status = 1;
+        return;
+      }
+      for (size_t i = 0; i < sizes[s]; ++i) {
+        checksum += static_cast<unsigned char>(sample.payload[i]);
+        expected += static_cast<unsigned char>(payload_byte(s, i));
+      }
+      ++s;
+    }
+    report(what, s - first, ms_since(start));
+    if (s != samples || checksum != expected) {
+      std::cerr << "Read " << s << " of " << samples << " samples back, checksum "
+                << (checksum == expected ? "matches" : "doesn't match") << std::endl;
+      status = 1;
+    }
+  };
+  read_from(0, "read all");
+  read_from(samples / 2, "seek and read half");
+
+  ACE_OS::unlink(path.c_str());
+  return status;
+}
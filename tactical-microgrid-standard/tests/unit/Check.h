@@ -0,0 +1,50 @@
+#ifndef TMS_UNIT_CHECK_H
+#define TMS_UNIT_CHECK_H
+
+// Checks shared by the unit tests. A failed check is reported with its
+// location and the test goes on, and main returns the result of failed().
+
+#include <cmath>
+#include <iostream>
+
+inline int& check_failures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+inline bool check(bool ok, const char* expr, const char* file, int line)
+{
+  if (!ok) {
+    std::cerr << file << ':' << line << ": check failed: " << expr << std::endl;
+    ++check_failures();
+  }
+  return ok;
+}
+
+inline bool check_near(double actual, double expected, double tolerance, const char* expr, const char* file, int line)
+{
+  const bool ok = std::fabs(actual - expected) <= tolerance;
+  if (!ok) {
+    std::cerr << file << ':' << line << ": check failed: " << expr << " is " << actual << ", expected "
+              << expected << std::endl;
+    ++check_failures();
+  }
+  return ok;
+}
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) \
+  check_near((actual), (expected), (tolerance), #actual, __FILE__, __LINE__)
+
+// Exit status of a test
+inline int failed()
+{
+  if (check_failures()) {
+    std::cerr << check_failures() << " check(s) failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+#endif
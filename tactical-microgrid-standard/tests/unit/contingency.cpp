@@ -0,0 +1,221 @@
+// Checks the single points of failure ContingencyAnalyzer finds in small
+// topologies against the articulation points and demand worked out by hand.
+
+#include "Check.h"
+#include "../bench/Fleet.h"
+
+#include <controller/ContingencyAnalyzer.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+using tms::DeviceRole;
+using tms::EnergyStartStopLevel;
+
+const Contingency* find(const std::vector<Contingency>& ranking, const tms::Identity& id)
+{
+  for (const Contingency& c : ranking) {
+    if (c.device == id) {
+      return &c;
+    }
+  }
+  return nullptr;
+}
+
+ContingencyAnalyzer::Config config()
+{
+  ContingencyAnalyzer::Config config;
+  config.threads = 2;
+  return config;
+}
+
+// source-1 - dist-1 - dist-2, and dist-2 to dist-5 in a ring. load-1 (1 kW) is
+// on dist-1, load-3 (2 kW) on dist-3 and load-4 (500 W) on dist-4.
+void articulation_points()
+{
+  Fleet fleet;
+  add_device(fleet, "source-1", DeviceRole::ROLE_SOURCE, 10000.0f);
+  for (size_t i = 1; i <= 5; ++i) {
+    add_device(fleet, dist_id(i), DeviceRole::ROLE_DISTRIBUTION);
+  }
+  add_device(fleet, "load-1", DeviceRole::ROLE_LOAD, 1000.0f);
+  add_device(fleet, "load-3", DeviceRole::ROLE_LOAD, 2000.0f);
+  add_device(fleet, "load-4", DeviceRole::ROLE_LOAD, 500.0f);
+  connect(fleet, "dist-1", "source-1");
+  connect(fleet, "dist-1", "load-1");
+  connect(fleet, "dist-1", "dist-2");
+  connect(fleet, "dist-2", "dist-3");
+  connect(fleet, "dist-3", "dist-4");
+  connect(fleet, "dist-4", "dist-5");
+  connect(fleet, "dist-5", "dist-2");
+  connect(fleet, "dist-3", "load-3");
+  connect(fleet, "dist-4", "load-4");
+
+  ContingencyAnalyzer analyzer(config());
+  analyzer.set_topology(fleet.topology, fleet.devices);
+  analyzer.analyze();
+  CHECK(analyzer.stats().islands == 1);
+  CHECK(analyzer.stats().single_points_of_failure == 5);
+
+  std::vector<Contingency> ranking = analyzer.ranking();
+  if (!CHECK(ranking.size() == 5)) {
+    return;
+  }
+
+  // Losing the source or dist-1 cuts off every load, and dist-1 also leaves
+  // the source on its own
+  const Contingency* source1 = find(ranking, "source-1");
+  const Contingency* dist1 = find(ranking, "dist-1");
+  if (CHECK(source1 && dist1)) {
+    CHECK(source1->islands == 1);
+    CHECK(dist1->islands == 2);
+    for (const Contingency* c : {source1, dist1}) {
+      CHECK(c->lost_loads == 3);
+      CHECK_NEAR(c->lost_demand, 3500.0, 1e-9);
+      CHECK_NEAR(c->unserved, 3500.0, 1e-9);
+    }
+  }
+
+  // dist-2 is where the ring hangs off, the devices of the ring only lose their own loads
+  CHECK(ranking[2].device == "dist-2");
+  CHECK(ranking[2].islands == 2);
+  CHECK(ranking[2].lost_loads == 2);
+  CHECK_NEAR(ranking[2].unserved, 2500.0, 1e-9);
+  CHECK(ranking[3].device == "dist-3");
+  CHECK(ranking[3].islands == 1);
+  CHECK(ranking[3].lost_loads == 1);
+  CHECK_NEAR(ranking[3].unserved, 2000.0, 1e-9);
+  CHECK(ranking[4].device == "dist-4");
+  CHECK_NEAR(ranking[4].unserved, 500.0, 1e-9);
+  CHECK(!find(ranking, "dist-5"));
+  CHECK(analyzer.ranking(2).size() == 2);
+
+  // Opening the ring makes dist-3 an articulation point
+  analyzer.set_levels({{"dist-5", EnergyStartStopLevel::ESSL_OFF}});
+  analyzer.analyze();
+  CHECK(analyzer.stats().last_analyzed_islands == 1);
+  ranking = analyzer.ranking();
+  const Contingency* dist3 = find(ranking, "dist-3");
+  if (CHECK(dist3)) {
+    CHECK(dist3->islands == 2);
+    CHECK(dist3->lost_loads == 2);
+    CHECK_NEAR(dist3->unserved, 2500.0, 1e-9);
+  }
+}
+
+// source-a (3 kW) and load-a (2 kW) on dist-a, source-b (1 kW) and load-b
+// (1.5 kW) on dist-b, and dist-a connected to dist-b. The island serves all of
+// its demand, but not without source-a.
+void shortfall()
+{
+  Fleet fleet;
+  add_device(fleet, "dist-a", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "dist-b", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "source-a", DeviceRole::ROLE_SOURCE, 3000.0f);
+  add_device(fleet, "source-b", DeviceRole::ROLE_SOURCE, 1000.0f);
+  add_device(fleet, "load-a", DeviceRole::ROLE_LOAD, 2000.0f);
+  add_device(fleet, "load-b", DeviceRole::ROLE_LOAD, 1500.0f);
+  connect(fleet, "dist-a", "source-a");
+  connect(fleet, "dist-a", "load-a");
+  connect(fleet, "dist-a", "dist-b");
+  connect(fleet, "dist-b", "source-b");
+  connect(fleet, "dist-b", "load-b");
+
+  ContingencyAnalyzer analyzer(config());
+  analyzer.set_topology(fleet.topology, fleet.devices);
+  analyzer.analyze();
+  const std::vector<Contingency> ranking = analyzer.ranking();
+  if (!CHECK(ranking.size() == 4)) {
+    return;
+  }
+
+  // Without dist-a, load-a is lost and dist-b falls 500 W short
+  CHECK(ranking[0].device == "dist-a");
+  CHECK(ranking[0].lost_loads == 1);
+  CHECK_NEAR(ranking[0].shortfall, 500.0, 1e-9);
+  CHECK_NEAR(ranking[0].unserved, 2500.0, 1e-9);
+
+  // Without source-a, nothing is cut off but the rest falls 2500 W short
+  CHECK(ranking[1].device == "source-a");
+  CHECK(ranking[1].lost_loads == 0);
+  CHECK_NEAR(ranking[1].shortfall, 2500.0, 1e-9);
+  CHECK_NEAR(ranking[1].unserved, 2500.0, 1e-9);
+
+  CHECK(ranking[2].device == "dist-b");
+  CHECK_NEAR(ranking[2].unserved, 1500.0, 1e-9);
+  CHECK(ranking[3].device == "source-b");
+  CHECK_NEAR(ranking[3].unserved, 500.0, 1e-9);
+}
+
+// Two feeders, source-<f> - dist-<f>a - dist-<f>b with load-<f> (1 kW) on dist-<f>b
+void add_feeder(Fleet& fleet, const std::string& f)
+{
+  add_device(fleet, "source-" + f, DeviceRole::ROLE_SOURCE, 10000.0f);
+  add_device(fleet, "dist-" + f + "a", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "dist-" + f + "b", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "load-" + f, DeviceRole::ROLE_LOAD, 1000.0f);
+  connect(fleet, "dist-" + f + "a", "source-" + f);
+  connect(fleet, "dist-" + f + "a", "dist-" + f + "b");
+  connect(fleet, "dist-" + f + "b", "load-" + f);
+}
+
+void topology_change()
+{
+  Fleet fleet;
+  add_feeder(fleet, "1");
+  add_feeder(fleet, "2");
+  ContingencyAnalyzer analyzer(config());
+  analyzer.set_topology(fleet.topology, fleet.devices);
+  analyzer.analyze();
+  CHECK(analyzer.stats().islands == 2);
+  CHECK(analyzer.stats().last_analyzed_islands == 2);
+  CHECK(analyzer.ranking().size() == 6);
+
+  // The same topology again, with its connections in another order
+  Fleet reordered = fleet;
+  std::reverse(reordered.topology.connections().begin(), reordered.topology.connections().end());
+  analyzer.set_topology(reordered.topology, reordered.devices);
+  analyzer.analyze();
+  CHECK(analyzer.stats().last_analyzed_islands == 0);
+  CHECK(analyzer.ranking().size() == 6);
+
+  // A second load on feeder 2 only changes its island
+  add_device(fleet, "load-2x", DeviceRole::ROLE_LOAD, 2000.0f);
+  connect(fleet, "dist-2b", "load-2x");
+  analyzer.set_topology(fleet.topology, fleet.devices);
+  analyzer.analyze();
+  CHECK(analyzer.stats().last_analyzed_islands == 1);
+  const std::vector<Contingency> ranking = analyzer.ranking();
+  const Contingency* source1 = find(ranking, "source-1");
+  const Contingency* source2 = find(ranking, "source-2");
+  if (CHECK(source1 && source2)) {
+    CHECK_NEAR(source1->unserved, 1000.0, 1e-9);
+    CHECK(source2->lost_loads == 2);
+    CHECK_NEAR(source2->unserved, 3000.0, 1e-9);
+  }
+
+  // Removing a device changes the islands of its neighbors
+  fleet.topology.connections().pop_back();
+  fleet.devices.erase("load-2x");
+  analyzer.set_topology(fleet.topology, fleet.devices);
+  analyzer.analyze();
+  CHECK(analyzer.stats().last_analyzed_islands == 1);
+  const std::vector<Contingency> after = analyzer.ranking();
+  source2 = find(after, "source-2");
+  if (CHECK(source2)) {
+    CHECK_NEAR(source2->unserved, 1000.0, 1e-9);
+  }
+}
+
+}
+
+int main()
+{
+  articulation_points();
+  shortfall();
+  topology_change();
+  return failed();
+}
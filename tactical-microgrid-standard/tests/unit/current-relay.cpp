@@ -0,0 +1,186 @@
+// Checks that CurrentRelay relays simulated current through a distribution
+// device without loops: current that came back to the device, would go back
+// to where it came from or to a device already on its path, or would grow its
+// path past the hop limit is not relayed.
+
+#include "Check.h"
+
+#include <power_devices/CurrentRelay.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using tms::DeviceRole;
+
+powersim::ConnectedDeviceSeq devices(const std::vector<std::pair<tms::Identity, DeviceRole>>& list)
+{
+  powersim::ConnectedDeviceSeq seq;
+  for (const auto& pair : list) {
+    powersim::ConnectedDevice dev;
+    dev.id(pair.first);
+    dev.role(pair.second);
+    seq.push_back(dev);
+  }
+  return seq;
+}
+
+// dist-2 in a ring of distribution devices dist-1 - dist-2 - dist-3 - dist-1,
+// with load-2 on it. Distribution neighbors are both inputs and outputs.
+std::unique_ptr<ConnectionSnapshot> ring_conns()
+{
+  return std::make_unique<ConnectionSnapshot>(
+    devices({{"dist-1", DeviceRole::ROLE_DISTRIBUTION}, {"dist-3", DeviceRole::ROLE_DISTRIBUTION}}),
+    devices({{"dist-1", DeviceRole::ROLE_DISTRIBUTION}, {"dist-3", DeviceRole::ROLE_DISTRIBUTION},
+             {"load-2", DeviceRole::ROLE_LOAD}}));
+}
+
+powersim::ElectricCurrent current(const std::vector<tms::Identity>& path, float amperage = 9.0f)
+{
+  powersim::ElectricCurrent ec;
+  ec.amperage(amperage);
+  ec.next_hop(path.back());
+  for (const tms::Identity& id : path) {
+    ec.power_path().push_back(id);
+  }
+  return ec;
+}
+
+// Keeps a copy of each sample written
+struct Written {
+  std::vector<powersim::ElectricCurrent> samples;
+  bool ok = true;
+
+  bool operator()(const powersim::ElectricCurrent& ec)
+  {
+    samples.push_back(ec);
+    return ok;
+  }
+};
+
+std::vector<tms::Identity> path_of(const powersim::ElectricCurrent& ec)
+{
+  return std::vector<tms::Identity>(ec.power_path().begin(), ec.power_path().end());
+}
+
+// From dist-1, 9 A goes on to dist-3 and load-2, 4.5 A each, but not back to dist-1.
+void relayed()
+{
+  const auto conns = ring_conns();
+  CurrentRelay relay("dist-2");
+  Written written;
+
+  powersim::ElectricCurrent ec = current({"source-1", "dist-1", "dist-2"});
+  CHECK(relay.relay(ec, *conns, written) == 2);
+  CHECK(written.samples.size() == 2);
+  if (written.samples.size() == 2) {
+    CHECK(written.samples[0].next_hop() == "dist-3");
+    CHECK(path_of(written.samples[0]) == std::vector<tms::Identity>({"source-1", "dist-1", "dist-2", "dist-3"}));
+    CHECK_NEAR(written.samples[0].amperage(), 4.5, 1e-6);
+    CHECK(written.samples[1].next_hop() == "load-2");
+    CHECK(path_of(written.samples[1]) == std::vector<tms::Identity>({"source-1", "dist-1", "dist-2", "load-2"}));
+    CHECK_NEAR(written.samples[1].amperage(), 4.5, 1e-6);
+  }
+
+  const RelayStats& stats = relay.stats();
+  CHECK(stats.received == 1);
+  CHECK(stats.relayed == 2);
+  CHECK(stats.split_horizon == 1);
+  CHECK(stats.dropped_loop == 0);
+
+  // Only the writes that succeed count as relayed
+  written.ok = false;
+  powersim::ElectricCurrent again = current({"source-1", "dist-1", "dist-2"});
+  CHECK(relay.relay(again, *conns, written) == 0);
+  CHECK(written.samples.size() == 4);
+  CHECK(stats.relayed == 2);
+}
+
+void loops()
+{
+  const auto conns = ring_conns();
+  CurrentRelay relay("dist-2");
+  Written written;
+
+  // Went around the ring and came back
+  powersim::ElectricCurrent looped = current({"source-1", "dist-1", "dist-2", "dist-3", "dist-2"});
+  CHECK(relay.relay(looped, *conns, written) == 0);
+  CHECK(relay.stats().dropped_loop == 1);
+  CHECK(written.samples.empty());
+
+  // Came from dist-3 through dist-1, so only load-2 is left, with all of the 9 A
+  powersim::ElectricCurrent around = current({"source-1", "dist-3", "dist-1", "dist-2"});
+  CHECK(relay.relay(around, *conns, written) == 1);
+  CHECK(relay.stats().dropped_loop == 2);
+  CHECK(relay.stats().split_horizon == 1);
+  CHECK(written.samples.size() == 1);
+  if (written.samples.size() == 1) {
+    CHECK(written.samples[0].next_hop() == "load-2");
+    CHECK_NEAR(written.samples[0].amperage(), 9.0, 1e-6);
+  }
+
+  // A device whose only output is where the current came from relays nothing
+  const ConnectionSnapshot dead_end(devices({{"dist-1", DeviceRole::ROLE_DISTRIBUTION}}),
+                                    devices({{"dist-1", DeviceRole::ROLE_DISTRIBUTION}}));
+  powersim::ElectricCurrent back = current({"source-1", "dist-1", "dist-2"});
+  CHECK(relay.relay(back, dead_end, written) == 0);
+  CHECK(relay.stats().no_output == 1);
+  CHECK(written.samples.size() == 1);
+}
+
+// With at most 4 devices in a path, a path of 3 grows to 4 and one of 4 is dropped.
+void hop_limit()
+{
+  const auto conns = ring_conns();
+  CurrentRelay relay("dist-2", 4);
+  Written written;
+
+  powersim::ElectricCurrent three = current({"source-1", "dist-1", "dist-2"});
+  CHECK(relay.relay(three, *conns, written) == 2);
+  CHECK(written.samples.size() == 2 && written.samples[0].power_path().size() == 4);
+
+  powersim::ElectricCurrent four = current({"source-1", "dist-4", "dist-1", "dist-2"});
+  CHECK(relay.relay(four, *conns, written) == 0);
+  CHECK(relay.stats().dropped_hop_limit == 1);
+  CHECK(written.samples.size() == 2);
+}
+
+// Current that isn't for this device, isn't from one of its inputs or has no
+// sender is ignored.
+void ignored()
+{
+  const auto conns = ring_conns();
+  CurrentRelay relay("dist-2");
+  Written written;
+
+  powersim::ElectricCurrent other = current({"source-1", "dist-1", "dist-3"});
+  CHECK(relay.relay(other, *conns, written) == 0);
+  CHECK(relay.stats().received == 0);
+
+  powersim::ElectricCurrent from_load = current({"source-1", "load-2", "dist-2"});
+  CHECK(relay.relay(from_load, *conns, written) == 0);
+  CHECK(relay.stats().dropped_not_input == 1);
+
+  powersim::ElectricCurrent unknown = current({"source-1", "dist-9", "dist-2"});
+  CHECK(relay.relay(unknown, *conns, written) == 0);
+  CHECK(relay.stats().dropped_not_input == 2);
+
+  powersim::ElectricCurrent short_path = current({"dist-2"});
+  CHECK(relay.relay(short_path, *conns, written) == 0);
+  CHECK(relay.stats().received == 2);
+  CHECK(written.samples.empty());
+}
+
+}
+
+int main()
+{
+  relayed();
+  loops();
+  hop_limit();
+  ignored();
+  return failed();
+}
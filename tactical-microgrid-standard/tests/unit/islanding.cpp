@@ -0,0 +1,142 @@
+// Checks the islands IslandingDetector reports as devices of a small topology
+// stop and start, against the islands expected from the topology.
+
+#include "Check.h"
+#include "../bench/Fleet.h"
+
+#include <controller/IslandingDetector.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+using tms::DeviceRole;
+using tms::EnergyStartStopLevel;
+
+std::vector<tms::Identity> sorted(std::vector<tms::Identity> devices)
+{
+  std::sort(devices.begin(), devices.end());
+  return devices;
+}
+
+bool only_change(const std::vector<IslandChange>& changes, IslandChange::Kind kind, const tms::Identity& cause)
+{
+  return changes.size() == 1 && changes[0].kind == kind && changes[0].cause == cause;
+}
+
+// source-1 - dist-1 - dist-2 - dist-3 with load-1 on dist-1 and load-3 on dist-3
+Fleet chain()
+{
+  Fleet fleet;
+  add_device(fleet, "source-1", DeviceRole::ROLE_SOURCE, 10000.0f);
+  add_device(fleet, "dist-1", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "dist-2", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "dist-3", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "load-1", DeviceRole::ROLE_LOAD, 1000.0f);
+  add_device(fleet, "load-3", DeviceRole::ROLE_LOAD, 1000.0f);
+  connect(fleet, "dist-1", "source-1");
+  connect(fleet, "dist-1", "load-1");
+  connect(fleet, "dist-1", "dist-2");
+  connect(fleet, "dist-2", "dist-3");
+  connect(fleet, "dist-3", "load-3");
+  return fleet;
+}
+
+void split_and_merge()
+{
+  const Fleet fleet = chain();
+  IslandingDetector detector;
+  detector.set_topology(fleet.topology, fleet.devices);
+  CHECK(detector.stats().devices == 6);
+  CHECK(detector.stats().islands == 1);
+  Island island = detector.island_of("load-3");
+  CHECK(island.devices.size() == 6);
+  CHECK(island.sources == 1);
+
+  // dist-3 and load-3 break off without a source
+  std::vector<IslandChange> changes = detector.set_levels({{"dist-2", EnergyStartStopLevel::ESSL_OFF}});
+  if (CHECK(only_change(changes, IslandChange::Kind::SPLIT, "dist-2")) && CHECK(changes[0].islands.size() == 1)) {
+    const Island& broken = changes[0].islands[0];
+    CHECK(sorted(broken.devices) == (std::vector<tms::Identity>{"dist-3", "load-3"}));
+    CHECK(!broken.energized());
+  }
+  CHECK(detector.stats().islands == 2);
+  CHECK(detector.island_of("dist-2").devices.empty());
+  CHECK(sorted(detector.island_of("load-1").devices) ==
+        (std::vector<tms::Identity>{"dist-1", "load-1", "source-1"}));
+  CHECK(!detector.island_of("load-3").energized());
+
+  // The island of dist-1 loses its only source
+  changes = detector.set_levels({{"source-1", EnergyStartStopLevel::ESSL_OFF}});
+  if (CHECK(only_change(changes, IslandChange::Kind::DEENERGIZED, "source-1")) &&
+      CHECK(changes[0].islands.size() == 1)) {
+    CHECK(sorted(changes[0].islands[0].devices) == (std::vector<tms::Identity>{"dist-1", "load-1"}));
+  }
+
+  // Starting dist-2 joins the two islands, neither of them energized
+  changes = detector.set_levels({{"dist-2", EnergyStartStopLevel::ESSL_OPERATIONAL}});
+  CHECK(only_change(changes, IslandChange::Kind::MERGED, "dist-2"));
+  CHECK(detector.stats().islands == 1);
+  CHECK(detector.island_of("load-1").devices.size() == 5);
+
+  // Starting the source energizes the whole island
+  changes = detector.set_levels({{"source-1", EnergyStartStopLevel::ESSL_OPERATIONAL}});
+  if (CHECK(only_change(changes, IslandChange::Kind::ENERGIZED, "source-1")) &&
+      CHECK(changes[0].islands.size() == 1)) {
+    CHECK(changes[0].islands[0].devices.size() == 6);
+    CHECK(changes[0].islands[0].sources == 1);
+  }
+
+  // A level that didn't change reports nothing
+  CHECK(detector.set_levels({{"dist-2", EnergyStartStopLevel::ESSL_OPERATIONAL}}).empty());
+}
+
+void ring()
+{
+  // dist-0 to dist-5 in a ring, with source-0 on dist-0
+  Fleet fleet;
+  const size_t dists = 6;
+  add_device(fleet, "source-0", DeviceRole::ROLE_SOURCE, 10000.0f);
+  for (size_t i = 0; i < dists; ++i) {
+    add_device(fleet, dist_id(i), DeviceRole::ROLE_DISTRIBUTION);
+  }
+  connect(fleet, dist_id(0), "source-0");
+  for (size_t i = 0; i < dists; ++i) {
+    connect(fleet, dist_id(i), dist_id((i + 1) % dists));
+  }
+
+  IslandingDetector detector;
+  detector.set_topology(fleet.topology, fleet.devices);
+
+  // The ring stays connected around a stopped device
+  CHECK(detector.set_levels({{dist_id(3), EnergyStartStopLevel::ESSL_OFF}}).empty());
+  CHECK(detector.stats().islands == 1);
+
+  // A second stop cuts the ring in two, and dist-4 and dist-5 are no longer
+  // reached from the source
+  std::vector<IslandChange> changes = detector.set_levels({{dist_id(0), EnergyStartStopLevel::ESSL_OFF}});
+  CHECK(detector.stats().islands == 3);
+  CHECK(detector.island_of(dist_id(1)).devices.size() == 2);
+  CHECK(detector.island_of(dist_id(4)).devices.size() == 2);
+  CHECK(detector.island_of("source-0").devices.size() == 1);
+  if (CHECK(!changes.empty() && changes[0].kind == IslandChange::Kind::SPLIT)) {
+    CHECK(changes[0].islands.size() == 2);
+  }
+
+  // Restarting dist-0 merges them again
+  changes = detector.set_levels({{dist_id(0), EnergyStartStopLevel::ESSL_OPERATIONAL}});
+  CHECK(only_change(changes, IslandChange::Kind::MERGED, dist_id(0)));
+  CHECK(detector.stats().islands == 1);
+  CHECK(detector.island_of(dist_id(4)).energized());
+}
+
+}
+
+int main()
+{
+  split_and_merge();
+  ring();
+  return failed();
+}
@@ -0,0 +1,154 @@
+// Checks the diff update_connections computes between the power connections
+// distributed last and those of a new topology, which is what the controller
+// sends to the power devices.
+
+#include "Check.h"
+
+#include <controller/PowerConnections.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using tms::DeviceRole;
+
+using Neighbors = std::vector<std::pair<tms::Identity, DeviceRole>>;
+
+powersim::PowerConnection connection(const tms::Identity& pd_id, const Neighbors& neighbors)
+{
+  powersim::PowerConnection pc;
+  pc.pd_id(pd_id);
+  for (const auto& neighbor : neighbors) {
+    powersim::ConnectedDevice cd;
+    cd.id(neighbor.first);
+    cd.role(neighbor.second);
+    pc.connected_devices().push_back(cd);
+  }
+  return pc;
+}
+
+powersim::PowerTopology topology(const std::vector<powersim::PowerConnection>& connections)
+{
+  powersim::PowerTopology pt;
+  for (const powersim::PowerConnection& pc : connections) {
+    pt.connections().push_back(pc);
+  }
+  return pt;
+}
+
+std::vector<tms::Identity> changed_ids(const PowerConnectionsDiff& diff)
+{
+  std::vector<tms::Identity> ids;
+  for (const powersim::PowerConnection& pc : diff.changed) {
+    ids.push_back(pc.pd_id());
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+std::vector<tms::Identity> removed_ids(const PowerConnectionsDiff& diff)
+{
+  std::vector<tms::Identity> ids = diff.removed;
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+const powersim::PowerConnection source_1 = connection("source-1", {{"dist-1", DeviceRole::ROLE_DISTRIBUTION}});
+const powersim::PowerConnection dist_1 = connection("dist-1", {{"source-1", DeviceRole::ROLE_SOURCE},
+                                                               {"load-1", DeviceRole::ROLE_LOAD}});
+const powersim::PowerConnection load_1 = connection("load-1", {{"dist-1", DeviceRole::ROLE_DISTRIBUTION}});
+
+// source-1 - dist-1 - load-1 is distributed whole the first time, and not at
+// all when it's distributed again, in any order.
+void unchanged()
+{
+  PowerConnections current;
+  PowerConnectionsDiff diff = update_connections(current, topology({source_1, dist_1, load_1}));
+  CHECK(changed_ids(diff) == std::vector<tms::Identity>({"dist-1", "load-1", "source-1"}));
+  CHECK(diff.removed.empty());
+  CHECK(current.size() == 3);
+  CHECK(current.at("dist-1").size() == 2);
+
+  diff = update_connections(current, topology({source_1, dist_1, load_1}));
+  CHECK(diff.empty());
+
+  diff = update_connections(current, topology({load_1, source_1, dist_1}));
+  CHECK(diff.empty());
+  CHECK(current.size() == 3);
+}
+
+// Only the devices whose own connections differ are sent again: a new
+// neighbor, a neighbor with another role, or the same neighbors in another
+// order, since that is what the device is sent.
+void changed()
+{
+  PowerConnections current;
+  update_connections(current, topology({source_1, dist_1, load_1}));
+
+  const powersim::PowerConnection dist_1_load_2 =
+    connection("dist-1", {{"source-1", DeviceRole::ROLE_SOURCE}, {"load-1", DeviceRole::ROLE_LOAD},
+                          {"load-2", DeviceRole::ROLE_LOAD}});
+  const powersim::PowerConnection load_2 = connection("load-2", {{"dist-1", DeviceRole::ROLE_DISTRIBUTION}});
+  PowerConnectionsDiff diff = update_connections(current, topology({source_1, dist_1_load_2, load_1, load_2}));
+  CHECK(changed_ids(diff) == std::vector<tms::Identity>({"dist-1", "load-2"}));
+  CHECK(diff.removed.empty());
+  CHECK(current.at("dist-1").size() == 3);
+
+  // The changed connections are sent whole
+  CHECK(diff.changed.size() == 2);
+  for (const powersim::PowerConnection& pc : diff.changed) {
+    if (pc.pd_id() == "dist-1") {
+      CHECK(pc.connected_devices().size() == 3);
+      CHECK(pc.connected_devices()[2].id() == "load-2");
+    }
+  }
+
+  const powersim::PowerConnection load_1_as_source = connection("load-1", {{"dist-1", DeviceRole::ROLE_SOURCE}});
+  diff = update_connections(current, topology({source_1, dist_1_load_2, load_1_as_source, load_2}));
+  CHECK(changed_ids(diff) == std::vector<tms::Identity>({"load-1"}));
+
+  const powersim::PowerConnection dist_1_reordered =
+    connection("dist-1", {{"load-2", DeviceRole::ROLE_LOAD}, {"source-1", DeviceRole::ROLE_SOURCE},
+                          {"load-1", DeviceRole::ROLE_LOAD}});
+  diff = update_connections(current, topology({source_1, dist_1_reordered, load_1_as_source, load_2}));
+  CHECK(changed_ids(diff) == std::vector<tms::Identity>({"dist-1"}));
+  CHECK(diff.removed.empty());
+}
+
+// Devices left out of the new topology are removed, and the devices that were
+// connected to them change.
+void removed()
+{
+  PowerConnections current;
+  update_connections(current, topology({source_1, dist_1, load_1}));
+
+  const powersim::PowerConnection dist_1_alone = connection("dist-1", {{"source-1", DeviceRole::ROLE_SOURCE}});
+  PowerConnectionsDiff diff = update_connections(current, topology({source_1, dist_1_alone}));
+  CHECK(changed_ids(diff) == std::vector<tms::Identity>({"dist-1"}));
+  CHECK(removed_ids(diff) == std::vector<tms::Identity>({"load-1"}));
+  CHECK(current.size() == 2);
+  CHECK(current.count("load-1") == 0);
+
+  diff = update_connections(current, topology({}));
+  CHECK(diff.changed.empty());
+  CHECK(removed_ids(diff) == std::vector<tms::Identity>({"dist-1", "source-1"}));
+  CHECK(current.empty());
+
+  // Back from nothing, everything is new again
+  diff = update_connections(current, topology({source_1, dist_1, load_1}));
+  CHECK(diff.changed.size() == 3);
+  CHECK(diff.removed.empty());
+}
+
+}
+
+int main()
+{
+  unchanged();
+  changed();
+  removed();
+  return failed();
+}
@@ -0,0 +1,268 @@
+// Checks SparseLdl against known solutions and PowerFlowSolver on a small
+// topology whose flows follow from the ratings of its loads and sources.
+
+#include "Check.h"
+#include "../bench/Fleet.h"
+
+#include <controller/PowerFlowSolver.h>
+#include <controller/SparseLdl.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Dense = std::vector<std::vector<double>>;
+
+// Both triangles of a dense symmetric matrix in compressed sparse column form
+SparseLdl::Matrix to_sparse(const Dense& dense)
+{
+  SparseLdl::Matrix a;
+  a.n = dense.size();
+  a.col_start.push_back(0);
+  for (size_t j = 0; j < a.n; ++j) {
+    for (size_t i = 0; i < a.n; ++i) {
+      if (dense[i][j] != 0.0) {
+        a.row.push_back(i);
+        a.value.push_back(dense[i][j]);
+      }
+    }
+    a.col_start.push_back(a.row.size());
+  }
+  return a;
+}
+
+std::vector<double> multiply(const Dense& dense, const std::vector<double>& x)
+{
+  std::vector<double> b(x.size(), 0.0);
+  for (size_t i = 0; i < x.size(); ++i) {
+    for (size_t j = 0; j < x.size(); ++j) {
+      b[i] += dense[i][j] * x[j];
+    }
+  }
+  return b;
+}
+
+void tridiagonal()
+{
+  const Dense dense = {{4, -1, 0}, {-1, 4, -1}, {0, -1, 4}};
+  const SparseLdl::Matrix a = to_sparse(dense);
+  SparseLdl ldl;
+  ldl.analyze(a);
+  CHECK(ldl.size() == 3);
+  if (!CHECK(ldl.factor(a))) {
+    return;
+  }
+  std::vector<double> x = {2, 4, 10};
+  ldl.solve(x);
+  CHECK_NEAR(x[0], 1.0, 1e-12);
+  CHECK_NEAR(x[1], 2.0, 1e-12);
+  CHECK_NEAR(x[2], 3.0, 1e-12);
+}
+
+// A ring with random chords and a diagonal that dominates, like the reduced
+// susceptance matrix of a meshed topology
+void random_mesh()
+{
+  const size_t n = 200;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> pick(0, n - 1);
+  Dense dense(n, std::vector<double>(n, 0.0));
+  auto branch = [&dense](size_t i, size_t j) {
+    if (i != j && dense[i][j] == 0.0) {
+      dense[i][j] = dense[j][i] = -1.0;
+      dense[i][i] += 1.0;
+      dense[j][j] += 1.0;
+    }
+  };
+  for (size_t i = 0; i < n; ++i) {
+    branch(i, (i + 1) % n);
+    if (i % 10 == 0) {
+      branch(i, pick(rng));
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    dense[i][i] += 0.5;
+  }
+
+  const SparseLdl::Matrix a = to_sparse(dense);
+  std::vector<size_t> order = SparseLdl::minimum_degree_order(a);
+  std::sort(order.begin(), order.end());
+  bool permutation = order.size() == n;
+  for (size_t i = 0; permutation && i < n; ++i) {
+    permutation = order[i] == i;
+  }
+  CHECK(permutation);
+
+  std::uniform_real_distribution<double> value(-1.0, 1.0);
+  std::vector<double> expected(n);
+  for (double& v : expected) {
+    v = value(rng);
+  }
+
+  SparseLdl ldl;
+  ldl.analyze(a);
+  if (!CHECK(ldl.factor(a))) {
+    return;
+  }
+  std::vector<double> x = multiply(dense, expected);
+  ldl.solve(x);
+  double error = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    error = std::max(error, std::fabs(x[i] - expected[i]));
+  }
+  CHECK_NEAR(error, 0.0, 1e-9);
+
+  // Same pattern, new values: only factor() is repeated
+  SparseLdl::Matrix doubled = a;
+  for (double& v : doubled.value) {
+    v *= 2.0;
+  }
+  if (!CHECK(ldl.factor(doubled))) {
+    return;
+  }
+  x = multiply(dense, expected);
+  ldl.solve(x);
+  CHECK_NEAR(x[0], expected[0] / 2, 1e-9);
+  CHECK_NEAR(x[n - 1], expected[n - 1] / 2, 1e-9);
+}
+
+void singular()
+{
+  // The susceptance matrix of an island without removing its reference bus
+  const SparseLdl::Matrix a = to_sparse({{1, -1, 0}, {-1, 2, -1}, {0, -1, 1}});
+  SparseLdl ldl;
+  ldl.analyze(a);
+  CHECK(!ldl.factor(a));
+}
+
+const powersim::PowerFlow* find(const PowerFlowUpdate& update, const tms::Identity& id)
+{
+  for (const powersim::PowerFlow& pf : update.changed) {
+    if (pf.pd_id() == id) {
+      return &pf;
+    }
+  }
+  return nullptr;
+}
+
+double flow_to(const powersim::PowerFlow& pf, const tms::Identity& to)
+{
+  for (const powersim::BranchFlow& flow : pf.flows()) {
+    if (flow.to() == to) {
+      return flow.power();
+    }
+  }
+  return 0.0;
+}
+
+// Power out of a bus through its branches must equal its injection
+void check_balance(const PowerFlowUpdate& update)
+{
+  for (const powersim::PowerFlow& pf : update.changed) {
+    double out = 0.0;
+    for (const powersim::BranchFlow& flow : pf.flows()) {
+      out += flow.power();
+    }
+    CHECK_NEAR(out, pf.injection(), 1e-3);
+  }
+}
+
+// source-1 (10 kW) and load-1 (1 kW) on dist-1, source-2 (5 kW) and load-2 (5 kW)
+// on dist-2, and dist-1 connected to dist-2
+Fleet two_feeders()
+{
+  using tms::DeviceRole;
+  Fleet fleet;
+  add_device(fleet, "dist-1", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "dist-2", DeviceRole::ROLE_DISTRIBUTION);
+  add_device(fleet, "source-1", DeviceRole::ROLE_SOURCE, 10000.0f);
+  add_device(fleet, "source-2", DeviceRole::ROLE_SOURCE, 5000.0f);
+  add_device(fleet, "load-1", DeviceRole::ROLE_LOAD, 1000.0f);
+  add_device(fleet, "load-2", DeviceRole::ROLE_LOAD, 5000.0f);
+  connect(fleet, "dist-1", "source-1");
+  connect(fleet, "dist-1", "load-1");
+  connect(fleet, "dist-1", "dist-2");
+  connect(fleet, "dist-2", "dist-1");
+  connect(fleet, "dist-2", "source-2");
+  connect(fleet, "dist-2", "load-2");
+  return fleet;
+}
+
+void power_flow()
+{
+  const tms::Identity mc_id = "mc-1";
+  Fleet fleet = two_feeders();
+  PowerFlowSolver solver;
+  solver.set_topology(fleet.topology, fleet.devices);
+
+  // The 6 kW of demand is shared 2:1 by the sources
+  PowerFlowUpdate update = solver.solve(mc_id);
+  CHECK(update.changed.size() == 6);
+  CHECK(update.removed.empty());
+  check_balance(update);
+  const powersim::PowerFlow* source1 = find(update, "source-1");
+  const powersim::PowerFlow* source2 = find(update, "source-2");
+  const powersim::PowerFlow* load2 = find(update, "load-2");
+  const powersim::PowerFlow* dist1 = find(update, "dist-1");
+  if (!CHECK(source1 && source2 && load2 && dist1)) {
+    return;
+  }
+  CHECK(source1->mc_id() == mc_id);
+  CHECK(source1->energized() && load2->energized());
+  CHECK_NEAR(source1->injection(), 4000.0, 1e-3);
+  CHECK_NEAR(source2->injection(), 2000.0, 1e-3);
+  CHECK_NEAR(load2->injection(), -5000.0, 1e-3);
+  CHECK_NEAR(flow_to(*dist1, "dist-2"), 3000.0, 1e-3);
+  CHECK(solver.stats().islands == 1);
+  CHECK(solver.stats().factorizations == 1);
+
+  // Nothing changed
+  CHECK(solver.solve(mc_id).empty());
+
+  // Stopping a load only changes the injections
+  solver.set_levels({{"load-2", tms::EnergyStartStopLevel::ESSL_OFF}});
+  update = solver.solve(mc_id);
+  check_balance(update);
+  source1 = find(update, "source-1");
+  if (CHECK(source1)) {
+    CHECK_NEAR(source1->injection(), 1000.0 * 2 / 3, 1e-3);
+  }
+  CHECK(solver.stats().factorizations == 1);
+  solver.set_levels({{"load-2", tms::EnergyStartStopLevel::ESSL_OPERATIONAL}});
+  solver.solve(mc_id);
+
+  // Stopping dist-2 opens its branches, which leaves load-2 without a source
+  solver.set_levels({{"dist-2", tms::EnergyStartStopLevel::ESSL_OFF}});
+  update = solver.solve(mc_id);
+  check_balance(update);
+  CHECK(solver.stats().factorizations == 2);
+  load2 = find(update, "load-2");
+  source1 = find(update, "source-1");
+  if (CHECK(load2 && source1)) {
+    CHECK(!load2->energized());
+    CHECK_NEAR(load2->injection(), 0.0, 1e-9);
+    CHECK_NEAR(source1->injection(), 1000.0, 1e-3);
+  }
+  CHECK(solver.stats().islands == 4);
+
+  // Devices no longer in the topology are reported as removed
+  fleet = two_feeders();
+  fleet.topology.connections().pop_back();
+  fleet.devices.erase("load-2");
+  solver.set_topology(fleet.topology, fleet.devices);
+  update = solver.solve(mc_id);
+  CHECK(update.removed.size() == 1 && update.removed[0] == "load-2");
+}
+
+}
+
+int main()
+{
+  tridiagonal();
+  random_mesh();
+  singular();
+  power_flow();
+  return failed();
+}
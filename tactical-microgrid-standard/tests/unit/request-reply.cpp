@@ -0,0 +1,238 @@
+// Unit tests of RequestReplyEngine: replies complete the request with the same
+// target and sequence number and nothing else, requests are sent again after
+// their timeout and expire after the last retry, and round-trip times are kept
+// per target.
+
+#include "Check.h"
+
+#include <common/RequestReplyEngine.h>
+
+#include <thread>
+
+namespace {
+
+using tms::EnergyStartStopRequest;
+using Engine = RequestReplyEngine<EnergyStartStopRequest>;
+
+// Writes nothing, but keeps what would have been written
+struct Sent {
+  std::vector<EnergyStartStopRequest> requests;
+  DDS::ReturnCode_t rc = DDS::RETCODE_OK;
+
+  Engine::SendFn fn()
+  {
+    return [this](const EnergyStartStopRequest& req) {
+      requests.push_back(req);
+      return rc;
+    };
+  }
+};
+
+EnergyStartStopRequest request(const tms::Identity& target)
+{
+  EnergyStartStopRequest req;
+  req.requestId().targetDeviceId(target);
+  req.toLevel(tms::EnergyStartStopLevel::ESSL_OPERATIONAL);
+  return req;
+}
+
+tms::Reply reply(const tms::Identity& target, tms::RequestSequence seq)
+{
+  tms::Reply reply;
+  reply.targetDeviceId(target);
+  reply.requestSequenceId(seq);
+  reply.status().code(tms::ReplyCode::REPLY_OK);
+  return reply;
+}
+
+// Run the sweep timer of the engine for a while
+void run_for(Engine& engine, Sec duration)
+{
+  const TimePoint end = Clock::now() + std::chrono::duration_cast<Clock::duration>(duration);
+  for (TimePoint now = Clock::now(); now < end; now = Clock::now()) {
+    ACE_Time_Value wait = to_time_value(end - now);
+    engine.get_reactor()->handle_events(wait);
+  }
+}
+
+Engine::Config config()
+{
+  Engine::Config config;
+  config.first_sequence = 10;
+  config.timeout = Sec(0.1);
+  config.sweep_period = Sec(0.01);
+  return config;
+}
+
+// Requests to a and b get 10, 11 and 12. A reply only completes the request
+// with both its target and its sequence number, and only once.
+void correlation()
+{
+  Sent sent;
+  Engine engine(sent.fn(), nullptr, config());
+
+  std::vector<Engine::Result> results;
+  const auto keep = [&](const Engine::Result& result) { results.push_back(result); };
+  CHECK(engine.send(request("load-a"), keep) == DDS::RETCODE_OK);
+  CHECK(engine.send(request("load-b"), keep) == DDS::RETCODE_OK);
+  CHECK(engine.send(request("load-a"), keep) == DDS::RETCODE_OK);
+  CHECK(sent.requests.size() == 3);
+  CHECK(sent.requests[0].sequenceId() == 10);
+  CHECK(sent.requests[1].sequenceId() == 11);
+  CHECK(sent.requests[2].sequenceId() == 12);
+  CHECK(engine.pending() == 3);
+
+  // The sequence number of b's request, but from a
+  CHECK(!engine.receive_reply(reply("load-a", 11)));
+  CHECK(!engine.receive_reply(reply("load-a", 99)));
+  CHECK(!engine.receive_reply(reply("load-c", 10)));
+  CHECK(results.empty());
+
+  CHECK(engine.receive_reply(reply("load-a", 12)));
+  CHECK(results.size() == 1);
+  CHECK(results.back().outcome == Engine::Outcome::REPLIED);
+  CHECK(results.back().target == "load-a");
+  CHECK(results.back().sequence_id == 12);
+  CHECK(results.back().attempts == 1);
+  CHECK(results.back().reply && results.back().reply->requestSequenceId() == 12);
+  CHECK(engine.pending() == 2);
+
+  // Duplicate
+  CHECK(!engine.receive_reply(reply("load-a", 12)));
+  CHECK(results.size() == 1);
+
+  CHECK(engine.receive_reply(reply("load-b", 11)));
+  CHECK(engine.receive_reply(reply("load-a", 10)));
+  CHECK(results.size() == 3);
+  CHECK(results[1].target == "load-b" && results[1].sequence_id == 11);
+  CHECK(results[2].target == "load-a" && results[2].sequence_id == 10);
+  CHECK(engine.pending() == 0);
+  CHECK(engine.retry_count() == 0);
+  CHECK(engine.expired_count() == 0);
+}
+
+// A failed write completes nothing and isn't pending, and a request beyond
+// max_pending is rejected. Both still use up their sequence number.
+void send_failures()
+{
+  Sent sent;
+  Engine::Config cfg = config();
+  cfg.max_pending = 1;
+  Engine engine(sent.fn(), nullptr, cfg);
+
+  bool called = false;
+  sent.rc = DDS::RETCODE_ERROR;
+  CHECK(engine.send(request("load-a"), [&](const Engine::Result&) { called = true; }) == DDS::RETCODE_ERROR);
+  CHECK(!called);
+  CHECK(engine.pending() == 0);
+
+  std::future<Engine::Result> failed = engine.send_future(request("load-a"));
+  const Engine::Result result = failed.get();
+  CHECK(result.outcome == Engine::Outcome::SEND_FAILED);
+  CHECK(result.sequence_id == 11);
+
+  sent.rc = DDS::RETCODE_OK;
+  CHECK(engine.send(request("load-a")) == DDS::RETCODE_OK);
+  CHECK(engine.send(request("load-b")) == DDS::RETCODE_OUT_OF_RESOURCES);
+  CHECK(sent.requests.size() == 3);
+  CHECK(sent.requests.back().sequenceId() == 12);
+  CHECK(engine.pending() == 1);
+
+  CHECK(!engine.receive_reply(reply("load-b", 13)));
+  CHECK(engine.receive_reply(reply("load-a", 12)));
+}
+
+// With a timeout of 100 ms and one retry, a request without a reply is sent
+// again with the same sequence number after 100 ms and expires after 200 ms.
+// A reply to the first attempt that arrives after the retry still completes it.
+void timeouts()
+{
+  Sent sent;
+  Engine engine(sent.fn(), nullptr, config());
+
+  std::vector<Engine::Result> results;
+  const auto keep = [&](const Engine::Result& result) { results.push_back(result); };
+  engine.send(request("load-a"), keep);
+  engine.send(request("load-b"), keep);
+
+  run_for(engine, Sec(0.05));
+  CHECK(sent.requests.size() == 2);
+  CHECK(engine.retry_count() == 0);
+
+  run_for(engine, Sec(0.1));
+  CHECK(sent.requests.size() == 4);
+  CHECK(engine.retry_count() == 2);
+  CHECK(sent.requests[2].sequenceId() == sent.requests[0].sequenceId());
+  CHECK(sent.requests[3].sequenceId() == sent.requests[1].sequenceId());
+  CHECK(results.empty());
+
+  CHECK(engine.receive_reply(reply("load-b", 11)));
+  CHECK(results.size() == 1);
+  CHECK(results.back().outcome == Engine::Outcome::REPLIED);
+  CHECK(results.back().attempts == 2);
+
+  run_for(engine, Sec(0.15));
+  CHECK(sent.requests.size() == 4);
+  CHECK(results.size() == 2);
+  CHECK(results.back().outcome == Engine::Outcome::EXPIRED);
+  CHECK(results.back().target == "load-a");
+  CHECK(results.back().sequence_id == 10);
+  CHECK(results.back().attempts == 2);
+  CHECK(!results.back().reply);
+  CHECK(engine.expired_count() == 1);
+  CHECK(engine.pending() == 0);
+
+  // Too late
+  CHECK(!engine.receive_reply(reply("load-a", 10)));
+  CHECK(results.size() == 2);
+
+  // Pending requests can be cancelled before they expire
+  engine.send(request("load-c"), keep);
+  engine.cancel_pending();
+  CHECK(results.size() == 3);
+  CHECK(results.back().outcome == Engine::Outcome::CANCELLED);
+  CHECK(results.back().target == "load-c");
+  CHECK(engine.pending() == 0);
+}
+
+// The round trip is the time since the last attempt was sent, and each reply
+// is recorded in the histogram of its target.
+void latency()
+{
+  Sent sent;
+  Engine engine(sent.fn(), nullptr, config());
+
+  std::future<Engine::Result> a = engine.send_future(request("load-a"));
+  std::future<Engine::Result> b = engine.send_future(request("load-b"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK(engine.receive_reply(reply("load-a", 10)));
+  CHECK(engine.receive_reply(reply("load-b", 11)));
+
+  const Engine::Result ra = a.get();
+  CHECK(ra.outcome == Engine::Outcome::REPLIED);
+  CHECK(ra.round_trip >= Sec(0.02));
+  CHECK(ra.round_trip < Sec(0.1));
+  CHECK(b.get().round_trip >= Sec(0.02));
+
+  engine.send(request("load-a"));
+  CHECK(engine.receive_reply(reply("load-a", 12)));
+
+  const Histogram ha = engine.latency("load-a");
+  CHECK(ha.count() == 2);
+  CHECK(ha.max_us() >= 20000);
+  CHECK(ha.min_us() < 20000);
+  CHECK(engine.latency("load-b").count() == 1);
+  CHECK(engine.latency("load-c").count() == 0);
+  CHECK(engine.latencies().size() == 2);
+}
+
+}
+
+int main()
+{
+  correlation();
+  send_failures();
+  timeouts();
+  latency();
+  return failed();
+}
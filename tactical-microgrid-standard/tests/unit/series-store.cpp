@@ -0,0 +1,306 @@
+// Checks that the Codec and the SeriesStore of the historian give back the
+// points they were given, that downsampled buckets start at the start of the
+// query, and that a block cut short before its header was completed is
+// ignored when the store is opened again and overwritten by the next one.
+
+#include "Check.h"
+
+#include <historian/Codec.h>
+#include <historian/SeriesStore.h>
+
+#include <ace/Dirent.h>
+#include <ace/OS_NS_unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+using History::Point;
+using History::Time;
+
+constexpr Time start_time = 1700000000LL * 1000000000;
+constexpr Time period = 1000000; // 1 kHz
+
+void remove_dir(const std::string& dir)
+{
+  ACE_Dirent entries;
+  if (entries.open(ACE_TEXT_CHAR_TO_TCHAR(dir.c_str())) == 0) {
+    for (ACE_DIRENT* entry = entries.read(); entry; entry = entries.read()) {
+      const std::string name = ACE_TEXT_ALWAYS_CHAR(entry->d_name);
+      if (name != "." && name != "..") {
+        ACE_OS::unlink((dir + "/" + name).c_str());
+      }
+    }
+    entries.close();
+  }
+  ACE_OS::rmdir(dir.c_str());
+}
+
+SeriesStore::Config config(const std::string& name)
+{
+  SeriesStore::Config config;
+  config.dir = "series-store-" + name + "-" + std::to_string(ACE_OS::getpid());
+  config.segment_size = 64 * 1024;
+  config.max_segments = 0;
+  config.block_points = 64;
+  remove_dir(config.dir);
+  return config;
+}
+
+bool same_bits(float a, float b)
+{
+  return std::memcmp(&a, &b, sizeof a) == 0;
+}
+
+bool same_points(const std::vector<Point>& a, const std::vector<Point>& b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].time != b[i].time || !same_bits(a[i].value, b[i].value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void codec()
+{
+  for (const uint64_t value : {uint64_t(0), uint64_t(127), uint64_t(128), uint64_t(1) << 63,
+                               std::numeric_limits<uint64_t>::max()}) {
+    std::vector<uint8_t> out;
+    Codec::put_varint(out, value);
+    const uint8_t* pos = out.data();
+    uint64_t decoded;
+    CHECK(Codec::get_varint(pos, out.data() + out.size(), decoded) && decoded == value);
+    CHECK(pos == out.data() + out.size());
+    if (out.size() > 1) {
+      pos = out.data();
+      CHECK(!Codec::get_varint(pos, out.data() + out.size() - 1, decoded));
+    }
+  }
+  for (const int64_t value : {std::numeric_limits<int64_t>::min(), int64_t(-1), int64_t(0), int64_t(1),
+                              std::numeric_limits<int64_t>::max()}) {
+    CHECK(Codec::unzigzag(Codec::zigzag(value)) == value);
+  }
+
+  // Steady times with jitter, a repeat and a gap, and values that repeat,
+  // change a little, change sign and aren't numbers
+  const std::vector<int64_t> times = {start_time, start_time + period, start_time + 2 * period,
+                                      start_time + 3 * period + 7, start_time + 3 * period + 7,
+                                      start_time + 4 * period - 3, start_time + 3600LL * 1000000000};
+  const std::vector<float> values = {120.0f, 120.0f, 120.01f, -0.0f, 0.0f, std::numeric_limits<float>::quiet_NaN(),
+                                     std::numeric_limits<float>::max()};
+  std::vector<uint8_t> time_bytes;
+  std::vector<uint8_t> value_bytes;
+  Codec::TimeEncoder time_encoder(times.front());
+  Codec::ValueEncoder value_encoder;
+  for (size_t i = 0; i < times.size(); ++i) {
+    time_encoder.add(time_bytes, times[i]);
+    value_encoder.add(value_bytes, values[i]);
+  }
+
+  Codec::TimeDecoder time_decoder(times.front());
+  Codec::ValueDecoder value_decoder;
+  const uint8_t* time_pos = time_bytes.data();
+  const uint8_t* value_pos = value_bytes.data();
+  for (size_t i = 0; i < times.size(); ++i) {
+    int64_t time;
+    float value;
+    CHECK(time_decoder.next(time_pos, time_bytes.data() + time_bytes.size(), time) && time == times[i]);
+    CHECK(value_decoder.next(value_pos, value_bytes.data() + value_bytes.size(), value) &&
+          same_bits(value, values[i]));
+  }
+  int64_t time;
+  CHECK(!time_decoder.next(time_pos, time_bytes.data() + time_bytes.size(), time));
+}
+
+void round_trip()
+{
+  const SeriesStore::Config cfg = config("round-trip");
+  std::vector<Point> voltage;
+  std::vector<Point> current;
+  for (size_t i = 0; i < 1000; ++i) {
+    voltage.push_back(Point{start_time + Time(i) * period, 120.0f + (i % 7 == 0 ? 0.5f : 0.0f)});
+    current.push_back(Point{start_time + Time(i) * period + Time(i % 3), 10.0f + std::sin(0.01f * i)});
+  }
+
+  {
+    SeriesStore store(cfg);
+    if (!CHECK(store.open())) {
+      return;
+    }
+    const SeriesStore::SeriesId v = store.series("dev-1/voltage");
+    const SeriesStore::SeriesId c = store.series("dev-1/current");
+    CHECK(store.series("dev-1/voltage") == v);
+    for (size_t i = 0; i < voltage.size(); ++i) {
+      store.append(v, voltage[i].time, voltage[i].value);
+      store.append(c, current[i].time, current[i].value);
+    }
+    // Older than the last point of its series
+    store.append(v, start_time, 1.0f);
+    CHECK(store.stats().dropped == 1);
+
+    // Both the points in blocks and those still in memory
+    CHECK(same_points(store.range(v, History::min_time, History::max_time), voltage));
+    const std::vector<Point> some = store.range(c, start_time + 100 * period, start_time + 200 * period);
+    CHECK(same_points(some, std::vector<Point>(current.begin() + 100, current.begin() + 200)));
+    store.close();
+  }
+
+  SeriesStore store(cfg);
+  if (!CHECK(store.open(true))) {
+    return;
+  }
+  CHECK(store.series_names().size() == 2);
+  SeriesStore::SeriesId c;
+  if (CHECK(store.find("dev-1/current", c))) {
+    CHECK(same_points(store.range(c, History::min_time, History::max_time), current));
+  }
+  CHECK(store.stats().stored_points == 2000);
+  remove_dir(cfg.dir);
+}
+
+void downsample()
+{
+  const SeriesStore::Config cfg = config("downsample");
+  SeriesStore store(cfg);
+  if (!CHECK(store.open())) {
+    return;
+  }
+  const SeriesStore::SeriesId id = store.series("dev-1/power");
+  for (size_t i = 0; i < 1000; ++i) {
+    store.append(id, start_time + Time(i) * period, float(i));
+  }
+  store.flush();
+
+  // Buckets of 100 points starting at the start of the query, not at the first point
+  const Time width = 100 * period;
+  const Time from = start_time - 50 * period;
+  const std::vector<History::Bucket> buckets = store.downsample(id, from, History::max_time, width);
+  if (CHECK(buckets.size() == 11)) {
+    CHECK(buckets[0].time == from);
+    CHECK(buckets[0].count == 50);
+    CHECK(buckets[0].min == 0.0f && buckets[0].max == 49.0f);
+    CHECK(buckets[1].time == from + width);
+    CHECK(buckets[1].count == 100);
+    CHECK_NEAR(buckets[1].mean, 99.5, 1e-3);
+    CHECK(buckets[10].count == 50);
+  }
+
+  // Unbounded queries have buckets at multiples of the width
+  const std::vector<History::Bucket> all = store.downsample(id, History::min_time, History::max_time, width);
+  if (CHECK(all.size() == 10)) {
+    CHECK(all[0].time == start_time);
+    CHECK(all[0].count == 100);
+  }
+  store.close();
+  remove_dir(cfg.dir);
+}
+
+std::vector<char> read_file(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void torn_block()
+{
+  const SeriesStore::Config cfg = config("torn-block");
+  const std::string segment = cfg.dir + "/segment-000001.dat";
+  std::vector<Point> points;
+  for (size_t i = 0; i < 4 * cfg.block_points; ++i) {
+    points.push_back(Point{start_time + Time(i) * period, float(i)});
+  }
+  auto append = [&points](SeriesStore& store, SeriesStore::SeriesId id, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      store.append(id, points[i].time, points[i].value);
+    }
+  };
+
+  // Two complete blocks, then a third one
+  std::vector<char> before;
+  {
+    SeriesStore store(cfg);
+    if (!CHECK(store.open())) {
+      return;
+    }
+    append(store, store.series("dev-1/power"), 0, 2 * cfg.block_points);
+    store.close();
+  }
+  before = read_file(segment);
+  {
+    SeriesStore store(cfg);
+    if (!CHECK(store.open())) {
+      return;
+    }
+    append(store, store.series("dev-1/power"), 2 * cfg.block_points, 3 * cfg.block_points);
+    store.close();
+  }
+
+  // Clear the magic number of the third block, as if the process died before
+  // completing its header. The block starts at the first byte that changed.
+  std::vector<char> after = read_file(segment);
+  if (!CHECK(before.size() == after.size())) {
+    return;
+  }
+  size_t offset = 0;
+  while (offset < after.size() && before[offset] == after[offset]) {
+    ++offset;
+  }
+  if (!CHECK(offset + sizeof(uint32_t) <= after.size())) {
+    return;
+  }
+  {
+    std::fstream file(segment, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(offset));
+    const uint32_t zero = 0;
+    file.write(reinterpret_cast<const char*>(&zero), sizeof zero);
+  }
+
+  {
+    SeriesStore store(cfg);
+    SeriesStore::SeriesId id;
+    if (CHECK(store.open(true)) && CHECK(store.find("dev-1/power", id))) {
+      const std::vector<Point> read = store.range(id, History::min_time, History::max_time);
+      CHECK(same_points(read, std::vector<Point>(points.begin(), points.begin() + 2 * cfg.block_points)));
+    }
+  }
+
+  // The next block takes the place of the torn one
+  {
+    SeriesStore store(cfg);
+    if (!CHECK(store.open())) {
+      return;
+    }
+    append(store, store.series("dev-1/power"), 3 * cfg.block_points, 4 * cfg.block_points);
+    store.close();
+  }
+  SeriesStore store(cfg);
+  SeriesStore::SeriesId id;
+  if (CHECK(store.open(true)) && CHECK(store.find("dev-1/power", id))) {
+    std::vector<Point> expected(points.begin(), points.begin() + 2 * cfg.block_points);
+    expected.insert(expected.end(), points.begin() + 3 * cfg.block_points, points.end());
+    CHECK(same_points(store.range(id, History::min_time, History::max_time), expected));
+    CHECK(store.stats().blocks == 3);
+  }
+  remove_dir(cfg.dir);
+}
+
+}
+
+int main()
+{
+  codec();
+  round_trip();
+  downsample();
+  torn_block();
+  return failed();
+}
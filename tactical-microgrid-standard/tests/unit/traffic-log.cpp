@@ -0,0 +1,213 @@
+// Checks that a TrafficLog reads back the topics, devices and samples that
+// were written, that seek starts early enough for every sample from a time on
+// while skipping the start of the log, and that a record cut short is ignored.
+
+#include "Check.h"
+
+#include <recorder/TrafficLog.h>
+
+#include <ace/OS_NS_unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr TrafficLog::Time start_time = 1700000000LL * 1000000000;
+constexpr TrafficLog::Time period = 1000000; // 1 kHz
+
+struct Written {
+  uint16_t topic;
+  uint16_t device;
+  uint8_t message_id;
+  uint8_t flags;
+  TrafficLog::Time time;
+  std::string payload;
+};
+
+std::string log_path(const char* name)
+{
+  const std::string path = std::string("traffic-log-") + name + "-" + std::to_string(ACE_OS::getpid()) + ".log";
+  ACE_OS::unlink(path.c_str());
+  return path;
+}
+
+void write(TrafficLog::Writer& log, const Written& w)
+{
+  ACE_Message_Block payload(w.payload.size() + 1);
+  for (const char c : w.payload) {
+    *payload.wr_ptr() = c;
+    payload.wr_ptr(1);
+  }
+  log.write(w.topic, w.device, w.message_id, w.flags, w.time, &payload);
+}
+
+bool matches(const TrafficLog::Sample& sample, const Written& w)
+{
+  const TrafficLog::RecordHeader& h = *sample.header;
+  return h.topic == w.topic && h.device == w.device && h.message_id == w.message_id && h.flags == w.flags &&
+    h.time == w.time && std::string(sample.payload, h.size) == w.payload;
+}
+
+void round_trip()
+{
+  const std::string path = log_path("round-trip");
+  TrafficLog::Topic tms_topic;
+  tms_topic.name = "EnergyStartStopRequest";
+  tms_topic.type_name = "tms::EnergyStartStopRequest";
+  TrafficLog::Topic sim_topic;
+  sim_topic.domain = TrafficLog::Domain::Sim;
+  sim_topic.name = "PowerTopology";
+  sim_topic.type_name = "powersim::PowerTopology";
+  sim_topic.has_keys = false;
+  sim_topic.reliability = 1;
+  sim_topic.durability = 1;
+  sim_topic.ownership = 1;
+
+  std::vector<Written> written;
+  {
+    TrafficLog::Writer log;
+    if (!CHECK(log.open(path))) {
+      return;
+    }
+    TrafficLog::Writer other;
+    CHECK(!other.open(path));
+
+    const uint16_t tms = log.topic(tms_topic);
+    const uint16_t sim = log.topic(sim_topic);
+    CHECK(log.topic(tms_topic) == tms);
+    const uint16_t load = log.device("load-1");
+    CHECK(log.device("load-1") == load);
+    CHECK(log.device("") == TrafficLog::no_device);
+
+    written.push_back(Written{tms, load, 0, TrafficLog::BYTE_ORDER_FLAG, start_time, "request"});
+    written.push_back(Written{sim, TrafficLog::no_device, 0, 0, start_time + period, std::string(300, 'x')});
+    written.push_back(Written{tms, load, 5, TrafficLog::KEY_FIELDS_ONLY_FLAG, start_time + 2 * period, "key"});
+    written.push_back(Written{tms, load, 0, 0, start_time + 3 * period, ""});
+    for (const Written& w : written) {
+      write(log, w);
+    }
+    CHECK(log.stats().samples == written.size());
+    CHECK(log.stats().topics == 2);
+    CHECK(log.stats().devices == 1);
+  }
+
+  {
+    TrafficLog::Reader log;
+    if (!CHECK(log.open(path))) {
+      return;
+    }
+    if (CHECK(log.topics().size() == 2)) {
+      const TrafficLog::Topic& sim = log.topics()[1];
+      CHECK(log.topics()[0].name == tms_topic.name && log.topics()[0].domain == TrafficLog::Domain::Tms);
+      CHECK(sim.domain == TrafficLog::Domain::Sim && sim.name == sim_topic.name && sim.type_name == sim_topic.type_name);
+      CHECK(!sim.has_keys && sim.reliability == 1 && sim.durability == 1 && sim.ownership == 1);
+    }
+    CHECK(log.devices() == std::vector<std::string>{"load-1"});
+    CHECK(log.samples() == written.size());
+    CHECK(log.topic_samples() == (std::vector<uint64_t>{3, 1}));
+    CHECK(log.first_time() == start_time);
+    CHECK(log.last_time() == start_time + 3 * period);
+
+    size_t i = 0;
+    TrafficLog::Sample sample;
+    for (size_t offset = TrafficLog::Reader::begin(); log.next(offset, sample); ++i) {
+      CHECK(i < written.size() && matches(sample, written[i]));
+    }
+    CHECK(i == written.size());
+  }
+  ACE_OS::unlink(path.c_str());
+}
+
+void seek_and_cut_short()
+{
+  const std::string path = log_path("seek");
+  const size_t samples = 10 * TrafficLog::Reader::index_interval;
+  std::vector<Written> written;
+  {
+    TrafficLog::Writer log;
+    if (!CHECK(log.open(path))) {
+      return;
+    }
+    TrafficLog::Topic topic;
+    topic.name = "Heartbeat";
+    topic.type_name = "tms::Heartbeat";
+    const uint16_t t = log.topic(topic);
+    const uint16_t d = log.device("source-1");
+
+    // Every seventh sample is a little late, as when writers are out of step
+    for (size_t s = 0; s < samples; ++s) {
+      const TrafficLog::Time time = start_time + TrafficLog::Time(s) * period - (s % 7 == 0 ? 3 * period : 0);
+      written.push_back(Written{t, d, 0, 0, time, std::to_string(s)});
+      write(log, written.back());
+    }
+  }
+
+  {
+    TrafficLog::Reader log;
+    if (!CHECK(log.open(path))) {
+      return;
+    }
+    for (const size_t from_sample : {size_t(0), size_t(1), samples / 3, samples / 2 + 1, samples - 1, samples + 10}) {
+      const TrafficLog::Time from = start_time + TrafficLog::Time(from_sample) * period;
+      size_t expected = 0;
+      for (const Written& w : written) {
+        expected += w.time >= from;
+      }
+
+      const size_t start = log.seek(from);
+      size_t found = 0;
+      TrafficLog::Sample sample;
+      for (size_t offset = start; log.next(offset, sample);) {
+        found += sample.header->time >= from;
+      }
+      CHECK(found == expected);
+      if (from_sample >= samples / 3) {
+        CHECK(start > TrafficLog::Reader::begin());
+      }
+    }
+
+    // Before every sample, all of them are read
+    size_t read = 0;
+    TrafficLog::Sample sample;
+    for (size_t offset = log.seek(start_time - 4 * period); log.next(offset, sample); ++read) {
+    }
+    CHECK(read == samples);
+  }
+
+  // Drop the last byte, as if the recorder died while writing the last sample
+  std::vector<char> bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  ACE_OS::unlink(path.c_str());
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 1));
+  }
+  {
+    TrafficLog::Reader cut;
+    if (CHECK(cut.open(path))) {
+      CHECK(cut.samples() == samples - 1);
+      size_t read = 0;
+      TrafficLog::Sample sample;
+      for (size_t offset = TrafficLog::Reader::begin(); cut.next(offset, sample); ++read) {
+        CHECK(read < written.size() && matches(sample, written[read]));
+      }
+      CHECK(read == samples - 1);
+    }
+  }
+  ACE_OS::unlink(path.c_str());
+}
+
+}
+
+int main()
+{
+  round_trip();
+  seek_and_cut_short();
+  return failed();
+}